@@ -2,11 +2,75 @@
  * LoRa Receiver with AES-128 Decryption
  *
  * This program receives encrypted messages via LoRa radio communication
- * and decrypts them using AES-128 encryption. The decrypted messages
- * along with signal quality metrics are output as JSON format.
+ * and decrypts them using AES-128 in CCM mode (see arduino/lora_comm.h).
+ * Packets with a bad MIC or an old packet counter are rejected, so
+ * tampered, forged and replayed packets never reach the output. Each
+ * node's counter is tracked across restarts through a high-water mark in
+ * NVS (see StoredNode). The
+ * decrypted messages along with signal quality metrics are output as
+ * JSON format.
+ *
+ * Accepted payload formats:
+ * - Binary telemetry frames (see arduino/telemetry.h), decoded back into
+ *   the "Temp:..|pH:..|TDS:..|ORP:.." message text
+ * - Batch frames carrying several buffered readings; each reading is
+ *   output as its own JSON line with its age in seconds
+ * - Delta frames carrying readings as differences from the node's last
+ *   acknowledged single or batch frame (its keyframe), rebuilt here into
+ *   full readings
+ * - Path frames (georeferenced track points) and obstacle frames, output
+ *   with positions in millionths of a degree
+ * - Energy budget frames and performance statistics frames (one JSON
+ *   line per timed code path)
+ * - Config frames reporting a node's settings and answering commands
+ * - Plain ASCII messages
+ *
+ * Binary frames are answered with an encrypted link hint carrying the
+ * spreading factor and coding rate the node should use next, chosen from
+ * the measured SNR (adaptive data rate, see arduino/adr.h). Frames of
+ * readings are always answered, the hint is their acknowledgement; other
+ * frames only when the data rate changes or a command is waiting, since
+ * the half-duplex radio hears nothing while it transmits. Built with
+ * MULTI_NODE, as a gateway for many nodes, the radio stays on the default
+ * data rate and every hint announces it, so one node's link never retunes
+ * the radio away from the others.
+ *
+ * Remote configuration: commands typed on the serial console are queued
+ * per node and ride on the link hints to it until the node answers with
+ * a config frame (see arduino/config.h). Values are in the node's units
+ * (milliseconds, 0.01 degC, 0.01 pH, 0.1 ppm, mV, dBm):
+ * - "SET,<node>,<param>,<value>" - param is SAMPLE, RECORD, REPORT,
+ *   HEARTBEAT, DUTY, TEMP_DB, PH_DB, TDS_DB, ORP_DB, ADR or TX_POWER
+ * - "CAL,<node>,PH|TDS|ORP,<value>" - add a calibration point at the
+ *   probe's current reading, "CAL,<node>,PH|TDS|ORP,CLEAR" to clear it
+ * - "RESET,<node>" - return the node's settings to its defaults
+ * - "ROTATE,<node>,<32 hex digits>" - send the node a new AES key
+ * - "KEY,<node>,<32 hex digits>" - set the key this receiver expects from
+ *   the node, also for a node not heard yet, e.g. one flashed with its
+ *   own key
+ * Every node starts with the factory key below. During a rotation the
+ * node's packets are checked against both keys, and the new key replaces
+ * the old one with the first packet sealed with it. Keys set by KEY or
+ * ROTATE are kept in NVS and restored at start, so a restarted receiver
+ * still accepts a node with a rotated key.
+ * Bootstrap limitation: the new key travels sealed under the node's
+ * current key, which for a first rotation is the factory key published
+ * with this source. Anyone who records that downlink learns the new key,
+ * so run the first rotation where nobody can listen, or flash each node
+ * with its own key and set it here with KEY.
+ *
+ * Gateway mode: the DIO0 interrupt only notes that a packet arrived.
+ * loop() copies it out of the radio into a receive queue, also between
+ * the readings of a long batch, so a packet arriving while an earlier one
+ * is being decrypted or printed is not lost. loop() drains the queue, keeps
+ * per-node state (packet counter, loss, RSSI/SNR history) and prints one
+ * compact JSON line per reading at 115200 baud, plus a statistics line
+ * per node every STATS_INTERVAL. Built with BINARY_OUTPUT, the same events
+ * leave as compact SLIP-framed binary records with a CRC instead.
  *
  * Hardware Requirements:
- * - Arduino compatible board (ESP32, Arduino Uno, etc.)
+ * - ESP32-class board: the receive queue and node table need more RAM
+ *   than an AVR (Arduino Uno, etc.) has
  * - LoRa module (SX1276/SX1278 based)
  * - Proper wiring for SPI communication
  *
@@ -21,6 +85,7 @@
 #include <Crypto.h>       // Cryptographic functions base library
 #include <AES.h>          // AES encryption/decryption implementation
 #include <ArduinoJson.h>  // JSON serialization for structured output
+#include <Preferences.h>  // ESP32 NVS, keeps node keys across restarts
 
 // Initialize AES-128 cipher object
 AES128 aes;
@@ -30,9 +95,1518 @@ AES128 aes;
 // The key must match exactly between transmitter and receiver
 byte key[16] = { 's','e','c','r','e','t','k','e','y','1','2','3','4','5','6','7' };
 
+// Secure packet layout: node id, packet counter, payload, MIC
+// Must match arduino/lora_comm.h and arduino/ccm.h on the sender side
+const int PACKET_HEADER_SIZE = 5;         // Node id and 32-bit packet counter
+const int CCM_MIC_SIZE = 4;               // Truncated CBC-MAC appended to every packet
+const int PACKET_OVERHEAD = PACKET_HEADER_SIZE + CCM_MIC_SIZE;
+const byte CCM_UPLINK = 0x00;             // Direction byte of the nonce for node packets
+const byte CCM_DOWNLINK = 0x01;           // Direction byte of the nonce for our replies
+
+// Binary telemetry frame layout
+// Must match arduino/telemetry.h on the sender side
+const int TELEMETRY_FRAME_SIZE = 12;      // Single reading frame
+const byte FRAME_TYPE_TELEMETRY = 0x01;   // Value of the first byte of a single frame
+const byte FRAME_TYPE_BATCH = 0x02;       // Value of the first byte of a batch frame
+const int BATCH_HEADER_SIZE = 2;          // Type, record count
+const int BATCH_RECORD_SIZE = 11;         // Age, four sensor fields, flags
+const byte FRAME_TYPE_ENERGY = 0x03;      // Value of the first byte of an energy frame
+const byte FRAME_TYPE_DELTA = 0x04;       // Value of the first byte of a delta frame
+const int DELTA_HEADER_SIZE = 4;          // Type, keyframe id, record count
+const int READING_FIELDS = 4;             // Temperature, pH, TDS, ORP
+const byte FRAME_TYPE_PATH = 0x05;        // Value of the first byte of a path frame
+const int PATH_HEADER_SIZE = 10;          // Type, point count, first latitude and longitude
+const byte FRAME_TYPE_OBSTACLE = 0x06;    // Value of the first byte of an obstacle frame
+const int OBSTACLE_FRAME_SIZE = 14;
+const int ENERGY_FIELDS = 6;              // CPU, sleep, radio TX, radio RX, sensors, GPS
+const int ENERGY_FRAME_SIZE = 5 + 4 * ENERGY_FIELDS;
+const byte FRAME_TYPE_PERF = 0x07;        // Value of the first byte of a perf frame
+const int PERF_HEADER_SIZE = 4;           // Type, window length, probe count
+const int PERF_BUCKETS = 8;               // Histogram buckets per probe
+const byte FRAME_TYPE_CONFIG = 0x08;      // Value of the first byte of a config frame
+const int CONFIG_FRAME_SIZE = 35;
+
+// Read a little-endian 16-bit field from a decrypted frame
+uint16_t getU16(const byte* src) {
+  return (uint16_t)src[0] | ((uint16_t)src[1] << 8);
+}
+
+// Read a little-endian 32-bit field from a packet
+uint32_t getU32(const byte* src) {
+  return (uint32_t)getU16(src) | ((uint32_t)getU16(src + 2) << 16);
+}
+
+// Read a varint from a delta frame, advancing 'src' past it
+// Returns false if the frame ends inside the varint
+bool getVarint(const byte*& src, const byte* end, uint32_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 35 && src < end; shift += 7) {
+    byte b = *src++;
+    value |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+// AES-CCM (RFC 3610, 4-byte MIC, 2-byte length field) in place
+// Encrypts ('decrypt' false) or decrypts the payload and writes the MIC
+// of the plaintext to 'mic'; the nonce is direction, node id, counter
+void ccmCrypt(byte direction, byte node, uint32_t counter, byte* data, int len, byte* mic,
+              bool decrypt) {
+  byte nonce[13] = { 0 };
+  nonce[0] = direction;
+  nonce[1] = node;
+  for (int i = 0; i < 4; i++) {
+    nonce[2 + i] = (counter >> (8 * i)) & 0xFF;
+  }
+
+  // B0: flags (M = 4, L = 2), nonce, payload length
+  byte mac[16];
+  mac[0] = ((CCM_MIC_SIZE - 2) / 2) << 3 | 0x01;
+  memcpy(mac + 1, nonce, 13);
+  mac[14] = len >> 8;
+  mac[15] = len & 0xFF;
+  aes.encryptBlock(mac, mac);
+
+  // Counter blocks A_i: flags (L = 2), nonce, block index
+  byte a[16];
+  byte s[16];
+  a[0] = 0x01;
+  memcpy(a + 1, nonce, 13);
+
+  for (int offset = 0; offset < len; offset += 16) {
+    int n = len - offset < 16 ? len - offset : 16;
+    int index = offset / 16 + 1;
+    a[14] = index >> 8;
+    a[15] = index & 0xFF;
+    aes.encryptBlock(s, a);
+
+    // CBC-MAC always runs over the plaintext
+    if (!decrypt) {
+      for (int i = 0; i < n; i++) mac[i] ^= data[offset + i];
+    }
+    for (int i = 0; i < n; i++) data[offset + i] ^= s[i];
+    if (decrypt) {
+      for (int i = 0; i < n; i++) mac[i] ^= data[offset + i];
+    }
+    aes.encryptBlock(mac, mac);
+  }
+
+  a[14] = 0;
+  a[15] = 0;
+  aes.encryptBlock(s, a);
+  for (int i = 0; i < CCM_MIC_SIZE; i++) {
+    mic[i] = mac[i] ^ s[i];
+  }
+}
+
+// Compare a received MIC with the computed one in constant time, so the
+// timing of a rejection does not tell a forger how many bytes were right
+bool micMatches(const byte* mic, const byte* expected) {
+  byte diff = 0;
+  for (int i = 0; i < CCM_MIC_SIZE; i++) {
+    diff |= mic[i] ^ expected[i];
+  }
+  return diff == 0;
+}
+
+// Fixed-size text buffer written with print(), so decoded messages are
+// built without String concatenation or heap allocation
+// Output that does not fit is dropped; the text stays NUL-terminated
+// Same behaviour as BufferWriter in arduino/bufferwriter.h
+class TextBuffer : public Print {
+public:
+  size_t write(uint8_t c) override {
+    if (len + 1 >= sizeof(text)) return 0;
+    text[len++] = c;
+    text[len] = '\0';
+    return 1;
+  }
+  using Print::write;
+
+  void clear() {
+    len = 0;
+    text[0] = '\0';
+  }
+
+  const char* c_str() const { return text; }
+
+private:
+  char text[48] = "";
+  size_t len = 0;
+};
+
+// Serial output format, chosen at compile time
+// BINARY_OUTPUT 0: one JSON line per event, readable in a serial monitor
+// BINARY_OUTPUT 1: SLIP-framed binary events protected by a CRC, about a
+//   third of the bytes on the wire, for gateways forwarding high packet
+//   rates to the host (host/ingest, mizuguna_ingest --framed)
+// VERBOSE_OUTPUT 1 adds diagnostics such as rejected packets and data
+// rate changes; binary output carries them as log events
+#ifndef BINARY_OUTPUT
+#define BINARY_OUTPUT 0
+#endif
+#ifndef VERBOSE_OUTPUT
+#define VERBOSE_OUTPUT 1
+#endif
+
+// Data rate policy, chosen at compile time
+// MULTI_NODE 1: a gateway for many nodes. The SX127x demodulates a single
+//   spreading factor at a time, so the radio stays on LORA_DEFAULT_SF /
+//   LORA_DEFAULT_CR, the rate every node boots with and falls back to,
+//   and link hints always announce it. Hints still acknowledge uplinks
+//   and carry commands
+// MULTI_NODE 0: a link to a single node; ADR moves the radio and the node
+//   together from the measured SNR
+#ifndef MULTI_NODE
+#define MULTI_NODE 1
+#endif
+
+// Interrupt handlers are placed in IRAM on the ESP32; other cores have no
+// such attribute
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// Binary event layout (multi-byte fields are little-endian), must match
+// host/ingest/serial_frames.h:
+//   [0]      event type (EVENT_*)
+//   [1]      node id (0 for gateway events)
+//   [2..5]   packet counter of the uplink the event came from
+//   [6..9]   millis() when the uplink arrived, or when the event was made
+//   [10..11] RSSI, int16, dBm
+//   [12]     SNR, int8, 0.25 dB
+//   [13..]   event body
+//   then     CRC-16/CCITT-FALSE of bytes [0..] up to here, uint16
+// Bodies:
+//   EVENT_READING        packet size u8, age u32 (s), then temperature,
+//                        pH, TDS and ORP in the telemetry frame units
+//                        (int16 0.01 degC, int16 0.01 pH, uint16 0.1 ppm,
+//                        int16 mV)
+//   EVENT_MESSAGE        packet size u8, then the plain text message
+//   EVENT_PATH           latitude, longitude (int32, 1e-6 degrees),
+//                        heading u16 (degrees), age u32 (s)
+//   EVENT_OBSTACLE       bytes [1..13] of the obstacle frame
+//   EVENT_ENERGY         bytes [1..] of the energy frame
+//   EVENT_NODE_STATS     received u32, lost u32, last heard u32 (s); the
+//                        header carries the mean RSSI and SNR
+//   EVENT_GATEWAY_STATS  receive queue overflows u32, missed hints u32
+//   EVENT_LOG            diagnostic text
+//   EVENT_PERF           probe index u8, window u16 (s), then count, min,
+//                        mean and max (u32 each, microseconds for the
+//                        times) and PERF_BUCKETS histogram shares (u8,
+//                        1/255 of the calls)
+//   EVENT_CONFIG         bytes [1..] of the config frame
+// Each frame starts and ends with SLIP_END; SLIP_END and SLIP_ESC inside
+// the frame are sent as two-byte escapes, so a reader that joins mid-
+// stream or meets line noise resynchronises at the next frame
+const byte SLIP_END = 0xC0;
+const byte SLIP_ESC = 0xDB;
+const byte SLIP_ESC_END = 0xDC;
+const byte SLIP_ESC_ESC = 0xDD;
+const byte EVENT_READING = 0x01;
+const byte EVENT_MESSAGE = 0x02;
+const byte EVENT_PATH = 0x03;
+const byte EVENT_OBSTACLE = 0x04;
+const byte EVENT_ENERGY = 0x05;
+const byte EVENT_NODE_STATS = 0x06;
+const byte EVENT_GATEWAY_STATS = 0x07;
+const byte EVENT_LOG = 0x08;
+const byte EVENT_PERF = 0x09;
+const byte EVENT_CONFIG = 0x0A;
+
+// Running CRC of the event being written
+uint16_t eventCrc = 0xFFFF;
+
+// Arrival time and signal quality of the packet being output, stamped on
+// every event it produces
+unsigned long eventReceivedAt = 0;
+int eventRssi = 0;
+float eventSnr = 0;
+
+// Write one byte of a SLIP frame, escaping the framing bytes
+// Frames are streamed straight to the UART, so no frame buffer is needed
+void slipWrite(byte b) {
+  if (b == SLIP_END) {
+    Serial.write(SLIP_ESC);
+    Serial.write(SLIP_ESC_END);
+  } else if (b == SLIP_ESC) {
+    Serial.write(SLIP_ESC);
+    Serial.write(SLIP_ESC_ESC);
+  } else {
+    Serial.write(b);
+  }
+}
+
+// Write event bytes, folding them into the CRC (polynomial 0x1021)
+void eventBytes(const byte* data, int len) {
+  for (int i = 0; i < len; i++) {
+    eventCrc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      eventCrc = eventCrc & 0x8000 ? (eventCrc << 1) ^ 0x1021 : eventCrc << 1;
+    }
+    slipWrite(data[i]);
+  }
+}
+
+void eventU8(byte value) {
+  eventBytes(&value, 1);
+}
+
+void eventU16(uint16_t value) {
+  byte bytes[2] = { (byte)value, (byte)(value >> 8) };
+  eventBytes(bytes, sizeof(bytes));
+}
+
+void eventU32(uint32_t value) {
+  eventU16(value & 0xFFFF);
+  eventU16(value >> 16);
+}
+
+// Start an event frame with its header
+void beginEvent(byte type, int node, uint32_t seq, unsigned long at, int rssi, float snr) {
+  Serial.write(SLIP_END);
+  eventCrc = 0xFFFF;
+  eventU8(type);
+  eventU8(node);
+  eventU32(seq);
+  eventU32(at);
+  eventU16((int16_t)rssi);
+  eventU8((int8_t)constrain(snr * 4, -128, 127));
+}
+
+// Start an event about the packet being output
+void beginPacketEvent(byte type, int node, uint32_t seq) {
+  beginEvent(type, node, seq, eventReceivedAt, eventRssi, eventSnr);
+}
+
+// Finish an event frame with its CRC
+void endEvent() {
+  uint16_t crc = eventCrc;
+  slipWrite(crc & 0xFF);
+  slipWrite(crc >> 8);
+  Serial.write(SLIP_END);
+}
+
+// Diagnostic text being assembled for logLine()
+TextBuffer logText;
+
+// Output a diagnostic line when VERBOSE_OUTPUT is set
+// Printed as is in JSON mode, wrapped in a log event in binary mode
+void logLine(const char* text) {
+  if (!VERBOSE_OUTPUT) return;
+  if (BINARY_OUTPUT) {
+    beginEvent(EVENT_LOG, 0, 0, millis(), 0, 0);
+    eventBytes((const byte*)text, strlen(text));
+    endEvent();
+  } else {
+    Serial.println(text);
+  }
+}
+
+// Decoded message text, reused for every reading
+TextBuffer decoded;
+
+// Read the four 16-bit sensor fields of a single or batch record
+// Values stay in the frame's fixed-point units
+void readFields(const byte* src, long* fields) {
+  fields[0] = (int16_t)getU16(src);      // 0.01 degC
+  fields[1] = (int16_t)getU16(src + 2);  // 0.01 pH
+  fields[2] = getU16(src + 4);           // 0.1 ppm
+  fields[3] = (int16_t)getU16(src + 6);  // mV
+}
+
+// Format fixed-point sensor fields back into the legacy message text
+// Produces the same "Temp:XX.XX | pH:X.XX | TDS:XXX.X | ORP:XXX" string
+// the sender used to transmit, so downstream parsers keep working
+// Returns the text, valid until the next call
+const char* formatReading(const long* fields) {
+  float temperature = fields[0] / 100.0;
+  float pH = fields[1] / 100.0;
+  float tds = fields[2] / 10.0;
+  long orp = fields[3];
+
+  decoded.clear();
+  decoded.print("Temp:");
+  decoded.print(temperature, 2);
+  decoded.print(" | pH:");
+  decoded.print(pH, 2);
+  decoded.print(" | TDS:");
+  decoded.print(tds, 1);
+  decoded.print(" | ORP:");
+  decoded.print(orp);
+  return decoded.c_str();
+}
+
+// Output one decoded message as a compact JSON line
+// Adds node id and packet counter as "seq", plus the reading age for
+// telemetry (age >= 0)
+void printMessageJson(int packetSize, const char* msg, int rssi, float snr,
+                      int node, long seq, long age) {
+  // Create JSON object for structured output
+  // This format makes it easy to parse the data in other applications
+  StaticJsonDocument<192> doc;
+  doc["packet_size"] = packetSize;  // Size of received packet in bytes
+  doc["message"] = msg;             // Decrypted message content
+  doc["rssi"] = rssi;               // Signal strength
+  doc["snr"] = snr;                 // Signal quality
+  doc["node"] = node;               // Sender node id
+  doc["seq"] = seq;                 // Packet counter
+  if (age >= 0) {
+    doc["age"] = age;               // Seconds between reading and transmission
+  }
+
+  // Output JSON to serial port
+  serializeJson(doc, Serial);
+  Serial.println();
+}
+
+// Output a plain text message
+void printMessage(int packetSize, const char* msg, int node, long seq) {
+  if (BINARY_OUTPUT) {
+    beginPacketEvent(EVENT_MESSAGE, node, seq);
+    eventU8(packetSize);
+    eventBytes((const byte*)msg, strlen(msg));
+    endEvent();
+    return;
+  }
+  printMessageJson(packetSize, msg, eventRssi, eventSnr, node, seq, -1);
+}
+
+// Output one reading given as fixed-point sensor fields
+// JSON mode formats it back into the legacy message text
+void printReading(int packetSize, const long* fields, int node, long seq, long age) {
+  if (BINARY_OUTPUT) {
+    beginPacketEvent(EVENT_READING, node, seq);
+    eventU8(packetSize);
+    eventU32(age);
+    for (int i = 0; i < READING_FIELDS; i++) {
+      eventU16((uint16_t)fields[i]);
+    }
+    endEvent();
+    return;
+  }
+  printMessageJson(packetSize, formatReading(fields), eventRssi, eventSnr, node, seq, age);
+}
+
+// Output one path point as a compact JSON line
+// Coordinates stay integers (1e-6 degrees) so no precision is lost on
+// boards where double is only 32 bits
+void printPathPoint(int node, long seq, long lat, long lng, int heading, long age) {
+  if (BINARY_OUTPUT) {
+    beginPacketEvent(EVENT_PATH, node, seq);
+    eventU32(lat);
+    eventU32(lng);
+    eventU16(heading);
+    eventU32(age);
+    endEvent();
+    return;
+  }
+
+  StaticJsonDocument<192> doc;
+  doc["node"] = node;
+  doc["seq"] = seq;
+  doc["type"] = "path";
+  doc["lat_e6"] = lat;
+  doc["lng_e6"] = lng;
+  doc["heading"] = heading;   // Degrees, 2 degree resolution
+  doc["age"] = age;           // Seconds between the fix and transmission
+  serializeJson(doc, Serial);
+  Serial.println();
+}
+
+// Output a path frame, one JSON line per point
+// Each point is a difference from the one before, starting from the
+// absolute position in the header
+void printPathFrame(const byte* frame, int len, int node, long seq) {
+  const byte* src = frame + PATH_HEADER_SIZE;
+  const byte* end = frame + len;
+  long lat = (int32_t)getU32(frame + 2);
+  long lng = (int32_t)getU32(frame + 6);
+
+  for (int i = 0; i < frame[1]; i++) {
+    uint32_t age, latZigzag, lngZigzag;
+    if (!getVarint(src, end, age) || src >= end) break;
+    int heading = *src++ * 2;
+    if (!getVarint(src, end, latZigzag) || !getVarint(src, end, lngZigzag)) {
+      logLine("Rejected: truncated path point");
+      return;
+    }
+    lat += (long)(latZigzag >> 1) ^ -(long)(latZigzag & 1);
+    lng += (long)(lngZigzag >> 1) ^ -(long)(lngZigzag & 1);
+    printPathPoint(node, seq, lat, lng, heading, age);
+  }
+}
+
+// Output an obstacle sighting as a compact JSON line
+// Position fields are left out when the node had no fix
+void printObstacle(const byte* frame, int node, long seq) {
+  if (BINARY_OUTPUT) {
+    beginPacketEvent(EVENT_OBSTACLE, node, seq);
+    eventBytes(frame + 1, OBSTACLE_FRAME_SIZE - 1);
+    endEvent();
+    return;
+  }
+
+  StaticJsonDocument<192> doc;
+  doc["node"] = node;
+  doc["seq"] = seq;
+  doc["type"] = "obstacle";
+  doc["distance_cm"] = getU16(frame + 9) / 10.0;
+  doc["heading"] = frame[11] * 2;
+  uint16_t fixAge = getU16(frame + 12);
+  if (fixAge != 0xFFFF) {
+    doc["lat_e6"] = (long)(int32_t)getU32(frame + 1);
+    doc["lng_e6"] = (long)(int32_t)getU32(frame + 5);
+    doc["fix_age"] = fixAge;  // Seconds between the fix and the sighting's transmission
+  }
+  serializeJson(doc, Serial);
+  Serial.println();
+}
+
+// Output a node's energy budget as a compact JSON line
+// Charges are microamp-hours since the node booted
+void printEnergy(const byte* frame, int node, long seq) {
+  static const char* const names[ENERGY_FIELDS] = {
+    "cpu_uah", "sleep_uah", "tx_uah", "rx_uah", "sensors_uah", "gps_uah"
+  };
+
+  if (BINARY_OUTPUT) {
+    beginPacketEvent(EVENT_ENERGY, node, seq);
+    eventBytes(frame + 1, ENERGY_FRAME_SIZE - 1);
+    endEvent();
+    return;
+  }
+
+  StaticJsonDocument<192> doc;
+  doc["node"] = node;
+  doc["seq"] = seq;
+  doc["rssi"] = eventRssi;
+  doc["snr"] = eventSnr;
+  doc["uptime"] = getU32(frame + 1);  // Seconds since the node booted
+  for (int i = 0; i < ENERGY_FIELDS; i++) {
+    doc[names[i]] = getU32(frame + 5 + 4 * i);
+  }
+
+  serializeJson(doc, Serial);
+  Serial.println();
+}
+
+// Output a node's performance statistics, one compact JSON line per probe
+// Probes the node never ran are left out; the histogram is the share of
+// the calls in each bucket (< 32 us, then one bucket per factor of 4), in
+// 1/255 units
+void printPerfFrame(const byte* frame, int len, int node, long seq) {
+  static const char* const names[] = {
+    "loop", "gps", "temp", "ph", "tds", "orp", "compass", "seal", "tx"
+  };
+  const int knownProbes = sizeof(names) / sizeof(names[0]);
+  const byte* src = frame + PERF_HEADER_SIZE;
+  const byte* end = frame + len;
+  uint16_t window = getU16(frame + 1);
+
+  for (int i = 0; i < frame[3]; i++) {
+    uint32_t count, minUs = 0, meanUs = 0, maxUs = 0;
+    if (!getVarint(src, end, count)) {
+      logLine("Rejected: truncated perf frame");
+      return;
+    }
+    if (count == 0) continue;
+    if (!getVarint(src, end, minUs) || !getVarint(src, end, meanUs) ||
+        !getVarint(src, end, maxUs) || end - src < PERF_BUCKETS) {
+      logLine("Rejected: truncated perf frame");
+      return;
+    }
+    const byte* histogram = src;
+    src += PERF_BUCKETS;
+
+    if (BINARY_OUTPUT) {
+      beginPacketEvent(EVENT_PERF, node, seq);
+      eventU8(i);
+      eventU16(window);
+      eventU32(count);
+      eventU32(minUs);
+      eventU32(meanUs);
+      eventU32(maxUs);
+      eventBytes(histogram, PERF_BUCKETS);
+      endEvent();
+      continue;
+    }
+
+    char hist[PERF_BUCKETS * 4];
+    char* out = hist;
+    for (int b = 0; b < PERF_BUCKETS; b++) {
+      out += sprintf(out, b ? ",%d" : "%d", histogram[b]);
+    }
+
+    StaticJsonDocument<256> doc;
+    doc["node"] = node;
+    doc["seq"] = seq;
+    doc["type"] = "perf";
+    if (i < knownProbes) {
+      doc["probe"] = names[i];
+    } else {
+      doc["probe"] = i;  // Probe added on the node after this sketch
+    }
+    doc["window"] = window;   // Seconds the statistics cover
+    doc["count"] = count;
+    doc["min_us"] = minUs;
+    doc["mean_us"] = meanUs;
+    doc["max_us"] = maxUs;
+    doc["hist"] = hist;
+    serializeJson(doc, Serial);
+    Serial.println();
+  }
+}
+
+// Output a node's settings and the outcome of its last command as a
+// compact JSON line
+void printConfigFrame(const byte* frame, int node, long seq) {
+  static const char* const statusNames[] = { "ok", "rejected", "unknown" };
+  const int knownStatuses = sizeof(statusNames) / sizeof(statusNames[0]);
+
+  if (BINARY_OUTPUT) {
+    beginPacketEvent(EVENT_CONFIG, node, seq);
+    eventBytes(frame + 1, CONFIG_FRAME_SIZE - 1);
+    endEvent();
+    return;
+  }
+
+  char deadbands[24];
+  sprintf(deadbands, "%u,%u,%u,%u", getU16(frame + 27), getU16(frame + 29), getU16(frame + 31),
+          getU16(frame + 33));
+
+  StaticJsonDocument<384> doc;
+  doc["node"] = node;
+  doc["seq"] = seq;
+  doc["type"] = "config";
+  doc["version"] = frame[1];
+  doc["key_id"] = frame[2];      // Key rotations since the node was provisioned
+  doc["command"] = frame[3];     // Id of the last command, 0 = none
+  if (frame[4] < knownStatuses) {
+    doc["status"] = statusNames[frame[4]];
+  } else {
+    doc["status"] = frame[4];
+  }
+  doc["adr"] = (frame[5] & 0x01) != 0;
+  doc["tx_power"] = frame[6];    // dBm
+  doc["sample_ms"] = getU32(frame + 7);
+  doc["record_ms"] = getU32(frame + 11);
+  doc["report_ms"] = getU32(frame + 15);
+  doc["heartbeat_ms"] = getU32(frame + 19);
+  doc["duty_ms"] = getU32(frame + 23);
+  doc["deadbands"] = deadbands;  // 0.01 degC, 0.01 pH, 0.1 ppm, mV
+  serializeJson(doc, Serial);
+  Serial.println();
+}
+
+// Adaptive data rate (ADR)
+// Link hint payload and fallback rules must match arduino/adr.h
+// The SX127x demodulates a single spreading factor at a time, so every
+// node heard by this receiver shares the data rate chosen here; with
+// MULTI_NODE it never leaves the default
+const byte FRAME_TYPE_LINK_HINT = 0x10;           // Value of the first byte of a link hint
+const int LINK_HINT_SIZE = 5;                     // Type, SNR, margin, spreading factor, coding rate
+const int LORA_DEFAULT_SF = 12;                   // Must match the node's LORA_DEFAULT_SF
+const int LORA_DEFAULT_CR = 8;                    // Must match the node's LORA_DEFAULT_CR
+const int ADR_MIN_SF = 7;                         // Fastest spreading factor the controller selects
+const float ADR_MARGIN_DB = 10.0;                 // SNR kept above the demodulation floor for fading
+const float ADR_CR_MARGIN_DB = 3.0;               // Extra margin needed to drop to coding rate 4/5
+const int ADR_HISTORY = 4;                        // Uplinks that must all have margin before stepping faster
+const unsigned long DOWNLINK_DELAY = 250;         // Must match the node's DOWNLINK_DELAY (milliseconds)
+const unsigned long RX_WINDOW_MARGIN = 100;       // Must match the node's RX_WINDOW_MARGIN (milliseconds)
+const unsigned long ADR_RESYNC_TIMEOUT = 180000;  // Silence before returning to the default rate (milliseconds)
+
+// Remote configuration
+// Command layout, opcodes and parameters must match arduino/config.h
+const byte FRAME_TYPE_COMMAND = 0x11;             // Link hint carrying a command
+const int MAX_DOWNLINK_SIZE = 16;                 // Must match the node's MAX_DOWNLINK_SIZE
+const int COMMAND_MAX_SIZE = MAX_DOWNLINK_SIZE - LINK_HINT_SIZE;  // Id, opcode, arguments
+const int COMMAND_QUEUE_DEPTH = 2;                // Commands waiting per node, a key rotation takes both
+const byte COMMAND_SET = 0x01;
+const byte COMMAND_CAL = 0x02;
+const byte COMMAND_KEY = 0x03;
+const byte COMMAND_RESET = 0x04;
+const byte COMMAND_OK = 0;                        // Status reported back in the config frame
+
+// Demodulation floor (lowest usable SNR in dB) for SF7..SF12, SX1276 datasheet
+const float REQUIRED_SNR[6] = { -7.5, -10.0, -12.5, -15.0, -17.5, -20.0 };
+
+int currentSf = LORA_DEFAULT_SF;     // Spreading factor the radio listens on
+int currentCr = LORA_DEFAULT_CR;     // Coding rate used for downlinks
+
+// Gateway receive pipeline
+// Sized for an ESP32-class gateway serving many nodes: the queue and node
+// table alone take about 10 KB
+#if defined(__AVR__)
+#error "The receiver needs an ESP32-class board, its buffers do not fit in an AVR's RAM"
+#endif
+const int MAX_PACKET_SIZE = 255;              // Largest LoRa packet
+const int RX_QUEUE_DEPTH = 4;                 // Packets copied out of the radio and waiting for processing
+const int MAX_NODES = 64;                     // Nodes tracked for replay protection and statistics
+const int HINT_QUEUE_DEPTH = 4;               // Link hints waiting for their send time
+const uint32_t MAX_COUNTER_GAP = 64;          // Larger counter jumps are node restarts, not losses
+const uint32_t COUNTER_RESERVE = 32;          // Counters accepted per NVS write (flash wear vs packets refused after a restart)
+const unsigned long STATS_INTERVAL = 60000;   // Time between per-node statistics lines (milliseconds)
+
+// One packet copied out of the radio FIFO
+struct RxPacket {
+  unsigned long receivedAt;       // millis() when the packet arrived
+  int rssi;                       // Packet RSSI (dBm)
+  float snr;                      // Packet SNR (dB)
+  int length;                     // Bytes in 'data'
+  byte data[MAX_PACKET_SIZE];     // Encrypted packet
+};
+
+// Receive queue: collectPacket() appends at rxHead + rxCount, loop()
+// consumes at rxHead
+RxPacket rxQueue[RX_QUEUE_DEPTH];
+uint8_t rxHead = 0;
+uint8_t rxCount = 0;
+volatile unsigned long rxOverflows = 0;   // Packets dropped because the queue was full or overwritten
+
+// Size of the packet the DIO0 interrupt announced, 0 once collected
+volatile int rxPacketSize = 0;
+
+// Per-node state: replay protection, loss accounting and link history
+// A packet is only accepted if its counter is above lastCounter
+// counterLimit is the highest counter NVS has recorded as possibly used
+struct NodeState {
+  bool used;                       // Slot holds a node
+  bool active;                     // Heard within ADR_RESYNC_TIMEOUT
+  byte node;                       // Node id
+  uint32_t lastCounter;            // Highest authentic packet counter seen
+  uint32_t counterLimit;           // Counters up to here are recorded in NVS
+  uint32_t received;               // Authentic packets accepted
+  uint32_t lost;                   // Packets missing from the counter sequence
+  unsigned long lastHeard;         // millis() of the last authentic packet
+  float snrHistory[ADR_HISTORY];   // SNR of the most recent uplinks (dB)
+  int rssiHistory[ADR_HISTORY];    // RSSI of the most recent uplinks (dBm)
+  uint8_t historyCount;            // Uplinks recorded since the last data rate change
+  bool hasKeyframe;                // A single or batch frame has been decoded
+  uint16_t keyframeId;             // Low 16 bits of that frame's packet counter
+  long keyframe[READING_FIELDS];   // Its last reading, the base of delta frames
+  byte key[16];                    // AES key the node seals its packets with
+  bool rotating;                   // pendingKey has been queued for the node
+  byte pendingKey[16];             // New key, in use once a packet verifies with it
+  byte commandId;                  // Id of the last command queued for the node
+  uint8_t commandCount;            // Commands waiting for the node's config frame
+  uint8_t commandLength[COMMAND_QUEUE_DEPTH];
+  byte commands[COMMAND_QUEUE_DEPTH][COMMAND_MAX_SIZE];  // Oldest first, id in [0]
+};
+NodeState nodes[MAX_NODES];
+
+// Link hint sealed and waiting until DOWNLINK_DELAY after its uplink
+struct PendingHint {
+  unsigned long receivedAt;                      // Arrival of the uplink being answered
+  int uplinkSf;                                  // Data rate the node is listening on
+  int uplinkCr;
+  int nextSf;                                    // Data rate the hint tells the node to use
+  int nextCr;
+  int length;                                    // Bytes in 'packet'
+  byte packet[PACKET_OVERHEAD + MAX_DOWNLINK_SIZE]; // Sealed downlink packet
+};
+PendingHint hints[HINT_QUEUE_DEPTH];
+uint8_t hintHead = 0;
+uint8_t hintCount = 0;
+unsigned long hintsMissed = 0;   // Hints dropped because the queue was full or they were late
+
+// A hint is on air; the radio returns to receiving once the TX-done
+// interrupt sets txDone
+bool transmitting = false;
+volatile bool txDone = false;
+
+unsigned long lastStatsAt = 0;   // millis() of the last statistics output
+
+// State of a node kept in NVS under "n<node id>" so it survives a
+// restart: its keys, and a counter high-water mark reserved in blocks of
+// COUNTER_RESERVE ahead of the packets accepted. After a restart counters
+// up to the mark count as used, so a recorded packet replayed then is
+// refused; so are up to COUNTER_RESERVE fresh ones, which the node resends
+// as their link hint never came
+struct StoredNode {
+  byte key[16];
+  bool rotating;
+  byte pendingKey[16];
+  uint32_t counterLimit;
+};
+Preferences store;
+
+// Key currently loaded into 'aes'
+byte loadedKey[16];
+bool keyLoaded = false;
+
+// Serial command line being received
+char commandLine[64];
+int commandLineLength = 0;
+
+// DIO0 interrupt: note the packet's size and nothing else
+// On an ESP32 it must sit in IRAM and stay clear of SPI and floating
+// point, which could run while the flash cache is off; the radio is read
+// from loop() by collectPacket(). A packet not collected before the next
+// one arrives has been overwritten in the FIFO
+void IRAM_ATTR onPacket(int packetSize) {
+  if (rxPacketSize != 0) {
+    rxOverflows++;
+  }
+  rxPacketSize = packetSize;
+}
+
+// Copy the packet the interrupt announced, with its arrival time and
+// signal quality, from the radio FIFO into the receive queue
+// Must be called often enough to collect each packet before the next
+// one ends; a packet that arrives while this one is read corrupts it,
+// and the MIC check then rejects it
+void collectPacket() {
+  noInterrupts();
+  int packetSize = rxPacketSize;
+  rxPacketSize = 0;
+  interrupts();
+  if (packetSize == 0) {
+    return;
+  }
+  if (rxCount >= RX_QUEUE_DEPTH) {
+    rxOverflows++;
+    return;
+  }
+
+  RxPacket& slot = rxQueue[(rxHead + rxCount) % RX_QUEUE_DEPTH];
+  slot.receivedAt = millis();
+  slot.rssi = LoRa.packetRssi();
+  slot.snr = LoRa.packetSnr();
+
+  int j = 0;
+  while (LoRa.available() && j < packetSize && j < MAX_PACKET_SIZE) {
+    slot.data[j++] = LoRa.read();
+  }
+  slot.length = j;
+  rxCount++;
+}
+
+// Find the state slot of a node already heard; returns NULL for a node
+// whose first authentic packet has not arrived yet
+NodeState* findNode(byte node) {
+  for (int i = 0; i < MAX_NODES; i++) {
+    if (nodes[i].used && nodes[i].node == node) {
+      return &nodes[i];
+    }
+  }
+  return NULL;
+}
+
+// Find the state slot of a node, claiming a free one for a node heard
+// for the first time; returns NULL if the table is full
+// Only called once a packet has verified, so forged headers cannot fill
+// the table
+// A new node starts with the factory key, and its command ids from a
+// random value: the node ignores a command repeating the id it last saw,
+// which a receiver restarting from 1 would often do
+NodeState* addNode(byte node) {
+  NodeState* known = findNode(node);
+  if (known != NULL) {
+    return known;
+  }
+  for (int i = 0; i < MAX_NODES; i++) {
+    if (!nodes[i].used) {
+      memset(&nodes[i], 0, sizeof(NodeState));
+      nodes[i].used = true;
+      nodes[i].node = node;
+      memcpy(nodes[i].key, key, sizeof(key));
+      nodes[i].commandId = random(1, 256);
+      return &nodes[i];
+    }
+  }
+  return NULL;
+}
+
+// Name of a node's NVS record
+void storeName(byte node, char* name, int size) {
+  snprintf(name, size, "n%d", node);
+}
+
+// Save a node's state after its keys or counter reservation changed
+void saveNode(const NodeState* state) {
+  StoredNode record;
+  memcpy(record.key, state->key, sizeof(record.key));
+  record.rotating = state->rotating;
+  memcpy(record.pendingKey, state->pendingKey, sizeof(record.pendingKey));
+  record.counterLimit = state->counterLimit;
+
+  char name[8];
+  storeName(state->node, name, sizeof(name));
+  if (store.putBytes(name, &record, sizeof(record)) != sizeof(record)) {
+    logLine("Node state not saved, it is lost on restart");
+  }
+}
+
+// Claim a slot for every node in NVS, before any packet arrives
+void restoreNodes() {
+  for (int node = 1; node < 256; node++) {
+    char name[8];
+    storeName(node, name, sizeof(name));
+    StoredNode record;
+    if (store.getBytesLength(name) != sizeof(record)) continue;
+    NodeState* state = addNode(node);
+    if (state == NULL) {
+      logLine("Node table full, stored nodes not restored");
+      return;
+    }
+    store.getBytes(name, &record, sizeof(record));
+    memcpy(state->key, record.key, sizeof(state->key));
+    state->rotating = record.rotating;
+    memcpy(state->pendingKey, record.pendingKey, sizeof(state->pendingKey));
+    state->lastCounter = record.counterLimit;
+    state->counterLimit = record.counterLimit;
+  }
+}
+
+// Record an authentic packet in its node's state
+// Counter gaps count as lost packets, except jumps beyond
+// MAX_COUNTER_GAP, which the node makes after a reset
+void recordUplink(NodeState* state, uint32_t counter, int rssi, float snr,
+                  unsigned long receivedAt) {
+  // Reserve counters in NVS before accepting one past the reservation, so
+  // a restart cannot reopen it to replays
+  if (counter > state->counterLimit) {
+    state->counterLimit = counter + COUNTER_RESERVE;
+    saveNode(state);
+  }
+
+  uint32_t gap = counter - state->lastCounter - 1;
+  if (state->received > 0 && gap <= MAX_COUNTER_GAP) {
+    state->lost += gap;
+  }
+
+  state->lastCounter = counter;
+  state->received++;
+  state->lastHeard = receivedAt;
+  state->active = true;
+  state->snrHistory[state->historyCount % ADR_HISTORY] = snr;
+  state->rssiHistory[state->historyCount % ADR_HISTORY] = rssi;
+  state->historyCount++;
+}
+
+// Switch the radio to a new spreading factor and coding rate
+// Coding rate is carried in the explicit LoRa header, so only the
+// spreading factor has to match the node for reception
+// While a hint is on air the radio keeps the hint's data rate, and
+// finishLinkHint() switches it afterwards
+void setDataRate(int sf, int cr) {
+  if (!transmitting) {
+    LoRa.setSpreadingFactor(sf);
+    LoRa.setCodingRate4(cr);
+  }
+  currentSf = sf;
+  currentCr = cr;
+
+  // Histories measured at the old rate say nothing about the new one
+  for (int i = 0; i < MAX_NODES; i++) {
+    nodes[i].historyCount = 0;
+  }
+
+  logText.clear();
+  logText.print("ADR: SF");
+  logText.print(sf);
+  logText.print(" CR4/");
+  logText.print(cr);
+  logLine(logText.c_str());
+}
+
+// Lowest spreading factor whose demodulation floor is at least
+// ADR_MARGIN_DB below the given SNR
+int spreadingFactorFor(float snr) {
+  for (int sf = ADR_MIN_SF; sf < 12; sf++) {
+    if (snr - REQUIRED_SNR[sf - 7] >= ADR_MARGIN_DB) {
+      return sf;
+    }
+  }
+  return 12;
+}
+
+// Choose the data rate to announce after an uplink with the given SNR
+// Steps slower as soon as one uplink lacks margin; steps faster only when
+// every active node has ADR_HISTORY uplinks at this rate and the worst
+// of them has margin at the new rate
+// With MULTI_NODE the current, default rate is always kept
+void chooseDataRate(float snr, int& nextSf, int& nextCr) {
+  nextSf = currentSf;
+  nextCr = currentCr;
+  if (MULTI_NODE) {
+    return;
+  }
+
+  if (spreadingFactorFor(snr) > currentSf) {
+    nextSf = spreadingFactorFor(snr);
+    nextCr = LORA_DEFAULT_CR;
+    return;
+  }
+
+  float worst = 1000;
+  for (int i = 0; i < MAX_NODES; i++) {
+    if (!nodes[i].used || !nodes[i].active) continue;
+    if (nodes[i].historyCount < ADR_HISTORY) return;
+    for (int h = 0; h < ADR_HISTORY; h++) {
+      if (nodes[i].snrHistory[h] < worst) worst = nodes[i].snrHistory[h];
+    }
+  }
+
+  nextSf = spreadingFactorFor(worst);
+  nextCr = worst - REQUIRED_SNR[nextSf - 7] >= ADR_MARGIN_DB + ADR_CR_MARGIN_DB ? 5 : 8;
+}
+
+// Load a node's key into the cipher
+// The key schedule is skipped when the key is already loaded, which it
+// is for every packet while all nodes share the factory key
+void useKey(const byte* nodeKey) {
+  if (keyLoaded && memcmp(loadedKey, nodeKey, sizeof(loadedKey)) == 0) {
+    return;
+  }
+  memcpy(loadedKey, nodeKey, sizeof(loadedKey));
+  aes.setKey(loadedKey, sizeof(loadedKey));
+  keyLoaded = true;
+}
+
+// Seal a link hint for a binary uplink and queue it for its send time
+// Only uplinks carrying readings ('acknowledge') are always answered;
+// any other uplink only when the data rate changes or a command waits
+// Sealed with the counter of the uplink being answered, so the node
+// accepts it for that uplink only, and with the key that uplink verified
+// with; the node's oldest queued command rides along until it is answered
+void queueLinkHint(NodeState* state, uint32_t counter, float snr, unsigned long receivedAt,
+                   bool acknowledge) {
+  int nextSf;
+  int nextCr;
+  chooseDataRate(snr, nextSf, nextCr);
+  bool rateChanged = nextSf != currentSf || nextCr != currentCr;
+  if (!acknowledge && !rateChanged && state->commandCount == 0) {
+    return;
+  }
+
+  if (hintCount >= HINT_QUEUE_DEPTH) {
+    hintsMissed++;
+    return;
+  }
+
+  PendingHint& h = hints[(hintHead + hintCount) % HINT_QUEUE_DEPTH];
+  h.receivedAt = receivedAt;
+  h.uplinkSf = currentSf;
+  h.uplinkCr = currentCr;
+  h.nextSf = nextSf;
+  h.nextCr = nextCr;
+
+  float margin = snr - REQUIRED_SNR[currentSf - 7];
+  h.packet[0] = state->node;
+  for (int i = 0; i < 4; i++) {
+    h.packet[1 + i] = (counter >> (8 * i)) & 0xFF;
+  }
+  byte* hint = h.packet + PACKET_HEADER_SIZE;
+  hint[0] = FRAME_TYPE_LINK_HINT;
+  hint[1] = (int8_t)constrain(snr * 4, -128, 127);
+  hint[2] = (int8_t)constrain(margin, -128, 127);
+  hint[3] = h.nextSf;
+  hint[4] = h.nextCr;
+  int len = LINK_HINT_SIZE;
+  if (state->commandCount > 0) {
+    hint[0] = FRAME_TYPE_COMMAND;
+    memcpy(hint + len, state->commands[0], state->commandLength[0]);
+    len += state->commandLength[0];
+  }
+  ccmCrypt(CCM_DOWNLINK, state->node, counter, hint, len, hint + len, false);
+  h.length = PACKET_OVERHEAD + len;
+
+  hintCount++;
+}
+
+// DIO0 interrupt in transmit mode: the hint has left the radio
+void IRAM_ATTR onTxDone() {
+  txDone = true;
+}
+
+// Return to receiving once the hint on air has been sent, at the data
+// rate chosen meanwhile
+void finishLinkHint() {
+  if (!transmitting || !txDone) {
+    return;
+  }
+  transmitting = false;
+  LoRa.setSpreadingFactor(currentSf);
+  LoRa.setCodingRate4(currentCr);
+  LoRa.receive();   // Transmitting left continuous receive mode
+}
+
+// Send the oldest queued hint once it is due, then follow it ourselves
+// The hint goes out at the uplink's data rate, DOWNLINK_DELAY after the
+// uplink ended, while the node's receive window is open; a hint that
+// can no longer start inside the window is dropped
+// Sending does not wait for the hint to leave the radio, finishLinkHint()
+// picks up from there
+void serviceLinkHints() {
+  if (hintCount == 0 || transmitting) {
+    return;
+  }
+
+  PendingHint& h = hints[hintHead];
+  unsigned long elapsed = millis() - h.receivedAt;
+  if (elapsed < DOWNLINK_DELAY) {
+    return;
+  }
+
+  bool sent = elapsed <= DOWNLINK_DELAY + RX_WINDOW_MARGIN;
+  if (sent) {
+    if (h.uplinkSf != currentSf || h.uplinkCr != currentCr) {
+      LoRa.setSpreadingFactor(h.uplinkSf);
+      LoRa.setCodingRate4(h.uplinkCr);
+    }
+    LoRa.beginPacket();
+    LoRa.write(h.packet, h.length);
+    txDone = false;
+    transmitting = true;
+    LoRa.endPacket(true);
+  } else {
+    hintsMissed++;
+  }
+
+  int nextSf = h.nextSf;
+  int nextCr = h.nextCr;
+  hintHead = (hintHead + 1) % HINT_QUEUE_DEPTH;
+  hintCount--;
+
+  if (sent && (nextSf != currentSf || nextCr != currentCr)) {
+    setDataRate(nextSf, nextCr);
+  }
+}
+
+// Radio work that cannot wait for the next pass of loop(): the end of a
+// hint on air, a due link hint and a packet waiting in the FIFO
+void serviceRadio() {
+  finishLinkHint();
+  serviceLinkHints();
+  collectPacket();
+}
+
+// Keep the last reading of a single or batch frame as the node's keyframe
+void storeKeyframe(NodeState* state, uint32_t counter, const byte* fields) {
+  state->hasKeyframe = true;
+  state->keyframeId = counter & 0xFFFF;
+  readFields(fields, state->keyframe);
+}
+
+// Rebuild one delta record against the node's keyframe, advancing 'src'
+// Returns false if the record runs past the end of the frame
+bool decodeDeltaRecord(const byte*& src, const byte* end, const NodeState* state,
+                       long* fields, uint32_t& age) {
+  if (!getVarint(src, end, age) || src >= end) return false;
+  src++;  // Status flags, not part of the message text
+
+  for (int i = 0; i < READING_FIELDS; i++) {
+    uint32_t zigzag;
+    if (!getVarint(src, end, zigzag)) return false;
+    long delta = (long)(zigzag >> 1) ^ -(long)(zigzag & 1);
+    fields[i] = state->keyframe[i] + delta;
+  }
+  return true;
+}
+
+// Settle the node's oldest queued command once its config frame reports it
+// The node's command id is adopted when nothing is queued, so commands
+// typed later continue from it
+// A key half the node did not take cancels the rotation
+void acknowledgeCommand(NodeState* state, const byte* frame) {
+  byte id = frame[3];
+  if (state->commandCount > 0 && state->commands[0][0] == id) {
+    bool keyFailed = state->commands[0][1] == COMMAND_KEY && frame[4] != COMMAND_OK;
+    state->commandCount--;
+    for (int i = 0; i < state->commandCount; i++) {
+      memcpy(state->commands[i], state->commands[i + 1], COMMAND_MAX_SIZE);
+      state->commandLength[i] = state->commandLength[i + 1];
+    }
+    if (keyFailed) {
+      state->rotating = false;
+      state->commandCount = 0;
+      saveNode(state);
+      logLine("Key rotation failed");
+    }
+  }
+  if (state->commandCount == 0) {
+    state->commandId = id;
+  }
+}
+
+// Decrypt, verify and output one queued packet
+void processPacket(RxPacket& p) {
+  if (p.length <= PACKET_OVERHEAD) {
+    logLine("Rejected: packet too short");
+    return;
+  }
+
+  // Cleartext header, then the payload and MIC
+  byte node = p.data[0];
+  uint32_t counter = getU32(p.data + 1);
+  byte* payload = p.data + PACKET_HEADER_SIZE;
+  int payloadLen = p.length - PACKET_OVERHEAD;
+  byte* mic = payload + payloadLen;
+
+  // Reject replays before spending time on decryption; a node heard for
+  // the first time has no state yet and is checked with the factory key
+  NodeState* state = findNode(node);
+  if (state != NULL && counter <= state->lastCounter) {
+    logText.clear();
+    logText.print("Rejected: replayed counter ");
+    logText.print(counter);
+    logLine(logText.c_str());
+    return;
+  }
+
+  // Decrypt in place with the node's key and check the MIC; any flipped
+  // bit fails here. During a key rotation a packet that fails is
+  // encrypted back and tried with the new key, which replaces the old
+  // one as soon as a packet verifies with it
+  byte expected[CCM_MIC_SIZE];
+  useKey(state != NULL ? state->key : key);
+  ccmCrypt(CCM_UPLINK, node, counter, payload, payloadLen, expected, true);
+  bool authentic = micMatches(mic, expected);
+  if (!authentic && state != NULL && state->rotating) {
+    ccmCrypt(CCM_UPLINK, node, counter, payload, payloadLen, expected, false);
+    useKey(state->pendingKey);
+    ccmCrypt(CCM_UPLINK, node, counter, payload, payloadLen, expected, true);
+    authentic = micMatches(mic, expected);
+    if (authentic) {
+      memcpy(state->key, state->pendingKey, sizeof(state->key));
+      state->rotating = false;
+      saveNode(state);
+      logText.clear();
+      logText.print("Node ");
+      logText.print(node);
+      logText.print(" key rotated");
+      logLine(logText.c_str());
+    }
+  }
+  if (!authentic) {
+    logLine("Rejected: bad MIC");
+    return;
+  }
+
+  // A slot is only claimed for a node that proved it holds the key
+  if (state == NULL) {
+    state = addNode(node);
+    if (state == NULL) {
+      logLine("Rejected: node table full");
+      return;
+    }
+  }
+  recordUplink(state, counter, p.rssi, p.snr, p.receivedAt);
+  eventReceivedAt = p.receivedAt;
+  eventRssi = p.rssi;
+  eventSnr = p.snr;
+
+  // Recognise the binary frame layouts
+  bool singleFrame = payloadLen == TELEMETRY_FRAME_SIZE && payload[0] == FRAME_TYPE_TELEMETRY;
+  bool batchFrame = payloadLen >= BATCH_HEADER_SIZE && payload[0] == FRAME_TYPE_BATCH &&
+                    BATCH_HEADER_SIZE + payload[1] * BATCH_RECORD_SIZE <= payloadLen;
+  bool energyFrame = payloadLen == ENERGY_FRAME_SIZE && payload[0] == FRAME_TYPE_ENERGY;
+  bool deltaFrame = payloadLen >= DELTA_HEADER_SIZE && payload[0] == FRAME_TYPE_DELTA;
+  bool pathFrame = payloadLen >= PATH_HEADER_SIZE && payload[0] == FRAME_TYPE_PATH;
+  bool obstacleFrame = payloadLen == OBSTACLE_FRAME_SIZE && payload[0] == FRAME_TYPE_OBSTACLE;
+  bool perfFrame = payloadLen >= PERF_HEADER_SIZE && payload[0] == FRAME_TYPE_PERF;
+  bool configFrame = payloadLen == CONFIG_FRAME_SIZE && payload[0] == FRAME_TYPE_CONFIG;
+
+  // A delta frame is only readable against the keyframe it names; leaving
+  // it unanswered makes the node send a fresh keyframe
+  if (deltaFrame && (!state->hasKeyframe || state->keyframeId != getU16(payload + 1))) {
+    logLine("Rejected: unknown keyframe");
+    return;
+  }
+
+  // A config frame answers the command its hint carried, which must not
+  // ride on the hint that answers it
+  if (configFrame) {
+    acknowledgeCommand(state, payload);
+  }
+
+  // Binary frames may be answered with a link hint, sent by
+  // serviceLinkHints(); readings always are, the node keeps them until then
+  if (singleFrame || batchFrame || energyFrame || deltaFrame || pathFrame || obstacleFrame ||
+      perfFrame || configFrame) {
+    queueLinkHint(state, counter, p.snr, p.receivedAt, singleFrame || batchFrame || deltaFrame);
+  }
+
+  if (singleFrame) {
+    // Fixed-layout binary telemetry frame
+    long fields[READING_FIELDS];
+    readFields(payload + 1, fields);
+    printReading(p.length, fields, node, counter, getU16(payload + 10));
+    storeKeyframe(state, counter, payload + 1);
+  } else if (batchFrame) {
+    // Batch frame: one JSON line per buffered reading, oldest first
+    int count = payload[1];
+    for (int r = 0; r < count; r++) {
+      const byte* record = payload + BATCH_HEADER_SIZE + r * BATCH_RECORD_SIZE;
+      long fields[READING_FIELDS];
+      readFields(record + 2, fields);
+      printReading(p.length, fields, node, counter, getU16(record));
+      serviceRadio();   // Long batches must not hold back a due hint or a new packet
+    }
+    if (count > 0) {
+      storeKeyframe(state, counter, payload + BATCH_HEADER_SIZE + (count - 1) * BATCH_RECORD_SIZE + 2);
+    }
+  } else if (deltaFrame) {
+    // Delta frame: one JSON line per reading, rebuilt from the keyframe
+    const byte* src = payload + DELTA_HEADER_SIZE;
+    const byte* end = payload + payloadLen;
+    int count = payload[3];
+    for (int r = 0; r < count; r++) {
+      long fields[READING_FIELDS];
+      uint32_t age;
+      if (!decodeDeltaRecord(src, end, state, fields, age)) {
+        logLine("Rejected: truncated delta record");
+        break;
+      }
+      printReading(p.length, fields, node, counter, age);
+      serviceRadio();
+    }
+  } else if (pathFrame) {
+    printPathFrame(payload, payloadLen, node, counter);
+  } else if (obstacleFrame) {
+    printObstacle(payload, node, counter);
+  } else if (energyFrame) {
+    printEnergy(payload, node, counter);
+  } else if (perfFrame) {
+    printPerfFrame(payload, payloadLen, node, counter);
+  } else if (configFrame) {
+    printConfigFrame(payload, node, counter);
+  } else {
+    // Plain text message, no padding to remove; terminate it in place
+    // over the first MIC byte, which has already been checked
+    payload[payloadLen] = '\0';
+    printMessage(p.length, (const char*)payload, node, counter);
+  }
+}
+
+// Output one statistics JSON line per known node, then the gateway totals
+void printStatistics() {
+  for (int i = 0; i < MAX_NODES; i++) {
+    NodeState& state = nodes[i];
+    if (!state.used || state.received == 0) continue;   // Not heard since the start
+
+    int samples = state.historyCount < ADR_HISTORY ? state.historyCount : ADR_HISTORY;
+    float rssi = 0;
+    float snr = 0;
+    for (int h = 0; h < samples; h++) {
+      rssi += state.rssiHistory[h];
+      snr += state.snrHistory[h];
+    }
+
+    if (BINARY_OUTPUT) {
+      beginEvent(EVENT_NODE_STATS, state.node, state.lastCounter, millis(),
+                 samples > 0 ? rssi / samples : 0, samples > 0 ? snr / samples : 0);
+      eventU32(state.received);
+      eventU32(state.lost);
+      eventU32((millis() - state.lastHeard) / 1000);
+      endEvent();
+      continue;
+    }
+
+    StaticJsonDocument<192> doc;
+    doc["node"] = state.node;
+    doc["received"] = state.received;
+    doc["lost"] = state.lost;
+    doc["loss_pct"] = 100.0 * state.lost / (state.received + state.lost);
+    if (samples > 0) {
+      doc["rssi"] = rssi / samples;   // Mean of the recent uplinks
+      doc["snr"] = snr / samples;
+    }
+    doc["last_heard"] = (millis() - state.lastHeard) / 1000;
+    serializeJson(doc, Serial);
+    Serial.println();
+  }
+
+  if (BINARY_OUTPUT) {
+    beginEvent(EVENT_GATEWAY_STATS, 0, 0, millis(), 0, 0);
+    eventU32(rxOverflows);
+    eventU32(hintsMissed);
+    endEvent();
+    return;
+  }
+
+  StaticJsonDocument<128> doc;
+  doc["rx_overflows"] = rxOverflows;
+  doc["hints_missed"] = hintsMissed;
+  serializeJson(doc, Serial);
+  Serial.println();
+}
+
+// Parse 32 hex digits into a 16-byte key
+// Returns false, leaving 'out' unchanged, for any other text
+bool parseKey(const char* hex, byte* out) {
+  byte parsed[16];
+  if (strlen(hex) != 32) return false;
+  for (int i = 0; i < 32; i++) {
+    char c = hex[i];
+    int digit;
+    if (c >= '0' && c <= '9') digit = c - '0';
+    else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+    else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+    else return false;
+    parsed[i / 2] = i % 2 ? parsed[i / 2] | digit : digit << 4;
+  }
+  memcpy(out, parsed, sizeof(parsed));
+  return true;
+}
+
+// Queue a command for a node under the next command id
+// 'body' is the opcode and its arguments
+// Returns false if the node's command queue is full
+bool queueCommand(NodeState* state, const byte* body, int len) {
+  if (state->commandCount >= COMMAND_QUEUE_DEPTH || len + 1 > COMMAND_MAX_SIZE) {
+    return false;
+  }
+
+  state->commandId = state->commandId == 255 ? 1 : state->commandId + 1;
+  byte* command = state->commands[state->commandCount];
+  command[0] = state->commandId;
+  memcpy(command + 1, body, len);
+  state->commandLength[state->commandCount] = len + 1;
+  state->commandCount++;
+
+  logText.clear();
+  logText.print("Command ");
+  logText.print(state->commandId);
+  logText.print(" queued for node ");
+  logText.print(state->node);
+  logLine(logText.c_str());
+  return true;
+}
+
+// Write a little-endian 32-bit command argument
+void putU32(byte* dst, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    dst[i] = (value >> (8 * i)) & 0xFF;
+  }
+}
+
+// Settings changed by "SET", in arduino/config.h ConfigParam order
+const char* const CONFIG_PARAMS[] = {
+  "SAMPLE", "RECORD", "REPORT", "HEARTBEAT", "DUTY", "TEMP_DB", "PH_DB", "TDS_DB", "ORP_DB",
+  "ADR", "TX_POWER"
+};
+
+// Probes addressed by "CAL", in arduino/config.h CAL_PROBE_* order, with
+// the factor from the typed value to the command's units
+const char* const CAL_PROBES[] = { "PH", "TDS", "ORP" };
+const float CAL_SCALES[] = { 100.0, 10.0, 1.0 };
+
+// Find 'name' in a table of names, returning its index or -1
+int findName(const char* const* names, int count, const char* name) {
+  for (int i = 0; i < count; i++) {
+    if (strcmp(names[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+// Parse and queue one serial command (see the commands at the top)
+// Fields are split in place at the commas
+void parseCommand(char* line) {
+  char* fields[4] = { line, NULL, NULL, NULL };
+  int fieldCount = 1;
+  for (char* c = line; *c && fieldCount < 4; c++) {
+    if (*c == ',') {
+      *c = '\0';
+      fields[fieldCount++] = c + 1;
+    }
+  }
+
+  int id = fieldCount > 1 ? atoi(fields[1]) : 0;
+  NodeState* state = id > 0 && id < 256 ? findNode(id) : NULL;
+  bool setKey = strcmp(fields[0], "KEY") == 0;
+  if (state == NULL && !setKey) {
+    logLine("Command rejected: no such node");
+    return;
+  }
+
+  byte body[COMMAND_MAX_SIZE];
+  bool queued = false;
+  if (strcmp(fields[0], "SET") == 0 && fieldCount == 4) {
+    int param = findName(CONFIG_PARAMS, sizeof(CONFIG_PARAMS) / sizeof(CONFIG_PARAMS[0]), fields[2]);
+    if (param >= 0) {
+      body[0] = COMMAND_SET;
+      body[1] = param + 1;
+      putU32(body + 2, strtoul(fields[3], NULL, 10));
+      queued = queueCommand(state, body, 6);
+    }
+  } else if (strcmp(fields[0], "CAL") == 0 && fieldCount == 4) {
+    int probe = findName(CAL_PROBES, sizeof(CAL_PROBES) / sizeof(CAL_PROBES[0]), fields[2]);
+    if (probe >= 0) {
+      bool clear = strcmp(fields[3], "CLEAR") == 0;
+      float value = clear ? 0 : atof(fields[3]) * CAL_SCALES[probe];
+      body[0] = COMMAND_CAL;
+      body[1] = probe;
+      body[2] = clear ? 1 : 0;
+      putU32(body + 3, (uint32_t)(long)(value < 0 ? value - 0.5 : value + 0.5));
+      queued = queueCommand(state, body, 7);
+    }
+  } else if (strcmp(fields[0], "RESET") == 0 && fieldCount == 2) {
+    body[0] = COMMAND_RESET;
+    queued = queueCommand(state, body, 1);
+  } else if (setKey && fieldCount == 3) {
+    // A node not heard since the restart gets its slot here, so its
+    // first packet is checked with this key instead of the factory key
+    byte newKey[16];
+    if (id > 0 && id < 256 && parseKey(fields[2], newKey)) {
+      if (state == NULL) {
+        state = addNode(id);
+      }
+      if (state != NULL) {
+        memcpy(state->key, newKey, sizeof(state->key));
+        state->rotating = false;
+        saveNode(state);
+        logLine("Key set");
+        return;
+      }
+    }
+  } else if (strcmp(fields[0], "ROTATE") == 0 && fieldCount == 3) {
+    // Both halves must fit the queue, and one rotation runs at a time
+    if (state->commandCount == 0 && parseKey(fields[2], state->pendingKey)) {
+      for (int half = 0; half < 2; half++) {
+        body[0] = COMMAND_KEY;
+        body[1] = half;
+        memcpy(body + 2, state->pendingKey + 8 * half, 8);
+        queueCommand(state, body, 10);
+      }
+      state->rotating = true;
+      saveNode(state);
+      queued = true;
+      if (memcmp(state->key, key, sizeof(key)) == 0) {
+        logLine("Warning: new key sent under the factory key (see top of sketch)");
+      }
+    }
+  }
+
+  if (!queued) {
+    logLine("Command rejected");
+  }
+}
+
+// Collect serial command bytes without blocking
+// A command ends at a carriage return or line feed
+void pollSerialCommands() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\r' || c == '\n') {
+      if (commandLineLength > 0) {
+        commandLine[commandLineLength] = '\0';
+        parseCommand(commandLine);
+        commandLineLength = 0;
+      }
+    } else if (commandLineLength < (int)sizeof(commandLine) - 1) {
+      commandLine[commandLineLength++] = c;
+    }
+  }
+}
+
 void setup() {
-  // Initialize serial communication for debugging and output
-  Serial.begin(9600);
+  // Initialize serial communication for output; the faster rate keeps
+  // JSON output short next to packet arrival times
+  Serial.begin(115200);
 
   // Wait for serial port to be ready (important for some boards like Leonardo)
   while (!Serial);
@@ -48,13 +1622,14 @@ void setup() {
   // Configure LoRa radio parameters for optimal performance
   // These settings should match the transmitter configuration
 
-  LoRa.setSpreadingFactor(12);    // SF12 = longest range, slowest data rate (293 bps)
+  LoRa.setSpreadingFactor(LORA_DEFAULT_SF);  // SF12 = longest range, slowest data rate (293 bps)
                                   // Range: SF7 (fastest) to SF12 (longest range)
+                                  // Changed at run time by adaptive data rate
 
   LoRa.setSignalBandwidth(125E3); // 125 kHz bandwidth
                                   // Options: 7.8E3, 10.4E3, 15.6E3, 20.8E3, 31.25E3, 41.7E3, 62.5E3, 125E3, 250E3, 500E3
 
-  LoRa.setCodingRate4(8);         // Coding rate 4/8 (highest error correction)
+  LoRa.setCodingRate4(LORA_DEFAULT_CR);  // Coding rate 4/8 (highest error correction)
                                   // Options: 5 (4/5), 6 (4/6), 7 (4/7), 8 (4/8)
 
   LoRa.setSyncWord(0x34);         // Sync word for network identification
@@ -62,93 +1637,58 @@ void setup() {
 
   LoRa.enableCrc();               // Enable CRC for error detection
 
-  // Initialize AES cipher with the encryption key
-  aes.setKey(key, sizeof(key));
+  // Initialize AES cipher with the factory key; each node's own key is
+  // loaded as its packets arrive
+  useKey(key);
 
-  Serial.println("LoRa + AES Receiver Ready");
-}
-
-void loop() {
-  // Check if a LoRa packet has been received
-  int packetSize = LoRa.parsePacket();
-
-  if (packetSize) {
-    // Packet received - start processing
-    Serial.print("Packet Size: ");
-    Serial.println(packetSize);
+  // Command ids of newly heard nodes start from wideband RSSI noise
+  unsigned long seed = 0;
+  for (int i = 0; i < 4; i++) {
+    seed = (seed << 8) ^ LoRa.random();
+  }
+  randomSeed(seed);
 
-    // Get signal quality metrics
-    int rssi = LoRa.packetRssi();   // Received Signal Strength Indicator (dBm)
-    float snr = LoRa.packetSnr();   // Signal-to-Noise Ratio (dB)
+  // Keys and counter reservations of the nodes heard before a restart
+  store.begin("nodes", false);
+  restoreNodes();
 
-    // Read the encrypted data from LoRa buffer
-    byte cipher[packetSize]; 
-    int j = 0;
+  // Packets are collected by the DIO0 interrupt from now on
+  LoRa.onReceive(onPacket);
+  LoRa.onTxDone(onTxDone);
+  LoRa.receive();
 
-    // Read each byte of the received packet
-    while(LoRa.available() && j < packetSize) {
-      cipher[j++] = LoRa.read();
-    }
-
-    // Prepare buffer for decrypted data
-    int total_len = packetSize;
-    byte padded_msg[total_len];
+  logLine("LoRa + AES Receiver Ready");
+}
 
-    // Decrypt the message in 16-byte blocks (AES block size)
-    // AES operates on fixed 16-byte blocks, so we process the entire message
-    // in chunks of 16 bytes
-    for (int i = 0; i < total_len; i += 16) {
-      aes.decryptBlock(padded_msg + i, cipher + i);
-    }
+void loop() {
+  // Due link hints first, their send window is only RX_WINDOW_MARGIN
+  // long; then the packet waiting in the radio, if any
+  serviceRadio();
 
-    // Remove PKCS#7 padding from decrypted message
-    // The last byte indicates how many padding bytes were added
-    int pad_len = (int)padded_msg[total_len - 1];
-    int msg_len = total_len - pad_len;
+  // Configuration commands typed on the console
+  pollSerialCommands();
 
-    // Convert decrypted bytes to string
-    String msg = "";
-    for (int i = 0; i < msg_len; i++) {
-      msg += (char)padded_msg[i];
-    }
+  // Process one queued packet per pass, then release its slot
+  if (rxCount > 0) {
+    processPacket(rxQueue[rxHead]);
+    rxHead = (rxHead + 1) % RX_QUEUE_DEPTH;
+    rxCount--;
+  }
 
-    // Display received encrypted data in hexadecimal format
-    Serial.print("Received: ");
-    for (int i = 0; i < total_len; i++) {
-      Serial.print(cipher[i], HEX);
-      Serial.print(" ");
+  // A node silent for a long time has fallen back to the default data
+  // rate (or lost our last hint), so meet it there
+  for (int i = 0; i < MAX_NODES; i++) {
+    NodeState& state = nodes[i];
+    if (state.used && state.active && millis() - state.lastHeard > ADR_RESYNC_TIMEOUT) {
+      state.active = false;
+      if (currentSf != LORA_DEFAULT_SF || currentCr != LORA_DEFAULT_CR) {
+        setDataRate(LORA_DEFAULT_SF, LORA_DEFAULT_CR);
+      }
     }
-    Serial.println();
-
-    // Display decrypted message
-    Serial.print("Decrypted: ");
-    Serial.println(msg);
-
-    // Display signal quality information
-    Serial.print("RSSI: ");
-    Serial.print(rssi);
-    Serial.println("dB");
-
-    Serial.print("SNR: ");
-    Serial.print(snr);
-    Serial.println("dB\n");
-
-    // Create JSON object for structured output
-    // This format makes it easy to parse the data in other applications
-    StaticJsonDocument<128> doc;
-    doc["packet_size"] = packetSize;  // Size of received packet in bytes
-    doc["message"] = msg;             // Decrypted message content
-    doc["rssi"] = rssi;               // Signal strength
-    doc["snr"] = snr;                 // Signal quality
-
-    // Output JSON to serial port
-    serializeJson(doc, Serial);
-    Serial.println();
-
-    // Clear any remaining data in LoRa buffer
-    LoRa.flush();
   }
 
-  // Loop continues to check for new packets
-  // No delay needed as parsePacket() is non-blocking
-}
\ No newline at end of file
+  if (millis() - lastStatsAt >= STATS_INTERVAL) {
+    lastStatsAt = millis();
+    printStatistics();
+  }
+}
@@ -0,0 +1,88 @@
+#include <Arduino.h>
+#include "adr.h"
+#include "lora_comm.h"
+#include "config.h"
+#include "constants.h"
+
+// Consecutive uplinks of readings whose receive window closed without a
+// downlink
+static uint8_t missed = 0;
+
+// Counter of the last uplink the receiver always answers
+static uint32_t expectedCounter = 0;
+
+// Told whether each uplink was answered, NULL when unused
+static UplinkResultCallback uplinkResult = NULL;
+
+// Switch data rate and report it on the debug console
+static void changeDataRate(uint8_t spreadingFactor, uint8_t codingRate) {
+  if (spreadingFactor == getSpreadingFactor() && codingRate == getCodingRate()) {
+    return;
+  }
+  setDataRate(spreadingFactor, codingRate);
+  Serial.print(F("ADR: SF"));
+  Serial.print(spreadingFactor);
+  Serial.print(F(" CR4/"));
+  Serial.println(codingRate);
+}
+
+// Apply a link hint addressed to this node
+// Hints with out-of-range settings are ignored rather than trusted
+static void applyLinkHint(const uint8_t* frame) {
+  uint8_t spreadingFactor = frame[3];
+  uint8_t codingRate = frame[4];
+
+  if (spreadingFactor < 7 || spreadingFactor > 12 || codingRate < 5 || codingRate > 8) {
+    return;
+  }
+  if (nodeConfig().adrEnabled) {
+    changeDataRate(spreadingFactor, codingRate);
+  }
+}
+
+// Service the receive window and the fallback protocol
+void serviceAdr() {
+  uint8_t frame[MAX_DOWNLINK_SIZE];
+  uint8_t len = 0;
+  DownlinkStatus status = pollDownlink(frame, len);
+
+  if (status != DOWNLINK_NONE && uplinkResult != NULL) {
+    uplinkResult(lastPacketCounter(), status == DOWNLINK_RECEIVED);
+  }
+
+  if (status == DOWNLINK_RECEIVED) {
+    if (len < LINK_HINT_SIZE ||
+        (frame[0] != FRAME_TYPE_LINK_HINT && frame[0] != FRAME_TYPE_COMMAND)) {
+      return;
+    }
+    missed = 0;
+    applyLinkHint(frame);
+    if (frame[0] == FRAME_TYPE_COMMAND) {
+      handleCommand(frame + LINK_HINT_SIZE, len - LINK_HINT_SIZE);
+    }
+  } else if (status == DOWNLINK_MISSED && lastPacketCounter() == expectedCounter) {
+    // The receiver may have moved to a data rate we never heard about, or
+    // the link got worse; either way the default rate is the meeting point
+    if (missed < 255) {
+      missed++;
+    }
+    if (missed >= ADR_MAX_MISSED) {
+      changeDataRate(LORA_DEFAULT_SF, LORA_DEFAULT_CR);
+    }
+  }
+}
+
+// Register the callback run when each receive window ends
+void onUplinkResult(UplinkResultCallback callback) {
+  uplinkResult = callback;
+}
+
+// Mark the uplink just sent as one the receiver always answers
+void expectDownlink() {
+  expectedCounter = lastPacketCounter();
+}
+
+// Number of consecutive uplinks that got no downlink
+uint8_t missedDownlinks() {
+  return missed;
+}
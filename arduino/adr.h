@@ -0,0 +1,61 @@
+#ifndef ADR_H
+#define ADR_H
+
+#include <Arduino.h>
+
+// Header file for the node side of adaptive data rate (ADR)
+// The receiver answers an uplink with a link hint measured from that
+// uplink's SNR, telling the node which spreading factor and coding rate
+// to use next. Uplinks of readings are always answered, the hint being
+// their acknowledgement; other uplinks only when the data rate changes or
+// a command is waiting, so only a missing answer to readings counts as a
+// missed downlink (see expectDownlink()). The receiver switches its own radio as soon as it has
+// sent the hint, so both ends step together. A gateway built for many
+// nodes (MULTI_NODE in the receiver sketch) always announces the default
+// rate, so its nodes stay there
+// If hints stop arriving the node falls back to the default SF12 / 4/8
+// data rate, which the receiver also returns to after a silence, so the
+// two ends always find each other again
+//
+// Link hint downlink payload (node id and the counter of the uplink being
+// answered are in the packet header, see lora_comm.h):
+//   [0]      frame type (FRAME_TYPE_LINK_HINT)
+//   [1]      SNR of the uplink, int8, 0.25 dB
+//   [2]      link margin above the demodulation floor, int8, dB
+//   [3]      spreading factor to use from the next uplink (7..12)
+//   [4]      coding rate denominator to use from the next uplink (5..8)
+//
+// When the receiver has a configuration command queued for the node, the
+// hint carries it instead (see config.h for the command layout):
+//   [0]      frame type (FRAME_TYPE_COMMAND)
+//   [1..4]   link hint fields as above
+//   [5..]    command, up to MAX_DOWNLINK_SIZE - LINK_HINT_SIZE bytes
+
+// Frame type identifiers and size of the link hint downlink
+constexpr uint8_t FRAME_TYPE_LINK_HINT = 0x10;
+constexpr uint8_t FRAME_TYPE_COMMAND = 0x11;
+constexpr uint8_t LINK_HINT_SIZE = 5;
+
+// Callback told how the receive window after an uplink ended
+// Parameters: counter - packet counter of the uplink
+//             acknowledged - true if an authentic downlink answered it
+// The downlink doubles as an acknowledgement that the uplink arrived
+typedef void (*UplinkResultCallback)(uint32_t counter, bool acknowledged);
+
+// Function to register the callback run when each receive window ends
+void onUplinkResult(UplinkResultCallback callback);
+
+// Function to service link hints and the fallback protocol
+// Scheduler task with period 0: polls the receive window after each uplink,
+// applies received hints, hands commands to the config module and counts
+// missed downlinks
+void serviceAdr();
+
+// Function to mark the uplink just sent as one the receiver always answers
+// Only these count toward the fallback when their downlink is missed
+void expectDownlink();
+
+// Function to get the number of consecutive uplinks that got no downlink
+uint8_t missedDownlinks();
+
+#endif
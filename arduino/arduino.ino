@@ -3,8 +3,31 @@
  *
  * This is the main Arduino sketch for a water quality monitoring system that:
  * - Reads multiple sensor values (temperature, pH, TDS, ORP)
- * - Sends encrypted data via LoRa radio
+ * - Sends encrypted data via LoRa radio as compact binary frames
+ * - Buffers timestamped readings and forwards them in batches, so one
+ *   LoRa packet carries several readings and outages lose nothing
+ * - Reports by exception: only readings that moved past a deadband, or a
+ *   periodic heartbeat, are sent, as differences from a keyframe the
+ *   receiver has acknowledged
+ * - Adapts LoRa spreading factor and coding rate to the link quality
+ *   reported back by the receiver (adaptive data rate)
+ * - Logs a georeferenced path (GPS fix plus compass heading) at 1 Hz and
+ *   sends it, and obstacle sightings, as compact fixed-point frames
+ * - Ranges obstacles with interrupt-timed ultrasonic ping bursts
+ * - Optionally duty-cycles: sleeps with sensors, GPS and radio powered
+ *   down between short sampling windows, and reports an energy budget
+ * - Times its sensor reads, loop passes and radio path, and reports the
+ *   statistics hourly as a compact perf frame
+ * - Listens before talking: every uplink waits a random jitter and a
+ *   clear channel, backing off when other nodes are on air, optionally
+ *   inside its own GPS-timed slot
+ * - Takes configuration commands from the receiver over the air: the
+ *   sampling, record and report periods, deadbands, ADR, transmit power,
+ *   probe calibration and the AES key, kept in a versioned EEPROM block
  * - Supports ORP sensor calibration via serial commands
+ * - Runs every job as a non-blocking task on a millis() scheduler, so
+ *   serial commands and GPS NMEA bytes are never missed while sensors
+ *   convert or the radio transmits
  *
  * Hardware Components:
  * - Temperature sensor
@@ -12,14 +35,44 @@
  * - TDS (Total Dissolved Solids) sensor
  * - ORP (Oxidation Reduction Potential) sensor
  * - LoRa radio module for wireless transmission
+ * - GPS module on SoftwareSerial
+ * - HMC5883 compass on I2C
+ * - HC-SR04 ultrasonic ranger (echo on an interrupt pin)
  *
  * Serial Commands:
  * - "CAL,xxx" - Calibrate ORP sensor to value xxx
  * - "CAL,CLEAR" - Clear ORP calibration data
+ * - "CAL,PH,x" - Add a pH calibration point in a buffer of pH x
+ * - "CAL,PH,CLEAR" - Clear the pH calibration points
+ * - "CAL,TDS,x" - Add a TDS calibration point in a standard of x ppm
+ * - "CAL,TDS,CLEAR" - Clear the TDS calibration points
+ * - "CAL,SHOW" - Print the pH and TDS calibration points
+ * - "CAL,MAG" - Calibrate the compass while the unit is turned a full circle
+ * - "CAL,MAG,CLEAR" - Return to the default compass calibration
+ * - "CAL,DECL,x" - Set the magnetic declination to x degrees (east positive)
+ * - "POWER,SAVE" - Duty-cycle between sampling windows
+ * - "POWER,ON" - Keep everything powered
+ * - "ENERGY" - Print the energy budget
+ * - "STATS" - Print the performance and channel access statistics
+ * - "CONFIG" - Print the runtime configuration
+ * - "CONFIG,RESET" - Return the runtime configuration to its defaults
  */
 
 #include "sensorSystem.h"    // Sensor reading and management functions
 #include "lora_comm.h"       // LoRa communication and encryption
+#include "storeforward.h"    // Reading buffer and batched transmission
+#include "adr.h"             // Adaptive data rate from receiver link hints
+#include "scheduler.h"       // Cooperative millis() task scheduler
+#include "gps.h"             // GPS serial stream and NMEA parsing
+#include "compass.h"         // Averaged compass heading
+#include "navigation.h"      // Path points and obstacle reports
+#include "ultrasonic.h"      // Interrupt-driven ultrasonic ranging
+#include "power.h"           // Duty cycling and energy accounting
+#include "perf.h"            // Scoped timers and their statistics
+#include "telemetry.h"       // Energy budget and perf frames
+#include "txschedule.h"      // Channel access statistics
+#include "compensation.h"    // pH and TDS calibration profiles
+#include "config.h"          // Runtime configuration and downlink commands
 #include "constants.h"       // System constants and configuration
 #include "pins.h"            // Pin definitions for hardware connections
 
@@ -28,59 +81,326 @@ const uint8_t bufferlen = 32;           // Maximum length for serial commands
 char user_data[bufferlen];              // Buffer to store incoming serial data
 uint8_t user_bytes_received = 0;        // Number of bytes received from serial
 
-// Function prototype for command parsing
+// Function prototypes for command parsing and scheduler tasks
 void parse_cmd(char* string);
+void pollSerialCommands();
+void recordReading();
+void sendReport();
+void storeLatestReading();
+void forwardReport();
+void closeSamplingWindow();
+void reportEnergy();
+bool sendEnergyFrame();
+void reportPerf();
+bool sendPerfFrame();
+bool sendConfigFrame();
+void applyConfig();
+void rangeObstacles();
+
+// Set by reportEnergy(), cleared once the energy frame has been sent
+bool energyReportDue = false;
+
+// Set by reportPerf(), cleared once the perf frame has been sent
+bool perfReportDue = false;
+
+// Set at boot and by every configuration change, cleared once the config
+// frame has been sent
+bool configReportDue = true;
 
 void setup() {
   // Initialize serial communication for debugging and calibration commands
   Serial.begin(9600);
-  delay(200);  // Allow serial to stabilize
+
+  // Settings and link key from EEPROM, read by everything below
+  initConfig();
+
+  // Power up the sensor and GPS supplies before anything talks to them
+  initPower();
+  delay(200);  // Allow serial and supplies to stabilize
 
   // Display calibration instructions to user
   Serial.println(F("Use command \"CAL,xxx\" to calibrate ORP to value xxx"));
   Serial.println(F("\"CAL,CLEAR\" clears ORP calibration"));
+  Serial.println(F("\"CAL,MAG\" calibrates the compass, turn the unit a full circle"));
 
   // Initialize all sensor systems (pH, TDS, ORP, temperature)
   initSensorSystem();
-  Serial.println("Sensor system ready.");
+  Serial.println(F("Sensor system ready."));
 
   // Initialize LoRa radio communication with encryption
   initLoRa();
+
+  // Start the GPS serial stream so NMEA sentences are parsed from boot
+  initGPS();
+
+  // Compass heading for path points and obstacle reports
+  initCompass();
+
+  // Arm the echo interrupt and report obstacles from every ranging burst
+  initUltrasonic();
+  onRangeComplete(reportObstacle);
+
+  // Downlinks acknowledge uplinks, which releases the readings they
+  // carried and settles the delta keyframe
+  onUplinkResult(acknowledgeUplink);
+
+  // In power-save mode each sampling window ends by storing a reading
+  onSamplingWindowEnd(closeSamplingWindow);
+
+  // Configuration commands retune the tasks below and are answered
+  onConfigChange(applyConfig);
+
+  // === Task Table ===
+  // Period 0 tasks run on every pass and must stay short
+  // Sample, record and report periods come from the runtime configuration
+  const NodeConfig& config = nodeConfig();
+  bool scheduled = true;
+  scheduled &= addTask(pollSerialCommands, 0);                        // Calibration commands
+  scheduled &= addTask(feedGPS, 0);                                   // Drain NMEA bytes before the buffer overflows
+  scheduled &= addTask(serviceAdr, 0);                                // Downlink window: link hints and commands
+  scheduled &= addTask(serviceUltrasonic, 0);                         // Fire pings, collect echo times
+  scheduled &= addTask(sampleTemperature, TEMP_SAMPLE_INTERVAL);      // Non-blocking DS18B20 conversion
+  scheduled &= addTask(sampleWaterQuality, config.sampleInterval);    // pH, TDS and ORP probes
+  scheduled &= addTask(recordReading, config.recordInterval);         // Queue a timestamped reading
+  scheduled &= addTask(sendReport, config.reportInterval);            // Forward queued readings by LoRa
+  scheduled &= addTask(rangeObstacles, RANGE_INTERVAL);               // Start an ultrasonic ping burst
+  scheduled &= addTask(sampleCompass, COMPASS_SAMPLE_INTERVAL);       // One magnetometer sample into the heading average
+  scheduled &= addTask(trackPath, PATH_INTERVAL);                     // Path point, PATH and OBSTACLE frames
+  scheduled &= addTask(reportEnergy, ENERGY_REPORT_INTERVAL);         // Send the energy budget
+  scheduled &= addTask(reportPerf, PERF_REPORT_INTERVAL);             // Send the performance statistics
+  scheduled &= addTask(managePower, 0);                               // Sleep between sampling windows (power-save mode)
+
+  // A task that did not fit would silently never run
+  if (!scheduled) {
+    Serial.println(F("Task table full, raise MAX_TASKS in scheduler.h"));
+    while (true);  // Halt rather than run without a task
+  }
 }
 
 void loop() {
-  // === Handle Serial Calibration Commands ===
-  // Check if calibration command received via serial port
-  if (Serial.available() > 0) {
-    // Read command until carriage return (ASCII 13)
-    user_bytes_received = Serial.readBytesUntil(13, user_data, sizeof(user_data));
+  // Run every task whose period has elapsed; nothing in here blocks,
+  // the radio transmits in the background (see sendFrame())
+  perfLoopPass();
+  runScheduler();
+}
+
+/*
+ * Collect serial command bytes without blocking
+ *
+ * Reads whatever has arrived since the last pass and dispatches the
+ * command once the terminating carriage return (ASCII 13) is seen.
+ * Line feeds are ignored so both CR and CR+LF line endings work.
+ */
+void pollSerialCommands() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+
+    if (c == 13) {
+      // Process received command if available
+      if (user_bytes_received) {
+        parse_cmd(user_data);                    // Parse and execute calibration command
+        user_bytes_received = 0;                 // Reset byte counter
+        memset(user_data, 0, sizeof(user_data)); // Clear command buffer
+      }
+    } else if (c != 10 && user_bytes_received < bufferlen - 1) {
+      user_data[user_bytes_received++] = c;      // Keep room for the terminator
+    }
+  }
+}
+
+/*
+ * Scheduler task queueing a reading every record interval
+ *
+ * In power-save mode readings are taken once per sampling window by
+ * closeSamplingWindow() instead.
+ */
+void recordReading() {
+  if (!powerSaving()) {
+    storeLatestReading();
   }
+}
 
-  // Process received command if available
-  if (user_bytes_received) {
-    parse_cmd(user_data);                    // Parse and execute calibration command
-    user_bytes_received = 0;                 // Reset byte counter
-    memset(user_data, 0, sizeof(user_data)); // Clear command buffer
+/*
+ * Scheduler task forwarding queued readings every report interval
+ *
+ * In power-save mode this happens at the end of each sampling window.
+ */
+void sendReport() {
+  if (!powerSaving()) {
+    forwardReport();
   }
+}
 
-  // === Sensor Data Collection and Transmission ===
-  // Read all sensor values and format as string (e.g., "Temp:25.5|pH:7.2|TDS:350|ORP:200")
-  String data = getSensorDataString();
+/*
+ * End of a power-save sampling window: store the settled readings and
+ * forward whatever is due, before the node goes to sleep
+ */
+void closeSamplingWindow() {
+  storeLatestReading();
+  forwardReport();
+}
 
-  // Encrypt and transmit sensor data via LoRa
-  sendMessage(data);
+/*
+ * Queue the latest sensor readings for transmission
+ *
+ * Readings come from the sampling tasks, so no sensor is read (or
+ * waited on) here. Readings inside every deadband are skipped.
+ */
+void storeLatestReading() {
+  // Take one snapshot so the stored record and the debug line agree
+  SensorReadings readings = getSensorReadings();
+  if (!storeReading(readings)) {
+    return;
+  }
 
-  // Wait 3 seconds before next reading cycle
-  // This prevents overwhelming the LoRa network and allows time for data processing
-  delay(3000);
+  // Debug output: print readings in the legacy text format
+  Serial.print(F("Stored: "));
+  printSensorData(Serial, readings);
+  Serial.println();
 }
 
 /*
- * Parse and execute calibration commands from serial input
+ * Transmit queued readings
+ *
+ * Readings stay queued until a batch is complete and the receiver
+ * acknowledges the frame carrying them.
+ */
+void forwardReport() {
+  // The radio takes one frame at a time; a due config, energy budget or
+  // perf frame goes first and the readings wait for the next report
+  if (configReportDue) {
+    configReportDue = !sendConfigFrame();
+    return;
+  }
+  if (energyReportDue) {
+    energyReportDue = !sendEnergyFrame();
+    return;
+  }
+  if (perfReportDue) {
+    perfReportDue = !sendPerfFrame();
+    return;
+  }
+
+  uint8_t sent = forwardReadings();
+
+  if (sent > 0) {
+    Serial.print(F("Forwarded "));
+    Serial.print(sent);
+    Serial.print(F(" readings, pending "));
+    Serial.println(pendingReadings());
+  }
+}
+
+/*
+ * Print the energy budget and mark it due for transmission
+ *
+ * Runs every ENERGY_REPORT_INTERVAL. The frame itself is sent by the next
+ * forwardReport(), so it never competes with a batch for the radio.
+ */
+void reportEnergy() {
+  printEnergy();
+  energyReportDue = true;
+}
+
+/*
+ * Send the energy budget as a telemetry frame
+ *
+ * Returns false if the radio did not accept the frame.
+ */
+bool sendEnergyFrame() {
+  uint32_t charges[ENERGY_FIELDS];
+  for (uint8_t i = 0; i < ENERGY_FIELDS; i++) {
+    charges[i] = energyUsed((EnergySubsystem)i);
+  }
+
+  encodeEnergyFrame(txBuffer, charges);
+  return sendFrame(txBuffer, ENERGY_FRAME_SIZE);
+}
+
+/*
+ * Print the performance statistics and mark them due for transmission
+ *
+ * Runs every PERF_REPORT_INTERVAL. Like the energy budget, the frame is
+ * sent by the next forwardReport().
+ */
+void reportPerf() {
+  printPerfStats();
+  perfReportDue = true;
+}
+
+/*
+ * Send the performance statistics as a telemetry frame
+ *
+ * A new window starts once the radio has accepted the frame, so every
+ * call is counted in exactly one frame. Returns false if the radio did
+ * not accept the frame.
+ */
+bool sendPerfFrame() {
+  size_t len = encodePerfFrame(txBuffer, perfWindowMillis(), perfStats);
+  if (!sendFrame(txBuffer, len)) {
+    return false;
+  }
+
+  perfReset();
+  return true;
+}
+
+/*
+ * Send the settings in use as a config frame
+ *
+ * Answers the last command, and tells the receiver the node's settings
+ * after a boot. Returns false if the radio did not accept the frame.
+ */
+bool sendConfigFrame() {
+  encodeConfigFrame(txBuffer, nodeConfig());
+  return sendFrame(txBuffer, CONFIG_FRAME_SIZE);
+}
+
+/*
+ * Put a configuration change into effect and answer it
+ *
+ * Registered with onConfigChange(). Task periods, key and transmit power
+ * are taken from the new configuration; deadbands, heartbeat, duty cycle
+ * and ADR are read where they are used. The config frame goes out with
+ * the next report.
+ */
+void applyConfig() {
+  const NodeConfig& config = nodeConfig();
+  setTaskPeriod(sampleWaterQuality, config.sampleInterval);
+  setTaskPeriod(recordReading, config.recordInterval);
+  setTaskPeriod(sendReport, config.reportInterval);
+  setLinkKey(config.key);
+  setTransmitPower(config.txPower);
+  configReportDue = true;
+}
+
+/*
+ * Start the next ultrasonic ranging burst
+ *
+ * Runs every RANGE_INTERVAL. The burst completes in the background and
+ * its result arrives in reportObstacle().
+ */
+void rangeObstacles() {
+  startRanging();
+}
+
+/*
+ * Parse and execute calibration and power commands from serial input
  *
  * Supported commands:
  * - "CAL,xxx" where xxx is a numeric value to calibrate ORP sensor
  * - "CAL,CLEAR" to clear existing ORP calibration
+ * - "CAL,PH,x" / "CAL,TDS,x" to add a pH buffer or TDS standard point
+ *   to the probe's calibration curve, "CAL,PH,CLEAR" / "CAL,TDS,CLEAR" to
+ *   drop the points, "CAL,SHOW" to print them
+ * - "CAL,MAG" to start a compass calibration run, "CAL,MAG,CLEAR" to
+ *   drop the stored compass calibration
+ * - "CAL,DECL,x" to store the magnetic declination in degrees
+ * - "POWER,SAVE" / "POWER,ON" to switch power-save mode
+ * - "ENERGY" to print the energy budget
+ * - "STATS" to print the performance and channel access statistics
+ * - "CONFIG" to print the runtime configuration, "CONFIG,RESET" to
+ *   return it to the constants.h defaults
  *
  * Args:
  *   string: Null-terminated command string from serial input
@@ -88,28 +408,66 @@ void loop() {
 void parse_cmd(char* string) {
   // Convert command to uppercase for consistent parsing
   strupr(string);
-  String cmd = String(string);
 
   // Check if command starts with "CAL" (calibration command)
-  if (cmd.startsWith("CAL")) {
+  if (strncmp(string, "CAL", 3) == 0) {
     // Find comma separator between command and parameter
-    int index = cmd.indexOf(',');
+    char* param = strchr(string, ',');
 
-    if (index != -1) {
-      // Extract parameter after comma
-      String param = cmd.substring(index + 1);
+    if (param != NULL) {
+      // Parameter follows the comma
+      param++;
 
-      if (param.equals("CLEAR")) {
+      if (strcmp(param, "CLEAR") == 0) {
         // Clear existing ORP calibration data
         clearORPCalibration();
-        Serial.println("CALIBRATION CLEARED");
+        Serial.println(F("CALIBRATION CLEARED"));
+      } else if (strcmp(param, "MAG") == 0) {
+        // Track the magnetometer extremes while the unit is turned
+        startCompassCalibration();
+        Serial.println(F("MAG CALIBRATING"));
+      } else if (strcmp(param, "MAG,CLEAR") == 0) {
+        clearCompassCalibration();
+        Serial.println(F("MAG CALIBRATION CLEARED"));
+      } else if (strcmp(param, "PH,CLEAR") == 0) {
+        clearPHCalibration();
+        Serial.println(F("PH CALIBRATION CLEARED"));
+      } else if (strncmp(param, "PH,", 3) == 0) {
+        Serial.println(calibratePH(atof(param + 3)) ? "PH CALIBRATED" : "PH CALIBRATION REJECTED");
+      } else if (strcmp(param, "TDS,CLEAR") == 0) {
+        clearTDSCalibration();
+        Serial.println(F("TDS CALIBRATION CLEARED"));
+      } else if (strncmp(param, "TDS,", 4) == 0) {
+        Serial.println(calibrateTDS(atof(param + 4)) ? "TDS CALIBRATED" : "TDS CALIBRATION REJECTED");
+      } else if (strcmp(param, "SHOW") == 0) {
+        printCalibration();
+      } else if (strncmp(param, "DECL,", 5) == 0) {
+        setDeclination(atof(param + 5));
+        Serial.println(F("DECLINATION SET"));
       } else {
         // Calibrate ORP sensor to specified value
-        int cal_param = param.toInt();    // Convert parameter to integer
+        int cal_param = atoi(param);      // Convert parameter to integer
         calibrateORP(cal_param);          // Perform calibration
-        Serial.println("ORP CALIBRATED");
+        Serial.println(F("ORP CALIBRATED"));
       }
     }
+  } else if (strcmp(string, "POWER,SAVE") == 0) {
+    // Commands are only heard while awake, i.e. during sampling windows
+    setPowerSave(true);
+    Serial.println(F("POWER SAVE"));
+  } else if (strcmp(string, "POWER,ON") == 0) {
+    setPowerSave(false);
+    Serial.println(F("POWER ON"));
+  } else if (strcmp(string, "ENERGY") == 0) {
+    printEnergy();
+  } else if (strcmp(string, "STATS") == 0) {
+    printPerfStats();
+    printTransmitStats();
+  } else if (strcmp(string, "CONFIG") == 0) {
+    printConfig();
+  } else if (strcmp(string, "CONFIG,RESET") == 0) {
+    resetConfig();
+    Serial.println(F("CONFIG RESET"));
   }
   // Note: Invalid commands are silently ignored
-}
\ No newline at end of file
+}
@@ -0,0 +1,25 @@
+#include "bufferwriter.h"
+
+// Wrap a caller-provided buffer, starting with an empty message
+BufferWriter::BufferWriter(char* buffer, size_t size) : buffer(buffer), size(size) {
+  clear();
+}
+
+// Append one character, keeping room for the terminator
+size_t BufferWriter::write(uint8_t c) {
+  if (len + 1 >= size) {
+    overflow = true;
+    return 0;
+  }
+
+  buffer[len++] = c;
+  buffer[len] = '\0';
+  return 1;
+}
+
+// Reset to an empty message
+void BufferWriter::clear() {
+  len = 0;
+  overflow = false;
+  buffer[0] = '\0';
+}
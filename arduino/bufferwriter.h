@@ -0,0 +1,40 @@
+#ifndef BUFFER_WRITER_H
+#define BUFFER_WRITER_H
+
+#include <Arduino.h>
+
+// Header file for allocation-free message formatting
+// A Print that writes into a caller-provided char buffer, so messages are
+// built with the usual print() calls instead of String concatenation
+// Nothing is ever allocated: the buffer is normally static, and output
+// that does not fit is dropped and flagged instead of growing the buffer
+// The buffer always holds a NUL-terminated string
+
+class BufferWriter : public Print {
+public:
+  // Parameter: buffer - storage for the message, including the terminator
+  // Parameter: size - size of 'buffer' in bytes, at least 1
+  BufferWriter(char* buffer, size_t size);
+
+  // Append one character, returns 0 and sets the overflow flag if full
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // Empty the buffer and clear the overflow flag
+  void clear();
+
+  // Message written so far
+  const char* c_str() const { return buffer; }
+  size_t length() const { return len; }
+
+  // True if output was dropped since the last clear()
+  bool overflowed() const { return overflow; }
+
+private:
+  char* buffer;
+  size_t size;
+  size_t len;
+  bool overflow;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include "ccm.h"
+
+// CCM flags: B0 has Adata = 0, M' = (4 - 2) / 2, L' = 2 - 1;
+// counter blocks carry only L'
+constexpr uint8_t CCM_FLAGS_B0 = ((CCM_MIC_SIZE - 2) / 2) << 3 | 0x01;
+constexpr uint8_t CCM_FLAGS_A = 0x01;
+
+// Encrypt counter block A_i to get keystream block S_i
+static void keystream(CcmContext& ctx, uint16_t index, uint8_t* out) {
+  uint8_t a[16];
+  a[0] = CCM_FLAGS_A;
+  memcpy(a + 1, ctx.nonce, 13);
+  a[14] = index >> 8;
+  a[15] = index & 0xFF;
+  ctx.cipher->encryptBlock(out, a);
+}
+
+// Fold one zero-padded plaintext block into the CBC-MAC
+static void macBlock(CcmContext& ctx, const uint8_t* data, uint8_t len) {
+  for (uint8_t i = 0; i < len; i++) {
+    ctx.mac[i] ^= data[i];
+  }
+  ctx.cipher->encryptBlock(ctx.mac, ctx.mac);
+}
+
+// Start a packet: build the nonce and MAC block B0
+void ccmBegin(CcmContext& ctx, AES128& cipher, uint8_t direction, uint8_t node,
+              uint32_t counter, uint16_t len) {
+  ctx.cipher = &cipher;
+  memset(ctx.nonce, 0, sizeof(ctx.nonce));
+  ctx.nonce[0] = direction;
+  ctx.nonce[1] = node;
+  ctx.nonce[2] = counter & 0xFF;
+  ctx.nonce[3] = (counter >> 8) & 0xFF;
+  ctx.nonce[4] = (counter >> 16) & 0xFF;
+  ctx.nonce[5] = counter >> 24;
+  ctx.block = 1;
+
+  ctx.mac[0] = CCM_FLAGS_B0;
+  memcpy(ctx.mac + 1, ctx.nonce, 13);
+  ctx.mac[14] = len >> 8;
+  ctx.mac[15] = len & 0xFF;
+  cipher.encryptBlock(ctx.mac, ctx.mac);
+}
+
+// MAC the plaintext, then XOR it with the next keystream block
+void ccmEncrypt(CcmContext& ctx, uint8_t* data, uint8_t len) {
+  uint8_t s[16];
+  macBlock(ctx, data, len);
+  keystream(ctx, ctx.block++, s);
+  for (uint8_t i = 0; i < len; i++) {
+    data[i] ^= s[i];
+  }
+}
+
+// XOR with the next keystream block, then MAC the recovered plaintext
+void ccmDecrypt(CcmContext& ctx, uint8_t* data, uint8_t len) {
+  uint8_t s[16];
+  keystream(ctx, ctx.block++, s);
+  for (uint8_t i = 0; i < len; i++) {
+    data[i] ^= s[i];
+  }
+  macBlock(ctx, data, len);
+}
+
+// MIC = first bytes of the CBC-MAC, encrypted with keystream block S_0
+void ccmFinish(CcmContext& ctx, uint8_t* mic) {
+  uint8_t s[16];
+  keystream(ctx, 0, s);
+  for (uint8_t i = 0; i < CCM_MIC_SIZE; i++) {
+    mic[i] = ctx.mac[i] ^ s[i];
+  }
+}
+
+// OR together the differences of every byte instead of stopping at the first
+bool ccmVerify(const uint8_t* mic, const uint8_t* expected) {
+  uint8_t diff = 0;
+  for (uint8_t i = 0; i < CCM_MIC_SIZE; i++) {
+    diff |= mic[i] ^ expected[i];
+  }
+  return diff == 0;
+}
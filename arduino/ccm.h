@@ -0,0 +1,53 @@
+#ifndef CCM_H
+#define CCM_H
+
+#include <Arduino.h>
+#include <AES.h>
+
+// Header file for AES-CCM authenticated encryption (RFC 3610)
+// Counter mode encryption plus a CBC-MAC, both with the one AES-128 key,
+// using a 4-byte MIC and a 2-byte length field (CCM M = 4, L = 2)
+// Only the AES encrypt direction is used, for sealing and for opening
+// Data is processed in place in chunks of up to 16 bytes, so a packet can
+// be streamed straight into the radio FIFO without a ciphertext buffer
+//
+// Nonce (13 bytes): direction, node id, packet counter (uint32 LE), zeros
+// A counter value must never be reused for the same node and direction
+
+// Packet direction, part of the nonce so uplink and downlink keystreams
+// never collide even when they share a counter value
+constexpr uint8_t CCM_UPLINK = 0x00;
+constexpr uint8_t CCM_DOWNLINK = 0x01;
+
+// Size of the message integrity code appended to every packet
+constexpr uint8_t CCM_MIC_SIZE = 4;
+
+// State of one packet being sealed or opened
+struct CcmContext {
+  AES128* cipher;     // Keyed AES instance
+  uint8_t nonce[13];  // Direction, node id, counter
+  uint8_t mac[16];    // Running CBC-MAC over the plaintext
+  uint16_t block;     // Index of the next counter block (1-based)
+};
+
+// Function to start sealing or opening a packet of 'len' payload bytes
+void ccmBegin(CcmContext& ctx, AES128& cipher, uint8_t direction, uint8_t node,
+              uint32_t counter, uint16_t len);
+
+// Function to encrypt one chunk of plaintext in place
+// Every chunk except the last must be exactly 16 bytes
+void ccmEncrypt(CcmContext& ctx, uint8_t* data, uint8_t len);
+
+// Function to decrypt one chunk of ciphertext in place
+// Every chunk except the last must be exactly 16 bytes
+void ccmDecrypt(CcmContext& ctx, uint8_t* data, uint8_t len);
+
+// Function to finish a packet and produce its CCM_MIC_SIZE byte MIC
+void ccmFinish(CcmContext& ctx, uint8_t* mic);
+
+// Function to compare a received MIC with the one computed for the packet
+// Takes the same time wherever the first difference is, so the timing of
+// rejections does not tell a forger how many bytes of a MIC were right
+bool ccmVerify(const uint8_t* mic, const uint8_t* expected);
+
+#endif
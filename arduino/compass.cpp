@@ -2,63 +2,177 @@
 #include <Wire.h>
 #include <Adafruit_Sensor.h>
 #include <Adafruit_HMC5883_U.h>
+#include <EEPROM.h>
 #include "compass.h"
 #include "constants.h"
+#include "conversion.h"
+#include "filters.h"
+#include "perf.h"
 
 // Global magnetometer object used for reading compass data
 // Uses unique ID 12345 for sensor identification
 Adafruit_HMC5883_Unified mag = Adafruit_HMC5883_Unified(12345);
 
+// Calibration record stored at EEPROM_COMPASS_ADDR
+struct CompassCalibration {
+  uint8_t magic;        // COMPASS_CAL_MAGIC when the record is valid
+  float xMin;           // Axis extremes over a full turn (uT)
+  float xMax;
+  float yMin;
+  float yMax;
+  int16_t declination;  // Hundredths of a degree, east positive
+};
+
+// Marks a valid record; an erased EEPROM reads 0xFF
+constexpr uint8_t COMPASS_CAL_MAGIC = 0xC5;
+
+static_assert(EEPROM_COMPASS_ADDR + sizeof(CompassCalibration) <= EEPROM_STORE_ADDR,
+              "Compass calibration overlaps the store-and-forward ring");
+
+// Calibration in use, starting from the constants.h defaults
+static CompassCalibration calibration = {
+  COMPASS_CAL_MAGIC, x_min, x_max, y_min, y_max,
+  (int16_t)(declinationAngle * 18000.0 / PI + 0.5)
+};
+
+// Calibration run state
+static bool calibrating = false;
+static unsigned long calibrationStart = 0;
+static float runXMin, runXMax, runYMin, runYMax;
+
 // Initializes the HMC5883 compass sensor
 // Sets up I2C communication and verifies sensor connection
 // If sensor is not detected, prints error message and enters infinite loop
+// Replaces the default calibration with the stored one, if any
 void initCompass() {
     if(!mag.begin())
     {
-        Serial.println("Ooops, no HMC5883 detected ... Check your wiring!");
+        Serial.println(F("Ooops, no HMC5883 detected ... Check your wiring!"));
         while(true);
     }
+
+    CompassCalibration stored;
+    EEPROM.get(EEPROM_COMPASS_ADDR, stored);
+    if (stored.magic == COMPASS_CAL_MAGIC && stored.xMax > stored.xMin && stored.yMax > stored.yMin) {
+        calibration = stored;
+    }
+    setMagCalibration(calibration.xMin, calibration.xMax, calibration.yMin, calibration.yMax);
+}
+
+// Fold one raw sample into the calibration run, and finish the run once
+// COMPASS_CAL_DURATION has passed
+static void trackCalibration(float x, float y) {
+  if (x < runXMin) runXMin = x;
+  if (x > runXMax) runXMax = x;
+  if (y < runYMin) runYMin = y;
+  if (y > runYMax) runYMax = y;
+
+  if (millis() - calibrationStart < COMPASS_CAL_DURATION) {
+    return;
+  }
+  calibrating = false;
+
+  if (runXMax - runXMin < COMPASS_CAL_MIN_SPAN || runYMax - runYMin < COMPASS_CAL_MIN_SPAN) {
+    Serial.println(F("MAG CALIBRATION FAILED, turn the unit a full circle"));
+    return;
+  }
+
+  calibration.xMin = runXMin;
+  calibration.xMax = runXMax;
+  calibration.yMin = runYMin;
+  calibration.yMax = runYMax;
+  setMagCalibration(runXMin, runXMax, runYMin, runYMax);
+  EEPROM.put(EEPROM_COMPASS_ADDR, calibration);
+
+  Serial.print(F("MAG CALIBRATED x "));
+  Serial.print(runXMin);
+  Serial.print(F(".."));
+  Serial.print(runXMax);
+  Serial.print(F(" y "));
+  Serial.print(runYMin);
+  Serial.print(F(".."));
+  Serial.println(runYMax);
 }
 
-// Reads compass heading and averages over multiple samples for accuracy
-// Takes 10 readings with 10ms delay between each reading
-// Applies calibration normalization using min/max values from constants.h
+// Vector sum of the samples in the averaging window in progress
+static CircularMean heading_mean;
+
+// Latest averaged heading in degrees (0-359)
+static int latest_heading = 0;
+
+// Takes one compass sample and folds it into the running average
+// Called by the scheduler every COMPASS_SAMPLE_INTERVAL instead of
+// looping with delay(10) between readings
+// Applies calibration normalization using the stored min/max values
 // Applies local magnetic declination correction for geographic accuracy
-// Returns heading in degrees (0-359) as integer
-int readCompass() {
+// Publishes a new heading (0-359) after COMPASS_SAMPLES samples
+// During a calibration run the raw samples also feed the run
+void sampleCompass() {
+  PerfTimer timer(PERF_COMPASS);
   sensors_event_t event;
-  
-  float sum_heading = 0;
-  float heading;
+  mag.getEvent(&event);
+
+  if (calibrating) {
+    trackCalibration(event.magnetic.x, event.magnetic.y);
+  }
 
-  // Take 10 samples and average them for better accuracy
-  for (int i = 0; i < 10; i++) {
-    mag.getEvent(&event);
+  // Normalize X and Y magnetometer readings using calibration values
+  // Maps raw sensor values to -MAG_NORM_SCALE..+MAG_NORM_SCALE fixed point
+  // and averages them as vectors, which stays correct across north
+  heading_mean.add(normalizeMagX(event.magnetic.x), normalizeMagY(event.magnetic.y));
 
-    // Normalize X and Y magnetometer readings using calibration values
-    // Maps raw sensor values to -1.0 to +1.0 range
-    float x_norm = ((event.magnetic.x - x_min) / (x_max - x_min)) * 2.0 - 1.0;
-    float y_norm = ((event.magnetic.y - y_min) / (y_max - y_min)) * 2.0 - 1.0;
+  if (heading_mean.count() < COMPASS_SAMPLES) {
+    return;
+  }
 
-    // Calculate heading angle using arctangent of Y/X components
-    heading = atan2(y_norm, x_norm);
+  // Calculate heading angle of the mean vector using integer arctangent
+  long heading = atan2Centidegrees(heading_mean.meanY(), heading_mean.meanX());
+  heading_mean.reset();
 
-    // Apply local magnetic declination correction (~0.009 radians)
-    // This corrects for the difference between magnetic north and true north
-    heading += declinationAngle;
+  // Apply local magnetic declination correction
+  // This corrects for the difference between magnetic north and true north
+  heading += calibration.declination;
 
-    sum_heading += heading;
-    delay(10); // Small delay between readings to allow sensor to settle
-  }
+  // Normalize heading to 0-360 degree range
+  if (heading < 0) heading += 36000;
+  if (heading >= 36000) heading -= 36000;
 
-  // Calculate average heading from all samples
-  heading = sum_heading / 10.0;
+  // Convert from hundredths of a degree to whole degrees
+  latest_heading = heading / 100;
+}
 
-  // Normalize heading to 0-2π range
-  if (heading < 0) heading += 2 * PI;
-  if (heading > 2 * PI) heading -= 2 * PI;
+// Returns the latest averaged heading in degrees (0-359)
+int getHeading() {
+  return latest_heading;
+}
 
-  // Convert from radians to degrees and return as integer
-  float headingDegrees = heading * 180.0 / PI;
-  return (int)headingDegrees;
-}
\ No newline at end of file
+// Starts tracking the axis extremes from the next sample
+void startCompassCalibration() {
+  runXMin = runYMin = 1e6;
+  runXMax = runYMax = -1e6;
+  calibrationStart = millis();
+  calibrating = true;
+}
+
+// True while a calibration run is in progress
+bool compassCalibrating() {
+  return calibrating;
+}
+
+// Sets and stores the declination, keeping the axis calibration
+void setDeclination(float degrees) {
+  calibration.declination = (int16_t)(degrees * 100 + (degrees < 0 ? -0.5 : 0.5));
+  EEPROM.put(EEPROM_COMPASS_ADDR, calibration);
+}
+
+// Invalidates the stored record and returns to the defaults
+void clearCompassCalibration() {
+  calibrating = false;
+  calibration.xMin = x_min;
+  calibration.xMax = x_max;
+  calibration.yMin = y_min;
+  calibration.yMax = y_max;
+  calibration.declination = (int16_t)(declinationAngle * 18000.0 / PI + 0.5);
+  setMagCalibration(x_min, x_max, y_min, y_max);
+  EEPROM.write(EEPROM_COMPASS_ADDR, 0xFF);
+}
@@ -9,20 +9,49 @@
 // Header file for compass (HMC5883) sensor functionality
 // Provides interface for initializing and reading compass heading data
 // Uses Adafruit HMC5883 library for magnetometer communication
+// Hard iron calibration and declination are loaded from EEPROM, falling
+// back to the constants.h defaults on a unit that was never calibrated
+// The sensor has no accelerometer, so the heading assumes the unit is
+// held level; on a boat, roll and pitch average out over the samples
 
 // External declaration of global magnetometer object
 // Actual object is defined in compass.cpp
 extern Adafruit_HMC5883_Unified mag;
 
 // Function to initialize the compass sensor
-// Must be called before using readCompass() function
+// Loads the stored calibration and declination, if any
+// Must be called before using sampleCompass() or getHeading()
 // Will halt execution if sensor is not detected
 void initCompass();
 
-// Function to read the compass heading with averaging and calibration
-// Returns heading in degrees from 0-359 degrees
+// Scheduler task for the compass
+// Takes one magnetometer sample per call instead of busy-waiting between
+// samples; every COMPASS_SAMPLES calls the averaged heading is updated
+// Run with a period of COMPASS_SAMPLE_INTERVAL to let the sensor settle
+void sampleCompass();
+
+// Function to get the latest averaged compass heading
+// Returns heading in degrees from 0-359 degrees without blocking
 // 0 degrees = North, 90 = East, 180 = South, 270 = West
 // Applies calibration correction and magnetic declination
-int readCompass();
+int getHeading();
+
+// Function to start an automatic calibration run
+// For COMPASS_CAL_DURATION sampleCompass() tracks the extremes of the X
+// and Y axes while the unit is turned through at least one full circle.
+// If both axes spanned COMPASS_CAL_MIN_SPAN the result is applied and
+// stored in EEPROM, otherwise the previous calibration is kept
+void startCompassCalibration();
+
+// Function to check whether a calibration run is in progress
+bool compassCalibrating();
+
+// Function to set the local magnetic declination and store it in EEPROM
+// Parameter: degrees - east positive
+void setDeclination(float degrees);
+
+// Function to erase the stored calibration and declination
+// The constants.h defaults are used again
+void clearCompassCalibration();
 
 #endif
\ No newline at end of file
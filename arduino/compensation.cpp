@@ -0,0 +1,320 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "compensation.h"
+#include "conversion.h"
+#include "constants.h"
+
+// One calibration point, as measured
+struct CalibrationPoint {
+  uint16_t code;        // Filtered ADC code in the solution
+  int16_t temperature;  // Water temperature, hundredths of a degree C
+  uint16_t value;       // Solution value: hundredths of pH or 1/TDS_TABLE_SCALE ppm
+};
+
+// Calibration profile of one probe, stored at EEPROM_PH_CAL_ADDR or
+// EEPROM_TDS_CAL_ADDR
+struct ProbeProfile {
+  uint8_t magic;  // PROBE_CAL_MAGIC when the record is valid
+  uint8_t count;  // Points in use, 0..PROBE_CAL_POINTS
+  CalibrationPoint points[PROBE_CAL_POINTS];
+};
+
+// Marks a valid record; an erased EEPROM reads 0xFF
+constexpr uint8_t PROBE_CAL_MAGIC = 0xCA;
+
+static_assert(EEPROM_PH_CAL_ADDR + sizeof(ProbeProfile) <= EEPROM_TDS_CAL_ADDR &&
+              EEPROM_TDS_CAL_ADDR + sizeof(ProbeProfile) <= EEPROM_CONFIG_ADDR,
+              "Probe calibration profiles overlap their EEPROM neighbours");
+static_assert(PROBE_CAL_POINTS <= CURVE_MAX_POINTS && CURVE_MAX_POINTS >= 2,
+              "A curve must hold every profile point, and a single point's synthetic second");
+
+// Default pH calibration in the filtered code domain: the pH 7 code and
+// the slope in hundredths of pH per code, both at 25 degC
+constexpr uint16_t PH_NEUTRAL_CODE =
+    (uint16_t)(PH_NEUTRAL_VOLTAGE / ADC_REFERENCE_VOLTAGE * ADC_MAX * (1 << ANALOG_OVERSAMPLE_BITS) + 0.5);
+constexpr float PH_CODE_SLOPE =
+    -100.0 * ADC_REFERENCE_VOLTAGE / (ADC_MAX * (1 << ANALOG_OVERSAMPLE_BITS) * PH_VOLTS_PER_UNIT);
+
+// Accepted segment slopes in Q14: half to twice the default pH slope, and
+// a TDS scale of 0.5..2 (buildCurve() rejects 2 itself)
+constexpr long PH_SLOPE_MIN_Q14 = (long)(2 * PH_CODE_SLOPE * 16384);
+constexpr long PH_SLOPE_MAX_Q14 = (long)(PH_CODE_SLOPE / 2 * 16384);
+constexpr long TDS_SLOPE_MIN_Q14 = 8192;
+
+// Curves built from the calibration profiles; a curve without points
+// means the probe has no usable profile and keeps the defaults
+// The profiles themselves stay in EEPROM, read back only to add a point
+// or print them (see loadProfile())
+static CalibrationCurve phCurve;
+static CalibrationCurve tdsCurve;
+static uint16_t phNeutral = PH_NEUTRAL_CODE;  // Probe's pH 7 code at 25 degC
+
+// Water temperature and its compensation factors, Q15
+static int16_t probeTemperature = 2500;   // Hundredths of a degree C
+static long nernstQ15 = 32768;            // (25 + 273.15) / (t + 273.15)
+static unsigned long conductivityQ15 = 32768;  // 1 / (1 + TDS_TEMP_COEFF * (t - 25))
+
+static long nernstFactor(int16_t temperature) {
+  return (long)(32768.0 * (25 + 273.15) / (temperature * 0.01 + 273.15) + 0.5);
+}
+
+static unsigned long conductivityFactor(int16_t temperature) {
+  return (unsigned long)(32768.0 / (1 + TDS_TEMP_COEFF * (temperature * 0.01 - 25)) + 0.5);
+}
+
+static uint16_t clampCode(long value) {
+  return value < 0 ? 0 : value > 65535 ? 65535 : (uint16_t)value;
+}
+
+// Refer a pH code to 25 degC: the distance from the pH 7 code scales with
+// the Nernst factor
+static uint16_t phCodeAt25(uint16_t code, long factorQ15, uint16_t neutral) {
+  long offset = ((long)code - neutral) * factorQ15;
+  return clampCode(neutral + ((offset + 16384) >> 15));
+}
+
+// TDS table value referred to 25 degC
+static uint16_t tdsAt25(uint16_t code, unsigned long factorQ15) {
+  return clampCode(((uint32_t)tdsFromAdc(code) * factorQ15 + 16384) >> 15);
+}
+
+// Build the pH curve of a profile with at least one point
+// The pH 7 code that the points are referred to 25 degC around comes from
+// the curve itself: a first pass through the measured codes finds it, a
+// second pass through the referred codes gives the curve
+// A single point gets a second one on the default slope
+static bool buildPHCurve(const ProbeProfile& profile, CalibrationCurve& curve, uint16_t& neutral) {
+  neutral = PH_NEUTRAL_CODE;
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    uint16_t x[CURVE_MAX_POINTS];
+    long y[CURVE_MAX_POINTS];
+    uint8_t count = profile.count;
+    for (uint8_t i = 0; i < count; i++) {
+      const CalibrationPoint& point = profile.points[i];
+      x[i] = pass == 0 ? point.code
+                       : phCodeAt25(point.code, nernstFactor(point.temperature), neutral);
+      y[i] = point.value;
+    }
+    if (count == 1) {
+      x[1] = x[0] + 1000;
+      y[1] = y[0] + (long)(PH_CODE_SLOPE * 1000);
+      count = 2;
+    }
+
+    if (!buildCurve(curve, x, y, count)) {
+      return false;
+    }
+    for (uint8_t i = 0; i + 1 < curve.count; i++) {
+      if (curve.slope[i] < PH_SLOPE_MIN_Q14 || curve.slope[i] > PH_SLOPE_MAX_Q14) {
+        return false;
+      }
+    }
+
+    // pH 7 on the segment that spans it, or on the end segment past it
+    uint8_t i = 0;
+    while (i + 2 < curve.count && curve.y[i + 1] > 700) {
+      i++;
+    }
+    neutral = clampCode(curve.x[i] + (700 - curve.y[i]) * 16384 / curve.slope[i]);
+  }
+  return true;
+}
+
+// Build the TDS curve of a profile with at least one point
+// A single point gets the origin as its second, making it a pure scale
+static bool buildTDSCurve(const ProbeProfile& profile, CalibrationCurve& curve) {
+  uint16_t x[CURVE_MAX_POINTS];
+  long y[CURVE_MAX_POINTS];
+  uint8_t count = profile.count;
+  for (uint8_t i = 0; i < count; i++) {
+    const CalibrationPoint& point = profile.points[i];
+    x[i] = tdsAt25(point.code, conductivityFactor(point.temperature));
+    y[i] = point.value;
+  }
+  if (count == 1) {
+    x[1] = 0;
+    y[1] = 0;
+    count = 2;
+  }
+
+  if (!buildCurve(curve, x, y, count)) {
+    return false;
+  }
+  for (uint8_t i = 0; i + 1 < curve.count; i++) {
+    if (curve.slope[i] < TDS_SLOPE_MIN_Q14) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// True for a stored record holding at least one point
+static bool validProfile(const ProbeProfile& profile) {
+  return profile.magic == PROBE_CAL_MAGIC && profile.count > 0 && profile.count <= PROBE_CAL_POINTS;
+}
+
+// Read back the profile a curve was built from, or an empty profile when
+// the probe keeps the defaults (no record, or one rejected at boot)
+static ProbeProfile loadProfile(int address, const CalibrationCurve& curve) {
+  ProbeProfile profile = { PROBE_CAL_MAGIC, 0, {} };
+  if (curve.count > 0) {
+    EEPROM.get(address, profile);
+  }
+  return profile;
+}
+
+// Build both curves from their profiles, keeping the defaults for a
+// missing or unusable one
+void initCompensation() {
+  ProbeProfile stored;
+  EEPROM.get(EEPROM_PH_CAL_ADDR, stored);
+  if (!validProfile(stored) || !buildPHCurve(stored, phCurve, phNeutral)) {
+    phCurve.count = 0;
+    phNeutral = PH_NEUTRAL_CODE;
+  }
+
+  EEPROM.get(EEPROM_TDS_CAL_ADDR, stored);
+  if (!validProfile(stored) || !buildTDSCurve(stored, tdsCurve)) {
+    tdsCurve.count = 0;
+  }
+}
+
+// Recompute the temperature factors when the temperature changes
+void setProbeTemperature(float celsius) {
+  if (celsius < 0) celsius = 0;
+  if (celsius > 60) celsius = 60;
+  int16_t temperature = (int16_t)(celsius * 100 + 0.5);
+  if (temperature == probeTemperature) {
+    return;
+  }
+
+  probeTemperature = temperature;
+  nernstQ15 = nernstFactor(temperature);
+  conductivityQ15 = conductivityFactor(temperature);
+}
+
+// pH in hundredths: refer the code to 25 degC, then apply the probe's
+// curve, or the default kernel when it has no calibration points
+int16_t compensatedPH(uint16_t code) {
+  uint16_t code25 = phCodeAt25(code, nernstQ15, phNeutral);
+  if (phCurve.count == 0) {
+    return phFromAdc(code25);
+  }
+  return (int16_t)evaluateCurve(phCurve, code25);
+}
+
+// TDS in 1/TDS_TABLE_SCALE ppm: table value referred to 25 degC, then
+// the probe's curve if it has calibration points
+uint16_t compensatedTDS(uint16_t code) {
+  uint16_t tds25 = tdsAt25(code, conductivityQ15);
+  if (tdsCurve.count == 0) {
+    return tds25;
+  }
+  return clampCode(evaluateCurve(tdsCurve, tds25));
+}
+
+// Put a point into a profile: over a stored point whose value is within
+// 'tolerance', else into a free slot, else over the point nearest in value
+static void insertPoint(ProbeProfile& profile, const CalibrationPoint& point, uint16_t tolerance) {
+  uint8_t nearest = 0;
+  uint16_t nearestDistance = 0xFFFF;
+  for (uint8_t i = 0; i < profile.count; i++) {
+    uint16_t value = profile.points[i].value;
+    uint16_t distance = value > point.value ? value - point.value : point.value - value;
+    if (distance < nearestDistance) {
+      nearest = i;
+      nearestDistance = distance;
+    }
+  }
+
+  if (nearestDistance > tolerance && profile.count < PROBE_CAL_POINTS) {
+    nearest = profile.count++;
+  }
+  profile.magic = PROBE_CAL_MAGIC;
+  profile.points[nearest] = point;
+}
+
+// Add a pH buffer point, keeping the old profile if the curve is implausible
+bool addPHPoint(uint16_t code, float pH) {
+  if (code == 0 || pH < 0 || pH > 14) {
+    return false;
+  }
+
+  ProbeProfile candidate = loadProfile(EEPROM_PH_CAL_ADDR, phCurve);
+  CalibrationPoint point = { code, probeTemperature, (uint16_t)(pH * 100 + 0.5) };
+  insertPoint(candidate, point, 50);
+
+  CalibrationCurve curve;
+  uint16_t neutral;
+  if (!buildPHCurve(candidate, curve, neutral)) {
+    return false;
+  }
+  phCurve = curve;
+  phNeutral = neutral;
+  EEPROM.put(EEPROM_PH_CAL_ADDR, candidate);
+  return true;
+}
+
+// Add a TDS standard point, keeping the old profile if the curve is
+// implausible
+bool addTDSPoint(uint16_t code, float ppm) {
+  if (code == 0 || ppm < 1 || ppm * TDS_TABLE_SCALE > 65535) {
+    return false;
+  }
+
+  ProbeProfile candidate = loadProfile(EEPROM_TDS_CAL_ADDR, tdsCurve);
+  uint16_t value = (uint16_t)(ppm * TDS_TABLE_SCALE + 0.5);
+  CalibrationPoint point = { code, probeTemperature, value };
+  insertPoint(candidate, point, value / 10);
+
+  CalibrationCurve curve;
+  if (!buildTDSCurve(candidate, curve)) {
+    return false;
+  }
+  tdsCurve = curve;
+  EEPROM.put(EEPROM_TDS_CAL_ADDR, candidate);
+  return true;
+}
+
+// Forget the pH points and invalidate the stored record
+void clearPHPoints() {
+  phCurve.count = 0;
+  phNeutral = PH_NEUTRAL_CODE;
+  EEPROM.write(EEPROM_PH_CAL_ADDR, 0xFF);
+}
+
+// Forget the TDS points and invalidate the stored record
+void clearTDSPoints() {
+  tdsCurve.count = 0;
+  EEPROM.write(EEPROM_TDS_CAL_ADDR, 0xFF);
+}
+
+// Print one profile, one line per point
+static void printProfile(const char* name, const ProbeProfile& profile, uint8_t decimals,
+                         float scale) {
+  if (profile.count == 0) {
+    Serial.print(F("Cal "));
+    Serial.print(name);
+    Serial.println(F(": default"));
+    return;
+  }
+
+  for (uint8_t i = 0; i < profile.count; i++) {
+    const CalibrationPoint& point = profile.points[i];
+    Serial.print(F("Cal "));
+    Serial.print(name);
+    Serial.print(F(": "));
+    Serial.print(point.value * scale, decimals);
+    Serial.print(F(" at code "));
+    Serial.print(point.code);
+    Serial.print(F(", "));
+    Serial.print(point.temperature * 0.01, 2);
+    Serial.println(F(" C"));
+  }
+}
+
+// Print both calibration profiles
+void printCalibration() {
+  printProfile("pH", loadProfile(EEPROM_PH_CAL_ADDR, phCurve), 2, 0.01);
+  printProfile("TDS", loadProfile(EEPROM_TDS_CAL_ADDR, tdsCurve), 1, 1.0 / TDS_TABLE_SCALE);
+}
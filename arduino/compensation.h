@@ -0,0 +1,65 @@
+#ifndef COMPENSATION_H
+#define COMPENSATION_H
+
+#include <Arduino.h>
+
+// Header file for the pH and TDS compensation engine
+// Turns filtered probe ADC codes into readings corrected for the water
+// temperature and for each probe's own calibration:
+// - pH: the electrode slope is proportional to absolute temperature
+//   (Nernst) and pivots around the probe's pH 7 code, so codes are
+//   referred to 25 degC around that code before the calibration curve
+// - TDS: conductivity rises by TDS_TEMP_COEFF (2 %) per degC, so the
+//   table value is divided by 1 + TDS_TEMP_COEFF * (t - 25)
+// - each probe keeps up to PROBE_CAL_POINTS points, measured in buffer
+//   or standard solutions and stored in EEPROM; readings follow the
+//   piecewise-linear curve through them (see conversion.h). A single pH
+//   point keeps the default slope and corrects the offset, a single TDS
+//   point scales the reading (cell constant), and no points keeps the
+//   constants.h defaults
+// Points keep the temperature they were measured at and are referred to
+// 25 degC when the curve is built, so they may come from different
+// temperatures. The temperature factors are recomputed only when the
+// water temperature changes, leaving each sample a few integer
+// multiplies and shifts
+
+// Function to load the calibration profiles from EEPROM
+// Must be called in setup() before the first probe sample
+void initCompensation();
+
+// Function to set the water temperature the probes are compensated for
+// Called with every DS18B20 conversion; clamped to 0..60 degC
+void setProbeTemperature(float celsius);
+
+// Function to convert a filtered pH probe ADC code (oversampled, as
+// produced by the filter pipeline) to pH at the current temperature
+// Returns pH in hundredths
+int16_t compensatedPH(uint16_t code);
+
+// Function to convert a filtered TDS probe ADC code to TDS referred to
+// 25 degC
+// Returns TDS in 1/TDS_TABLE_SCALE ppm
+uint16_t compensatedTDS(uint16_t code);
+
+// Functions to add a calibration point measured in a solution of known pH
+// or TDS, at the current temperature
+// Parameters: code - filtered ADC code in the solution
+//             pH / ppm - value of the solution
+// A point within 0.5 pH or 10 % TDS of a stored one replaces it; when the
+// profile is full the point nearest in value is replaced
+// The updated profile is stored in EEPROM
+// Returns false, keeping the old profile, if the value is out of range or
+// the curve would be implausible: a pH slope outside 0.5..2 times the
+// default, or a TDS scale outside 0.5..2
+bool addPHPoint(uint16_t code, float pH);
+bool addTDSPoint(uint16_t code, float ppm);
+
+// Functions to drop a probe's calibration points and return to the
+// constants.h defaults
+void clearPHPoints();
+void clearTDSPoints();
+
+// Function to print both calibration profiles on the serial console
+void printCalibration();
+
+#endif
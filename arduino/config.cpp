@@ -0,0 +1,295 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "config.h"
+#include "sensorSystem.h"
+#include "lora_comm.h"
+#include "constants.h"
+
+// Configuration block stored at EEPROM_CONFIG_ADDR
+struct StoredConfig {
+  NodeConfig config;
+  uint16_t crc;  // CRC-16/CCITT-FALSE of 'config'
+};
+
+static_assert(EEPROM_CONFIG_ADDR + sizeof(StoredConfig) <= EEPROM_STORE_ADDR,
+              "Config block overlaps the store-and-forward ring");
+
+// Accepted range of each ConfigParam, indexed by parameter - 1
+struct ParamLimits {
+  uint32_t min;
+  uint32_t max;
+};
+static const ParamLimits limits[] = {
+  { 100, 60000 },       // PARAM_SAMPLE_INTERVAL
+  { 1000, 3600000 },    // PARAM_RECORD_INTERVAL
+  { 1000, 3600000 },    // PARAM_REPORT_INTERVAL
+  { 10000, 150000 },    // PARAM_HEARTBEAT_INTERVAL, below the receiver's ADR_RESYNC_TIMEOUT
+  { 5000, 3600000 },    // PARAM_DUTY_CYCLE_PERIOD, longer than warm-up and sampling
+  { 0, 65535 },         // PARAM_TEMP_DEADBAND
+  { 0, 65535 },         // PARAM_PH_DEADBAND
+  { 0, 65535 },         // PARAM_TDS_DEADBAND
+  { 0, 65535 },         // PARAM_ORP_DEADBAND
+  { 0, 1 },             // PARAM_ADR
+  { 2, 17 }             // PARAM_TX_POWER
+};
+constexpr uint8_t PARAM_COUNT = sizeof(limits) / sizeof(limits[0]);
+
+static NodeConfig config;
+
+// Run after every change, NULL when unused
+static ConfigChangeCallback changed = NULL;
+
+// First half of a key being rotated, held until the second half arrives
+static uint8_t stagedKey[8];
+static bool keyHalfStaged = false;
+
+// CRC-16/CCITT-FALSE, as the receiver uses for its serial events
+static uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Read a little-endian 32-bit command argument
+static uint32_t getU32(const uint8_t* src) {
+  return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) |
+         ((uint32_t)src[3] << 24);
+}
+
+// Fill in the constants.h defaults, leaving the key and command history
+static void setDefaults(NodeConfig& c) {
+  c.sampleInterval = ANALOG_SAMPLE_INTERVAL;
+  c.recordInterval = RECORD_INTERVAL;
+  c.reportInterval = REPORT_INTERVAL;
+  c.heartbeatInterval = HEARTBEAT_INTERVAL;
+  c.dutyCyclePeriod = DUTY_CYCLE_PERIOD;
+  c.tempDeadband = (uint16_t)(TEMP_DEADBAND * 100 + 0.5);
+  c.phDeadband = (uint16_t)(PH_DEADBAND * 100 + 0.5);
+  c.tdsDeadband = (uint16_t)(TDS_DEADBAND * 10 + 0.5);
+  c.orpDeadband = ORP_DEADBAND;
+  c.version = CONFIG_VERSION;
+  c.adrEnabled = ADR_ENABLED;
+  c.txPower = LORA_DEFAULT_TX_POWER;
+}
+
+// Write the block; EEPROM.put() only rewrites bytes that changed
+static void storeConfig() {
+  StoredConfig stored;
+  stored.config = config;
+  stored.crc = crc16((const uint8_t*)&config, sizeof(config));
+  EEPROM.put(EEPROM_CONFIG_ADDR, stored);
+}
+
+// Load the block, falling back to the defaults and the factory key
+void initConfig() {
+  StoredConfig stored;
+  EEPROM.get(EEPROM_CONFIG_ADDR, stored);
+  if (stored.config.version == CONFIG_VERSION &&
+      stored.crc == crc16((const uint8_t*)&stored.config, sizeof(stored.config))) {
+    config = stored.config;
+    return;
+  }
+
+  memset(&config, 0, sizeof(config));
+  setDefaults(config);
+  memcpy(config.key, key, sizeof(config.key));
+}
+
+// Settings in use
+const NodeConfig& nodeConfig() {
+  return config;
+}
+
+// Register the callback run after every change
+void onConfigChange(ConfigChangeCallback callback) {
+  changed = callback;
+}
+
+// Change one setting in 'c' if the value is in range
+static bool applyParam(NodeConfig& c, uint8_t param, uint32_t value) {
+  if (param < 1 || param > PARAM_COUNT) {
+    return false;
+  }
+  if (value < limits[param - 1].min || value > limits[param - 1].max) {
+    return false;
+  }
+
+  switch (param) {
+    case PARAM_SAMPLE_INTERVAL:    c.sampleInterval = value; break;
+    case PARAM_RECORD_INTERVAL:    c.recordInterval = value; break;
+    case PARAM_REPORT_INTERVAL:    c.reportInterval = value; break;
+    case PARAM_HEARTBEAT_INTERVAL: c.heartbeatInterval = value; break;
+    case PARAM_DUTY_CYCLE_PERIOD:  c.dutyCyclePeriod = value; break;
+    case PARAM_TEMP_DEADBAND:      c.tempDeadband = value; break;
+    case PARAM_PH_DEADBAND:        c.phDeadband = value; break;
+    case PARAM_TDS_DEADBAND:       c.tdsDeadband = value; break;
+    case PARAM_ORP_DEADBAND:       c.orpDeadband = value; break;
+    case PARAM_ADR:                c.adrEnabled = value; break;
+    case PARAM_TX_POWER:           c.txPower = value; break;
+  }
+  return true;
+}
+
+// Change one setting and store the block
+bool setConfigParam(uint8_t param, uint32_t value) {
+  if (!applyParam(config, param, value)) {
+    return false;
+  }
+  storeConfig();
+  if (changed != NULL) {
+    changed();
+  }
+  return true;
+}
+
+// Return every setting to its default and store the block
+void resetConfig() {
+  setDefaults(config);
+  storeConfig();
+  if (changed != NULL) {
+    changed();
+  }
+}
+
+// Add a calibration point at the current reading, or clear the probe
+static CommandStatus calibrate(uint8_t probe, uint8_t action, long value) {
+  if (action > 1) {
+    return COMMAND_UNKNOWN;
+  }
+
+  switch (probe) {
+    case CAL_PROBE_PH:
+      if (action == 1) {
+        clearPHCalibration();
+        return COMMAND_OK;
+      }
+      return calibratePH(value / 100.0) ? COMMAND_OK : COMMAND_REJECTED;
+    case CAL_PROBE_TDS:
+      if (action == 1) {
+        clearTDSCalibration();
+        return COMMAND_OK;
+      }
+      return calibrateTDS(value / 10.0) ? COMMAND_OK : COMMAND_REJECTED;
+    case CAL_PROBE_ORP:
+      if (action == 1) {
+        clearORPCalibration();
+        return COMMAND_OK;
+      }
+      if (value < -2000 || value > 2000) {
+        return COMMAND_REJECTED;
+      }
+      calibrateORP(value);
+      return COMMAND_OK;
+    default:
+      return COMMAND_UNKNOWN;
+  }
+}
+
+// Take one half of a new key; the second half completes the rotation
+static CommandStatus receiveKeyHalf(uint8_t half, const uint8_t* bytes) {
+  if (half == 0) {
+    memcpy(stagedKey, bytes, sizeof(stagedKey));
+    keyHalfStaged = true;
+    return COMMAND_OK;
+  }
+  if (half != 1 || !keyHalfStaged) {
+    return COMMAND_REJECTED;
+  }
+
+  memcpy(config.key, stagedKey, sizeof(stagedKey));
+  memcpy(config.key + sizeof(stagedKey), bytes, sizeof(stagedKey));
+  config.keyId++;
+  keyHalfStaged = false;
+  return COMMAND_OK;
+}
+
+// Decode and apply one command, returning its status
+static CommandStatus runCommand(uint8_t opcode, const uint8_t* args, uint8_t len) {
+  switch (opcode) {
+    case COMMAND_SET:
+      if (len < 5) return COMMAND_UNKNOWN;
+      if (args[0] < 1 || args[0] > PARAM_COUNT) return COMMAND_UNKNOWN;
+      return applyParam(config, args[0], getU32(args + 1)) ? COMMAND_OK : COMMAND_REJECTED;
+    case COMMAND_CAL:
+      if (len < 6) return COMMAND_UNKNOWN;
+      return calibrate(args[0], args[1], (int32_t)getU32(args + 2));
+    case COMMAND_KEY:
+      if (len < 9) return COMMAND_UNKNOWN;
+      return receiveKeyHalf(args[0], args + 1);
+    case COMMAND_RESET:
+      setDefaults(config);
+      return COMMAND_OK;
+    default:
+      return COMMAND_UNKNOWN;
+  }
+}
+
+// Apply a command received in a downlink
+// A command without an id cannot be answered and is ignored
+void handleCommand(const uint8_t* command, uint8_t len) {
+  if (len < 2 || command[0] == 0) {
+    return;
+  }
+
+  // The id alone does not identify a repeat: the receiver's ids wrap and
+  // restart from a random value, so a new command may reuse the last id
+  uint16_t crc = crc16(command, len);
+  if (command[0] != config.lastCommand || crc != config.lastCommandCrc) {
+    config.lastCommand = command[0];
+    config.lastCommandCrc = crc;
+    config.lastStatus = runCommand(command[1], command + 2, len - 2);
+    storeConfig();
+
+    Serial.print(F("Config: command "));
+    Serial.print(command[0]);
+    Serial.print(F(" opcode "));
+    Serial.print(command[1]);
+    Serial.print(F(" status "));
+    Serial.println(config.lastStatus);
+  }
+
+  // Repeats are answered again: the receiver missed the config frame
+  if (changed != NULL) {
+    changed();
+  }
+}
+
+// Print the settings on the serial console
+void printConfig() {
+  Serial.print(F("Config: v"));
+  Serial.print(config.version);
+  Serial.print(F(" key "));
+  Serial.print(config.keyId);
+  Serial.print(F(" sample="));
+  Serial.print(config.sampleInterval);
+  Serial.print(F(" record="));
+  Serial.print(config.recordInterval);
+  Serial.print(F(" report="));
+  Serial.print(config.reportInterval);
+  Serial.print(F(" heartbeat="));
+  Serial.print(config.heartbeatInterval);
+  Serial.print(F(" duty="));
+  Serial.println(config.dutyCyclePeriod);
+
+  Serial.print(F("Deadbands: temp="));
+  Serial.print(config.tempDeadband);
+  Serial.print(F(" pH="));
+  Serial.print(config.phDeadband);
+  Serial.print(F(" TDS="));
+  Serial.print(config.tdsDeadband);
+  Serial.print(F(" ORP="));
+  Serial.print(config.orpDeadband);
+  Serial.print(F(" ADR="));
+  Serial.print(config.adrEnabled);
+  Serial.print(F(" power="));
+  Serial.print(config.txPower);
+  Serial.print(F(" last command "));
+  Serial.print(config.lastCommand);
+  Serial.print(F(" status "));
+  Serial.println(config.lastStatus);
+}
@@ -0,0 +1,130 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <Arduino.h>
+
+// Header file for the node's runtime configuration
+// Settings that used to need a USB cable - sampling and report periods,
+// deadbands, ADR and transmit power, and the AES key - are kept in a
+// versioned, CRC-checked block at EEPROM_CONFIG_ADDR. A missing, corrupt
+// or older block is replaced by the constants.h defaults and the factory
+// key, so a node always boots with a working configuration
+//
+// The receiver changes them over the air: a command rides on the link
+// hint that answers an uplink (FRAME_TYPE_COMMAND, see adr.h), so it is
+// sealed and authenticated like every downlink and only accepted for the
+// node's latest uplink. The node applies it, stores the block and answers
+// with a config frame (see telemetry.h) carrying the command id and its
+// status. The receiver repeats the command with every hint until that
+// answer arrives; a repeat of the last command, same id and same bytes,
+// is answered again but not applied twice, which matters for calibration
+// points. A new command that happens to reuse the last id is applied
+//
+// Command layout (follows the link hint fields of the downlink):
+//   [0]      command id (1..255), chosen by the receiver
+//   [1]      opcode (COMMAND_*)
+//   [2..]    arguments, multi-byte fields little-endian:
+//     COMMAND_SET     parameter (ConfigParam), value uint32 in the
+//                     parameter's units
+//     COMMAND_CAL     probe (CAL_PROBE_*), action (0 = add a point at the
+//                     current reading, 1 = clear), value int32: pH in
+//                     0.01, TDS in 0.1 ppm, ORP in mV
+//     COMMAND_KEY     half (0 or 1), then 8 bytes of the new key
+//     COMMAND_RESET   none; returns every setting to its default, keeping
+//                     the key
+// Keys are rotated in two halves; the node switches to the new key as
+// soon as the second half arrives, so the config frame answering it is
+// already sealed with the new key
+
+// Command opcodes
+constexpr uint8_t COMMAND_SET = 0x01;
+constexpr uint8_t COMMAND_CAL = 0x02;
+constexpr uint8_t COMMAND_KEY = 0x03;
+constexpr uint8_t COMMAND_RESET = 0x04;
+
+// Probes addressed by COMMAND_CAL
+constexpr uint8_t CAL_PROBE_PH = 0;
+constexpr uint8_t CAL_PROBE_TDS = 1;
+constexpr uint8_t CAL_PROBE_ORP = 2;
+
+// Settings changed by COMMAND_SET, with their units and accepted range
+enum ConfigParam : uint8_t {
+  PARAM_SAMPLE_INTERVAL = 1,     // pH, TDS and ORP sampling period, ms (100..60000)
+  PARAM_RECORD_INTERVAL = 2,     // Time between stored readings, ms (1000..3600000)
+  PARAM_REPORT_INTERVAL = 3,     // Time between transmission attempts, ms (1000..3600000)
+  PARAM_HEARTBEAT_INTERVAL = 4,  // Longest time without a stored reading, ms (10000..150000)
+  PARAM_DUTY_CYCLE_PERIOD = 5,   // Power-save sampling window period, ms (5000..3600000)
+  PARAM_TEMP_DEADBAND = 6,       // 0.01 degC (0..65535)
+  PARAM_PH_DEADBAND = 7,         // 0.01 pH (0..65535)
+  PARAM_TDS_DEADBAND = 8,        // 0.1 ppm (0..65535)
+  PARAM_ORP_DEADBAND = 9,        // mV (0..65535)
+  PARAM_ADR = 10,                // Follow the receiver's data rate hints (0 or 1)
+  PARAM_TX_POWER = 11            // Transmit power, dBm (2..17)
+};
+
+// Outcome of the last command, reported in the config frame
+enum CommandStatus : uint8_t {
+  COMMAND_OK = 0,        // Applied and stored
+  COMMAND_REJECTED = 1,  // Value out of range or calibration rejected
+  COMMAND_UNKNOWN = 2    // Opcode, parameter or probe not known, or truncated
+};
+
+// Layout version of the EEPROM block; a block of another version is
+// replaced by the defaults
+constexpr uint8_t CONFIG_VERSION = 2;
+
+// Settings in use
+// Deadbands are in the telemetry record units (see telemetry.h)
+struct NodeConfig {
+  uint32_t sampleInterval;     // ms
+  uint32_t recordInterval;     // ms
+  uint32_t reportInterval;     // ms
+  uint32_t heartbeatInterval;  // ms
+  uint32_t dutyCyclePeriod;    // ms
+  uint16_t tempDeadband;       // 0.01 degC
+  uint16_t phDeadband;         // 0.01 pH
+  uint16_t tdsDeadband;        // 0.1 ppm
+  uint16_t orpDeadband;        // mV
+  uint16_t lastCommandCrc;     // CRC-16 of the last command, id to last argument
+  uint8_t version;             // CONFIG_VERSION
+  uint8_t adrEnabled;          // 0 or 1
+  uint8_t txPower;             // dBm
+  uint8_t keyId;               // Number of key rotations, 0 = factory key
+  uint8_t lastCommand;         // Id of the last command received, 0 = none
+  uint8_t lastStatus;          // CommandStatus of that command
+  uint8_t key[16];             // AES-128 link key
+};
+
+// Callback run after the configuration has changed
+typedef void (*ConfigChangeCallback)();
+
+// Function to load the configuration from EEPROM
+// Must be called first in setup(), before anything reads nodeConfig()
+void initConfig();
+
+// Function to get the settings in use
+const NodeConfig& nodeConfig();
+
+// Function to register the callback run after every change, including
+// commands that only repeat the last one
+// The callback applies the new periods and sends a config frame
+void onConfigChange(ConfigChangeCallback callback);
+
+// Function to change one setting and store the block
+// Returns false, leaving the configuration unchanged, if the parameter is
+// unknown or the value out of range
+bool setConfigParam(uint8_t param, uint32_t value);
+
+// Function to return every setting to its default and store the block
+// The key, key id and last command id are kept
+void resetConfig();
+
+// Function to apply a command received in a downlink
+// Parameters: command - the bytes after the link hint fields
+//             len - number of bytes
+void handleCommand(const uint8_t* command, uint8_t len);
+
+// Function to print the settings on the serial console
+void printConfig();
+
+#endif
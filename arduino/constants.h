@@ -6,23 +6,158 @@
 // Modify these values to adjust sensor behavior and system timing
 
 // Physical constants for ultrasonic distance calculation
-constexpr float SOUND_SPEED = 340.1;  // Speed of sound in air at room temperature (m/s)
-constexpr unsigned long PULSE_TIMEOUT = 12000;  // Maximum time to wait for ultrasonic echo (microseconds)
+constexpr float SOUND_SPEED_0C = 331.3;      // Speed of sound in air at 0 degrees C (m/s)
+constexpr float SOUND_SPEED_PER_C = 0.606;   // Increase of the speed of sound per degree C (m/s)
+constexpr unsigned long PULSE_TIMEOUT = 12000;  // Longest echo accepted, about 2 m of range (microseconds)
+
+// Interrupt-driven ranging bursts
+constexpr uint8_t ULTRASONIC_BURST_PINGS = 3;     // Pings per burst, the median is reported
+constexpr uint8_t ULTRASONIC_MAX_PINGS = 7;       // Largest burst startRanging() accepts
+constexpr unsigned long PING_INTERVAL = 50;       // Minimum time between pings, lets echoes die out (milliseconds)
+constexpr unsigned long ECHO_LOST_TIMEOUT = 60;   // Abandon a ping whose echo never ends (milliseconds)
+
+// Analog front end shared by the pH and TDS probes
+constexpr float ADC_REFERENCE_VOLTAGE = 5.0;  // ADC reference voltage (V)
+constexpr uint16_t ADC_MAX = 1023;            // Highest 10-bit ADC code
+
+// Analog filter pipeline (see filters.h)
+// Each pH/TDS sample is 4^ANALOG_OVERSAMPLE_BITS reads (~110 us each)
+constexpr uint8_t ANALOG_OVERSAMPLE_BITS = 2;  // Extra bits of resolution from oversampling (0-3)
+constexpr uint8_t ANALOG_MEDIAN_WINDOW = 5;    // Samples in the spike-rejecting median (odd, 1 = off)
+constexpr uint8_t ANALOG_EMA_SHIFT = 2;        // EMA weight of a new sample is 1/2^n (0 = off)
+constexpr uint8_t ORP_MEDIAN_WINDOW = 5;       // Median window for the ORP library readings (odd, 1 = off)
+constexpr uint8_t ORP_EMA_SHIFT = 2;           // EMA weight for ORP readings is 1/2^n (0 = off)
+
+// pH probe default calibration at 25 degC: pH 7.0 reads PH_NEUTRAL_VOLTAGE,
+// pH rises as the voltage falls; replaced by "CAL,PH,x" points (see compensation.h)
+constexpr float PH_NEUTRAL_VOLTAGE = 2.5;  // Probe output at pH 7.0 (V)
+constexpr float PH_VOLTS_PER_UNIT = 0.18;  // Probe sensitivity at 25 degC (V per pH unit)
+
+// TDS probe cubic calibration curve at 25 degC: ppm = (a*V^3 + b*V^2 + c*V) * factor
+// The cubic gives the conductivity (uS/cm), the factor converts it to TDS
+constexpr float TDS_COEFF_CUBIC = 133.42;
+constexpr float TDS_COEFF_SQUARE = -255.86;
+constexpr float TDS_COEFF_LINEAR = 857.39;
+constexpr float TDS_FACTOR = 0.5;         // ppm per uS/cm
+constexpr float TDS_TEMP_COEFF = 0.02;    // Conductivity change per degC, referred to 25 degC
+
+// Probe calibration profiles, loaded with "CAL,PH,x" / "CAL,TDS,x"
+constexpr uint8_t PROBE_CAL_POINTS = 3;   // Calibration points kept per probe
 
 // Compass calibration and magnetic declination settings
+// These are the defaults for a unit that has not been calibrated with
+// "CAL,MAG" / "CAL,DECL,x"; calibrated values are kept in EEPROM
 constexpr float declinationAngle = 0.009;  // Local magnetic declination angle in radians (~0.5 degrees)
 // Compass hard iron calibration values - determined through calibration procedure
 constexpr float x_min = -27.64;  // Minimum X magnetometer reading during calibration
 constexpr float x_max = 43.36;   // Maximum X magnetometer reading during calibration
 constexpr float y_min = -47.82;  // Minimum Y magnetometer reading during calibration
 constexpr float y_max = 24.36;   // Maximum Y magnetometer reading during calibration
+constexpr uint8_t COMPASS_SAMPLES = 4;   // Number of magnetometer samples averaged per heading
+constexpr unsigned long COMPASS_CAL_DURATION = 30000;  // Length of a "CAL,MAG" run, turn the unit at least once (milliseconds)
+constexpr float COMPASS_CAL_MIN_SPAN = 25.0;  // Smallest X and Y range accepted from a run (uT), less means no full turn
 
 // Obstacle detection thresholds for ultrasonic sensor
 constexpr int MIN_OBS_DISTANCE = 15;  // Minimum distance in cm to trigger obstacle detection
 constexpr int MAX_OBS_DISTANCE = 30;  // Maximum distance in cm for obstacle detection range
 
+// Record, report and analog sample intervals, the deadbands, heartbeat,
+// duty cycle period and ADR switch below are defaults: the values in use
+// live in the EEPROM config block and can be changed over the air (see config.h)
+
 // Communication timing intervals
-constexpr unsigned long PATH_INTERVAL = 1000;  // Time between GPS path log messages (milliseconds)
+constexpr unsigned long PATH_INTERVAL = 1000;  // Time between GPS path points (milliseconds)
+constexpr unsigned long PATH_REPORT_INTERVAL = 10000;  // Time between PATH frames carrying the queued points (milliseconds)
+constexpr unsigned long FIX_MAX_AGE = 3000;    // Oldest GPS fix still used for path points (milliseconds)
+constexpr unsigned long GPS_TIME_MAX_AGE = 10000;  // Oldest GPS time still extrapolated with millis() (milliseconds)
 constexpr unsigned long OBS_INTERVAL = 1000;   // Time between obstacle detection messages (milliseconds)
+constexpr unsigned long OBS_REPORT_INTERVAL = 10000;  // Time between OBSTACLE frames, the latest sighting is sent (milliseconds)
+constexpr unsigned long RANGE_INTERVAL = 200;  // Time between ultrasonic ranging bursts (milliseconds)
+constexpr unsigned long RECORD_INTERVAL = 3000;  // Time between stored readings (milliseconds)
+constexpr unsigned long REPORT_INTERVAL = 3000;  // Time between transmission attempts (milliseconds)
+
+// Sensor sampling periods for the task scheduler
+constexpr unsigned long TEMP_SAMPLE_INTERVAL = 1000;    // DS18B20 conversion cycle, must exceed 750 ms at 12-bit (milliseconds)
+constexpr unsigned long ANALOG_SAMPLE_INTERVAL = 250;   // pH, TDS and ORP probe sampling period (milliseconds)
+constexpr unsigned long COMPASS_SAMPLE_INTERVAL = 10;   // Time between magnetometer samples (milliseconds)
+
+// Path points queued for the next PATH frame
+constexpr uint8_t PATH_CAPACITY = 12;
+
+// Store-and-forward buffering and batching
+constexpr uint8_t STORE_CAPACITY = 8;         // Readings held in RAM, at least BATCH_SIZE; a backlog spills to EEPROM
+constexpr uint8_t BATCH_SIZE = 8;             // Readings per LoRa frame, 1 = one TELEMETRY_FRAME_SIZE frame per reading
+constexpr bool STORE_EEPROM_SPILL = true;     // Move readings to EEPROM instead of dropping them when RAM is full
+constexpr unsigned long UPLINK_ACK_TIMEOUT = 60000;  // Longest wait for the downlink releasing sent readings, exceeds a slot frame plus backoff (milliseconds)
+
+// Report by exception: a reading is stored, and sent at the next report,
+// only when a channel moved past its deadband or the heartbeat is due
+constexpr bool REPORT_BY_EXCEPTION = true;          // false = store every reading and wait for full batches
+constexpr float TEMP_DEADBAND = 0.1;                // degC
+constexpr float PH_DEADBAND = 0.05;                 // pH units
+constexpr float TDS_DEADBAND = 2.0;                 // ppm
+constexpr int ORP_DEADBAND = 10;                    // mV
+// Must stay below the receiver's ADR_RESYNC_TIMEOUT (180 s) so a quiet
+// node is heard before the receiver falls back to the default data rate
+constexpr unsigned long HEARTBEAT_INTERVAL = 120000;  // Longest time without a stored reading (milliseconds)
+
+// Delta encoding against the last keyframe the receiver acknowledged
+constexpr bool DELTA_ENCODING = true;                 // false = always send full single/batch frames
+constexpr unsigned long KEYFRAME_INTERVAL = 3600000;  // Time before a fresh keyframe is sent (milliseconds)
+
+// EEPROM layout (1 KB on the ATmega328P)
+constexpr int EEPROM_ORP_ADDR = 0;           // Reserved for the Surveyor ORP library calibration (16 bytes)
+constexpr int EEPROM_COUNTER_ADDR = 16;      // Highest reserved packet counter (4 bytes)
+constexpr int EEPROM_COMPASS_ADDR = 20;      // Compass calibration and declination (19 bytes)
+constexpr int EEPROM_PH_CAL_ADDR = 48;       // pH probe calibration profile (20 bytes)
+constexpr int EEPROM_TDS_CAL_ADDR = 68;      // TDS probe calibration profile (20 bytes)
+constexpr int EEPROM_CONFIG_ADDR = 88;       // Runtime configuration and link key (54 bytes)
+constexpr int EEPROM_STORE_ADDR = 640;       // Store-and-forward overflow ring
+constexpr int EEPROM_STORE_RECORDS = 24;     // Readings in the overflow ring
+
+// LoRa data rate and adaptive data rate (ADR)
+constexpr uint8_t LORA_DEFAULT_SF = 12;          // Spreading factor at boot and after ADR fallback
+constexpr uint8_t LORA_DEFAULT_CR = 8;           // Coding rate denominator (4/8) at boot and after fallback
+constexpr uint8_t LORA_DEFAULT_TX_POWER = 17;    // Transmit power on PA_BOOST (dBm, 2..17)
+constexpr bool ADR_ENABLED = true;               // Follow the receiver's data rate hints
+constexpr uint8_t ADR_MAX_MISSED = 3;            // Missed downlinks before falling back to the default rate
+constexpr unsigned long DOWNLINK_DELAY = 250;    // Receiver's delay between uplink end and downlink (milliseconds)
+constexpr unsigned long RX_WINDOW_MARGIN = 100;  // Extra receive window time for clock and processing slack (milliseconds)
+
+// Transmit scheduling and listen-before-talk (see txschedule.h)
+constexpr bool LBT_ENABLED = true;              // Check the channel with CAD before every uplink
+constexpr uint8_t LBT_MAX_ATTEMPTS = 6;         // Busy channel checks before the uplink is sent anyway
+constexpr uint8_t LBT_MAX_BACKOFF_EXP = 3;      // Backoff window grows to 2^n channel occupancies
+constexpr unsigned long TX_JITTER_MAX = 500;    // Random delay before every uplink, so nodes drift out of step (milliseconds)
+constexpr bool TX_SLOTTED = false;              // Send only in this node's slot of a frame timed by GPS
+constexpr uint8_t TX_SLOT_COUNT = 8;            // Slots per frame; this node owns slot NODE_ID % TX_SLOT_COUNT
+constexpr unsigned long TX_SLOT_LENGTH = 4000;  // Slot length, fits an uplink and its receive window at the rate ADR settles on (milliseconds)
+constexpr unsigned long TX_SLOT_GUARD = 200;    // Kept clear at both slot edges for GPS time error (milliseconds)
+
+// Low-power duty cycle (see power.h)
+constexpr bool POWER_SAVE_DEFAULT = false;            // Boot in power-save mode, toggled with "POWER,SAVE" / "POWER,ON"
+constexpr unsigned long DUTY_CYCLE_PERIOD = 60000;    // Time between the starts of two sampling windows (milliseconds)
+constexpr unsigned long SENSOR_WARMUP = 1000;         // Probe settling time after power-up (milliseconds)
+constexpr unsigned long SAMPLING_WINDOW = 2000;       // Sampling time once the probes have settled (milliseconds)
+constexpr unsigned long ENERGY_REPORT_INTERVAL = 600000;  // Time between energy budget frames (milliseconds)
+
+// Nominal supply currents for energy accounting (microamps)
+constexpr uint32_t CURRENT_CPU_ACTIVE = 12000;   // ATmega328P at 16 MHz, 5 V
+constexpr uint32_t CURRENT_CPU_SLEEP = 10;       // Power-down with the watchdog running
+constexpr uint32_t CURRENT_RADIO_TX = 90000;     // SX1276 at +17 dBm on PA_BOOST
+constexpr uint32_t CURRENT_RADIO_RX = 11500;     // SX1276 receiving
+constexpr uint32_t CURRENT_SENSORS = 25000;      // pH, TDS and ORP boards plus the DS18B20
+constexpr uint32_t CURRENT_GPS = 45000;          // GPS module tracking, active antenna
+
+// On-device performance instrumentation (see perf.h)
+constexpr bool PERF_ENABLED = true;                      // Time the instrumented code paths
+constexpr unsigned long PERF_REPORT_INTERVAL = 3600000;  // Time between PERF frames (milliseconds, keep under ~70 min: sums are 32-bit microseconds)
+
+// Packet counter persistence: the counter is the AES-CCM nonce and must
+// never repeat, so blocks of counters are reserved in EEPROM ahead of use
+constexpr uint32_t COUNTER_RESERVE = 256;  // Packets per EEPROM write (EEPROM wear vs counters skipped at reset)
+
+// Telemetry identification
+constexpr uint8_t NODE_ID = 1;  // Unique id of this sensor node, carried in every telemetry frame
 
 #endif
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include <Arduino.h>
+#include "conversion.h"
+#include "constants.h"
+
+// === pH ===
+// pH = 7 + (PH_NEUTRAL_VOLTAGE - raw * ADC_REFERENCE_VOLTAGE / ADC_MAX) / PH_VOLTS_PER_UNIT
+// rearranged into hundredths of pH as offset - raw * slope, both in Q16
+constexpr long PH_OFFSET_Q16 =
+    (long)(65536.0 * 100.0 * (7.0 + PH_NEUTRAL_VOLTAGE / PH_VOLTS_PER_UNIT) + 0.5);
+constexpr long PH_SLOPE_Q16 =
+    (long)(65536.0 * 100.0 * ADC_REFERENCE_VOLTAGE / (ADC_MAX * PH_VOLTS_PER_UNIT) + 0.5);
+
+static_assert(PH_OFFSET_Q16 + PH_SLOPE_Q16 * ADC_MAX < 2147483647L &&
+              PH_SLOPE_Q16 * ((long)ADC_MAX << ANALOG_OVERSAMPLE_BITS) < 2147483647L,
+              "pH calibration does not fit the Q16 kernel");
+
+// Convert a pH probe reading to hundredths of pH
+// One 16x32 multiply and two shifts; the +32768 rounds to nearest
+int16_t phFromAdc(uint16_t code) {
+  long slope = ((long)code * PH_SLOPE_Q16) >> ANALOG_OVERSAMPLE_BITS;
+  return (int16_t)((PH_OFFSET_Q16 - slope + 32768) >> 16);
+}
+
+// === TDS ===
+// The cubic calibration curve evaluated for every ADC code at compile
+// time and stored in flash, so a conversion is a single table read
+
+// TDS in 1/TDS_TABLE_SCALE ppm for one ADC code, as computed by the
+// original float formula
+constexpr double tdsVoltage(unsigned raw) {
+  return raw * (ADC_REFERENCE_VOLTAGE / ADC_MAX);
+}
+
+constexpr double tdsPpm(double v) {
+  return (TDS_COEFF_CUBIC * v * v * v + TDS_COEFF_SQUARE * v * v + TDS_COEFF_LINEAR * v) *
+         TDS_FACTOR;
+}
+
+constexpr uint16_t tdsEntry(unsigned raw) {
+  return tdsPpm(tdsVoltage(raw)) <= 0 ? 0
+                                      : (uint16_t)(tdsPpm(tdsVoltage(raw)) * TDS_TABLE_SCALE + 0.5);
+}
+
+static_assert(tdsPpm(ADC_REFERENCE_VOLTAGE) * TDS_TABLE_SCALE < 65535,
+              "TDS calibration overflows the 16-bit table, lower TDS_TABLE_SCALE");
+
+// Compile-time list of table indexes 0..N-1
+// C++11 has no std::index_sequence; this builds one with logarithmic
+// template recursion depth so 1024 entries stay within compiler limits
+template <unsigned... Is>
+struct Indices {};
+
+template <typename A, typename B>
+struct JoinIndices;
+
+template <unsigned... As, unsigned... Bs>
+struct JoinIndices<Indices<As...>, Indices<Bs...>> {
+  typedef Indices<As..., (sizeof...(As) + Bs)...> type;
+};
+
+template <unsigned N>
+struct MakeIndices {
+  typedef typename JoinIndices<typename MakeIndices<N / 2>::type,
+                               typename MakeIndices<N - N / 2>::type>::type type;
+};
+
+template <>
+struct MakeIndices<1> {
+  typedef Indices<0> type;
+};
+
+template <typename Seq>
+struct TdsTable;
+
+template <unsigned... Is>
+struct TdsTable<Indices<Is...>> {
+  static const uint16_t values[sizeof...(Is)];
+};
+
+template <unsigned... Is>
+const uint16_t TdsTable<Indices<Is...>>::values[sizeof...(Is)] PROGMEM = { tdsEntry(Is)... };
+
+typedef TdsTable<MakeIndices<ADC_MAX + 1>::type> TdsLookup;
+
+// Convert a TDS probe reading by table lookup
+// The whole ADC count indexes the table, the oversampling fraction
+// interpolates towards the next entry, rounding to nearest
+uint16_t tdsFromAdc(uint16_t code) {
+  uint16_t index = code >> ANALOG_OVERSAMPLE_BITS;
+  uint8_t fraction = code & ((1 << ANALOG_OVERSAMPLE_BITS) - 1);
+  if (index >= ADC_MAX) {
+    return pgm_read_word(&TdsLookup::values[ADC_MAX]);
+  }
+
+  uint16_t low = pgm_read_word(&TdsLookup::values[index]);
+  uint16_t high = pgm_read_word(&TdsLookup::values[index + 1]);
+  return low + (((uint32_t)(high - low) * fraction + ((1 << ANALOG_OVERSAMPLE_BITS) >> 1)) >> ANALOG_OVERSAMPLE_BITS);
+}
+
+// === Calibration curves ===
+
+// Sort the points by x (insertion sort, at most CURVE_MAX_POINTS) and
+// precompute each segment's slope
+bool buildCurve(CalibrationCurve& curve, const uint16_t* x, const long* y, uint8_t count) {
+  if (count < 2 || count > CURVE_MAX_POINTS) {
+    return false;
+  }
+
+  curve.count = count;
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t j = i;
+    for (; j > 0 && curve.x[j - 1] > x[i]; j--) {
+      curve.x[j] = curve.x[j - 1];
+      curve.y[j] = curve.y[j - 1];
+    }
+    curve.x[j] = x[i];
+    curve.y[j] = y[i];
+  }
+
+  for (uint8_t i = 0; i + 1 < count; i++) {
+    long dx = (long)curve.x[i + 1] - curve.x[i];
+    if (dx == 0) {
+      return false;
+    }
+    long slope = (curve.y[i + 1] - curve.y[i]) * 16384 / dx;
+    if (slope >= 32768 || slope <= -32768) {
+      return false;
+    }
+    curve.slope[i] = slope;
+  }
+  return true;
+}
+
+// Evaluate on the segment that holds x, or the end segment past either end
+// |x - x[i]| < 2^16 and |slope| < 2^15 keep the product within 32 bits;
+// the arithmetic shift rounds negative products to nearest as well
+long evaluateCurve(const CalibrationCurve& curve, uint16_t x) {
+  uint8_t i = 0;
+  while (i + 2 < curve.count && x > curve.x[i + 1]) {
+    i++;
+  }
+  return curve.y[i] + ((((long)x - curve.x[i]) * curve.slope[i] + 8192) >> 14);
+}
+
+// === Compass heading ===
+
+// Hard iron calibration folded into one multiply and add per axis:
+// ((v - min) / (max - min) * 2 - 1) * MAG_NORM_SCALE
+// Scaling each axis by its own range also removes the axis-aligned part
+// of soft iron distortion
+static float magXGain = 2.0 * MAG_NORM_SCALE / (x_max - x_min);
+static float magXOffset = -x_min * magXGain - MAG_NORM_SCALE;
+static float magYGain = 2.0 * MAG_NORM_SCALE / (y_max - y_min);
+static float magYOffset = -y_min * magYGain - MAG_NORM_SCALE;
+
+void setMagCalibration(float xMin, float xMax, float yMin, float yMax) {
+  magXGain = 2.0 * MAG_NORM_SCALE / (xMax - xMin);
+  magXOffset = -xMin * magXGain - MAG_NORM_SCALE;
+  magYGain = 2.0 * MAG_NORM_SCALE / (yMax - yMin);
+  magYOffset = -yMin * magYGain - MAG_NORM_SCALE;
+}
+
+// Clamp to int16 so a wild reading cannot wrap around
+static int16_t toFixed(float value) {
+  if (value > 32767) return 32767;
+  if (value < -32767) return -32767;
+  return (int16_t)(value < 0 ? value - 0.5 : value + 0.5);
+}
+
+int16_t normalizeMagX(float x) {
+  return toFixed(x * magXGain + magXOffset);
+}
+
+int16_t normalizeMagY(float y) {
+  return toFixed(y * magYGain + magYOffset);
+}
+
+// atan(i / 32) in hundredths of a degree for i = 0..32
+static const uint16_t ATAN_TABLE[33] PROGMEM = {
+     0,  179,  358,  536,  713,  888, 1062, 1234, 1404, 1571, 1735,
+  1897, 2056, 2211, 2363, 2511, 2657, 2798, 2936, 3070, 3201, 3327,
+  3451, 3571, 3687, 3800, 3909, 4016, 4119, 4218, 4315, 4409, 4500
+};
+
+// Integer atan2 in hundredths of a degree
+// Reduces the angle to the first octant (0..45 degrees), where the ratio
+// of the smaller to the larger component indexes the arctangent table
+int16_t atan2Centidegrees(int16_t y, int16_t x) {
+  uint16_t ax = x < 0 ? -(long)x : x;
+  uint16_t ay = y < 0 ? -(long)y : y;
+  if (ax == 0 && ay == 0) {
+    return 0;
+  }
+
+  // Ratio min/max in Q15 (0..32768)
+  bool steep = ay > ax;
+  uint16_t ratio = steep ? ((uint32_t)ax << 15) / ay : ((uint32_t)ay << 15) / ax;
+
+  // 32 table segments of 1024 ratio steps each
+  uint8_t index = ratio >> 10;
+  uint16_t fraction = ratio & 1023;
+  int16_t angle = pgm_read_word(&ATAN_TABLE[index]);
+  if (index < 32) {
+    int16_t next = pgm_read_word(&ATAN_TABLE[index + 1]);
+    angle += ((long)(next - angle) * fraction + 512) >> 10;
+  }
+
+  // Unfold the octant
+  if (steep) angle = 9000 - angle;
+  if (x < 0) angle = 18000 - angle;
+  if (y < 0) angle = -angle;
+  return angle;
+}
@@ -0,0 +1,79 @@
+#ifndef CONVERSION_H
+#define CONVERSION_H
+
+#include <Arduino.h>
+
+// Header file for integer sensor conversion kernels
+// Replaces the float formulas for pH, TDS and compass heading with lookup
+// tables and fixed-point arithmetic, so each sample costs a few integer
+// operations instead of software floating point (pow, atan2, division)
+// on the FPU-less AVR. The probe kernels are derived at compile time from
+// the calibration constants in constants.h; the magnetometer calibration
+// and the probe calibration curves (see compensation.h) can be replaced
+// at run time
+
+// Scale of the TDS table entries: 8 = 1/8 ppm resolution
+// Fine enough that the table never adds error beyond the ADC's own
+// quantization (about 2 ppm per count), while 5 V still fits 16 bits
+constexpr uint8_t TDS_TABLE_SCALE = 8;
+
+// Scale of the fixed-point magnetometer inputs to headingCentidegrees()
+// A normalized reading of 1.0 is represented as MAG_NORM_SCALE
+constexpr int16_t MAG_NORM_SCALE = 4096;
+
+// Both probe kernels take oversampled ADC codes as produced by the filter
+// pipeline: counts scaled by 2^ANALOG_OVERSAMPLE_BITS (constants.h)
+
+// Function to convert a pH probe ADC code to pH
+// Returns pH in hundredths (e.g. 720 = pH 7.20), rounded to nearest
+int16_t phFromAdc(uint16_t code);
+
+// Function to convert a TDS probe ADC code to TDS
+// Looks up the cubic calibration curve in a 1024-entry flash table,
+// interpolating linearly for the oversampling fraction bits; table
+// entries and the interpolation both round to nearest, so the result is
+// within 1/TDS_TABLE_SCALE ppm of the cubic
+// Returns TDS in 1/TDS_TABLE_SCALE ppm
+uint16_t tdsFromAdc(uint16_t code);
+
+// Most points a calibration curve can hold
+constexpr uint8_t CURVE_MAX_POINTS = 3;
+
+// Piecewise-linear calibration curve prepared for integer evaluation
+// Points are sorted by x; the first and last segments extend past the
+// ends of the curve
+struct CalibrationCurve {
+  uint8_t count;                     // Points in use, 2..CURVE_MAX_POINTS
+  uint16_t x[CURVE_MAX_POINTS];      // Inputs, ascending
+  long y[CURVE_MAX_POINTS];          // Outputs at the points
+  int16_t slope[CURVE_MAX_POINTS - 1];  // dy/dx of each segment in Q14, below +/-2
+};
+
+// Function to prepare a curve through 'count' points given in any order
+// Returns false if there are fewer than 2 or more than CURVE_MAX_POINTS
+// points, two points share an x, or a segment is steeper than +/-2 (its
+// product with a 16-bit input would overflow the kernel)
+bool buildCurve(CalibrationCurve& curve, const uint16_t* x, const long* y, uint8_t count);
+
+// Function to evaluate a prepared curve at 'x'
+// One segment search, one multiply and a shift; rounds to nearest
+long evaluateCurve(const CalibrationCurve& curve, uint16_t x);
+
+// Function to set the magnetometer calibration used by normalizeMagX/Y
+// Parameters: the extremes of each axis over a full turn (uT)
+// The defaults are the x_min..y_max constants from constants.h
+void setMagCalibration(float xMin, float xMax, float yMin, float yMax);
+
+// Function to convert raw magnetometer axes (uT) to normalized fixed point
+// Applies the hard iron offset and per-axis scale so that the calibrated
+// range maps to -MAG_NORM_SCALE..+MAG_NORM_SCALE
+int16_t normalizeMagX(float x);
+int16_t normalizeMagY(float y);
+
+// Function to compute atan2(y, x) on integers
+// Uses octant reduction and a 33-entry arctangent table with linear
+// interpolation; worst-case error is about 0.01 degree
+// Returns the angle in hundredths of a degree, -18000..18000
+int16_t atan2Centidegrees(int16_t y, int16_t x);
+
+#endif
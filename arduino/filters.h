@@ -0,0 +1,145 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <Arduino.h>
+
+// Header file for the sensor filter pipeline
+// Small statically sized filter stages that can be chained per channel:
+//   Oversampler    - reads an analog pin 4^n times and decimates the sum,
+//                    gaining n bits of resolution from the probe noise
+//   MedianFilter   - median of the last K samples, rejects single spikes
+//   EmaFilter      - exponential moving average with weight 1/2^n
+//   AnalogPipeline - the three stages above for one analog channel
+//   CircularMean   - averages headings as x/y vectors, so samples either
+//                    side of north average to north instead of south
+// All stages are integer only and allocate nothing at run time
+
+// Reads an analog pin 4^BITS times and returns the decimated sum
+// Result is in ADC counts scaled by 2^BITS (e.g. 12-bit for BITS = 2)
+template <uint8_t BITS>
+class Oversampler {
+public:
+  static_assert(BITS <= 3, "Oversampling sum would overflow 16 bits");
+
+  explicit Oversampler(uint8_t pin) : pin(pin) {}
+
+  uint16_t sample() const {
+    uint16_t sum = 0;
+    for (uint16_t i = 0; i < (1u << (2 * BITS)); i++) {
+      sum += analogRead(pin);
+    }
+    return sum >> BITS;
+  }
+
+private:
+  uint8_t pin;
+};
+
+// Median of the last K values
+// Until K values have been seen, the median of those available is returned
+template <typename T, uint8_t K>
+class MedianFilter {
+public:
+  static_assert(K % 2 == 1, "Median window must be odd");
+
+  T update(T value) {
+    window[next] = value;
+    next = (next + 1) % K;
+    if (count < K) {
+      count++;
+    }
+
+    // Insertion sort of a copy; K is small, so this beats anything clever
+    T sorted[K];
+    for (uint8_t i = 0; i < count; i++) {
+      T item = window[i];
+      uint8_t j = i;
+      while (j > 0 && sorted[j - 1] > item) {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = item;
+    }
+    return sorted[count / 2];
+  }
+
+private:
+  T window[K];
+  uint8_t next = 0;   // Slot the next value is written to
+  uint8_t count = 0;  // Values stored, up to K
+};
+
+// Exponential moving average: y += (x - y) / 2^SHIFT
+// The accumulator keeps SHIFT fraction bits so small steps are not lost
+// The first value initializes the average; SHIFT = 0 passes values through
+template <uint8_t SHIFT>
+class EmaFilter {
+public:
+  long update(long value) {
+    if (!primed) {
+      accumulator = value * (1L << SHIFT);
+      primed = true;
+    } else {
+      accumulator += value - (accumulator >> SHIFT);
+    }
+    return accumulator >> SHIFT;
+  }
+
+private:
+  long accumulator = 0;
+  bool primed = false;
+};
+
+// Complete filter chain for one analog channel:
+// oversample -> median -> EMA, all in 2^BITS scaled ADC counts
+template <uint8_t BITS, uint8_t MEDIAN, uint8_t EMA_SHIFT>
+class AnalogPipeline {
+public:
+  explicit AnalogPipeline(uint8_t pin) : oversampler(pin) {}
+
+  // Take one oversampled reading and return the filtered value
+  uint16_t sample() {
+    filtered = ema.update(median.update(oversampler.sample()));
+    return filtered;
+  }
+
+  // Latest filtered value without sampling
+  uint16_t value() const { return filtered; }
+
+private:
+  Oversampler<BITS> oversampler;
+  MedianFilter<uint16_t, MEDIAN> median;
+  EmaFilter<EMA_SHIFT> ema;
+  uint16_t filtered = 0;
+};
+
+// Mean of angles computed from the mean of their x/y components
+// Averaging the angles themselves fails at the wraparound (359 and 1
+// degrees average to 180); averaging the vectors gives 0 as expected
+class CircularMean {
+public:
+  void add(int16_t x, int16_t y) {
+    sumX += x;
+    sumY += y;
+    samples++;
+  }
+
+  uint8_t count() const { return samples; }
+
+  void reset() {
+    sumX = 0;
+    sumY = 0;
+    samples = 0;
+  }
+
+  // Mean x and y components (same scale as the added values)
+  int16_t meanX() const { return samples ? sumX / samples : 0; }
+  int16_t meanY() const { return samples ? sumY / samples : 0; }
+
+private:
+  long sumX = 0;
+  long sumY = 0;
+  uint8_t samples = 0;
+};
+
+#endif
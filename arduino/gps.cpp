@@ -3,6 +3,7 @@
 #include <SoftwareSerial.h>
 #include "gps.h"
 #include "compass.h"
+#include "perf.h"
 #include "constants.h"
 #include "pins.h"
 
@@ -14,6 +15,15 @@ TinyGPSPlus gps;
 // Uses pins defined in pins.h for RX/TX communication with GPS module
 SoftwareSerial ss(GPS_RX, GPS_TX);
 
+// Most recent fix, updated by feedGPS()
+static GeoFix fix = { false, 0, 0, 0 };
+
+// UTC time of the most recent sentence (milliseconds since midnight) and
+// millis() when it was parsed
+static bool timeValid = false;
+static unsigned long timeOfDay = 0;
+static unsigned long timeStamp = 0;
+
 // Initialize the GPS module communication
 // Sets up software serial at 9600 baud rate (standard for most GPS modules)
 // Must be called in setup() before using GPS functions
@@ -21,22 +31,98 @@ void initGPS() {
     ss.begin(9600);
 }
 
-// Creates a formatted path point message with current GPS location and heading
+// Convert TinyGPS++ raw degrees to millionths of a degree
+// Integer arithmetic keeps full precision, which a 32-bit float on the
+// AVR cannot (it holds only ~7 significant digits)
+static int32_t toMicrodegrees(const RawDegrees& raw) {
+    int32_t value = (int32_t)raw.deg * 1000000L + (int32_t)((raw.billionths + 500) / 1000);
+    return raw.negative ? -value : value;
+}
+
+// Drain the GPS serial stream into the NMEA parser
+// Runs on every scheduler pass so the 64-byte SoftwareSerial buffer never
+// overflows while other tasks are busy
+// Caches the position and time whenever a sentence carried new ones
+void feedGPS() {
+    PerfTimer timer(PERF_GPS);
+    while (ss.available() > 0) {
+        gps.encode(ss.read());
+    }
+
+    if (gps.location.isUpdated() && gps.location.isValid()) {
+        fix.latitude = toMicrodegrees(gps.location.rawLat());
+        fix.longitude = toMicrodegrees(gps.location.rawLng());
+        fix.timestamp = millis();
+        fix.valid = true;
+    }
+
+    if (gps.time.isUpdated() && gps.time.isValid()) {
+        uint32_t hhmmsscc = gps.time.value();
+        timeOfDay = ((hhmmsscc / 1000000) * 3600UL + (hhmmsscc / 10000 % 100) * 60UL +
+                     hhmmsscc / 100 % 100) * 1000UL + hhmmsscc % 100 * 10UL;
+        timeStamp = millis();
+        timeValid = true;
+    }
+}
+
+// Cached fix
+const GeoFix& lastFix() {
+    return fix;
+}
+
+// Age of the cached fix
+unsigned long fixAge() {
+    return fix.valid ? millis() - fix.timestamp : 0xFFFFFFFF;
+}
+
+// UTC time of day, extrapolated from the last sentence
+bool gpsTimeOfDay(unsigned long& ms) {
+    unsigned long age = millis() - timeStamp;
+    if (!timeValid || age > GPS_TIME_MAX_AGE) {
+        return false;
+    }
+    ms = (timeOfDay + age) % 86400000UL;
+    return true;
+}
+
+// Print a fixed-point coordinate with 6 decimal places
+static void printCoordinate(Print& out, int32_t microdegrees) {
+    if (microdegrees < 0) {
+        out.print('-');
+        microdegrees = -microdegrees;
+    }
+    out.print(microdegrees / 1000000L);
+    out.print('.');
+
+    // Zero-pad the fraction to 6 digits
+    int32_t fraction = microdegrees % 1000000L;
+    for (int32_t digit = 100000L; digit > 1 && fraction < digit; digit /= 10) {
+        out.print('0');
+    }
+    out.print(fraction);
+}
+
+// Creates a formatted path point message with the cached location and heading
 // Combines GPS coordinates with compass heading for complete position data
 // Used for logging vehicle/device path for navigation or tracking purposes
-// Returns false if GPS location is invalid (no fix), true if successful
+// Returns false if there is no recent fix, true if successful
 // Output format: "PATH,latitude,longitude,heading" where coordinates have 6 decimal places
-bool logPathPoint(String& outMsg) {
-    // Check if GPS has a valid location fix
-    if(!gps.location.isValid()) {
+bool logPathPoint(Print& out) {
+    // Check if a recent location fix is cached
+    if (fixAge() > FIX_MAX_AGE) {
         return false;
     }
 
-    // Get current compass heading
-    int heading = readCompass();
+    // Get latest compass heading from the sampling task
+    int heading = getHeading();
 
     // Format message as CSV: PATH,lat,lon,heading
     // Latitude and longitude are formatted to 6 decimal places for ~1 meter accuracy
-    outMsg = "PATH," + String(gps.location.lat(), 6) + "," + String(gps.location.lng(), 6) + "," + String(heading);
+    out.print(F("PATH,"));
+    printCoordinate(out, fix.latitude);
+    out.print(',');
+    printCoordinate(out, fix.longitude);
+    out.print(',');
+    out.print(heading);
     return true;
 }
\ No newline at end of file
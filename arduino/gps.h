@@ -18,17 +18,51 @@ extern TinyGPSPlus gps;
 // Configured with pins defined in pins.h
 extern SoftwareSerial ss;
 
+// Last GPS fix, cached whenever TinyGPS++ parses a new location
+// Coordinates are fixed point in millionths of a degree (~0.11 m),
+// converted from the parser's raw degrees so no float rounding is involved
+struct GeoFix {
+  bool valid;               // A fix has been received since boot
+  int32_t latitude;         // 1e-6 degrees, north positive
+  int32_t longitude;        // 1e-6 degrees, east positive
+  unsigned long timestamp;  // millis() when the fix was parsed
+};
+
 // Function to initialize GPS module communication
 // Sets up software serial communication with GPS module
 // Must be called before attempting to read GPS data
 void initGPS();
 
+// Scheduler task that drains the GPS serial stream
+// Feeds every byte waiting in the SoftwareSerial buffer to TinyGPS++
+// Must run on every scheduler pass: the buffer holds only 64 bytes
+// (~67 ms at 9600 baud) and bytes arriving while it is full are lost
+void feedGPS();
+
+// Function to get the cached fix
+// valid is false until the first fix arrives; the last position is kept
+// if the fix is later lost, so check fixAge() before trusting it
+const GeoFix& lastFix();
+
+// Function to get the age of the cached fix in milliseconds
+// Returns 0xFFFFFFFF if no fix has been received yet
+unsigned long fixAge();
+
+// Function to get the UTC time of day from the GPS
+// Extrapolates the time of the last NMEA sentence with millis(); sentences
+// reach the parser some tens of milliseconds after the second they
+// report, so the result runs late by about that much
+// Output parameter 'ms' receives milliseconds since UTC midnight
+// Returns false if no time was parsed in the last GPS_TIME_MAX_AGE
+bool gpsTimeOfDay(unsigned long& ms);
+
 // Function to create a formatted path point message
-// Combines current GPS coordinates with compass heading
-// Output parameter 'outMsg' contains formatted CSV string if successful
-// Returns false if GPS location is invalid (no satellite fix)
-// Returns true if valid location data is available and message is created
-// Message format: "PATH,latitude,longitude,heading"
-bool logPathPoint(String& outMsg);
+// Combines the cached GPS fix with the latest compass heading
+// Writes the CSV message to 'out' (e.g. Serial or a BufferWriter)
+// Returns false if no fix younger than FIX_MAX_AGE is cached, with
+// nothing written
+// Message format: "PATH,latitude,longitude,heading", coordinates printed
+// from the fixed-point fix with 6 decimal places
+bool logPathPoint(Print& out);
 
 #endif
\ No newline at end of file
@@ -3,18 +3,75 @@
 #include <LoRa.h>
 #include <SPI.h>
 #include <AES.h>
+#include <EEPROM.h>
 #include "lora_comm.h"
+#include "ccm.h"
+#include "power.h"
+#include "perf.h"
+#include "txschedule.h"
+#include "config.h"
 #include "constants.h"
 #include "pins.h"
 
 // AES encryption object for secure LoRa communication
 AES128 aes;
 
-// AES-128 encryption key (16 bytes)
+// Factory AES-128 encryption key (16 bytes), used until a key is rotated
+// in over the air
 // WARNING: In production, use a more secure key generation method
 // This key must match exactly on both sender and receiver
 byte key[16] = {'s','e','c','r','e','t','k','e','y','1','2','3','4','5','6','7'};
 
+// Frame buffer shared by every sender; one static buffer instead of one
+// per frame type keeps the ATmega328P's 2 KB of RAM for the stores
+uint8_t txBuffer[MAX_PAYLOAD_SIZE];
+
+// Counter of the last packet sent, and the highest value reserved in
+// EEPROM; counters up to the reservation may be used without writing
+// EEPROM, and a reset skips to the reservation so none is ever reused
+static uint32_t packetCounter = 0;
+static uint32_t reservedCounter = 0;
+
+// Data rate currently configured on the radio
+static uint8_t currentSf = LORA_DEFAULT_SF;
+static uint8_t currentCr = LORA_DEFAULT_CR;
+
+// Receive window bookkeeping
+// txDone is set from the DIO0 interrupt when the uplink has left the radio
+static volatile bool txDone = false;
+static bool awaitingTxDone = false;
+static bool rxWindowOpen = false;
+static unsigned long rxWindowStart = 0;
+static unsigned long rxWindowLength = 0;
+
+// micros() when the current uplink was handed to the radio
+static unsigned long txStartMicros = 0;
+
+// Sealed packet waiting in the radio FIFO for the transmit scheduler
+// (see txschedule.h), and its length on air
+static bool txQueued = false;
+static uint8_t queuedLength = 0;
+
+// Channel activity detection bookkeeping
+// cadDone and cadBusy are set from the DIO0 CAD-done interrupt
+static volatile bool cadDone = false;
+static volatile bool cadBusy = false;
+static bool cadRunning = false;
+static unsigned long cadStart = 0;
+
+// DIO0 TX-done interrupt handler
+// Only sets a flag; the window is opened from pollDownlink()
+static void onTxDone() {
+    txDone = true;
+}
+
+// DIO0 CAD-done interrupt handler
+// Only records the outcome; the scheduler is told from pollDownlink()
+static void onCadDone(boolean detected) {
+    cadBusy = detected;
+    cadDone = true;
+}
+
 // Initialize LoRa module with encryption capabilities
 // Configures LoRa radio parameters for optimal range and reliability
 // Sets up AES encryption for secure message transmission
@@ -25,70 +82,307 @@ void initLoRa() {
 
     // Initialize LoRa radio on 433MHz frequency
     if (!LoRa.begin(433E6)) {
-        Serial.println("LoRa init failed. Check wiring.");
+        Serial.println(F("LoRa init failed. Check wiring."));
         while (true);  // Halt execution if LoRa fails to initialize
     }
 
     // Configure LoRa parameters for maximum range and reliability
-    LoRa.setSpreadingFactor(12);    // Maximum spreading factor for longest range
+    // The default data rate (SF12, 4/8) is also where the link falls back
+    // to whenever adaptive data rate loses contact with the receiver
+    setDataRate(LORA_DEFAULT_SF, LORA_DEFAULT_CR);
     LoRa.setSignalBandwidth(125E3); // 125kHz bandwidth for good sensitivity
-    LoRa.setCodingRate4(8);         // Maximum error correction (4/8 coding rate)
+    setTransmitPower(nodeConfig().txPower);
     LoRa.setSyncWord(0x34);         // Sync word to distinguish our network
     LoRa.enableCrc();               // Enable CRC for error detection
+    LoRa.onTxDone(onTxDone);        // Open the receive window after each uplink
+    LoRa.onCadDone(onCadDone);      // Listen before talk
+
+    // Seed the transmit jitter from wideband RSSI noise, mixed with the
+    // node id so nodes that read the same noise still pick different times
+    unsigned long seed = NODE_ID;
+    for (uint8_t i = 0; i < 4; i++) {
+        seed = (seed << 8) ^ LoRa.random();
+    }
+    randomSeed(seed);
+
+    // Initialize AES encryption with the configured key
+    setLinkKey(nodeConfig().key);
 
-    // Initialize AES encryption with the predefined key
-    aes.setKey(key, sizeof(key));
-    Serial.println("LoRa + AES Sender Ready");
+    // Continue after the last reserved packet counter; an erased EEPROM
+    // reads 0xFFFFFFFF and starts from zero
+    EEPROM.get(EEPROM_COUNTER_ADDR, reservedCounter);
+    if (reservedCounter == 0xFFFFFFFF) {
+        reservedCounter = 0;
+    }
+    packetCounter = reservedCounter;
+    Serial.println(F("LoRa + AES Sender Ready"));
 }
 
 // Send an encrypted message via LoRa
-// Applies PKCS#7 padding to message, encrypts it using AES-128, then transmits
-// Padding ensures message length is multiple of 16 bytes (AES block size)
-// Prints both encrypted hex data and original message for debugging
+// The text is sealed like any other frame; counter mode needs no padding
+// Prints the original message for debugging
 // Returns true when message is successfully queued for transmission
-bool sendMessage(const String& msg) {
-    int msg_len = msg.length();
+bool sendMessage(const char* msg) {
+    if (!sendFrame((const uint8_t*)msg, strlen(msg))) {
+        return false;
+    }
 
-    // Calculate padding needed to make message length multiple of 16 (AES block size)
-    int pad_len = 16 - (msg_len % 16);
-    int total_len = msg_len + pad_len;
+    // Debug output: print original message
+    Serial.print(F("Sent: "));
+    Serial.println(msg);
+    return true;
+}
 
-    // Create padded message buffer
-    byte padded_msg[total_len];
+// Take the next packet counter, reserving a new block in EEPROM first
+// when the current reservation is used up
+static uint32_t nextPacketCounter() {
+    packetCounter++;
+    if (packetCounter > reservedCounter) {
+        reservedCounter = packetCounter + COUNTER_RESERVE;
+        EEPROM.put(EEPROM_COUNTER_ADDR, reservedCounter);
+    }
+    return packetCounter;
+}
+
+// Hand the queued packet to the radio without waiting for TX done
+// At SF12 a telemetry frame is ~1.7 s on air; returning immediately
+// lets the scheduler keep serving GPS and serial while it is sent
+static void startTransmit() {
+    txQueued = false;
+    txDone = false;
+    awaitingTxDone = true;
+    LoRa.endPacket(true);
+    txStartMicros = micros();
+    chargeEnergy(ENERGY_RADIO_TX, timeOnAir(queuedLength));
+}
 
-    // Copy original message to padded buffer
-    for (int i = 0; i < msg_len; i++) {
-        padded_msg[i] = msg[i];
+// Move the queued packet along the transmit schedule
+// Starts a CAD when the scheduler asks for one, reports its outcome, and
+// transmits once the scheduler allows it; the FIFO keeps the sealed
+// packet through the CAD, which only uses the radio's receiver
+static void serviceTransmit() {
+    if (cadRunning) {
+        if (!cadDone) {
+            return;
+        }
+        cadRunning = false;
+        chargeEnergy(ENERGY_RADIO_RX, millis() - cadStart);
+        channelChecked(cadBusy);
+        if (cadBusy) {
+            Serial.println(F("LoRa channel busy, backing off"));
+        }
     }
 
-    // Apply PKCS#7 padding - fill remaining bytes with pad length value
-    // This allows the receiver to determine how much padding to remove
-    for (int i = 0; i < pad_len; i++) {
-        padded_msg[msg_len + i] = pad_len;
+    if (!txQueued) {
+        return;
     }
 
-    // Buffer to store encrypted data
-    byte cipher[total_len];
+    switch (nextTransmitAction()) {
+        case TX_LISTEN:
+            cadDone = false;
+            cadRunning = true;
+            cadStart = millis();
+            LoRa.channelActivityDetection();
+            break;
+        case TX_SEND:
+            startTransmit();
+            break;
+        default:
+            break;
+    }
+}
 
-    // Encrypt message in 16-byte blocks using AES-128
-    for (int i = 0; i < total_len; i += 16) {
-        aes.encryptBlock(cipher + i, padded_msg + i);
+// Send an encrypted binary frame via LoRa
+// Seals the frame with AES-CCM while streaming it into the radio FIFO in
+// 16-byte chunks, so no ciphertext buffer is needed
+// Transmission is asynchronous: the call returns as soon as the frame is
+// sealed, and the transmit scheduler sends it from pollDownlink() after
+// its jitter, channel checks and slot wait
+// Returns false if the frame is empty or too long, or the radio is still
+// busy with the previous frame
+bool sendFrame(const uint8_t* frame, size_t len) {
+    if (len == 0 || len > MAX_PAYLOAD_SIZE) {
+        return false;
     }
-    
-    // Transmit encrypted data via LoRa
-    LoRa.beginPacket();
-    LoRa.write(cipher, total_len);
-    LoRa.endPacket();
 
-    // Debug output: print encrypted data in hexadecimal format
-    Serial.print("Encrypted: ");
-    for (int i = 0; i < total_len; i++) {
-        Serial.print(cipher[i], HEX);
-        Serial.print(" ");
+    // Radio still holding or sending the previous frame or listening for
+    // its downlink, drop this one rather than wait
+    if (radioBusy() || !LoRa.beginPacket()) {
+        Serial.println(F("LoRa busy, frame dropped"));
+        return false;
     }
-    Serial.println();
 
-    // Debug output: print original message
-    Serial.println("Sent: " + msg);
+    unsigned long sealStart = micros();
+    uint32_t counter = nextPacketCounter();
+    uint8_t header[PACKET_HEADER_SIZE] = {
+        NODE_ID,
+        (uint8_t)counter, (uint8_t)(counter >> 8), (uint8_t)(counter >> 16), (uint8_t)(counter >> 24)
+    };
+    LoRa.write(header, sizeof(header));
+
+    CcmContext ccm;
+    ccmBegin(ccm, aes, CCM_UPLINK, NODE_ID, counter, len);
+    uint8_t chunk[16];
+    for (size_t offset = 0; offset < len; offset += 16) {
+        uint8_t n = len - offset < 16 ? len - offset : 16;
+        memcpy(chunk, frame + offset, n);
+        ccmEncrypt(ccm, chunk, n);
+        LoRa.write(chunk, n);
+    }
+
+    uint8_t mic[CCM_MIC_SIZE];
+    ccmFinish(ccm, mic);
+    LoRa.write(mic, sizeof(mic));
+    perfRecord(PERF_SEAL, micros() - sealStart);
+
+    // Leave the packet in the FIFO for the transmit scheduler; the channel
+    // is held for the uplink and the receive window that follows it
+    txQueued = true;
+    queuedLength = len + PACKET_OVERHEAD;
+    scheduleTransmit(timeOnAir(queuedLength) + DOWNLINK_DELAY +
+                     timeOnAir(MAX_DOWNLINK_SIZE + PACKET_OVERHEAD) + RX_WINDOW_MARGIN);
+
+    // Debug output: packet counter, size on air and MIC
+    Serial.print(F("Encrypted: #"));
+    Serial.print(counter);
+    Serial.print(F(", "));
+    Serial.print(len + PACKET_OVERHEAD);
+    Serial.print(F(" bytes, MIC "));
+    for (uint8_t i = 0; i < CCM_MIC_SIZE; i++) {
+        Serial.print(mic[i], HEX);
+        Serial.print(F(" "));
+    }
+    Serial.println();
     return true;
-}
\ No newline at end of file
+}
+
+// Counter of the most recently sent packet
+uint32_t lastPacketCounter() {
+    return packetCounter;
+}
+
+static_assert(MAX_DOWNLINK_SIZE <= 16, "Downlinks are decrypted as a single CCM chunk");
+
+// End the receive window and put the radio to sleep until the next
+// uplink; beginPacket() wakes it again
+static void closeRxWindow() {
+    rxWindowOpen = false;
+    LoRa.sleep();
+    chargeEnergy(ENERGY_RADIO_RX, millis() - rxWindowStart);
+}
+
+// True from handing a frame to the radio until its receive window closes
+bool radioBusy() {
+    return txQueued || cadRunning || awaitingTxDone || rxWindowOpen;
+}
+
+// Service the transmit schedule and the receive window that follows each
+// uplink
+// Opens the window once the TX-done interrupt has fired and polls it with
+// parsePacket() until an authentic downlink arrives or the window times out
+// Packets addressed to another node or another uplink, and packets that
+// fail the MIC check, are ignored and the window stays open
+DownlinkStatus pollDownlink(uint8_t* payload, uint8_t& len) {
+    serviceTransmit();
+
+    if (awaitingTxDone) {
+        if (!txDone) {
+            return DOWNLINK_NONE;
+        }
+        perfRecord(PERF_TX, micros() - txStartMicros);
+        awaitingTxDone = false;
+        rxWindowOpen = true;
+        rxWindowStart = millis();
+        rxWindowLength = DOWNLINK_DELAY + timeOnAir(MAX_DOWNLINK_SIZE + PACKET_OVERHEAD) +
+                         RX_WINDOW_MARGIN;
+    }
+
+    if (!rxWindowOpen) {
+        return DOWNLINK_NONE;
+    }
+
+    int packetSize = LoRa.parsePacket();
+    if (packetSize > PACKET_OVERHEAD && packetSize <= PACKET_OVERHEAD + MAX_DOWNLINK_SIZE) {
+        uint8_t header[PACKET_HEADER_SIZE];
+        for (uint8_t i = 0; i < PACKET_HEADER_SIZE; i++) {
+            header[i] = LoRa.read();
+        }
+        uint32_t counter = (uint32_t)header[1] | ((uint32_t)header[2] << 8) |
+                           ((uint32_t)header[3] << 16) | ((uint32_t)header[4] << 24);
+
+        len = packetSize - PACKET_OVERHEAD;
+        for (uint8_t i = 0; i < len; i++) {
+            payload[i] = LoRa.read();
+        }
+        uint8_t mic[CCM_MIC_SIZE];
+        for (uint8_t i = 0; i < CCM_MIC_SIZE; i++) {
+            mic[i] = LoRa.read();
+        }
+
+        if (header[0] == NODE_ID && counter == packetCounter) {
+            CcmContext ccm;
+            ccmBegin(ccm, aes, CCM_DOWNLINK, NODE_ID, counter, len);
+            ccmDecrypt(ccm, payload, len);
+            uint8_t expected[CCM_MIC_SIZE];
+            ccmFinish(ccm, expected);
+
+            if (ccmVerify(mic, expected)) {
+                closeRxWindow();
+                return DOWNLINK_RECEIVED;
+            }
+        }
+    }
+
+    if (millis() - rxWindowStart >= rxWindowLength) {
+        closeRxWindow();
+        return DOWNLINK_MISSED;
+    }
+    return DOWNLINK_NONE;
+}
+
+// Key the cipher for the following packets
+// Keys change between packets: the downlink that carried a new key has
+// already been opened with the old one
+void setLinkKey(const uint8_t* newKey) {
+    aes.setKey(newKey, 16);
+}
+
+// Change the transmit power used for the next packets
+void setTransmitPower(uint8_t dbm) {
+    LoRa.setTxPower(dbm);
+}
+
+// Change the spreading factor and coding rate used for the next packets
+// Bandwidth is fixed at 125 kHz, so the spreading factor alone decides
+// whether the receiver can demodulate the packet
+void setDataRate(uint8_t spreadingFactor, uint8_t codingRate) {
+    currentSf = spreadingFactor;
+    currentCr = codingRate;
+    LoRa.setSpreadingFactor(spreadingFactor);
+    LoRa.setCodingRate4(codingRate);
+}
+
+// Spreading factor currently configured on the radio
+uint8_t getSpreadingFactor() {
+    return currentSf;
+}
+
+// Coding rate denominator currently configured on the radio
+uint8_t getCodingRate() {
+    return currentCr;
+}
+
+// Time on air of a packet at the current data rate (milliseconds)
+// Explicit header, CRC on, 8 symbol preamble, 125 kHz bandwidth; low data
+// rate optimization is on for SF11 and SF12, as arduino-LoRa configures it
+unsigned long timeOnAir(size_t len) {
+    float symbolMs = (float)(1L << currentSf) / 125.0;
+    int lowDataRate = currentSf >= 11 ? 1 : 0;
+
+    long numerator = 8L * len - 4L * currentSf + 28 + 16;
+    long denominator = 4L * (currentSf - 2 * lowDataRate);
+    long blocks = numerator > 0 ? (numerator + denominator - 1) / denominator : 0;
+    float symbols = 8 + 4.25 + 8 + blocks * currentCr;
+
+    return (unsigned long)(symbols * symbolMs + 0.5);
+}
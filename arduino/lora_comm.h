@@ -7,30 +7,118 @@
 #include <AES.h>
 
 // Header file for encrypted LoRa communication interface
-// Provides functions for secure wireless message transmission using LoRa + AES-128 encryption
-// Handles initialization, message padding, encryption, and transmission
+// Provides functions for secure wireless message transmission using LoRa + AES-128
+// Every packet is sealed with AES-CCM (see ccm.h): counter mode encryption,
+// so the payload needs no padding, plus a 4-byte MIC that rejects tampered
+// and forged packets
+//
+// Packet layout on air (multi-byte fields little-endian):
+//   [0]       node id (NODE_ID for uplinks, the addressed node for downlinks)
+//   [1..4]    packet counter, uint32; increments on every uplink and is
+//             never reused, the receiver rejects counters it has seen
+//   [5..N-5]  encrypted payload
+//   [N-4..]   MIC over the payload, node id, counter and direction
+// Downlinks reuse the counter of the uplink they answer, so a node only
+// accepts a downlink meant for its latest uplink
+
+// Size of the cleartext packet header (node id and counter)
+constexpr uint8_t PACKET_HEADER_SIZE = 5;
+
+// Bytes every packet adds around its payload (header and MIC)
+constexpr uint8_t PACKET_OVERHEAD = PACKET_HEADER_SIZE + 4;
+
+// Largest payload that fits the 255-byte LoRa packet
+constexpr uint8_t MAX_PAYLOAD_SIZE = 255 - PACKET_OVERHEAD;
+
+// Largest downlink payload accepted in the window after each uplink
+constexpr uint8_t MAX_DOWNLINK_SIZE = 16;
+
+// Frame buffer shared by every sender, MAX_PAYLOAD_SIZE bytes
+// A task builds its frame here and hands it to sendFrame() before it
+// returns; sendFrame() seals it into the radio FIFO, so the buffer is free
+// again afterwards and nothing may be kept in it between tasks
+extern uint8_t txBuffer[MAX_PAYLOAD_SIZE];
 
 // External declaration of AES encryption object
 // Used for encrypting messages before LoRa transmission
 extern AES128 aes;
 
-// External declaration of AES encryption key
-// 16-byte key used for AES-128 encryption
+// External declaration of the factory AES encryption key
+// 16-byte key used for AES-128 encryption until a new key is rotated in
+// over the air (see config.h); the key in use is nodeConfig().key
 // Must be identical on both sender and receiver for successful decryption
 extern byte key[16];
 
+// Result of polling the receive window that follows each uplink
+enum DownlinkStatus {
+  DOWNLINK_NONE,      // Uplink still on air, window still open, or no uplink sent
+  DOWNLINK_RECEIVED,  // An authentic downlink was received and decrypted
+  DOWNLINK_MISSED     // The window closed without an authentic downlink
+};
+
 // Function to initialize LoRa module with encryption
 // Configures LoRa radio parameters for maximum range and reliability
-// Sets up AES encryption with predefined key
+// Sets up AES encryption with the configured key and transmit power
+// Restores the packet counter from EEPROM so it never repeats after a reset
 // Must be called in setup() before sending messages
 void initLoRa();
 
 // Function to send encrypted message via LoRa
-// Automatically handles message padding to AES block size (16 bytes)
-// Encrypts message using AES-128 before transmission
-// Provides debug output showing both encrypted data and original message
-// Parameter: msg - String message to encrypt and send
+// Sends the text as the packet payload, no padding required
+// Provides debug output showing the original message
+// Parameter: msg - NUL-terminated message to encrypt and send, e.g. the
+//                  buffer of a BufferWriter
 // Returns: true when message is successfully queued for transmission
-bool sendMessage(const String& msg);
+bool sendMessage(const char* msg);
+
+// Function to send an encrypted binary frame via LoRa
+// Frame length may be anything from 1 to MAX_PAYLOAD_SIZE bytes; the
+// packet on air is exactly PACKET_OVERHEAD bytes longer
+// Used for the telemetry frames built by telemetry.h
+// The sealed packet waits in the radio until the transmit scheduler lets
+// it go (see txschedule.h); pollDownlink() drives that
+// Returns without waiting for the transmission to finish
+// Returns false if the length is out of range or the radio is busy
+bool sendFrame(const uint8_t* frame, size_t len);
+
+// Function to get the counter of the most recently sent packet
+uint32_t lastPacketCounter();
+
+// Function to service the transmit schedule and the receive window that
+// follows each uplink
+// Must be polled frequently (scheduler period 0): a sealed packet is sent
+// once the channel is clear and its time has come; once it has left the
+// radio, the window stays open for DOWNLINK_DELAY plus the downlink's
+// time on air, and no new frame can be sent until it closes
+// Output parameter 'payload' must hold MAX_DOWNLINK_SIZE bytes and receives
+// the decrypted downlink payload, its length in 'len', when
+// DOWNLINK_RECEIVED is returned
+// The radio sleeps from the end of the window until the next uplink
+DownlinkStatus pollDownlink(uint8_t* payload, uint8_t& len);
+
+// Function to check whether an uplink is waiting, on air or in its receive
+// window
+// The node must not power down while this returns true
+bool radioBusy();
+
+// Function to change the AES-128 key the following packets are sealed
+// and opened with
+// Parameter: newKey - 16 bytes
+void setLinkKey(const uint8_t* newKey);
+
+// Function to change the transmit power (dBm, 2..17 on PA_BOOST)
+void setTransmitPower(uint8_t dbm);
+
+// Function to change the spreading factor (7..12) and coding rate
+// denominator (5..8, i.e. 4/5..4/8) used for the following packets
+void setDataRate(uint8_t spreadingFactor, uint8_t codingRate);
+
+// Functions to get the data rate currently configured on the radio
+uint8_t getSpreadingFactor();
+uint8_t getCodingRate();
+
+// Function to calculate the time on air of a 'len' byte packet at the
+// current data rate, per the SX127x datasheet (milliseconds)
+unsigned long timeOnAir(size_t len);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,118 @@
+#include <Arduino.h>
+#include "navigation.h"
+#include "gps.h"
+#include "compass.h"
+#include "telemetry.h"
+#include "ringbuffer.h"
+#include "lora_comm.h"
+#include "constants.h"
+
+static_assert(PATH_HEADER_SIZE + PATH_CAPACITY * PATH_POINT_MAX_SIZE <= MAX_PAYLOAD_SIZE,
+              "A PATH frame of every queued point must fit txBuffer");
+
+// Path points waiting for the next PATH frame, oldest first
+// When the radio cannot keep up the oldest points are dropped
+static RingBuffer<PathPoint, PATH_CAPACITY> pathStore;
+
+// millis() of the last PATH frame
+static unsigned long lastPathReport = 0;
+
+// Latest obstacle not yet sent, and the times of the last one logged
+// and the last one sent
+static bool obstaclePending = false;
+static PathPoint obstacleWhere;
+static bool obstacleHasFix = false;
+static float obstacleDistance = 0;
+static unsigned long lastObstacleReport = 0;
+static unsigned long lastObstacleFrame = 0;
+
+// Position and heading from the cached fix
+static PathPoint currentPosition() {
+  const GeoFix& fix = lastFix();
+  PathPoint point;
+  point.timestamp = fix.timestamp;
+  point.latitude = fix.latitude;
+  point.longitude = fix.longitude;
+  point.heading = getHeading();
+  return point;
+}
+
+// Path point source for encodePathFrame()
+static PathPoint queuedPoint(uint8_t index) {
+  return pathStore.peek(index);
+}
+
+// Send the pending obstacle, keeping it if the radio is busy
+static void sendObstacle() {
+  encodeObstacleFrame(txBuffer, obstacleWhere, obstacleHasFix, obstacleDistance);
+  if (sendFrame(txBuffer, OBSTACLE_FRAME_SIZE)) {
+    obstaclePending = false;
+    lastObstacleFrame = millis();
+  }
+}
+
+// Send every queued path point in one frame, keeping them if the radio
+// is busy
+static void sendPath() {
+  uint8_t count = pathStore.size();
+  size_t len = encodePathFrame(txBuffer, queuedPoint, count);
+  if (!sendFrame(txBuffer, len)) {
+    return;
+  }
+
+  pathStore.discard(count);
+  lastPathReport = millis();
+  Serial.print(F("Sent "));
+  Serial.print(count);
+  Serial.println(F(" path points"));
+}
+
+// Log and queue the current position, then send whatever is due
+void trackPath() {
+  if (fixAge() <= FIX_MAX_AGE) {
+    logPathPoint(Serial);
+    Serial.println();
+
+    if (pathStore.full()) {
+      pathStore.discard(1);
+    }
+    pathStore.push(currentPosition());
+  }
+
+  // One frame per call: the radio takes a single frame at a time, and an
+  // obstacle is more urgent than the track
+  if (radioBusy()) {
+    return;
+  }
+  if (obstaclePending && millis() - lastObstacleFrame >= OBS_REPORT_INTERVAL) {
+    sendObstacle();
+  } else if (!pathStore.empty() && millis() - lastPathReport >= PATH_REPORT_INTERVAL) {
+    sendPath();
+  }
+}
+
+// Report an obstacle with the position it was seen from
+void reportObstacle(float distanceCm) {
+  if (distanceCm < MIN_OBS_DISTANCE || distanceCm > MAX_OBS_DISTANCE) {
+    return;
+  }
+  if (millis() - lastObstacleReport < OBS_INTERVAL) {
+    return;
+  }
+  lastObstacleReport = millis();
+
+  Serial.print(F("Obstacle: "));
+  Serial.print(distanceCm);
+  Serial.println(F(" cm"));
+
+  // A newer sighting replaces one still waiting to be sent
+  obstacleWhere = currentPosition();
+  obstacleHasFix = fixAge() <= FIX_MAX_AGE;
+  obstacleDistance = distanceCm;
+  obstaclePending = true;
+}
+
+// Number of path points waiting for transmission
+uint8_t pendingPathPoints() {
+  return pathStore.size();
+}
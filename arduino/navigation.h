@@ -0,0 +1,32 @@
+#ifndef NAVIGATION_H
+#define NAVIGATION_H
+
+#include <Arduino.h>
+
+// Header file for the navigation subsystem
+// Georeferences the survey from the cached GPS fix (see gps.h) and the
+// latest compass heading:
+// - every PATH_INTERVAL the position is logged on the serial console and
+//   queued as a path point; queued points leave together in one PATH
+//   frame every PATH_REPORT_INTERVAL
+// - obstacles inside the detection band are logged at most once per
+//   OBS_INTERVAL; the latest one leaves as an OBSTACLE frame, tagged with
+//   the position it was seen from, at most once per OBS_REPORT_INTERVAL
+// Frames are sent only when the radio is free; nothing here waits for
+// the GPS, the compass or the radio
+
+// Scheduler task run every PATH_INTERVAL
+// Queues a path point when a recent fix is cached, sends a pending
+// obstacle, then the path frame when it is due
+void trackPath();
+
+// Function to report an obstacle inside the detection band
+// Registered with onRangeComplete() (see ultrasonic.h); distances outside
+// MIN_OBS_DISTANCE..MAX_OBS_DISTANCE are ignored
+// Parameter: distanceCm - median distance of a ranging burst
+void reportObstacle(float distanceCm);
+
+// Function to get the number of path points waiting for transmission
+uint8_t pendingPathPoints();
+
+#endif
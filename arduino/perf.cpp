@@ -0,0 +1,112 @@
+#include <Arduino.h>
+#include "perf.h"
+#include "constants.h"
+
+// Statistics per probe, and the start of the current window
+// With PERF_ENABLED false a single entry stays zero and stands in for
+// every probe, so the table costs no RAM worth counting
+static PerfStats stats[PERF_ENABLED ? PERF_PROBES : 1];
+static unsigned long windowStart = 0;
+
+// micros() at the start of the current loop() pass, and whether the pass
+// should be recorded
+static unsigned long passStart = 0;
+static bool passValid = false;
+
+// Histogram bucket of a duration: < 32 us, then one bucket per factor of 4
+static uint8_t bucketOf(unsigned long elapsedMicros) {
+  unsigned long scaled = elapsedMicros >> 5;
+  uint8_t bucket = 0;
+  while (scaled > 0 && bucket < PERF_BUCKETS - 1) {
+    scaled >>= 2;
+    bucket++;
+  }
+  return bucket;
+}
+
+// Record one measurement
+// A few dozen cycles, cheap enough for the every-pass probes
+void perfRecord(PerfProbe probe, unsigned long elapsedMicros) {
+  if (!PERF_ENABLED) {
+    return;
+  }
+
+  PerfStats& s = stats[probe];
+  if (s.count == 0 || elapsedMicros < s.minMicros) s.minMicros = elapsedMicros;
+  if (elapsedMicros > s.maxMicros) s.maxMicros = elapsedMicros;
+  s.totalMicros += elapsedMicros;
+  s.count++;
+
+  // Keep the histogram's shape when a bucket fills up; halving rounds up
+  // so a rare slow call is not halved away by the common fast ones
+  uint8_t bucket = bucketOf(elapsedMicros);
+  if (s.histogram[bucket] == 0xFF) {
+    for (uint8_t i = 0; i < PERF_BUCKETS; i++) {
+      s.histogram[i] = (s.histogram[i] + 1) >> 1;
+    }
+  }
+  s.histogram[bucket]++;
+}
+
+// Close the previous pass and open a new one
+void perfLoopPass() {
+  if (!PERF_ENABLED) {
+    return;
+  }
+
+  unsigned long now = micros();
+  if (passValid) {
+    perfRecord(PERF_LOOP, now - passStart);
+  }
+  passStart = now;
+  passValid = true;
+}
+
+void perfSkipPass() {
+  passValid = false;
+}
+
+const PerfStats& perfStats(PerfProbe probe) {
+  return stats[PERF_ENABLED ? probe : 0];
+}
+
+unsigned long perfWindowMillis() {
+  return millis() - windowStart;
+}
+
+void perfReset() {
+  memset(stats, 0, sizeof(stats));
+  windowStart = millis();
+}
+
+// Print one line per measured probe:
+// "Perf <name>: n=<count> min/mean/max=<a>/<b>/<c> us hist=<8 counts>"
+void printPerfStats() {
+  // Fixed-width names, so the table lives in flash without a pointer array
+  static const char NAMES[PERF_PROBES][8] PROGMEM = { "loop", "gps", "temp", "ph", "tds", "orp",
+                                                      "compass", "seal", "tx" };
+
+  Serial.print(F("Perf window s="));
+  Serial.println(perfWindowMillis() / 1000);
+  for (uint8_t i = 0; i < PERF_PROBES; i++) {
+    const PerfStats& s = perfStats((PerfProbe)i);
+    if (s.count == 0) continue;
+
+    Serial.print(F("Perf "));
+    Serial.print((const __FlashStringHelper*)NAMES[i]);
+    Serial.print(F(": n="));
+    Serial.print(s.count);
+    Serial.print(F(" min/mean/max="));
+    Serial.print(s.minMicros);
+    Serial.print('/');
+    Serial.print(s.totalMicros / s.count);
+    Serial.print('/');
+    Serial.print(s.maxMicros);
+    Serial.print(F(" us hist="));
+    for (uint8_t b = 0; b < PERF_BUCKETS; b++) {
+      if (b) Serial.print(',');
+      Serial.print(s.histogram[b]);
+    }
+    Serial.println();
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <Arduino.h>
+
+// Header file for on-device performance instrumentation
+// Scoped micros() timers around the sensor reads, the scheduler pass and
+// the radio path record, per probe, the call count, min, max and mean
+// time and a histogram with fixed power-of-four buckets, all in static RAM
+// Statistics cover a window that starts at boot and is restarted every
+// time the PERF frame is sent (see telemetry.h), so each frame shows how
+// the last PERF_REPORT_INTERVAL behaved; "STATS" prints the open window
+// Set PERF_ENABLED to false (constants.h) to compile the timers and their
+// statistics out; every probe then reads as never called
+
+// Instrumented code paths
+enum PerfProbe : uint8_t {
+  PERF_LOOP,         // One pass of loop(), sleep excluded
+  PERF_GPS,          // feedGPS(): draining and parsing NMEA bytes
+  PERF_TEMPERATURE,  // sampleTemperature(): DS18B20 read and restart
+  PERF_PH,           // readPH()
+  PERF_TDS,          // readTDS()
+  PERF_ORP,          // readORP()
+  PERF_COMPASS,      // sampleCompass(): one magnetometer sample over I2C
+  PERF_SEAL,         // sendFrame(): CCM encryption and radio FIFO writes
+  PERF_TX,           // endPacket() to TX done, i.e. time on air
+  PERF_PROBES        // Number of probes
+};
+
+// Histogram buckets: < 32 us, < 128 us, < 512 us, < 2 ms, < 8 ms,
+// < 32 ms, < 128 ms and everything longer
+constexpr uint8_t PERF_BUCKETS = 8;
+
+// Statistics of one probe over the current window
+// Times are microseconds; the total wraps after ~71 minutes of measured
+// time, which PERF_REPORT_INTERVAL keeps out of reach
+struct PerfStats {
+  uint32_t count;
+  uint32_t totalMicros;
+  uint32_t minMicros;
+  uint32_t maxMicros;
+  uint8_t histogram[PERF_BUCKETS];  // Halved together when one would overflow
+};
+
+// Function to record one measurement of a probe
+void perfRecord(PerfProbe probe, unsigned long elapsedMicros);
+
+// Scoped timer: measures from construction to the end of the scope
+// Usage: PerfTimer timer(PERF_PH); at the top of the function
+class PerfTimer {
+public:
+  explicit PerfTimer(PerfProbe probe) : probe(probe), start(micros()) {}
+  ~PerfTimer() { perfRecord(probe, micros() - start); }
+
+private:
+  PerfProbe probe;
+  unsigned long start;
+};
+
+// Function to mark the start of a loop() pass
+// Records the previous pass as a PERF_LOOP measurement
+void perfLoopPass();
+
+// Function to leave the current loop() pass out of PERF_LOOP
+// Called after the node slept, which is not loop time
+void perfSkipPass();
+
+// Function to get the statistics of a probe
+const PerfStats& perfStats(PerfProbe probe);
+
+// Function to get the length of the current window in milliseconds
+unsigned long perfWindowMillis();
+
+// Function to clear all statistics and start a new window
+void perfReset();
+
+// Function to print the current window to the serial console, one line
+// per probe that has been measured
+void printPerfStats();
+
+#endif
@@ -19,7 +19,7 @@ constexpr uint8_t LoRa_DIO0 = 3;   // Digital I/O pin 0 for interrupt/status
 // Ultrasonic distance sensor pins
 // HC-SR04 compatible ultrasonic sensor interface
 constexpr uint8_t TRIG_PIN = 5;  // Trigger pin to initiate distance measurement
-constexpr uint8_t ECHO_PIN = 4;  // Echo pin to receive distance measurement pulse
+constexpr uint8_t ECHO_PIN = 2;  // Echo pin, must be an external interrupt pin (INT0)
 
 // Water quality sensor system pins
 // Analog and digital pins for various water quality measurements
@@ -28,4 +28,9 @@ constexpr uint8_t TDS_PIN = A0;      // Analog pin for Total Dissolved Solids se
 constexpr uint8_t PH_PIN = A1;       // Analog pin for pH sensor
 // Note: ORP sensor pin (A2) is defined in sensorSystem.cpp due to conditional compilation
 
+// Power switches for low-power duty cycling (see power.h)
+// Drive high-side load switches; HIGH = powered
+constexpr uint8_t SENSOR_POWER_PIN = 4;  // pH, TDS and ORP boards and the DS18B20
+constexpr uint8_t GPS_POWER_PIN = A3;    // GPS module (keep its backup supply for hot starts)
+
 #endif
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <Arduino.h>
+#include <LoRa.h>
+#include "power.h"
+#include "lora_comm.h"
+#include "perf.h"
+#include "config.h"
+#include "constants.h"
+#include "pins.h"
+
+#ifdef __AVR__
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// Arduino core millisecond counter; Timer0 stops in power-down, so the
+// time spent asleep is added back by hand
+extern volatile unsigned long timer0_millis;
+
+// Watchdog wake-up interrupt: one-shot, the watchdog is re-armed per sleep
+ISR(WDT_vect) {
+  wdt_disable();
+}
+#endif
+
+// Nominal supply current of each subsystem in microamps, by EnergySubsystem
+static const uint32_t SUBSYSTEM_CURRENT[ENERGY_SUBSYSTEMS] = {
+  CURRENT_CPU_ACTIVE, CURRENT_CPU_SLEEP, CURRENT_RADIO_TX,
+  CURRENT_RADIO_RX, CURRENT_SENSORS, CURRENT_GPS
+};
+
+// Accumulated charge per subsystem: whole microamp-hours plus the
+// remainder in microamp-milliseconds (3,600,000 per microamp-hour)
+static uint32_t chargeUah[ENERGY_SUBSYSTEMS];
+static uint32_t chargeRemainder[ENERGY_SUBSYSTEMS];
+static unsigned long accountedUntil = 0;  // millis() up to which awake time is charged
+
+// Power switch state
+static bool powerSave = POWER_SAVE_DEFAULT;
+static bool sensorsOn = false;
+static unsigned long sensorsOnAt = 0;    // millis() when the sensors were powered
+static bool gpsOn = false;
+
+// Duty cycle state
+enum WindowState : uint8_t { WINDOW_SAMPLING, WINDOW_DRAINING };
+static WindowState windowState = WINDOW_SAMPLING;
+static unsigned long windowStart = 0;    // millis() when the current window was powered up
+static TaskFunction windowEndTask = NULL;
+
+// Charge 'ms' of a subsystem at its nominal current
+// Split into 10 s steps so current * time never overflows 32 bits
+void chargeEnergy(EnergySubsystem subsystem, unsigned long ms) {
+  while (ms > 0) {
+    unsigned long step = ms > 10000 ? 10000 : ms;
+    chargeRemainder[subsystem] += SUBSYSTEM_CURRENT[subsystem] * step;
+    chargeUah[subsystem] += chargeRemainder[subsystem] / 3600000UL;
+    chargeRemainder[subsystem] %= 3600000UL;
+    ms -= step;
+  }
+}
+
+// Charge the awake time since the last call to the CPU and to every
+// subsystem that is powered
+static void accountAwakeTime() {
+  unsigned long now = millis();
+  unsigned long elapsed = now - accountedUntil;
+  accountedUntil = now;
+
+  chargeEnergy(ENERGY_CPU, elapsed);
+  if (sensorsOn) chargeEnergy(ENERGY_SENSORS, elapsed);
+  if (gpsOn) chargeEnergy(ENERGY_GPS, elapsed);
+}
+
+// Switch the sensor and GPS supplies, charging the time spent so far
+static void setRails(bool on) {
+  accountAwakeTime();
+
+  digitalWrite(SENSOR_POWER_PIN, on ? HIGH : LOW);
+  digitalWrite(GPS_POWER_PIN, on ? HIGH : LOW);
+  if (on && !sensorsOn) {
+    sensorsOnAt = millis();
+  }
+  sensorsOn = on;
+  gpsOn = on;
+}
+
+// Sleep for 'ms' with the MCU in power-down, woken by the watchdog
+// The watchdog only has power-of-two periods from 16 ms to 8 s, so the
+// sleep is split into the largest steps that fit (WDTO_8S is 8192 ms); the remainder is
+// waited awake. The watchdog oscillator is only accurate to about 10 %,
+// which is why the sampling windows are timed in whole periods
+static void sleepFor(unsigned long ms) {
+  chargeEnergy(ENERGY_SLEEP, ms);
+
+#ifdef __AVR__
+  static const uint16_t WDT_STEP_MS[] = { 8192, 4096, 2048, 1024, 512, 256, 128, 64, 32, 16 };
+  static const uint8_t WDT_STEP_CODE[] = { WDTO_8S, WDTO_4S, WDTO_2S, WDTO_1S, WDTO_500MS,
+                                           WDTO_250MS, WDTO_120MS, WDTO_60MS, WDTO_30MS,
+                                           WDTO_15MS };
+
+  ADCSRA &= ~_BV(ADEN);  // ADC draws ~200 uA even in power-down
+  for (uint8_t i = 0; i < sizeof(WDT_STEP_MS) / sizeof(WDT_STEP_MS[0]); i++) {
+    while (ms >= WDT_STEP_MS[i]) {
+      uint8_t code = WDT_STEP_CODE[i];
+      noInterrupts();
+      wdt_reset();
+      MCUSR &= ~_BV(WDRF);
+      WDTCSR = _BV(WDCE) | _BV(WDE);
+      WDTCSR = _BV(WDIE) | ((code & 0x08) ? _BV(WDP3) : 0) | (code & 0x07);
+      set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+      sleep_enable();
+      interrupts();
+      sleep_cpu();
+      sleep_disable();
+
+      noInterrupts();
+      timer0_millis += WDT_STEP_MS[i];
+      interrupts();
+      ms -= WDT_STEP_MS[i];
+    }
+  }
+  ADCSRA |= _BV(ADEN);
+#endif
+
+  // Remainder below the shortest watchdog period (all of it on the host)
+  delay(ms);
+  accountedUntil = millis();
+}
+
+// Initialize the power switches with everything powered
+// At boot the supplies have been on since reset, so the sensors count
+// as settled straight away
+void initPower() {
+  pinMode(SENSOR_POWER_PIN, OUTPUT);
+  pinMode(GPS_POWER_PIN, OUTPUT);
+  setRails(true);
+  sensorsOnAt = millis() - SENSOR_WARMUP;
+  windowStart = sensorsOnAt;
+}
+
+// Switch power-save mode; a new duty cycle starts with the current
+// window, and leaving power-save mode powers everything back up
+void setPowerSave(bool enable) {
+  powerSave = enable;
+  windowState = WINDOW_SAMPLING;
+  windowStart = millis();
+  setRails(true);
+}
+
+bool powerSaving() {
+  return powerSave;
+}
+
+// Sensors are usable once powered for SENSOR_WARMUP
+bool sensorsReady() {
+  return sensorsOn && millis() - sensorsOnAt >= SENSOR_WARMUP;
+}
+
+void onSamplingWindowEnd(TaskFunction task) {
+  windowEndTask = task;
+}
+
+// Run the duty cycle: sample, hand over to the window-end task, wait for
+// the radio and the serial console to finish, then sleep
+void managePower() {
+  if (!powerSave) {
+    return;
+  }
+
+  if (windowState == WINDOW_SAMPLING) {
+    if (millis() - windowStart < SENSOR_WARMUP + SAMPLING_WINDOW) {
+      return;
+    }
+    if (windowEndTask) {
+      windowEndTask();
+    }
+    windowState = WINDOW_DRAINING;
+  }
+
+  // Uplink still on air or its downlink window open
+  if (radioBusy()) {
+    return;
+  }
+
+  setRails(false);
+  LoRa.sleep();
+  Serial.flush();  // Power-down stops the UART mid-byte
+
+  unsigned long elapsed = millis() - windowStart;
+  unsigned long period = nodeConfig().dutyCyclePeriod;
+  if (elapsed < period) {
+    sleepFor(period - elapsed);
+    perfSkipPass();  // The sleep is not loop time
+  }
+
+  windowState = WINDOW_SAMPLING;
+  windowStart = millis();
+  setRails(true);
+}
+
+// Charge used by a subsystem since boot, in microamp-hours
+uint32_t energyUsed(EnergySubsystem subsystem) {
+  accountAwakeTime();
+  return chargeUah[subsystem];
+}
+
+// Print the energy budget as one line, in microamp-hours
+void printEnergy() {
+  static const char* const NAMES[ENERGY_SUBSYSTEMS] = { "cpu", "sleep", "tx", "rx", "sensors",
+                                                        "gps" };
+
+  Serial.print(F("Energy uAh:"));
+  for (uint8_t i = 0; i < ENERGY_SUBSYSTEMS; i++) {
+    Serial.print(' ');
+    Serial.print(NAMES[i]);
+    Serial.print('=');
+    Serial.print(energyUsed((EnergySubsystem)i));
+  }
+  Serial.println();
+}
@@ -0,0 +1,67 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+#include "scheduler.h"
+
+// Header file for power management and energy accounting
+// In power-save mode the node only wakes for a sampling window every
+// duty cycle period (DUTY_CYCLE_PERIOD unless changed over the air, see
+// config.h): the sensors and GPS are powered up, given
+// SENSOR_WARMUP to settle and sampled for SAMPLING_WINDOW, then the
+// window-end task stores (and forwards) the reading. Once the radio is
+// done, sensors and GPS are power-gated, the SX127x is put to sleep and
+// the MCU enters power-down, woken by the watchdog
+// Outside power-save mode everything stays powered, as before
+//
+// Charge drawn by each subsystem is estimated from its nominal current
+// (constants.h) and the time it spends in each state, so the energy
+// report shows which subsystem drains the battery
+
+// Subsystems charged separately in the energy budget
+enum EnergySubsystem : uint8_t {
+  ENERGY_CPU,        // MCU awake
+  ENERGY_SLEEP,      // MCU in power-down
+  ENERGY_RADIO_TX,   // SX127x transmitting (time-on-air)
+  ENERGY_RADIO_RX,   // SX127x in a receive window
+  ENERGY_SENSORS,    // Water quality probes and DS18B20 powered
+  ENERGY_GPS,        // GPS module powered
+  ENERGY_SUBSYSTEMS  // Number of subsystems
+};
+
+// Function to initialize the power switches and energy accounting
+// Powers the sensors and GPS; must be called first in setup()
+void initPower();
+
+// Function to switch power-save mode on or off
+// Parameter: enable - true to duty-cycle, false to keep everything powered
+void setPowerSave(bool enable);
+
+// Function to check whether power-save mode is active
+bool powerSaving();
+
+// Function to check whether the sensors are powered and settled
+// Sampling tasks skip their work while this returns false
+bool sensorsReady();
+
+// Function to register the task run at the end of each sampling window
+// Replaces the periodic record and report tasks in power-save mode
+void onSamplingWindowEnd(TaskFunction task);
+
+// Scheduler task driving the duty cycle, run with period 0
+// Does nothing outside power-save mode; otherwise ends the sampling
+// window, waits for the radio to finish and sleeps until the next one
+void managePower();
+
+// Function to charge 'ms' of activity of a subsystem at its nominal current
+// Used by lora_comm for transmit time-on-air and receive windows
+void chargeEnergy(EnergySubsystem subsystem, unsigned long ms);
+
+// Function to get the charge used by a subsystem since boot
+// Returns microamp-hours, including time up to now
+uint32_t energyUsed(EnergySubsystem subsystem);
+
+// Function to print the energy budget to the serial console
+void printEnergy();
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <Arduino.h>
+
+// Header file for a fixed-capacity circular buffer
+// Statically sized FIFO used to hold items in RAM without heap allocation
+// Oldest item is at index 0; push() fails when the buffer is full so the
+// caller decides whether to drop or spill the oldest item
+
+template <typename T, uint8_t N>
+class RingBuffer {
+public:
+  // Number of items currently stored
+  uint8_t size() const { return count; }
+
+  // Maximum number of items the buffer can hold
+  uint8_t capacity() const { return N; }
+
+  bool empty() const { return count == 0; }
+  bool full() const { return count == N; }
+
+  // Append an item after the newest one
+  // Returns false (and stores nothing) if the buffer is full
+  bool push(const T& item) {
+    if (full()) {
+      return false;
+    }
+    items[(head + count) % N] = item;
+    count++;
+    return true;
+  }
+
+  // Remove the oldest item and copy it to 'item'
+  // Returns false if the buffer is empty
+  bool pop(T& item) {
+    if (empty()) {
+      return false;
+    }
+    item = items[head];
+    discard(1);
+    return true;
+  }
+
+  // Access an item without removing it, 0 = oldest
+  // Index must be less than size()
+  const T& peek(uint8_t index) const {
+    return items[(head + index) % N];
+  }
+
+  // Remove the 'n' oldest items (or all of them if fewer are stored)
+  void discard(uint8_t n) {
+    if (n > count) {
+      n = count;
+    }
+    head = (head + n) % N;
+    count -= n;
+  }
+
+private:
+  T items[N];
+  uint8_t head = 0;   // Index of the oldest item
+  uint8_t count = 0;  // Number of stored items
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include <Arduino.h>
+#include "scheduler.h"
+
+// One entry in the task table
+struct Task {
+  TaskFunction run;         // Function to call
+  unsigned long periodMs;   // Time between calls, 0 = every pass
+  unsigned long lastRun;    // millis() timestamp of the last scheduled slot
+};
+
+// Static task table, filled in setup() by addTask()
+static Task tasks[MAX_TASKS];
+static uint8_t taskCount = 0;
+
+// Register a periodic task
+// The first call happens one period after registration
+// Returns false if all MAX_TASKS slots are in use
+bool addTask(TaskFunction task, unsigned long periodMs) {
+  if (taskCount >= MAX_TASKS) {
+    return false;
+  }
+
+  tasks[taskCount].run = task;
+  tasks[taskCount].periodMs = periodMs;
+  tasks[taskCount].lastRun = millis();
+  taskCount++;
+  return true;
+}
+
+// Change the period of a registered task, e.g. after a configuration
+// command; a task more than a new period overdue runs on the next pass
+bool setTaskPeriod(TaskFunction task, unsigned long periodMs) {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (tasks[i].run == task) {
+      tasks[i].periodMs = periodMs;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Run every task whose period has elapsed
+// Slots advance by whole periods so tasks keep a fixed rate without drift
+// If a task fell more than one period behind, it is re-anchored to now
+// instead of being called repeatedly to catch up
+void runScheduler() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    Task& task = tasks[i];
+    unsigned long now = millis();
+
+    if (task.periodMs == 0) {
+      task.run();
+      continue;
+    }
+
+    if (now - task.lastRun >= task.periodMs) {
+      task.lastRun += task.periodMs;
+      if (now - task.lastRun >= task.periodMs) {
+        task.lastRun = now;
+      }
+      task.run();
+    }
+  }
+}
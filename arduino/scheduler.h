@@ -0,0 +1,37 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+// Header file for the cooperative millis()-based task scheduler
+// Replaces the delay()-driven main loop: every sensor and service is a
+// short non-blocking task with its own period, so serial commands and
+// GPS bytes are serviced between tasks instead of being missed
+// Tasks must return quickly and keep their own state between calls
+
+// Maximum number of tasks that can be registered; setup() halts if the
+// task table in arduino.ino outgrows it
+constexpr uint8_t MAX_TASKS = 14;
+
+// Signature of a scheduled task
+typedef void (*TaskFunction)();
+
+// Function to register a periodic task
+// Parameter: task - function to call when the period has elapsed
+// Parameter: periodMs - time between calls in milliseconds, 0 = every pass
+// Returns false if the task table is full
+bool addTask(TaskFunction task, unsigned long periodMs);
+
+// Function to change the period of a registered task
+// Parameter: task - function passed to addTask()
+// Parameter: periodMs - new time between calls in milliseconds
+// The next call is due one new period after the last one
+// Returns false if the task is not registered
+bool setTaskPeriod(TaskFunction task, unsigned long periodMs);
+
+// Function to run one pass over the task table
+// Calls every task whose period has elapsed, in registration order
+// Must be called continuously from loop()
+void runScheduler();
+
+#endif
@@ -1,5 +1,11 @@
 #include "sensorSystem.h"
 #include "pins.h"
+#include "conversion.h"
+#include "compensation.h"
+#include "filters.h"
+#include "constants.h"
+#include "power.h"
+#include "perf.h"
 #include <Arduino.h>
 #include <OneWire.h>
 #include <DallasTemperature.h>
@@ -22,60 +28,119 @@ OneWire oneWire(ONE_WIRE_BUS);
 // Handles temperature sensor discovery and reading
 DallasTemperature sensors(&oneWire);
 
+// Per-channel filter pipelines: oversample, reject spikes, smooth
+// Depths are configured in constants.h
+static AnalogPipeline<ANALOG_OVERSAMPLE_BITS, ANALOG_MEDIAN_WINDOW, ANALOG_EMA_SHIFT> phFilter(PH_PIN);
+static AnalogPipeline<ANALOG_OVERSAMPLE_BITS, ANALOG_MEDIAN_WINDOW, ANALOG_EMA_SHIFT> tdsFilter(TDS_PIN);
+static MedianFilter<int, ORP_MEDIAN_WINDOW> orpMedian;
+static EmaFilter<ORP_EMA_SHIFT> orpEma;
+
+// Latest filtered pH and TDS codes, taken as the measured value of a
+// calibration point (0 until the first sample)
+static uint16_t phCode = 0;
+static uint16_t tdsCode = 0;
+
+// Latest readings, updated by the sampling tasks
+// Temperature starts at the 25.0 default until the first conversion completes
+static SensorReadings latest = { 25.0, true, 7.0, 0.0, 0 };
+
+// Non-blocking temperature conversion state
+static bool conversionPending = false;        // A conversion has been started and not yet read
+static unsigned long conversionStart = 0;     // millis() when the conversion was started
+static unsigned long conversionTimeMs = 750;  // Conversion time for the sensor's resolution
+
 // Initialize all water quality sensors
-// Sets up temperature sensor bus and loads ORP sensor calibration from EEPROM
+// Sets up temperature sensor bus and loads ORP, pH and TDS calibration
+// from EEPROM
 // Must be called in setup() before reading sensor values
 void initSensorSystem() {
-  sensors.begin();  // Initialize OneWire temperature sensors
-  ORP.begin();      // Initialize ORP sensor and load calibration data
+  sensors.begin();      // Initialize OneWire temperature sensors
+  ORP.begin();          // Initialize ORP sensor and load calibration data
+  initCompensation();   // pH and TDS calibration profiles
+
+  // Return immediately from requestTemperatures() instead of blocking
+  // for the whole conversion; results are collected by sampleTemperature()
+  sensors.setWaitForConversion(false);
+  conversionTimeMs = sensors.millisToWaitForConversion(sensors.getResolution());
+
+  sensors.requestTemperatures();
+  conversionStart = millis();
+  conversionPending = true;
 }
 
 // Read water temperature from DS18B20 sensor
-// Requests temperature reading and waits for conversion
+// Returns the latest completed conversion, never waits for the sensor
 // Returns 25.0°C as default if sensor is disconnected or fails
 // Temperature is returned in Celsius
 float readTemperature() {
-  sensors.requestTemperatures();  // Initiate temperature conversion
-  float temp = sensors.getTempCByIndex(0);  // Read first sensor on bus
+  return latest.temperature;
+}
 
-  // Return default temperature if sensor is disconnected
-  return (temp == DEVICE_DISCONNECTED_C) ? 25.0 : temp;
+// Sample the DS18B20 without blocking
+// Reads the pending conversion once its conversion time has elapsed,
+// then immediately starts the next conversion for the following call
+// Each new temperature is handed to the pH and TDS compensation
+void sampleTemperature() {
+  PerfTimer timer(PERF_TEMPERATURE);
+
+  // Unpowered probe: any conversion in progress was lost with its supply
+  if (!sensorsReady()) {
+    conversionPending = false;
+    return;
+  }
+
+  if (conversionPending) {
+    // Conversion still running, try again on the next call
+    if (millis() - conversionStart < conversionTimeMs) {
+      return;
+    }
+
+    float temp = sensors.getTempCByIndex(0);  // Read first sensor on bus
+
+    // Use default temperature if sensor is disconnected
+    latest.temperatureDefaulted = (temp == DEVICE_DISCONNECTED_C);
+    latest.temperature = latest.temperatureDefaulted ? 25.0 : temp;
+    setProbeTemperature(latest.temperature);
+  }
+
+  sensors.requestTemperatures();  // Initiate next conversion, returns immediately
+  conversionStart = millis();
+  conversionPending = true;
 }
 
 // Read pH value from analog pH sensor
 // Converts analog voltage to pH scale (0-14)
-// Uses linear conversion: pH = 7 + ((2.5V - measured_voltage) / 0.18)
-// Assumes pH 7.0 = 2.5V, with 0.18V per pH unit sensitivity
+// Uncalibrated: pH = 7 + ((2.5V - measured_voltage) / 0.18) at 25 degC
+// Takes one oversampled sample through the filter pipeline and returns
+// the filtered value, converted in fixed point with the Nernst slope
+// correction for the water temperature and the probe's calibration
+// curve (see compensation.h)
 float readPH() {
-  int phRaw = analogRead(PH_PIN);  // Read raw ADC value (0-1023)
-  float voltagePH = phRaw * (5.0 / 1023.0);  // Convert to voltage (0-5V)
-
-  // Convert voltage to pH using calibration formula
-  // pH 7.0 corresponds to 2.5V, with ~0.18V per pH unit
-  return 7 + ((2.5 - voltagePH) / 0.18);
+  PerfTimer timer(PERF_PH);
+  phCode = phFilter.sample();
+  return compensatedPH(phCode) * 0.01;
 }
 
 // Read Total Dissolved Solids (TDS) from analog sensor
 // Converts analog voltage to TDS in ppm (parts per million)
 // Uses cubic polynomial calibration curve for accuracy
-// Includes temperature compensation factor (0.5)
+// Takes one oversampled sample through the filter pipeline; the curve
+// is precomputed for every ADC code in a flash table, then referred to
+// 25 degC (2 %/degC) and corrected by the probe's calibration curve
 float readTDS() {
-  int tdsRaw = analogRead(TDS_PIN);  // Read raw ADC value (0-1023)
-  float voltageTDS = tdsRaw * (5.0 / 1023.0);  // Convert to voltage (0-5V)
-
-  // Apply cubic polynomial calibration curve
-  // Coefficients determined through sensor calibration process
-  return (133.42 * pow(voltageTDS, 3)
-         - 255.86 * pow(voltageTDS, 2)
-         + 857.39 * voltageTDS) * 0.5;  // 0.5 factor for temperature compensation
+  PerfTimer timer(PERF_TDS);
+  tdsCode = tdsFilter.sample();
+  return compensatedTDS(tdsCode) * (1.0 / TDS_TABLE_SCALE);
 }
 
 // Read Oxidation Reduction Potential (ORP) from sensor
 // Returns ORP value in millivolts (mV)
 // Uses calibrated sensor library for accurate readings
 // Positive values indicate oxidizing conditions, negative = reducing
+// Library readings go through a median and EMA filter
 int readORP() {
-  return ORP.read_orp();  // Library handles voltage conversion and calibration
+  PerfTimer timer(PERF_ORP);
+  return orpEma.update(orpMedian.update(ORP.read_orp()));
 }
 
 // Calibrate ORP sensor to known standard solution
@@ -93,22 +158,60 @@ void clearORPCalibration() {
   ORP.cal_clear();  // Erase calibration data from EEPROM
 }
 
-// Create formatted string with all sensor readings
-// Combines temperature, pH, TDS, and ORP into single pipe-delimited string
-// Used for logging and LoRa transmission of sensor data
+// Calibrate the pH probe with the buffer it is standing in
+// The filtered code of the last sample is taken as the buffer's reading,
+// so the probe should have settled in the buffer first
+bool calibratePH(float pH) {
+  return addPHPoint(phCode, pH);
+}
+
+// Return to the default pH calibration
+void clearPHCalibration() {
+  clearPHPoints();
+}
+
+// Calibrate the TDS probe with the standard solution it is standing in
+bool calibrateTDS(float ppm) {
+  return addTDSPoint(tdsCode, ppm);
+}
+
+// Return to the default TDS calibration
+void clearTDSCalibration() {
+  clearTDSPoints();
+}
+
+// Sample the analog water quality probes
+// Stores pH, TDS, and ORP as the latest readings for the report task
+void sampleWaterQuality() {
+  // Unpowered or still settling probes would only feed noise to the filters
+  if (!sensorsReady()) {
+    return;
+  }
+
+  latest.pH = readPH();
+  latest.tds = readTDS();
+  latest.orp = readORP();
+}
+
+// Get the latest readings from every water quality sensor
+// Values are those cached by sampleTemperature() and sampleWaterQuality()
+SensorReadings getSensorReadings() {
+  return latest;
+}
+
+// Print all sensor readings as a single pipe-delimited line
+// Writes straight to 'out' (Serial or a BufferWriter), allocating nothing
+// Used for logging and serial debug output of sensor data
 // Format: "Temp:XX.XX | pH:X.XX | TDS:XXX.X | ORP:XXX"
-String getSensorDataString() {
-  // Read all sensor values
-  float temperature = readTemperature();
-  float pH = readPH();
-  float tds = readTDS();
-  int orp = readORP();
-
-  // Format data string with appropriate decimal places
-  String data = "Temp:" + String(temperature, 2);  // 2 decimal places for temperature
-  data += " | pH:" + String(pH, 2);                // 2 decimal places for pH
-  data += " | TDS:" + String(tds, 1);              // 1 decimal place for TDS
-  data += " | ORP:" + String(orp);                 // Integer value for ORP
-
-  return data;
+size_t printSensorData(Print& out, const SensorReadings& readings) {
+  // Format data with appropriate decimal places
+  size_t n = out.print(F("Temp:"));
+  n += out.print(readings.temperature, 2);  // 2 decimal places for temperature
+  n += out.print(F(" | pH:"));
+  n += out.print(readings.pH, 2);           // 2 decimal places for pH
+  n += out.print(F(" | TDS:"));
+  n += out.print(readings.tds, 1);          // 1 decimal place for TDS
+  n += out.print(F(" | ORP:"));
+  n += out.print(readings.orp);             // Integer value for ORP
+  return n;
 }
\ No newline at end of file
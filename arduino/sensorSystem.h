@@ -5,19 +5,52 @@
 
 // Header file for water quality sensor system
 // Provides interface for reading temperature, pH, TDS, and ORP sensors
-// Includes calibration functions for ORP sensor accuracy
+// Includes calibration functions for ORP, pH and TDS sensor accuracy
 // Designed for aquatic monitoring applications
 
+// One complete set of water quality readings taken in the same cycle
+// Shared by the ASCII debug formatter and the binary telemetry encoder
+struct SensorReadings {
+  float temperature;          // Water temperature in degrees Celsius
+  bool temperatureDefaulted;  // True if the DS18B20 was missing and 25.0 was substituted
+  float pH;                   // pH value (0-14)
+  float tds;                  // Total dissolved solids in ppm
+  int orp;                    // Oxidation reduction potential in mV
+};
+
 // Function to initialize all water quality sensors
 // Sets up OneWire temperature sensors and loads ORP calibration
+// Switches the DS18B20 to non-blocking conversions and starts the first one
 // Must be called in setup() before using other sensor functions
 void initSensorSystem();
 
-// Function to get formatted string with all sensor readings
-// Returns pipe-delimited string containing all sensor values
+// Scheduler task for the DS18B20 temperature sensor
+// Collects the result of the previous conversion once it has finished,
+// then starts the next one without waiting for it
+// Run with a period of at least the conversion time (750 ms at 12 bits)
+// Skipped while the sensors are power-gated or settling (see power.h)
+void sampleTemperature();
+
+// Scheduler task for the analog water quality probes
+// Reads pH, TDS, and ORP once and stores them as the latest readings
+// Skipped while the sensors are power-gated or settling (see power.h)
+void sampleWaterQuality();
+
+// Function to get the latest temperature reading in Celsius
+// Returns the most recent completed conversion without blocking
+// Returns 25.0 until the first conversion completes or if the sensor is missing
+float readTemperature();
+
+// Function to get the latest readings from every water quality sensor
+// Returns values cached by the sampling tasks, never blocks
+SensorReadings getSensorReadings();
+
+// Function to print all sensor readings to any Print (Serial, BufferWriter)
+// Writes a pipe-delimited line without allocating any heap memory
 // Format: "Temp:XX.XX | pH:X.XX | TDS:XXX.X | ORP:XXX"
-// Used for data logging and wireless transmission
-String getSensorDataString();
+// Used for data logging and serial debug output
+// Returns the number of characters written
+size_t printSensorData(Print& out, const SensorReadings& readings);
 
 // Function to calibrate ORP sensor to known reference value
 // Performs single-point calibration using standard solution
@@ -31,4 +64,22 @@ void calibrateORP(int value);
 // Use before performing new calibration procedure
 void clearORPCalibration();
 
+// Function to calibrate the pH probe in a buffer solution
+// Adds a point to the probe's calibration curve (see compensation.h);
+// let the reading settle in the buffer before calling
+// Parameter: pH - value of the buffer at its current temperature
+// Returns false if the point was rejected as implausible
+bool calibratePH(float pH);
+
+// Function to clear the pH calibration points stored in EEPROM
+void clearPHCalibration();
+
+// Function to calibrate the TDS probe in a standard solution
+// Parameter: ppm - TDS of the standard, referred to 25 degC
+// Returns false if the point was rejected as implausible
+bool calibrateTDS(float ppm);
+
+// Function to clear the TDS calibration points stored in EEPROM
+void clearTDSCalibration();
+
 #endif
\ No newline at end of file
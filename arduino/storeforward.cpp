@@ -0,0 +1,268 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "storeforward.h"
+#include "telemetry.h"
+#include "ringbuffer.h"
+#include "lora_comm.h"
+#include "adr.h"
+#include "config.h"
+#include "constants.h"
+
+static_assert(BATCH_SIZE >= 1 && BATCH_SIZE <= MAX_BATCH_RECORDS,
+              "BATCH_SIZE must be between 1 and MAX_BATCH_RECORDS");
+static_assert(MAX_FRAME_SIZE <= MAX_PAYLOAD_SIZE, "Batch frames must fit one LoRa packet");
+static_assert(STORE_CAPACITY >= BATCH_SIZE, "A full batch must fit the RAM store");
+static_assert(EEPROM_STORE_ADDR + EEPROM_STORE_RECORDS * sizeof(TelemetryRecord) <= 1024,
+              "EEPROM store ring does not fit in the 1 KB EEPROM");
+
+// Readings waiting for transmission, oldest first
+static RingBuffer<TelemetryRecord, STORE_CAPACITY> ramStore;
+
+// EEPROM overflow ring; holds readings older than everything in RAM
+// Indexes live in RAM only: after a reset the timestamps are meaningless,
+// so spilled readings are deliberately not recovered
+static uint16_t eepromHead = 0;   // Slot of the oldest spilled reading
+static uint16_t eepromCount = 0;  // Number of spilled readings
+
+// Readings lost because both RAM and EEPROM were full
+static unsigned long dropped = 0;
+
+// Last queued reading, the reference for the deadbands
+static TelemetryRecord lastStored;
+static bool haveStored = false;
+
+// Keyframe the receiver acknowledged; delta frames quote its id
+static TelemetryRecord keyframe;
+static uint16_t keyframeId = 0;
+static unsigned long keyframeTime = 0;
+
+// Set while only full frames may be sent: at boot, after an unanswered
+// delta frame and once the keyframe is due for renewal; cleared when a
+// full frame is acknowledged
+static bool keyframeNeeded = true;
+
+// Frame of readings awaiting its downlink: the number of oldest pending
+// readings it carries, its packet counter and kind, and for a full frame
+// its last record, which becomes the keyframe once the frame is answered
+// Packet counters start at 1, so a counter of 0 means none in flight
+static uint16_t inFlight = 0;
+static uint32_t inFlightCounter = 0;
+static unsigned long inFlightSince = 0;
+static bool inFlightDelta = false;
+static TelemetryRecord candidate;
+
+// EEPROM address of a spill ring slot
+static int eepromSlotAddress(uint16_t slot) {
+  return EEPROM_STORE_ADDR + (slot % EEPROM_STORE_RECORDS) * sizeof(TelemetryRecord);
+}
+
+// Count the oldest pending reading as lost once it has been pushed out
+// If it was in flight, the frame's acknowledgement now covers one
+// reading fewer
+static void droppedOldest() {
+  dropped++;
+  if (inFlight > 0) {
+    inFlight--;
+  }
+}
+
+// Append a reading to the EEPROM ring, overwriting the oldest when full
+// EEPROM.put() only rewrites bytes that changed, limiting cell wear
+static void spillToEeprom(const TelemetryRecord& record) {
+  if (eepromCount == EEPROM_STORE_RECORDS) {
+    eepromHead = (eepromHead + 1) % EEPROM_STORE_RECORDS;
+    eepromCount--;
+    droppedOldest();
+  }
+  EEPROM.put(eepromSlotAddress(eepromHead + eepromCount), record);
+  eepromCount++;
+}
+
+// Get the i-th oldest pending reading, looking in EEPROM first
+static TelemetryRecord pendingAt(uint16_t index) {
+  TelemetryRecord record;
+  if (index < eepromCount) {
+    EEPROM.get(eepromSlotAddress(eepromHead + index), record);
+  } else {
+    record = ramStore.peek(index - eepromCount);
+  }
+  return record;
+}
+
+// Remove the 'n' oldest pending readings once the receiver has them
+static void discardPending(uint16_t n) {
+  uint16_t fromEeprom = n < eepromCount ? n : eepromCount;
+  eepromHead = (eepromHead + fromEeprom) % EEPROM_STORE_RECORDS;
+  eepromCount -= fromEeprom;
+  ramStore.discard(n - fromEeprom);
+}
+
+// True if a value moved further than its deadband from the reference
+// Values and deadband are in the record's fixed-point units
+static bool outsideDeadband(long value, long reference, uint16_t deadband) {
+  return labs(value - reference) > deadband;
+}
+
+// Decide whether a reading is news: the first one, a heartbeat, a change
+// of status flags or any channel outside its deadband
+// Deadbands and heartbeat come from the runtime configuration
+static bool worthStoring(const TelemetryRecord& record) {
+  if (!REPORT_BY_EXCEPTION || !haveStored) {
+    return true;
+  }
+  const NodeConfig& config = nodeConfig();
+  if (record.timestamp - lastStored.timestamp >= config.heartbeatInterval) {
+    return true;
+  }
+  return record.flags != lastStored.flags ||
+         outsideDeadband(record.temperature, lastStored.temperature, config.tempDeadband) ||
+         outsideDeadband(record.pH, lastStored.pH, config.phDeadband) ||
+         outsideDeadband(record.tds, lastStored.tds, config.tdsDeadband) ||
+         outsideDeadband(record.orp, lastStored.orp, config.orpDeadband);
+}
+
+// Queue a reading for transmission
+bool storeReading(const SensorReadings& readings) {
+  TelemetryRecord record = makeTelemetryRecord(readings);
+  if (!worthStoring(record)) {
+    return false;
+  }
+  lastStored = record;
+  haveStored = true;
+
+  if (ramStore.full()) {
+    TelemetryRecord oldest;
+    ramStore.pop(oldest);
+    if (STORE_EEPROM_SPILL) {
+      spillToEeprom(oldest);
+    } else {
+      droppedOldest();
+    }
+  }
+  ramStore.push(record);
+  return true;
+}
+
+// Hold the 'count' oldest readings until the frame just sent is answered
+static void awaitAcknowledgement(uint16_t count, bool delta) {
+  inFlight = count;
+  inFlightCounter = lastPacketCounter();
+  inFlightSince = millis();
+  inFlightDelta = delta;
+  expectDownlink();
+}
+
+// Remember the last record of a full frame that was just sent; it becomes
+// the keyframe if the receiver acknowledges the frame
+static void sentFullFrame(const TelemetryRecord& last, uint16_t count) {
+  candidate = last;
+  awaitAcknowledgement(count, false);
+}
+
+// Settle the frame in flight once its receive window has ended
+// An acknowledged frame releases its readings, and a full frame becomes
+// the keyframe. An unanswered frame leaves its readings at the head of the
+// queue for the next report; after an unanswered delta frame they go as a
+// full frame, since the receiver may not hold the keyframe any more (it
+// may have restarted)
+static void settleInFlight(bool acknowledged) {
+  if (acknowledged) {
+    discardPending(inFlight);
+    if (!inFlightDelta) {
+      keyframe = candidate;
+      keyframeId = inFlightCounter & 0xFFFF;
+      keyframeTime = millis();
+      keyframeNeeded = false;
+    }
+  } else if (inFlightDelta) {
+    keyframeNeeded = true;
+  }
+  inFlight = 0;
+  inFlightCounter = 0;
+}
+
+// Send queued readings as differences from the keyframe
+static uint8_t forwardDeltas(uint16_t pending) {
+  uint8_t count = BATCH_SIZE == 1 ? 1 : (pending < 255 ? pending : 255);
+
+  size_t len = encodeDeltaFrame(txBuffer, pendingAt, count, keyframe, keyframeId);
+  if (!sendFrame(txBuffer, len)) {
+    return 0;
+  }
+  awaitAcknowledgement(count, true);
+  return count;
+}
+
+// Transmit the oldest queued readings
+// Readings stay queued until the downlink answering their frame arrives
+// (see acknowledgeUplink()); a busy radio, an unanswered frame or a
+// receiver outage leaves them in place to be sent again with the next
+// report. Only one frame of readings is in flight at a time
+uint8_t forwardReadings() {
+  // An answer that never comes, e.g. an uplink held back by the transmit
+  // schedule past any reasonable window, does not pin the queue for good
+  if (inFlightCounter != 0 && millis() - inFlightSince >= UPLINK_ACK_TIMEOUT) {
+    settleInFlight(false);
+  }
+  if (inFlightCounter != 0) {
+    return 0;
+  }
+
+  uint16_t pending = pendingReadings();
+  if (pending == 0) {
+    return 0;
+  }
+
+  // Wait for a full batch unless reporting by exception; a backlog left
+  // by an outage is drained in frames as large as the radio allows
+  if (BATCH_SIZE > 1 && !REPORT_BY_EXCEPTION && pending < BATCH_SIZE) {
+    return 0;
+  }
+
+  // Renew the keyframe now and then, so a long-lived one does not leave
+  // every difference wider than it needs to be
+  if (DELTA_ENCODING && !keyframeNeeded && millis() - keyframeTime >= KEYFRAME_INTERVAL) {
+    keyframeNeeded = true;
+  }
+  if (DELTA_ENCODING && !keyframeNeeded) {
+    return forwardDeltas(pending);
+  }
+
+  if (BATCH_SIZE == 1) {
+    TelemetryRecord record = pendingAt(0);
+    encodeTelemetryFrame(txBuffer, record);
+    if (!sendFrame(txBuffer, TELEMETRY_FRAME_SIZE)) {
+      return 0;
+    }
+    sentFullFrame(record, 1);
+    return 1;
+  }
+
+  uint8_t count = pending < MAX_BATCH_RECORDS ? pending : MAX_BATCH_RECORDS;
+
+  size_t len = encodeBatchFrame(txBuffer, pendingAt, count);
+  if (!sendFrame(txBuffer, len)) {
+    return 0;
+  }
+  sentFullFrame(pendingAt(count - 1), count);
+  return count;
+}
+
+// Release acknowledged readings and track the receiver's keyframe from
+// the answers to our uplinks
+// Answers to other frames (config, energy, perf, navigation) are ignored
+void acknowledgeUplink(uint32_t counter, bool acknowledged) {
+  if (inFlightCounter != 0 && counter == inFlightCounter) {
+    settleInFlight(acknowledged);
+  }
+}
+
+// Number of readings waiting for transmission
+uint16_t pendingReadings() {
+  return eepromCount + ramStore.size();
+}
+
+// Number of readings lost to buffer overflow
+unsigned long droppedReadings() {
+  return dropped;
+}
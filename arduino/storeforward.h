@@ -0,0 +1,54 @@
+#ifndef STORE_FORWARD_H
+#define STORE_FORWARD_H
+
+#include <Arduino.h>
+#include "sensorSystem.h"
+
+// Header file for store-and-forward telemetry buffering
+// Readings are timestamped and queued in a RAM ring buffer, optionally
+// overflowing into an EEPROM ring, and leave the queue only once the
+// receiver has acknowledged the frame carrying them with a downlink; an
+// unanswered frame is sent again, so readings survive receiver outages
+// (the receiver may then see a reading twice, when only the downlink
+// was lost)
+// In batching mode (BATCH_SIZE > 1) many readings share one encrypted
+// LoRa frame, so the preamble and header cost is paid once per batch
+// With REPORT_BY_EXCEPTION only readings that moved past a deadband, or
+// a heartbeat, are queued, and they are sent at the next report instead
+// of waiting for a full batch
+// With DELTA_ENCODING readings travel as small differences from the last
+// keyframe the receiver acknowledged; a full frame is sent first, after a
+// delta frame goes unanswered, and every KEYFRAME_INTERVAL, and becomes
+// the new keyframe once its downlink arrives
+
+// Function to queue a reading for transmission
+// Scales and timestamps the reading, then appends it to the RAM buffer
+// When RAM is full the oldest reading is spilled to EEPROM (if enabled)
+// or dropped
+// Returns false if the reading was inside every deadband and no
+// heartbeat was due, so nothing was queued
+bool storeReading(const SensorReadings& readings);
+
+// Function to transmit queued readings
+// Single mode: sends the oldest reading as a TELEMETRY_FRAME_SIZE telemetry frame
+// Batching mode: waits for BATCH_SIZE readings, then sends them (or a
+// larger backlog, up to MAX_BATCH_RECORDS) in one batch frame
+// Report by exception: sends whatever is queued without waiting
+// Nothing is sent while an earlier frame of readings awaits its answer
+// Returns the number of readings transmitted, 0 if nothing was sent
+uint8_t forwardReadings();
+
+// Function to release the readings of an acknowledged frame, or keep an
+// unanswered frame's readings for the next report, and to track which
+// frame the receiver holds as the keyframe
+// Registered with onUplinkResult() (see adr.h)
+void acknowledgeUplink(uint32_t counter, bool acknowledged);
+
+// Function to get the number of readings waiting for transmission
+// Includes readings spilled to EEPROM and readings awaiting their answer
+uint16_t pendingReadings();
+
+// Function to get the number of readings lost because every buffer was full
+unsigned long droppedReadings();
+
+#endif
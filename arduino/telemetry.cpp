@@ -0,0 +1,237 @@
+#include <Arduino.h>
+#include "telemetry.h"
+
+// Write a 16-bit value into the frame in little-endian byte order
+static void putU16(uint8_t* dst, uint16_t value) {
+  dst[0] = value & 0xFF;
+  dst[1] = value >> 8;
+}
+
+// Write a 32-bit value into the frame in little-endian byte order
+static void putU32(uint8_t* dst, uint32_t value) {
+  putU16(dst, value & 0xFFFF);
+  putU16(dst + 2, value >> 16);
+}
+
+// Write an unsigned varint, returns the number of bytes written (1..5)
+static uint8_t putVarint(uint8_t* dst, uint32_t value) {
+  uint8_t n = 0;
+  while (value >= 0x80) {
+    dst[n++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  dst[n++] = value;
+  return n;
+}
+
+// Write a signed difference as a zigzag varint, so small differences of
+// either sign take one byte
+static uint8_t putZigzag(uint8_t* dst, int32_t value) {
+  return putVarint(dst, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+// Scale a float reading to a fixed-point integer and clamp it to the field range
+// Rounds to nearest instead of truncating so 7.199 pH is sent as 720, not 719
+static long scaleReading(float value, float scale, long minValue, long maxValue) {
+  float scaled = value * scale;
+  long rounded = (long)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+
+  if (rounded < minValue) return minValue;
+  if (rounded > maxValue) return maxValue;
+  return rounded;
+}
+
+// Age of a record in whole seconds at the time of encoding
+// Saturates at ~18 hours, the largest value the 16-bit field can hold
+static uint16_t recordAge(const TelemetryRecord& record) {
+  unsigned long age = (millis() - record.timestamp) / 1000;
+  return age > 65535 ? 65535 : age;
+}
+
+// Write the four scaled sensor fields (8 bytes) shared by both frame layouts
+static void putReadingFields(uint8_t* dst, const TelemetryRecord& record) {
+  putU16(dst, record.temperature);
+  putU16(dst + 2, record.pH);
+  putU16(dst + 4, record.tds);
+  putU16(dst + 6, record.orp);
+}
+
+// Scale sensor readings into a telemetry record
+TelemetryRecord makeTelemetryRecord(const SensorReadings& readings) {
+  TelemetryRecord record;
+  record.timestamp = millis();
+  record.temperature = scaleReading(readings.temperature, 100.0, -32768, 32767);
+  record.pH = scaleReading(readings.pH, 100.0, -32768, 32767);
+  record.tds = scaleReading(readings.tds, 10.0, 0, 65535);
+  record.orp = constrain(readings.orp, -32768, 32767);
+  record.flags = readings.temperatureDefaulted ? TELEMETRY_FLAG_TEMP_DEFAULT : 0;
+  return record;
+}
+
+// Encode one record into a TELEMETRY_FRAME_SIZE binary telemetry frame
+// Layout is documented in telemetry.h and mirrored by the receiver sketch
+void encodeTelemetryFrame(uint8_t* frame, const TelemetryRecord& record) {
+  frame[0] = FRAME_TYPE_TELEMETRY;
+  putReadingFields(frame + 1, record);
+  frame[9] = record.flags;
+  putU16(frame + 10, recordAge(record));
+}
+
+// Encode several records into one batch frame
+// Records share the frame header, so each extra reading costs only
+// BATCH_RECORD_SIZE bytes instead of a whole packet
+// Returns the frame length, ready for sendFrame()
+size_t encodeBatchFrame(uint8_t* frame, RecordSource recordAt, uint8_t count) {
+  if (count > MAX_BATCH_RECORDS) {
+    count = MAX_BATCH_RECORDS;
+  }
+
+  frame[0] = FRAME_TYPE_BATCH;
+  frame[1] = count;
+
+  uint8_t* dst = frame + BATCH_HEADER_SIZE;
+  for (uint8_t i = 0; i < count; i++) {
+    TelemetryRecord record = recordAt(i);
+    putU16(dst, recordAge(record));
+    putReadingFields(dst + 2, record);
+    dst[10] = record.flags;
+    dst += BATCH_RECORD_SIZE;
+  }
+
+  return BATCH_HEADER_SIZE + (size_t)count * BATCH_RECORD_SIZE;
+}
+
+// Encode records as differences from the acknowledged keyframe
+// Differences are taken from the keyframe rather than the previous record,
+// so a lost delta frame never corrupts the ones after it
+size_t encodeDeltaFrame(uint8_t* frame, RecordSource recordAt, uint8_t& count,
+                        const TelemetryRecord& keyframe, uint16_t keyframeId) {
+  frame[0] = FRAME_TYPE_DELTA;
+  putU16(frame + 1, keyframeId);
+
+  uint8_t* dst = frame + DELTA_HEADER_SIZE;
+  uint8_t encoded = 0;
+  while (encoded < count && dst + DELTA_RECORD_MAX_SIZE <= frame + MAX_FRAME_SIZE) {
+    TelemetryRecord record = recordAt(encoded);
+    dst += putVarint(dst, recordAge(record));
+    *dst++ = record.flags;
+    dst += putZigzag(dst, (int32_t)record.temperature - keyframe.temperature);
+    dst += putZigzag(dst, (int32_t)record.pH - keyframe.pH);
+    dst += putZigzag(dst, (int32_t)record.tds - keyframe.tds);
+    dst += putZigzag(dst, (int32_t)record.orp - keyframe.orp);
+    encoded++;
+  }
+
+  frame[3] = encoded;
+  count = encoded;
+  return dst - frame;
+}
+
+// Compass heading in the 2-degree units of path and obstacle frames
+static uint8_t packHeading(uint16_t heading) {
+  return ((heading + 1) / 2) % 180;
+}
+
+// Encode path points, each as a difference from the one before
+size_t encodePathFrame(uint8_t* frame, PathSource pointAt, uint8_t count) {
+  frame[0] = FRAME_TYPE_PATH;
+  frame[1] = count;
+  if (count == 0) {
+    return 2;
+  }
+
+  PathPoint previous = pointAt(0);
+  putU32(frame + 2, previous.latitude);
+  putU32(frame + 6, previous.longitude);
+
+  uint8_t* dst = frame + PATH_HEADER_SIZE;
+  for (uint8_t i = 0; i < count; i++) {
+    PathPoint point = pointAt(i);
+    unsigned long age = (millis() - point.timestamp) / 1000;
+    dst += putVarint(dst, age > 65535 ? 65535 : age);
+    *dst++ = packHeading(point.heading);
+    dst += putZigzag(dst, point.latitude - previous.latitude);
+    dst += putZigzag(dst, point.longitude - previous.longitude);
+    previous = point;
+  }
+  return dst - frame;
+}
+
+// Encode an obstacle with the position it was seen from
+void encodeObstacleFrame(uint8_t* frame, const PathPoint& where, bool hasFix, float distanceCm) {
+  frame[0] = FRAME_TYPE_OBSTACLE;
+  putU32(frame + 1, hasFix ? where.latitude : 0);
+  putU32(frame + 5, hasFix ? where.longitude : 0);
+  putU16(frame + 9, scaleReading(distanceCm, 10.0, 0, 65535));
+  frame[11] = packHeading(where.heading);
+
+  unsigned long age = (millis() - where.timestamp) / 1000;
+  putU16(frame + 12, !hasFix ? 0xFFFF : (age > 0xFFFE ? 0xFFFE : age));
+}
+
+// Encode the energy budget with the current uptime
+void encodeEnergyFrame(uint8_t* frame, const uint32_t* charges) {
+  frame[0] = FRAME_TYPE_ENERGY;
+  putU32(frame + 1, millis() / 1000);
+  for (uint8_t i = 0; i < ENERGY_FIELDS; i++) {
+    putU32(frame + 5 + 4 * i, charges[i]);
+  }
+}
+
+// Clamp a count or duration to the 4-byte varint range of the perf frame
+static uint32_t perfField(uint32_t value) {
+  return value > 0x0FFFFFFF ? 0x0FFFFFFF : value;
+}
+
+// Encode every probe, skipping the details of those never called
+size_t encodePerfFrame(uint8_t* frame, unsigned long windowMs, PerfSource statsOf) {
+  unsigned long window = windowMs / 1000;
+  frame[0] = FRAME_TYPE_PERF;
+  putU16(frame + 1, window > 65535 ? 65535 : window);
+  frame[3] = PERF_PROBES;
+
+  uint8_t* dst = frame + PERF_HEADER_SIZE;
+  for (uint8_t i = 0; i < PERF_PROBES; i++) {
+    const PerfStats& s = statsOf((PerfProbe)i);
+    dst += putVarint(dst, perfField(s.count));
+    if (s.count == 0) {
+      continue;
+    }
+
+    dst += putVarint(dst, perfField(s.minMicros));
+    dst += putVarint(dst, perfField(s.totalMicros / s.count));
+    dst += putVarint(dst, perfField(s.maxMicros));
+
+    // Buckets are halved together on overflow, so shares are taken of
+    // their sum rather than of the call count
+    uint32_t total = 0;
+    for (uint8_t b = 0; b < PERF_BUCKETS; b++) {
+      total += s.histogram[b];
+    }
+    for (uint8_t b = 0; b < PERF_BUCKETS; b++) {
+      uint32_t share = total ? ((uint32_t)s.histogram[b] * 255 + total / 2) / total : 0;
+      *dst++ = (s.histogram[b] && share == 0) ? 1 : share;
+    }
+  }
+  return dst - frame;
+}
+
+// Encode the settings, with the outcome of the last command
+void encodeConfigFrame(uint8_t* frame, const NodeConfig& config) {
+  frame[0] = FRAME_TYPE_CONFIG;
+  frame[1] = config.version;
+  frame[2] = config.keyId;
+  frame[3] = config.lastCommand;
+  frame[4] = config.lastStatus;
+  frame[5] = config.adrEnabled ? 0x01 : 0x00;
+  frame[6] = config.txPower;
+  putU32(frame + 7, config.sampleInterval);
+  putU32(frame + 11, config.recordInterval);
+  putU32(frame + 15, config.reportInterval);
+  putU32(frame + 19, config.heartbeatInterval);
+  putU32(frame + 23, config.dutyCyclePeriod);
+  putU16(frame + 27, config.tempDeadband);
+  putU16(frame + 29, config.phDeadband);
+  putU16(frame + 31, config.tdsDeadband);
+  putU16(frame + 33, config.orpDeadband);
+}
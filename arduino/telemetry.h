@@ -0,0 +1,225 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "sensorSystem.h"
+#include "perf.h"
+#include "config.h"
+
+// Header file for the compact binary telemetry frames
+// Readings are scaled to fixed-point records and packed into either a
+// single-reading frame, or a batch frame that shares one header (and one
+// LoRa preamble) across many readings
+// Node id and sequence number travel in the packet header added by
+// sendFrame() (see lora_comm.h), so frames carry only the readings
+// The receiver sketch decodes both layouts back into the legacy JSON
+//
+// Single frame layout (multi-byte fields are little-endian):
+//   [0]      frame type (FRAME_TYPE_TELEMETRY)
+//   [1..2]   temperature, int16, 0.01 degC
+//   [3..4]   pH, int16, 0.01 pH
+//   [5..6]   TDS, uint16, 0.1 ppm (clamped to 0..6553.5)
+//   [7..8]   ORP, int16, mV
+//   [9]      status flags (TELEMETRY_FLAG_*)
+//   [10..11] age of the reading at transmission, uint16, seconds
+//
+// Batch frame layout:
+//   [0]      frame type (FRAME_TYPE_BATCH)
+//   [1]      number of records N
+//   [2..]    N records of BATCH_RECORD_SIZE bytes, oldest first:
+//              [0..1] age in seconds, [2..9] temperature, pH, TDS, ORP
+//              as in the single frame, [10] status flags
+//
+// Delta frame layout:
+//   [0]      frame type (FRAME_TYPE_DELTA)
+//   [1..2]   keyframe id, uint16: low 16 bits of the packet counter of the
+//            single or batch frame whose last record is the keyframe
+//   [3]      number of records N
+//   [4..]    N records, oldest first:
+//              age in seconds (varint), status flags (1 byte), then the
+//              temperature, pH, TDS and ORP differences from the keyframe
+//              in the single frame units (zigzag varint each)
+// Varints are 7 bits per byte, least significant group first, high bit
+// set on every byte but the last; zigzag maps 0, -1, 1, -2 to 0, 1, 2, 3
+// An unchanged reading costs 6 bytes instead of BATCH_RECORD_SIZE
+//
+// Path frame layout:
+//   [0]      frame type (FRAME_TYPE_PATH)
+//   [1]      number of points N
+//   [2..5]   latitude of the first point, int32, 1e-6 degrees
+//   [6..9]   longitude of the first point, int32, 1e-6 degrees
+//   [10..]   N points, oldest first:
+//              age in seconds (varint), heading (uint8, 2 degrees), then
+//              latitude and longitude difference from the previous point
+//              (zigzag varint each, 0 for the first point)
+// A boat at survey speed moves a few tens of 1e-6 degrees per second, so
+// a point usually costs 4 bytes
+//
+// Obstacle frame layout:
+//   [0]      frame type (FRAME_TYPE_OBSTACLE)
+//   [1..4]   latitude, int32, 1e-6 degrees
+//   [5..8]   longitude, int32, 1e-6 degrees
+//   [9..10]  distance, uint16, millimetres
+//   [11]     heading, uint8, 2 degrees
+//   [12..13] age of the position fix, uint16, seconds (0xFFFF = no fix,
+//            latitude and longitude are then 0)
+//
+// Energy frame layout:
+//   [0]      frame type (FRAME_TYPE_ENERGY)
+//   [1..4]   uptime, uint32, seconds
+//   [5..]    ENERGY_FIELDS charges, uint32, microamp-hours since boot, in
+//            EnergySubsystem order: CPU, sleep, radio TX, radio RX,
+//            sensors, GPS
+//
+// Perf frame layout:
+//   [0]      frame type (FRAME_TYPE_PERF)
+//   [1..2]   length of the measurement window, uint16, seconds
+//   [3]      number of probes N, in PerfProbe order
+//   [4..]    N probes: call count (varint); if not zero, then min, mean
+//            and max time in microseconds (varint each) and PERF_BUCKETS
+//            bytes with each histogram bucket's share of the calls in
+//            1/255 units (a bucket with any calls is at least 1)
+// Counts and times are clamped to 28 bits so every varint fits 4 bytes
+//
+// Config frame layout, sent at boot and to answer every command (see
+// config.h):
+//   [0]      frame type (FRAME_TYPE_CONFIG)
+//   [1]      config block version (CONFIG_VERSION)
+//   [2]      key id, number of key rotations
+//   [3]      id of the last command received, 0 = none
+//   [4]      status of that command (CommandStatus)
+//   [5]      flags: bit 0 = ADR enabled
+//   [6]      transmit power, dBm
+//   [7..26]  sample, record, report, heartbeat and duty cycle periods,
+//            uint32 each, milliseconds
+//   [27..34] temperature, pH, TDS and ORP deadbands, uint16 each, in the
+//            single frame units
+
+// Size of an encoded single telemetry frame in bytes
+constexpr uint8_t TELEMETRY_FRAME_SIZE = 12;
+
+// Frame type identifiers stored in the first byte of every frame
+constexpr uint8_t FRAME_TYPE_TELEMETRY = 0x01;
+constexpr uint8_t FRAME_TYPE_BATCH = 0x02;
+constexpr uint8_t FRAME_TYPE_ENERGY = 0x03;
+constexpr uint8_t FRAME_TYPE_DELTA = 0x04;
+constexpr uint8_t FRAME_TYPE_PATH = 0x05;
+constexpr uint8_t FRAME_TYPE_OBSTACLE = 0x06;
+constexpr uint8_t FRAME_TYPE_PERF = 0x07;
+constexpr uint8_t FRAME_TYPE_CONFIG = 0x08;
+
+// Path and obstacle frame geometry
+constexpr uint8_t PATH_HEADER_SIZE = 10;
+constexpr uint8_t PATH_POINT_MAX_SIZE = 14;  // 3-byte age, heading, two 5-byte differences
+constexpr uint8_t OBSTACLE_FRAME_SIZE = 14;
+
+// Delta frame geometry
+constexpr uint8_t DELTA_HEADER_SIZE = 4;
+constexpr uint8_t DELTA_RECORD_MAX_SIZE = 16;  // 3-byte age, flags, four 3-byte differences
+
+// Energy frame geometry
+constexpr uint8_t ENERGY_FIELDS = 6;
+constexpr uint8_t ENERGY_FRAME_SIZE = 5 + 4 * ENERGY_FIELDS;
+
+// Perf frame geometry
+constexpr uint8_t PERF_HEADER_SIZE = 4;
+constexpr uint8_t PERF_PROBE_MAX_SIZE = 4 * 4 + PERF_BUCKETS;  // Four 4-byte varints and the histogram
+constexpr uint8_t PERF_FRAME_MAX_SIZE = PERF_HEADER_SIZE + PERF_PROBES * PERF_PROBE_MAX_SIZE;
+
+// Config frame geometry
+constexpr uint8_t CONFIG_FRAME_SIZE = 35;
+
+// Batch frame geometry
+constexpr uint8_t BATCH_HEADER_SIZE = 2;
+constexpr uint8_t BATCH_RECORD_SIZE = 11;
+// Largest frame that fits one packet: the 255-byte LoRa payload minus the
+// packet header and MIC (MAX_PAYLOAD_SIZE in lora_comm.h)
+constexpr uint8_t MAX_FRAME_SIZE = 246;
+constexpr uint8_t MAX_BATCH_RECORDS = (MAX_FRAME_SIZE - BATCH_HEADER_SIZE) / BATCH_RECORD_SIZE;
+
+// Status flag set when the temperature sensor was disconnected and the
+// 25 degC default was reported instead of a measurement
+constexpr uint8_t TELEMETRY_FLAG_TEMP_DEFAULT = 0x01;
+
+// One reading scaled to the fixed-point units used on air
+// Kept in the store-and-forward buffer until it has been transmitted
+struct TelemetryRecord {
+  uint32_t timestamp;   // millis() when the reading was stored
+  int16_t temperature;  // 0.01 degC
+  int16_t pH;           // 0.01 pH
+  uint16_t tds;         // 0.1 ppm
+  int16_t orp;          // mV
+  uint8_t flags;        // TELEMETRY_FLAG_*
+};
+
+// One georeferenced position, used for path points and obstacles
+struct PathPoint {
+  uint32_t timestamp;  // millis() of the GPS fix
+  int32_t latitude;    // 1e-6 degrees
+  int32_t longitude;   // 1e-6 degrees
+  uint16_t heading;    // Compass heading, degrees (0-359)
+};
+
+// Function to scale sensor readings into a telemetry record
+// Rounds each value to its fixed-point unit and clamps it to the field range
+// Timestamp is set to the current millis()
+TelemetryRecord makeTelemetryRecord(const SensorReadings& readings);
+
+// Function to encode one record into a single telemetry frame
+// Output parameter 'frame' must hold at least TELEMETRY_FRAME_SIZE bytes
+void encodeTelemetryFrame(uint8_t* frame, const TelemetryRecord& record);
+
+// Callback returning the i-th record of a batch, 0 = oldest
+// Lets records be read straight from their store instead of being
+// copied into a temporary array on the stack
+typedef TelemetryRecord (*RecordSource)(uint16_t index);
+
+// Function to encode several records into one batch frame
+// Output parameter 'frame' must hold at least MAX_FRAME_SIZE bytes
+// 'count' is clamped to MAX_BATCH_RECORDS
+// Returns the frame length
+size_t encodeBatchFrame(uint8_t* frame, RecordSource recordAt, uint8_t count);
+
+// Function to encode records as differences from a keyframe
+// Output parameter 'frame' must hold at least MAX_FRAME_SIZE bytes
+// 'count' is the number of records wanted; on return it holds the number
+// that fit the frame
+// Returns the frame length
+size_t encodeDeltaFrame(uint8_t* frame, RecordSource recordAt, uint8_t& count,
+                        const TelemetryRecord& keyframe, uint16_t keyframeId);
+
+// Callback returning the i-th queued path point, 0 = oldest
+typedef PathPoint (*PathSource)(uint8_t index);
+
+// Function to encode path points into a path frame
+// Output parameter 'frame' must hold PATH_HEADER_SIZE plus
+// PATH_POINT_MAX_SIZE bytes per point
+// Returns the frame length
+size_t encodePathFrame(uint8_t* frame, PathSource pointAt, uint8_t count);
+
+// Function to encode an obstacle sighting into an obstacle frame
+// Parameters: where - position and heading, ignored if 'hasFix' is false
+//             distanceCm - measured distance to the obstacle
+// Output parameter 'frame' must hold at least OBSTACLE_FRAME_SIZE bytes
+void encodeObstacleFrame(uint8_t* frame, const PathPoint& where, bool hasFix, float distanceCm);
+
+// Function to encode the energy budget into an energy frame
+// Parameter: charges - ENERGY_FIELDS values in microamp-hours
+// Output parameter 'frame' must hold at least ENERGY_FRAME_SIZE bytes
+void encodeEnergyFrame(uint8_t* frame, const uint32_t* charges);
+
+// Callback returning the statistics of a probe, e.g. perfStats()
+typedef const PerfStats& (*PerfSource)(PerfProbe probe);
+
+// Function to encode the performance statistics into a perf frame
+// Parameters: windowMs - length of the window the statistics cover
+//             statsOf - statistics of each probe
+// Output parameter 'frame' must hold at least PERF_FRAME_MAX_SIZE bytes
+// Returns the frame length
+size_t encodePerfFrame(uint8_t* frame, unsigned long windowMs, PerfSource statsOf);
+
+// Function to encode the settings in use into a config frame
+// Output parameter 'frame' must hold at least CONFIG_FRAME_SIZE bytes
+void encodeConfigFrame(uint8_t* frame, const NodeConfig& config);
+
+#endif
@@ -0,0 +1,116 @@
+#include <Arduino.h>
+#include "txschedule.h"
+#include "gps.h"
+#include "constants.h"
+
+static_assert(86400000UL % (TX_SLOT_LENGTH * TX_SLOT_COUNT) == 0,
+              "Slot frames must tile the day so slots stay aligned across midnight");
+static_assert(TX_SLOT_LENGTH > 3 * TX_SLOT_GUARD, "Slot guards leave no time to transmit");
+
+// Packet waiting in the radio
+static bool pending = false;
+static bool channelClear = false;   // Send without another CAD once the wait is over
+static unsigned long occupancy = 0; // Channel time of the uplink and its receive window (milliseconds)
+static uint8_t busyCount = 0;       // Busy checks for this packet
+
+// No attempt before waitStart + waitLength (millis())
+static unsigned long waitStart = 0;
+static unsigned long waitLength = 0;
+
+static TransmitStats stats = { 0, 0, 0 };
+
+// Hold the packet for 'ms' from now
+static void waitFor(unsigned long ms) {
+  waitStart = millis();
+  waitLength = ms;
+}
+
+// Time until this node's slot can take the packet, 0 if it may start now
+// Always 0 when slotting is off or no recent GPS time is known
+// A packet too long for its slot may still start in the slot's first
+// TX_SLOT_GUARD and overruns into the next slot, where the owner's CAD
+// hears it
+static unsigned long slotWait() {
+  unsigned long timeOfDay;
+  if (!TX_SLOTTED || !gpsTimeOfDay(timeOfDay)) {
+    return 0;
+  }
+
+  const unsigned long frameLength = TX_SLOT_LENGTH * TX_SLOT_COUNT;
+  const unsigned long usable = TX_SLOT_LENGTH - 2 * TX_SLOT_GUARD;
+  unsigned long position = timeOfDay % frameLength;
+  unsigned long open = (NODE_ID % TX_SLOT_COUNT) * TX_SLOT_LENGTH + TX_SLOT_GUARD;
+  unsigned long latest = open + (occupancy + TX_SLOT_GUARD < usable ? usable - occupancy : TX_SLOT_GUARD);
+
+  if (position >= open && position <= latest) {
+    return 0;
+  }
+  return (open + frameLength - position) % frameLength;
+}
+
+// Schedule a packet after a random jitter
+void scheduleTransmit(unsigned long occupancyMs) {
+  pending = true;
+  channelClear = false;
+  occupancy = occupancyMs;
+  busyCount = 0;
+  stats.uplinks++;
+  waitFor(random(TX_JITTER_MAX + 1));
+}
+
+// Next step for the scheduled packet
+// The slot is checked again after every wait, including after a clear
+// CAD, so a backoff never pushes the uplink past the end of the slot
+TransmitAction nextTransmitAction() {
+  if (!pending || millis() - waitStart < waitLength) {
+    return TX_WAIT;
+  }
+
+  unsigned long wait = slotWait();
+  if (wait > 0) {
+    waitFor(wait);
+    return TX_WAIT;
+  }
+
+  if (channelClear || !LBT_ENABLED) {
+    pending = false;
+    return TX_SEND;
+  }
+  return TX_LISTEN;
+}
+
+// Record a CAD outcome and plan the randomized exponential backoff
+// After LBT_MAX_ATTEMPTS busy checks the packet still waits out the last
+// backoff, then goes without listening again
+void channelChecked(bool busy) {
+  if (!busy) {
+    channelClear = true;
+    return;
+  }
+
+  stats.busyChecks++;
+  busyCount++;
+  if (busyCount >= LBT_MAX_ATTEMPTS) {
+    stats.forced++;
+    channelClear = true;
+  }
+
+  uint8_t exponent = busyCount < LBT_MAX_BACKOFF_EXP ? busyCount : LBT_MAX_BACKOFF_EXP;
+  unsigned long window = occupancy << exponent;
+  waitFor(random(window / 2, window));
+}
+
+// Channel access counters since boot
+const TransmitStats& transmitStats() {
+  return stats;
+}
+
+// Print the channel access counters
+void printTransmitStats() {
+  Serial.print(F("Channel: uplinks="));
+  Serial.print(stats.uplinks);
+  Serial.print(F(" busy="));
+  Serial.print(stats.busyChecks);
+  Serial.print(F(" forced="));
+  Serial.println(stats.forced);
+}
@@ -0,0 +1,57 @@
+#ifndef TXSCHEDULE_H
+#define TXSCHEDULE_H
+
+#include <Arduino.h>
+
+// Header file for the uplink transmit scheduler
+// Decides when a sealed packet waiting in the radio (see sendFrame() in
+// lora_comm.h) may go on air, so that nodes sharing a channel stop
+// colliding with each other:
+// - every uplink waits a random 0..TX_JITTER_MAX first, so nodes that
+//   powered up together and run the same report period drift apart
+// - with LBT_ENABLED the channel is then checked with channel activity
+//   detection (CAD); on activity the uplink backs off for a random time
+//   in the upper half of a window of 2^n channel occupancies, n counting
+//   the busy checks up to LBT_MAX_BACKOFF_EXP, and after LBT_MAX_ATTEMPTS
+//   busy checks it is sent anyway rather than held forever
+// - with TX_SLOTTED the GPS UTC time splits the day into frames of
+//   TX_SLOT_COUNT slots of TX_SLOT_LENGTH, and uplinks start only inside
+//   this node's slot, early enough to finish before its guard time;
+//   without a recent GPS time the node falls back to jitter and LBT
+// lora_comm.cpp runs the CAD and the transmission; this module only
+// keeps the timing policy and its counters
+
+// Next step for the packet waiting in the radio
+enum TransmitAction {
+  TX_WAIT,    // Nothing queued, or its time has not come yet
+  TX_LISTEN,  // Check the channel with CAD and report the outcome
+  TX_SEND     // Hand the packet to the radio now
+};
+
+// Channel access counters since boot
+struct TransmitStats {
+  uint32_t uplinks;     // Packets scheduled
+  uint32_t busyChecks;  // CAD checks that found the channel busy
+  uint32_t forced;      // Packets sent after LBT_MAX_ATTEMPTS busy checks
+};
+
+// Function to schedule a packet that has just been written to the radio
+// Parameter: occupancyMs - time the uplink and its receive window hold the
+//                          channel, used for slot fitting and backoff
+void scheduleTransmit(unsigned long occupancyMs);
+
+// Function to get the next step for the scheduled packet
+// Polled by lora_comm.cpp until it returns TX_SEND
+TransmitAction nextTransmitAction();
+
+// Function to report the outcome of the CAD requested with TX_LISTEN
+// Parameter: busy - whether the CAD detected a LoRa preamble
+void channelChecked(bool busy);
+
+// Function to get the channel access counters
+const TransmitStats& transmitStats();
+
+// Function to print the channel access counters on the serial console
+void printTransmitStats();
+
+#endif
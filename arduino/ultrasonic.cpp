@@ -2,22 +2,72 @@
 #include <Arduino.h>
 #include "constants.h"
 #include "pins.h"
+#include "sensorSystem.h"
+
+// Echo edge timestamps, written by the echo interrupt
+// Multi-byte values are only read with interrupts disabled
+static volatile unsigned long echoRiseAt = 0;   // micros() of the rising edge
+static volatile unsigned long echoWidth = 0;    // Echo pulse width in microseconds
+static volatile bool echoRisen = false;         // Rising edge seen for the current ping
+static volatile bool echoEnded = false;         // Falling edge seen, echoWidth is valid
+
+// Burst state, only touched outside interrupt context
+static uint8_t burstPings = 0;                  // Pings requested, 0 = idle
+static uint8_t pingsFired = 0;                  // Pings triggered so far
+static uint8_t echoCount = 0;                   // Valid echoes collected so far
+static uint16_t echoTimes[ULTRASONIC_MAX_PINGS];  // Round-trip times in microseconds
+static bool pingActive = false;                 // Waiting for the current ping's echo
+static unsigned long pingAt = 0;                // millis() of the last trigger
+
+// Result of the last completed burst
+static float lastRange = NO_RANGE;
+static bool resultReady = false;
+static RangeCallback rangeCallback = NULL;
+
+// Echo pin interrupt, fires on both edges
+// Keeps only the timestamps; everything else happens in serviceUltrasonic()
+static void onEcho() {
+  unsigned long now = micros();
+
+  if (digitalRead(ECHO_PIN) == HIGH) {
+    echoRiseAt = now;
+    echoRisen = true;
+  } else if (echoRisen) {
+    echoWidth = now - echoRiseAt;
+    echoEnded = true;
+  }
+}
 
 // Initialize ultrasonic sensor pins for HC-SR04 or compatible sensor
 // Sets trigger pin as output for sending ultrasonic pulses
-// Sets echo pin as input for receiving reflected pulses
-// Must be called in setup() before using measureDistance()
+// Sets echo pin as input and times its edges with an external interrupt
+// Must be called in setup() before using the ranging functions
 void initUltrasonic() {
-    pinMode(TRIG_PIN, OUTPUT);  // Trigger pin sends 10μs pulse to start measurement
-    pinMode(ECHO_PIN, INPUT);   // Echo pin receives reflected pulse timing
+  pinMode(TRIG_PIN, OUTPUT);  // Trigger pin sends 10μs pulse to start measurement
+  pinMode(ECHO_PIN, INPUT);   // Echo pin receives reflected pulse timing
+  digitalWrite(TRIG_PIN, LOW);
+  attachInterrupt(digitalPinToInterrupt(ECHO_PIN), onEcho, CHANGE);
 }
 
-// Measure distance using ultrasonic time-of-flight principle
-// Sends 10μs trigger pulse, measures echo return time
-// Calculates distance using speed of sound and travel time
-// Includes timeout protection to prevent infinite blocking
-// Returns distance in centimeters, or 999 if no valid reading
-float measureDistance() {
+// Start a burst of pings, fired one by one from serviceUltrasonic()
+bool startRanging(uint8_t pings) {
+  if (burstPings != 0) {
+    return false;
+  }
+
+  burstPings = constrain(pings, 1, ULTRASONIC_MAX_PINGS);
+  pingsFired = 0;
+  echoCount = 0;
+  return true;
+}
+
+// Send the 10μs trigger pulse and arm the echo interrupt for a new ping
+static void firePing() {
+  noInterrupts();
+  echoRisen = false;
+  echoEnded = false;
+  interrupts();
+
   // Ensure trigger pin starts low
   digitalWrite(TRIG_PIN, LOW);
   delayMicroseconds(2);
@@ -26,24 +76,104 @@ float measureDistance() {
   digitalWrite(TRIG_PIN, HIGH);
   delayMicroseconds(10);
   digitalWrite(TRIG_PIN, LOW);
-  
-  long ping_travel_time;
 
-  // Measure time for echo pulse (HIGH duration on echo pin)
-  // PULSE_TIMEOUT prevents infinite blocking if no echo received
-  ping_travel_time = pulseIn(ECHO_PIN, HIGH, PULSE_TIMEOUT);
+  pingAt = millis();
+  pingActive = true;
+  pingsFired++;
+}
+
+// Reduce the burst to one distance and publish it
+// The median rejects single bad pings (multipath, missed edges); fewer
+// than half the pings echoing means there is nothing in range
+static void finishBurst() {
+  float distance = NO_RANGE;
+
+  if (echoCount * 2 >= burstPings) {
+    // Insertion sort, at most ULTRASONIC_MAX_PINGS entries
+    for (uint8_t i = 1; i < echoCount; i++) {
+      uint16_t value = echoTimes[i];
+      uint8_t j = i;
+      while (j > 0 && echoTimes[j - 1] > value) {
+        echoTimes[j] = echoTimes[j - 1];
+        j--;
+      }
+      echoTimes[j] = value;
+    }
 
-  // Return error code if no pulse received (timeout occurred)
-  if (ping_travel_time == 0) return 999;
+    // Speed of sound rises about 0.6 m/s per degree; the DS18B20 reading
+    // stands in for the air temperature above the water
+    float speed = SOUND_SPEED_0C + SOUND_SPEED_PER_C * readTemperature();
 
-  // Calculate one-way travel time (divide by 2 for round trip)
-  // Convert microseconds to seconds for calculation
-  float time = (ping_travel_time / 1E6) / 2;
+    // Half the round trip: cm = μs * (m/s) / 1e6 * 100 / 2
+    distance = echoTimes[echoCount / 2] * speed / 20000.0;
+  }
 
-  // Calculate distance using speed of sound
-  // Distance = speed × time
-  // Multiply by 100 to convert meters to centimeters
-  float distance = SOUND_SPEED * time * 100;
+  lastRange = distance;
+  resultReady = true;
+  burstPings = 0;
 
-  return distance;
-}
\ No newline at end of file
+  if (rangeCallback) {
+    rangeCallback(distance);
+  }
+}
+
+// Drive the ranging engine without blocking
+void serviceUltrasonic() {
+  if (burstPings == 0) {
+    return;
+  }
+
+  if (pingActive) {
+    noInterrupts();
+    bool ended = echoEnded;
+    unsigned long width = echoWidth;
+    interrupts();
+
+    if (ended) {
+      // Echoes longer than PULSE_TIMEOUT are out of range (the module
+      // holds the line high for ~38 ms when nothing reflects)
+      if (width <= PULSE_TIMEOUT) {
+        echoTimes[echoCount++] = width;
+      }
+      pingActive = false;
+    } else if (millis() - pingAt >= ECHO_LOST_TIMEOUT) {
+      // No complete echo at all, count the ping as lost
+      pingActive = false;
+    } else {
+      return;
+    }
+  }
+
+  if (pingsFired >= burstPings) {
+    finishBurst();
+    return;
+  }
+
+  // Let the previous echo die out; the module ignores triggers while
+  // its echo line is still high
+  unsigned long sincePing = millis() - pingAt;
+  if (sincePing < PING_INTERVAL ||
+      (digitalRead(ECHO_PIN) == HIGH && sincePing < ECHO_LOST_TIMEOUT)) {
+    return;
+  }
+
+  firePing();
+}
+
+// Register the burst completion callback
+void onRangeComplete(RangeCallback callback) {
+  rangeCallback = callback;
+}
+
+// Report a completed burst once
+bool rangeReady() {
+  bool ready = resultReady;
+  resultReady = false;
+  return ready;
+}
+
+// Distance of the last completed burst
+// Returns distance in centimeters, or NO_RANGE if no valid reading
+float measureDistance() {
+  return lastRange;
+}
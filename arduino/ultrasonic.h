@@ -1,23 +1,52 @@
 #ifndef ULTRASONIC_H
 #define ULTRASONIC_H
 
+#include <Arduino.h>
+#include "constants.h"
+
 // Header file for ultrasonic distance sensor interface (HC-SR04 compatible)
-// Provides functions for initializing and reading distance measurements
-// Uses time-of-flight principle with ultrasonic sound waves
-// Suitable for obstacle detection and distance ranging applications
+// Interrupt-driven ranging engine: the echo edges are timestamped by an
+// external interrupt, so a ping never blocks the CPU while the sound is
+// in flight and GPS parsing and radio I/O keep running
+// A range is the median of a burst of pings, converted with a speed of
+// sound compensated for the measured temperature
+
+// Distance returned when no valid range is available (centimeters)
+constexpr float NO_RANGE = 999.0;
+
+// Signature of the function called when a burst completes
+// Parameter: distanceCm - median distance of the burst, or NO_RANGE
+typedef void (*RangeCallback)(float distanceCm);
 
 // Function to initialize ultrasonic sensor pins
-// Configures trigger pin as output and echo pin as input
+// Configures trigger pin as output, echo pin as input and attaches the
+// echo interrupt; the echo pin must be an external interrupt pin
 // Must be called in setup() before measuring distances
 // Uses pin definitions from pins.h
 void initUltrasonic();
 
-// Function to measure distance using ultrasonic sensor
-// Sends ultrasonic pulse and measures echo return time
-// Calculates distance based on speed of sound in air
-// Includes timeout protection to prevent blocking
+// Function to start a burst of 'pings' pings (1..ULTRASONIC_MAX_PINGS)
+// Returns immediately; pings are fired by serviceUltrasonic()
+// Returns false if a burst is already running
+bool startRanging(uint8_t pings = ULTRASONIC_BURST_PINGS);
+
+// Scheduler task driving the ranging engine, run with period 0
+// Fires the next ping once the previous echo has ended, collects echo
+// times from the interrupt and completes the burst
+void serviceUltrasonic();
+
+// Function to register a callback for completed bursts (NULL for none)
+// The callback runs from serviceUltrasonic(), not from interrupt context
+void onRangeComplete(RangeCallback callback);
+
+// Function to poll for a completed burst
+// Returns true once per completed burst, then false until the next one
+bool rangeReady();
+
+// Function to get the distance of the last completed burst
 // Returns distance in centimeters (floating point for precision)
-// Returns 999.0 if measurement fails or times out
+// Returns NO_RANGE if fewer than half of the pings returned an echo
+// Never blocks
 float measureDistance();
 
-#endif
\ No newline at end of file
+#endif
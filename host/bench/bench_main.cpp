@@ -0,0 +1,478 @@
+// Payload path benchmark
+// Measures each stage a reading passes through between the sensor node
+// and the gateway host, in host nanoseconds and heap allocations per
+// reading, for every payload format:
+//   format   node: reading into message text or a telemetry frame
+//   seal     node: AES-CCM into a packet, as sendFrame() does
+//   receive  gateway: replay check, decrypt, MIC check, decode and output,
+//            for the JSON and the BINARY_OUTPUT receiver builds
+//   parse    host: what host/ingest does with one line or frame of it
+// then the time on air per reading of each format at every spreading
+// factor and bandwidth
+// The removed text path (String concatenation, PKCS#7 padding and one
+// AES block at a time, no nonce or MIC) runs alongside as the baseline
+// Readings come from a fixed synthetic trace, so runs are comparable
+// between commits; host timings only compare formats with each other,
+// the AVR is two to three orders of magnitude slower
+//
+// Usage: mizuguna_bench [--iterations N] [--cr N]
+//
+// --iterations sets the messages run through each stage (default 50000)
+// --cr sets the coding rate denominator of the airtime table (default 8)
+
+#include <Arduino.h>
+#include <AES.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include "sim.h"
+#include "receivers.h"
+#include "json_scan.h"
+#include "serial_frames.h"
+#include "../../arduino/bufferwriter.h"
+#include "../../arduino/ccm.h"
+#include "../../arduino/constants.h"
+#include "../../arduino/lora_comm.h"
+#include "../../arduino/sensorSystem.h"
+#include "../../arduino/telemetry.h"
+
+// === Heap accounting ===
+// String allocations are counted by the simulated core; everything else
+// on the host heap is counted here
+static unsigned long hostAllocations = 0;
+
+void* operator new(size_t size) {
+  hostAllocations++;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+static unsigned long allocationsSoFar() {
+  return hostAllocations + simHeapStats().allocations;
+}
+
+// === Synthetic trace ===
+// Slow diurnal-like swings plus a little deterministic noise: enough
+// movement for delta frames to carry real differences
+static const int TRACE_LENGTH = 256;
+static SensorReadings trace[TRACE_LENGTH];
+static TelemetryRecord records[TRACE_LENGTH];
+
+// The keyframe delta frames refer to: record 0, sent in packet 1
+static const uint32_t KEYFRAME_COUNTER = 1;
+static const uint32_t FIRST_COUNTER = KEYFRAME_COUNTER + 1;
+
+static void makeTrace() {
+  uint32_t state = 12345;
+  for (int i = 0; i < TRACE_LENGTH; i++) {
+    state = state * 1103515245 + 12345;
+    float noise = ((state >> 16) & 0x7FFF) / 32767.0 - 0.5;
+    trace[i].temperature = 24.5 + 0.3 * sin(i / 40.0) + 0.02 * noise;
+    trace[i].temperatureDefaulted = false;
+    trace[i].pH = 7.20 + 0.05 * sin(i / 25.0) + 0.01 * noise;
+    trace[i].tds = 420.0 + 5.0 * sin(i / 60.0) + 0.4 * noise;
+    trace[i].orp = 210 + (int)lround(3.0 * sin(i / 30.0) + noise);
+    records[i] = makeTelemetryRecord(trace[i]);
+  }
+}
+
+// Batch and delta frames read their records from here
+static int traceBase = 0;
+
+static TelemetryRecord traceRecord(uint16_t index) {
+  return records[(traceBase + index) % TRACE_LENGTH];
+}
+
+// === Payload formats ===
+enum Format {
+  FORMAT_STRING,  // Removed String concatenation, sent with ECB + PKCS#7
+  FORMAT_TEXT,    // Message text from printSensorData(), sealed with CCM
+  FORMAT_SINGLE,  // Single telemetry frame
+  FORMAT_BATCH,   // Batch frame of BATCH_SIZE readings
+  FORMAT_DELTA,   // Delta frame of BATCH_SIZE readings
+  FORMATS
+};
+
+static const char* const FORMAT_NAMES[FORMATS] = { "string+ecb", "text", "single", "batch",
+                                                   "delta" };
+
+static int readingsPer(Format format) {
+  return format == FORMAT_BATCH || format == FORMAT_DELTA ? BATCH_SIZE : 1;
+}
+
+// The message text as the removed getSensorDataString() built it
+static String legacyString(const SensorReadings& r) {
+  String data = "Temp:" + String(r.temperature, 2);
+  data += " | pH:" + String(r.pH, 2);
+  data += " | TDS:" + String(r.tds, 1);
+  data += " | ORP:" + String(r.orp);
+  return data;
+}
+
+// Encode the payload starting at trace position 'position'
+// 'out' must hold MAX_PAYLOAD_SIZE bytes; returns the payload length
+static size_t encodePayload(Format format, int position, uint8_t* out) {
+  const SensorReadings& reading = trace[position % TRACE_LENGTH];
+  switch (format) {
+    case FORMAT_STRING: {
+      String text = legacyString(reading);
+      memcpy(out, text.c_str(), text.length());
+      return text.length();
+    }
+    case FORMAT_TEXT: {
+      BufferWriter writer((char*)out, MAX_PAYLOAD_SIZE);
+      printSensorData(writer, reading);
+      return writer.length();
+    }
+    case FORMAT_SINGLE:
+      encodeTelemetryFrame(out, makeTelemetryRecord(reading));
+      return TELEMETRY_FRAME_SIZE;
+    case FORMAT_BATCH:
+      traceBase = position;
+      return encodeBatchFrame(out, traceRecord, BATCH_SIZE);
+    case FORMAT_DELTA: {
+      traceBase = position;
+      uint8_t count = BATCH_SIZE;
+      return encodeDeltaFrame(out, traceRecord, count, records[0], KEYFRAME_COUNTER & 0xFFFF);
+    }
+    default:
+      return 0;
+  }
+}
+
+// === Node crypto ===
+static AES128 nodeCipher;
+static const uint8_t KEY[16] = { 's','e','c','r','e','t','k','e','y','1','2','3','4','5','6','7' };
+
+// Seal a payload into a packet the way sendFrame() streams it into the
+// radio FIFO: header, 16-byte CCM chunks, MIC
+static size_t sealPacket(uint8_t* packet, const uint8_t* payload, size_t len, uint32_t counter) {
+  packet[0] = NODE_ID;
+  for (int i = 0; i < 4; i++) {
+    packet[1 + i] = counter >> (8 * i);
+  }
+
+  CcmContext ccm;
+  ccmBegin(ccm, nodeCipher, CCM_UPLINK, NODE_ID, counter, len);
+  uint8_t* dst = packet + PACKET_HEADER_SIZE;
+  for (size_t offset = 0; offset < len; offset += 16) {
+    uint8_t n = len - offset < 16 ? len - offset : 16;
+    memcpy(dst + offset, payload + offset, n);
+    ccmEncrypt(ccm, dst + offset, n);
+  }
+  ccmFinish(ccm, dst + len);
+  return len + PACKET_OVERHEAD;
+}
+
+// The removed sendMessage() scheme: PKCS#7 padding, then each 16-byte
+// block encrypted on its own; the packet is the bare ciphertext
+static size_t sealLegacy(uint8_t* packet, const uint8_t* payload, size_t len) {
+  size_t padded = (len / 16 + 1) * 16;
+  uint8_t pad = padded - len;
+  uint8_t block[16];
+  for (size_t offset = 0; offset < padded; offset += 16) {
+    for (int i = 0; i < 16; i++) {
+      block[i] = offset + i < len ? payload[offset + i] : pad;
+    }
+    nodeCipher.encryptBlock(packet + offset, block);
+  }
+  return padded;
+}
+
+// Decrypt and unpad a legacy packet in place, as the old receiver did
+// Returns the message length, or -1 for bad padding
+static int openLegacy(uint8_t* packet, size_t len) {
+  for (size_t offset = 0; offset < len; offset += 16) {
+    nodeCipher.decryptBlock(packet + offset, packet + offset);
+  }
+  uint8_t pad = packet[len - 1];
+  if (pad == 0 || pad > 16) return -1;
+  return len - pad;
+}
+
+// === Measurement ===
+struct Measurement {
+  double nanos;         // Per reading
+  double allocations;   // Per reading
+};
+
+template <typename Fn>
+static Measurement measure(long iterations, int readings, Fn fn) {
+  unsigned long allocationsBefore = allocationsSoFar();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++) {
+    fn(i);
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  double total = (double)iterations * readings;
+  Measurement m;
+  m.nanos = std::chrono::duration<double, std::nano>(end - start).count() / total;
+  m.allocations = (allocationsSoFar() - allocationsBefore) / total;
+  return m;
+}
+
+static void printHeader(const char* title, const char* bytesLabel) {
+  printf("\n=== %s ===\n", title);
+  printf("%-8s %-11s %-7s %6s %10s %10s\n", "stage", "format", "build", bytesLabel, "ns/rd",
+         "allocs/rd");
+}
+
+static void printRow(const char* stage, Format format, const char* build, double bytes,
+                     const Measurement& m) {
+  printf("%-8s %-11s %-7s %6.1f %10.1f %10.2f\n", stage, FORMAT_NAMES[format], build, bytes,
+         m.nanos, m.allocations);
+}
+
+// A recorded run of sealed packets with consecutive counters
+struct SealedPacket {
+  uint8_t data[MAX_PAYLOAD_SIZE + PACKET_OVERHEAD];
+  size_t length;
+};
+
+static const int RECORDED_PACKETS = TRACE_LENGTH;
+
+static std::vector<SealedPacket> recordPackets(Format format) {
+  std::vector<SealedPacket> packets(RECORDED_PACKETS);
+  uint8_t payload[MAX_PAYLOAD_SIZE];
+  for (int i = 0; i < RECORDED_PACKETS; i++) {
+    size_t len = encodePayload(format, i * readingsPer(format), payload);
+    if (format == FORMAT_STRING) {
+      packets[i].length = sealLegacy(packets[i].data, payload, len);
+    } else {
+      packets[i].length = sealPacket(packets[i].data, payload, len, FIRST_COUNTER + i);
+    }
+  }
+  return packets;
+}
+
+// Receiver output for a recorded run, split into lines or SLIP frames
+static std::vector<std::string> captureOutput(ReceiverBuild build,
+                                              const std::vector<SealedPacket>& packets) {
+  char* buffer = nullptr;
+  size_t size = 0;
+  FILE* capture = open_memstream(&buffer, &size);
+  receiverSerial(build).capture(capture);
+  receiverRewind(build, NODE_ID, FIRST_COUNTER - 1);
+  for (size_t i = 0; i < packets.size(); i++) {
+    receiverProcess(build, packets[i].data, packets[i].length);
+  }
+  receiverSerial(build).capture(nullptr);
+  fclose(capture);
+
+  std::vector<std::string> pieces;
+  char separator = build == RECEIVER_JSON ? '\n' : (char)SLIP_END;
+  size_t begin = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (buffer[i] != separator) continue;
+    if (i > begin) pieces.push_back(std::string(buffer + begin, i - begin));
+    begin = i + 1;
+  }
+  free(buffer);
+  return pieces;
+}
+
+// Results of the parse stage land here so they are not optimized away
+static volatile int64_t sink = 0;
+
+static int64_t intField(const JsonLine& json, const char* key) {
+  const JsonField* field = json.find(key);
+  int64_t value = 0;
+  if (field) parseInt(field->value, value);
+  return value;
+}
+
+static void usage(const char* argv0) {
+  fprintf(stderr, "usage: %s [--iterations N] [--cr N]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+  long iterations = 50000;
+  int codingRate = LORA_DEFAULT_CR;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--iterations" && hasValue) {
+      iterations = atol(argv[++i]);
+    } else if (arg == "--cr" && hasValue) {
+      codingRate = atoi(argv[++i]);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (iterations < 1 || codingRate < 5 || codingRate > 8) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  simSetSerialEcho(false);
+  makeTrace();
+  nodeCipher.setKey(KEY, sizeof(KEY));
+  receiverBegin();
+
+  // Both receivers learn the keyframe delta frames are encoded against
+  // (a node's first packet, so no rewind is needed yet)
+  uint8_t payload[MAX_PAYLOAD_SIZE];
+  SealedPacket keyframe;
+  encodeTelemetryFrame(payload, records[0]);
+  keyframe.length = sealPacket(keyframe.data, payload, TELEMETRY_FRAME_SIZE, KEYFRAME_COUNTER);
+  for (int b = 0; b < RECEIVER_BUILDS; b++) {
+    receiverProcess((ReceiverBuild)b, keyframe.data, keyframe.length);
+  }
+
+  printf("payload path benchmark: %ld messages per stage, %d readings per batch\n", iterations,
+         BATCH_SIZE);
+
+  // --- Node side ---
+  printHeader("node", "air/rd");
+  double airBytes[FORMATS];
+  for (int f = 0; f < FORMATS; f++) {
+    Format format = (Format)f;
+    size_t len = encodePayload(format, 0, payload);
+    airBytes[f] = (double)(format == FORMAT_STRING ? (len / 16 + 1) * 16 : len + PACKET_OVERHEAD) /
+                  readingsPer(format);
+    Measurement m = measure(iterations, readingsPer(format), [&](long i) {
+      encodePayload(format, (int)i * readingsPer(format), payload);
+    });
+    printRow("format", format, "node", airBytes[f], m);
+  }
+
+  for (int f = 0; f < FORMATS; f++) {
+    Format format = (Format)f;
+    size_t len = encodePayload(format, 0, payload);
+    uint8_t packet[MAX_PAYLOAD_SIZE + PACKET_OVERHEAD];
+    Measurement m = measure(iterations, readingsPer(format), [&](long i) {
+      if (format == FORMAT_STRING) {
+        sealLegacy(packet, payload, len);
+      } else {
+        sealPacket(packet, payload, len, FIRST_COUNTER + (uint32_t)i);
+      }
+    });
+    printRow("seal", format, "node", airBytes[f], m);
+  }
+
+  // --- Gateway side ---
+  printHeader("gateway", "uart/rd");
+  std::vector<SealedPacket> recorded[FORMATS];
+  for (int f = 0; f < FORMATS; f++) {
+    recorded[f] = recordPackets((Format)f);
+  }
+
+  for (int f = 0; f < FORMATS; f++) {
+    Format format = (Format)f;
+    const std::vector<SealedPacket>& packets = recorded[f];
+
+    for (int b = 0; b < RECEIVER_BUILDS; b++) {
+      ReceiverBuild build = (ReceiverBuild)b;
+      // The removed scheme only ever fed the JSON receiver
+      if (format == FORMAT_STRING && build != RECEIVER_JSON) continue;
+
+      // Single and batch frames move the keyframe along; put it back
+      if (format == FORMAT_DELTA) {
+        receiverRewind(build, NODE_ID, KEYFRAME_COUNTER - 1);
+        receiverProcess(build, keyframe.data, keyframe.length);
+      }
+
+      HardwareSerial& serial = receiverSerial(build);
+      unsigned long written = serial.bytesWritten();
+      Measurement m = measure(iterations, readingsPer(format), [&](long i) {
+        const SealedPacket& p = packets[i % RECORDED_PACKETS];
+        if (format == FORMAT_STRING) {
+          uint8_t text[MAX_PAYLOAD_SIZE + PACKET_OVERHEAD + 1];
+          memcpy(text, p.data, p.length);
+          int len = openLegacy(text, p.length);
+          if (len < 0) return;
+          text[len] = '\0';
+          receiverPrintMessage(p.length, (const char*)text, NODE_ID, FIRST_COUNTER + (uint32_t)i);
+          return;
+        }
+        if (i % RECORDED_PACKETS == 0) {
+          receiverRewind(build, NODE_ID, FIRST_COUNTER - 1);
+        }
+        receiverProcess(build, p.data, p.length);
+      });
+      double uart = (double)(serial.bytesWritten() - written) / iterations / readingsPer(format);
+      printRow("receive", format, build == RECEIVER_JSON ? "json" : "binary", uart, m);
+    }
+  }
+
+  // --- Host side ---
+  // Readings decoded from single frames; every format prints the same
+  // lines and events, only their number per packet differs
+  std::vector<std::string> lines = captureOutput(RECEIVER_JSON, recorded[FORMAT_SINGLE]);
+  std::vector<std::string> frames = captureOutput(RECEIVER_BINARY, recorded[FORMAT_SINGLE]);
+  double lineBytes = 0;
+  for (size_t i = 0; i < lines.size(); i++) lineBytes += lines[i].size() + 1;
+  double frameBytes = 0;
+  for (size_t i = 0; i < frames.size(); i++) frameBytes += frames[i].size() + 2;
+
+  printHeader("host", "uart/rd");
+  long parsed = 0;
+  Measurement jsonParse = measure(iterations, 1, [&](long i) {
+    const std::string& line = lines[i % lines.size()];
+    JsonLine json;
+    MessageValues values;
+    const JsonField* message;
+    if (!scanJsonLine(line.data(), line.size(), json)) return;
+    if (!(message = json.find("message")) || !parseReadingMessage(message->value, values)) return;
+    double snr = 0;
+    const JsonField* snrField = json.find("snr");
+    if (snrField) parseDecimal(snrField->value, snr);
+    sink = intField(json, "node") + intField(json, "seq") + intField(json, "rssi") +
+           intField(json, "age") + (int64_t)(snr + values.temperature);
+    parsed++;
+  });
+  printRow("parse", FORMAT_SINGLE, "json", lineBytes / lines.size(), jsonParse);
+
+  Measurement frameParse = measure(iterations, 1, [&](long i) {
+    const std::string& frame = frames[i % frames.size()];
+    uint8_t work[MAX_PAYLOAD_SIZE];
+    size_t len = frame.size() < sizeof(work) ? frame.size() : sizeof(work);
+    memcpy(work, frame.data(), len);
+    len = slipDecodeInPlace(work, len);
+    SerialEvent event;
+    ReadingEvent values;
+    if (parseSerialEvent(work, len, event) && decodeReadingEvent(event, values)) {
+      sink = event.seq + (int64_t)values.temperature;
+      parsed++;
+    }
+  });
+  printRow("parse", FORMAT_SINGLE, "binary", frameBytes / frames.size(), frameParse);
+
+  if (parsed < 2 * iterations) {
+    printf("FAIL: only %ld of %ld lines and frames decoded\n", parsed, 2 * iterations);
+    return 1;
+  }
+
+  // --- Air ---
+  static const int SPREADING_FACTORS[] = { 7, 8, 9, 10, 11, 12 };
+  static const long BANDWIDTHS[] = { 125000, 250000, 500000 };
+  printf("\n=== time on air per reading, ms (CR 4/%d, 8 symbol preamble, CRC) ===\n", codingRate);
+  printf("%-4s %-7s", "sf", "bw kHz");
+  for (int f = 0; f < FORMATS; f++) printf(" %11s", FORMAT_NAMES[f]);
+  printf("\n");
+  for (size_t s = 0; s < sizeof(SPREADING_FACTORS) / sizeof(SPREADING_FACTORS[0]); s++) {
+    for (size_t w = 0; w < sizeof(BANDWIDTHS) / sizeof(BANDWIDTHS[0]); w++) {
+      printf("SF%-2d %-7ld", SPREADING_FACTORS[s], BANDWIDTHS[w] / 1000);
+      for (int f = 0; f < FORMATS; f++) {
+        size_t packetBytes = (size_t)lround(airBytes[f] * readingsPer((Format)f));
+        uint64_t micros = simTimeOnAirMicros(packetBytes, SPREADING_FACTORS[s], BANDWIDTHS[w],
+                                             codingRate, 8, true);
+        printf(" %11.1f", micros / 1e3 / readingsPer((Format)f));
+      }
+      printf("\n");
+    }
+  }
+  return 0;
+}
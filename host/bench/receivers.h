@@ -0,0 +1,36 @@
+#ifndef BENCH_RECEIVERS_H
+#define BENCH_RECEIVERS_H
+
+// Gateway side of the payload benchmark
+// The receiver sketch is compiled twice, printing JSON lines and with
+// BINARY_OUTPUT, each in its own namespace; these functions feed both
+// builds packets straight into processPacket(), without the simulated
+// radio, interrupt queue or link hint timing around it
+
+#include <Arduino.h>
+
+enum ReceiverBuild {
+  RECEIVER_JSON,
+  RECEIVER_BINARY,
+  RECEIVER_BUILDS
+};
+
+// Function to key both receivers
+void receiverBegin();
+
+// Function to process one sealed packet as if it had just been received
+// Link hints are sealed as usual but never sent, and the hint queue is
+// emptied afterwards so every packet pays for its own hint
+void receiverProcess(ReceiverBuild build, const uint8_t* packet, size_t len);
+
+// Function to rewind a node's replay protection, so a recorded run of
+// packets can be processed again
+void receiverRewind(ReceiverBuild build, uint8_t node, uint32_t lastCounter);
+
+// Serial console of a receiver build
+HardwareSerial& receiverSerial(ReceiverBuild build);
+
+// Function to print a decrypted text message as the JSON receiver does
+void receiverPrintMessage(int packetSize, const char* msg, uint8_t node, uint32_t seq);
+
+#endif
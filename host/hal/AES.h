@@ -0,0 +1,27 @@
+#ifndef HOST_AES_H
+#define HOST_AES_H
+
+// Host-side AES-128 block cipher with the same interface as the Crypto
+// library's AES128 class. A real implementation, so ciphertext produced
+// in the simulator matches the one produced on the board
+
+#include <Crypto.h>
+
+class AES128 {
+public:
+  AES128();
+  ~AES128();
+
+  size_t blockSize() const { return 16; }
+  size_t keySize() const { return 16; }
+
+  bool setKey(const uint8_t* key, size_t len);
+  void encryptBlock(uint8_t* output, const uint8_t* input);
+  void decryptBlock(uint8_t* output, const uint8_t* input);
+  void clear();
+
+private:
+  uint8_t schedule[176];
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HOST_ADAFRUIT_HMC5883_U_H
+#define HOST_ADAFRUIT_HMC5883_U_H
+
+// Host-side replacement for the Adafruit HMC5883 magnetometer driver
+// Readings come from the simulated compass model (see sim.h)
+
+#include <Adafruit_Sensor.h>
+
+class Adafruit_HMC5883_Unified {
+public:
+  explicit Adafruit_HMC5883_Unified(int32_t sensorID = -1) : sensorID(sensorID) {}
+
+  bool begin();
+  bool getEvent(sensors_event_t* event);
+
+private:
+  int32_t sensorID;
+};
+
+#endif
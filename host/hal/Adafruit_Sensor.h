@@ -0,0 +1,31 @@
+#ifndef HOST_ADAFRUIT_SENSOR_H
+#define HOST_ADAFRUIT_SENSOR_H
+
+// Host-side replacement for the Adafruit unified sensor types
+
+#include <stdint.h>
+
+typedef struct {
+  union {
+    float v[3];
+    struct {
+      float x;
+      float y;
+      float z;
+    };
+  };
+} sensors_vec_t;
+
+typedef struct {
+  int32_t version;
+  int32_t sensor_id;
+  int32_t type;
+  int32_t reserved0;
+  int32_t timestamp;
+  union {
+    sensors_vec_t magnetic;
+    float data[4];
+  };
+} sensors_event_t;
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host-side replacement for the Arduino core header
+// Provides the subset of the Arduino API used by the firmware so that
+// arduino/*.cpp compile unchanged on Linux against the simulator
+// Timing functions run on the simulator's virtual clock (see sim.h)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+
+#include "WString.h"
+#include "Stream.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// Digital pin levels and modes
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+// Interrupt trigger modes
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+// Analog pin numbers, matching the ATmega328P layout
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+#define PI 3.1415926535897932384626433832795
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+// Flash storage macros collapse to plain memory on the host
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+
+// Virtual clock
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Digital and analog I/O backed by the simulated sensors
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000UL);
+
+// External interrupts
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+void attachInterrupt(uint8_t interruptNum, void (*isr)(), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void noInterrupts();
+void interrupts();
+
+// Pseudo random numbers, seeded deterministically by the simulator
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+// AVR libc extension used by the command parser
+char* strupr(char* s);
+
+// Serial console of the sketch currently being simulated
+class HardwareSerial : public Stream {
+public:
+  explicit HardwareSerial(const char* tag) : tag(tag) {}
+
+  void begin(unsigned long baud);
+  void end() {}
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  using Print::write;
+  void flush() {}
+  operator bool() const { return true; }
+
+  // Simulator hook: queue text as if typed into the serial monitor
+  void inject(const char* text);
+
+  // Simulator hook: copy every byte written to 'out' as sent on the wire
+  void capture(FILE* out) { captureFile = out; }
+
+  // Bytes written since begin(), used to estimate UART wire time
+  unsigned long bytesWritten() const { return written; }
+
+private:
+  const char* tag;
+  std::string line;
+  std::string input;
+  size_t inputPos = 0;
+  unsigned long baud = 0;
+  unsigned long written = 0;
+  uint64_t txBusyUntil = 0;
+  FILE* captureFile = nullptr;
+};
+
+extern HardwareSerial Serial;
+
+#endif
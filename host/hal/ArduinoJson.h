@@ -0,0 +1,55 @@
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+// Host-side replacement for the subset of ArduinoJson used by the receiver
+// Flat objects only: doc["key"] = value, then serializeJson(doc, Serial)
+// Members keep insertion order and are serialized compactly, like ArduinoJson
+
+#include <Arduino.h>
+
+class JsonDocument;
+
+class JsonMemberProxy {
+public:
+  JsonMemberProxy(JsonDocument& doc, const char* key) : doc(doc), key(key) {}
+
+  JsonMemberProxy& operator=(const char* value);
+  JsonMemberProxy& operator=(const String& value);
+  JsonMemberProxy& operator=(bool value);
+  JsonMemberProxy& operator=(int value) { return operator=((long)value); }
+  JsonMemberProxy& operator=(unsigned int value) { return operator=((unsigned long)value); }
+  JsonMemberProxy& operator=(long value);
+  JsonMemberProxy& operator=(unsigned long value);
+  JsonMemberProxy& operator=(float value) { return operator=((double)value); }
+  JsonMemberProxy& operator=(double value);
+
+private:
+  JsonDocument& doc;
+  const char* key;
+};
+
+class JsonDocument {
+public:
+  static const int MAX_MEMBERS = 16;
+
+  JsonMemberProxy operator[](const char* key) { return JsonMemberProxy(*this, key); }
+  void clear() { count = 0; }
+  size_t size() const { return count; }
+
+  // Sets a member to an already serialized JSON value
+  // Fixed storage like a StaticJsonDocument, so no heap is used
+  void set(const char* key, const char* json);
+  size_t serialize(Print& out) const;
+
+private:
+  char keys[MAX_MEMBERS][24];
+  char values[MAX_MEMBERS][96];
+  size_t count = 0;
+};
+
+template <size_t CAPACITY>
+class StaticJsonDocument : public JsonDocument {};
+
+size_t serializeJson(const JsonDocument& doc, Print& out);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef HOST_CRYPTO_H
+#define HOST_CRYPTO_H
+
+// Host-side replacement for the Crypto library base header
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Overwrite sensitive data so it does not linger in memory
+void clean(void* dest, size_t size);
+
+#endif
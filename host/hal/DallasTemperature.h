@@ -0,0 +1,39 @@
+#ifndef HOST_DALLAS_TEMPERATURE_H
+#define HOST_DALLAS_TEMPERATURE_H
+
+// Host-side replacement for the DallasTemperature (DS18B20) library
+// Conversions take the datasheet time on the virtual clock: blocking
+// requests advance the clock, non-blocking requests complete once the
+// clock has moved past the conversion time
+
+#include <OneWire.h>
+
+#define DEVICE_DISCONNECTED_C -127
+
+class DallasTemperature {
+public:
+  explicit DallasTemperature(OneWire* bus) : bus(bus) {}
+
+  void begin() {}
+  uint8_t getDeviceCount();
+  void setResolution(uint8_t newResolution) { resolution = newResolution; }
+  uint8_t getResolution() { return resolution; }
+  void setWaitForConversion(bool flag) { waitForConversion = flag; }
+  bool getWaitForConversion() { return waitForConversion; }
+
+  void requestTemperatures();
+  bool requestTemperaturesByIndex(uint8_t index);
+  bool isConversionComplete();
+  int16_t millisToWaitForConversion(uint8_t bitResolution);
+
+  float getTempCByIndex(uint8_t index);
+
+private:
+  OneWire* bus;
+  uint8_t resolution = 12;
+  bool waitForConversion = true;
+  unsigned long conversionStart = 0;
+  bool converting = false;
+};
+
+#endif
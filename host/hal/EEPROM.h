@@ -0,0 +1,35 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+// Host-side replacement for the AVR EEPROM library
+// 1 KB of simulated EEPROM (ATmega328P size), erased to 0xFF at start
+// Write counts are tracked so wear from persistence code can be measured
+
+#include <stdint.h>
+#include <string.h>
+
+class EEPROMClass {
+public:
+  uint8_t read(int idx);
+  void write(int idx, uint8_t val);
+  void update(int idx, uint8_t val);
+  uint16_t length() { return 1024; }
+
+  template <typename T> T& get(int idx, T& t) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+      ((uint8_t*)&t)[i] = read(idx + i);
+    }
+    return t;
+  }
+
+  template <typename T> const T& put(int idx, const T& t) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+      update(idx + i, ((const uint8_t*)&t)[i]);
+    }
+    return t;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef HOST_LORA_H
+#define HOST_LORA_H
+
+// Host-side replacement for the arduino-LoRa (SX127x) library
+// Every LoRaClass instance is one radio attached to the simulated air
+// (see sim.h). endPacket() advances the virtual clock by the packet's
+// time-on-air, and packets are delivered to every other radio listening
+// on the same frequency, spreading factor, bandwidth and sync word
+// channelActivityDetection() reports, two symbols later, whether any
+// packet was on the radio's channel meanwhile
+
+#include <Arduino.h>
+
+class LoRaClass : public Stream {
+public:
+  LoRaClass();
+  ~LoRaClass();
+
+  int begin(long frequency);
+  void end();
+
+  int beginPacket(int implicitHeader = false);
+  int endPacket(bool async = false);
+
+  int parsePacket(int size = 0);
+  int packetRssi();
+  float packetSnr();
+  long packetFrequencyError() { return 0; }
+  int rssi();
+
+  size_t write(uint8_t byte) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() {}
+
+  void onReceive(void (*callback)(int));
+  void onTxDone(void (*callback)());
+  void onCadDone(void (*callback)(boolean));
+  void receive(int size = 0);
+  void channelActivityDetection();
+
+  void idle();
+  void sleep();
+
+  void setTxPower(int level, int outputPin = 1) { txPower = level; (void)outputPin; }
+  void setFrequency(long frequency) { this->frequency = frequency; }
+  void setSpreadingFactor(int sf) { spreadingFactor = sf; }
+  void setSignalBandwidth(long sbw) { bandwidth = sbw; }
+  void setCodingRate4(int denominator) { codingRate = denominator; }
+  void setPreambleLength(long length) { preambleLength = length; }
+  void setSyncWord(int sw) { syncWord = sw; }
+  void enableCrc() { crc = true; }
+  void disableCrc() { crc = false; }
+  void enableInvertIQ() { invertIQ = true; }
+  void disableInvertIQ() { invertIQ = false; }
+
+  void setPins(int ss, int reset, int dio0) { (void)ss; (void)reset; (void)dio0; }
+  void setSPIFrequency(uint32_t frequency) { (void)frequency; }
+
+  byte random();
+
+  // Simulator accessors
+  int getSpreadingFactor() const { return spreadingFactor; }
+  long getSignalBandwidth() const { return bandwidth; }
+  int getCodingRate4() const { return codingRate; }
+  long getPreambleLength() const { return preambleLength; }
+  bool isCrcEnabled() const { return crc; }
+  bool isListening() const;
+
+  // Called by the simulated air when a packet reaches this radio
+  void deliver(const uint8_t* data, size_t len, int rssi, float snr);
+
+private:
+  friend class SimAir;
+
+  enum Mode { MODE_SLEEP, MODE_STANDBY, MODE_RX_SINGLE, MODE_RX_CONTINUOUS, MODE_TX, MODE_CAD };
+
+  long frequency = 0;
+  int spreadingFactor = 7;
+  long bandwidth = 125E3;
+  int codingRate = 5;
+  long preambleLength = 8;
+  int syncWord = 0x12;
+  int txPower = 17;
+  bool crc = false;
+  bool invertIQ = false;
+  bool begun = false;
+  Mode mode = MODE_SLEEP;
+
+  uint8_t txBuffer[255];
+  size_t txLength = 0;
+
+  // Receive FIFO: the packet currently being read plus one pending packet
+  uint8_t rxBuffer[255];
+  size_t rxLength = 0;
+  size_t rxIndex = 0;
+  bool rxPending = false;
+  uint8_t pendingBuffer[255];
+  size_t pendingLength = 0;
+  int lastRssi = -157;
+  float lastSnr = 0;
+  int pendingRssi = -157;
+  float pendingSnr = 0;
+
+  void (*onReceiveCallback)(int) = nullptr;
+  void (*onTxDoneCallback)() = nullptr;
+  void (*onCadDoneCallback)(boolean) = nullptr;
+};
+
+extern LoRaClass LoRa;
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_ONEWIRE_H
+#define HOST_ONEWIRE_H
+
+// Host-side placeholder for the OneWire bus
+// DallasTemperature talks to the simulated probe directly
+
+#include <stdint.h>
+
+class OneWire {
+public:
+  explicit OneWire(uint8_t pin) : pin(pin) {}
+
+private:
+  uint8_t pin;
+};
+
+#endif
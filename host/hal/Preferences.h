@@ -0,0 +1,42 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+// Host-side replacement for the ESP32 Preferences library (NVS)
+// Each object holds its own simulated store of byte values, so receiver
+// builds sharing the process keep separate NVS. As on the ESP32, nothing
+// is read or written before begin(), and keys are at most 15 characters
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false, const char* partitionLabel = NULL);
+  void end();
+
+  size_t putBytes(const char* key, const void* value, size_t len);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t getBytesLength(const char* key);
+  bool isKey(const char* key);
+  bool remove(const char* key);
+
+private:
+  static const int MAX_ENTRIES = 128;
+  static const int MAX_KEY = 15;
+  static const int MAX_VALUE = 64;
+
+  struct Entry {
+    bool used;
+    char key[MAX_KEY + 1];
+    uint8_t length;
+    uint8_t value[MAX_VALUE];
+  };
+
+  Entry* find(const char* key);
+
+  bool started = false;
+  bool readOnly = false;
+  Entry entries[MAX_ENTRIES] = {};
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+// Host-side placeholder for the SPI library
+// The simulated LoRa radio does not go through a bus, so nothing is needed
+
+#endif
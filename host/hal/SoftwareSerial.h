@@ -0,0 +1,45 @@
+#ifndef HOST_SOFTWARE_SERIAL_H
+#define HOST_SOFTWARE_SERIAL_H
+
+// Host-side replacement for SoftwareSerial
+// Models the GPS UART: bytes arrive on the virtual clock at the configured
+// baud rate into a 64-byte receive buffer, and bytes that arrive while the
+// buffer is full are dropped and counted, exactly like the AVR library
+
+#include <Arduino.h>
+
+class SoftwareSerial : public Stream {
+public:
+  SoftwareSerial(uint8_t rxPin, uint8_t txPin, bool inverseLogic = false);
+
+  void begin(long speed);
+  bool listen() { return true; }
+  bool isListening() { return true; }
+  bool overflow();
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t byte) override;
+  using Print::write;
+
+  // Simulator statistics
+  unsigned long droppedBytes() const { return dropped; }
+  unsigned long deliveredBytes() const { return delivered; }
+
+private:
+  static const int RX_BUFFER_SIZE = 64;
+
+  long baud = 0;
+  unsigned long lastFill = 0;
+  uint8_t buffer[RX_BUFFER_SIZE];
+  int head = 0;
+  int tail = 0;
+  bool overflowFlag = false;
+  unsigned long dropped = 0;
+  unsigned long delivered = 0;
+
+  void fill();
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef HOST_STREAM_H
+#define HOST_STREAM_H
+
+// Host-side replacement for the Arduino Stream base class
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { timeoutMs = timeout; }
+  size_t readBytes(char* buffer, size_t length);
+  size_t readBytesUntil(char terminator, char* buffer, size_t length);
+  String readStringUntil(char terminator);
+
+protected:
+  unsigned long timeoutMs = 1000;
+  int timedRead();
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef HOST_TINYGPSPLUS_H
+#define HOST_TINYGPSPLUS_H
+
+// Host-side replacement for TinyGPS++
+// Parses the $GPGGA and $GPRMC sentences produced by the simulated GPS
+// (checksums included) and exposes the same accessor objects
+
+#include <Arduino.h>
+
+// Coordinate as whole degrees plus billionths, without float rounding
+struct RawDegrees {
+  uint16_t deg = 0;
+  uint32_t billionths = 0;
+  bool negative = false;
+};
+
+struct TinyGPSLocation {
+  bool isValid() const { return valid; }
+  bool isUpdated() { bool u = updated; updated = false; return u; }
+  unsigned long age() const { return valid ? millis() - lastCommit : 0xFFFFFFFFUL; }
+  double lat() { updated = false; return latitude; }
+  double lng() { updated = false; return longitude; }
+  const RawDegrees& rawLat() { updated = false; rawLatitude = toRaw(latitude); return rawLatitude; }
+  const RawDegrees& rawLng() { updated = false; rawLongitude = toRaw(longitude); return rawLongitude; }
+
+  bool valid = false;
+  bool updated = false;
+  unsigned long lastCommit = 0;
+  double latitude = 0;
+  double longitude = 0;
+  RawDegrees rawLatitude;
+  RawDegrees rawLongitude;
+
+private:
+  static RawDegrees toRaw(double value) {
+    RawDegrees raw;
+    raw.negative = value < 0;
+    if (raw.negative) value = -value;
+    raw.deg = (uint16_t)value;
+    raw.billionths = (uint32_t)((value - raw.deg) * 1e9 + 0.5);
+    return raw;
+  }
+};
+
+struct TinyGPSTime {
+  bool isValid() const { return valid; }
+  bool isUpdated() { bool u = updated; updated = false; return u; }
+  unsigned long age() const { return valid ? millis() - lastCommit : 0xFFFFFFFFUL; }
+  uint32_t value() { updated = false; return time; }
+  uint8_t hour() { updated = false; return time / 1000000; }
+  uint8_t minute() { updated = false; return (time / 10000) % 100; }
+  uint8_t second() { updated = false; return (time / 100) % 100; }
+  uint8_t centisecond() { updated = false; return time % 100; }
+
+  bool valid = false;
+  bool updated = false;
+  unsigned long lastCommit = 0;
+  uint32_t time = 0;
+};
+
+struct TinyGPSDate {
+  bool isValid() const { return valid; }
+  bool isUpdated() { bool u = updated; updated = false; return u; }
+  uint32_t value() { updated = false; return date; }
+  uint16_t year() { updated = false; return date % 100 + 2000; }
+  uint8_t month() { updated = false; return (date / 100) % 100; }
+  uint8_t day() { updated = false; return date / 10000; }
+
+  bool valid = false;
+  bool updated = false;
+  uint32_t date = 0;
+};
+
+struct TinyGPSInteger {
+  bool isValid() const { return valid; }
+  bool isUpdated() { bool u = updated; updated = false; return u; }
+  uint32_t value() { updated = false; return val; }
+
+  bool valid = false;
+  bool updated = false;
+  uint32_t val = 0;
+};
+
+struct TinyGPSDecimal {
+  bool isValid() const { return valid; }
+  bool isUpdated() { bool u = updated; updated = false; return u; }
+  int32_t value() { updated = false; return val; }
+  double deg() { updated = false; return val / 100.0; }
+  double hdop() { updated = false; return val / 100.0; }
+  double meters() { updated = false; return val / 100.0; }
+  double knots() { updated = false; return val / 100.0; }
+
+  bool valid = false;
+  bool updated = false;
+  int32_t val = 0;
+};
+
+class TinyGPSPlus {
+public:
+  bool encode(char c);
+
+  TinyGPSLocation location;
+  TinyGPSDate date;
+  TinyGPSTime time;
+  TinyGPSDecimal speed;
+  TinyGPSDecimal course;
+  TinyGPSDecimal altitude;
+  TinyGPSInteger satellites;
+  TinyGPSDecimal hdop;
+
+  uint32_t charsProcessed() const { return chars; }
+  uint32_t sentencesWithFix() const { return withFix; }
+  uint32_t failedChecksum() const { return failed; }
+  uint32_t passedChecksum() const { return passed; }
+
+private:
+  char sentence[96];
+  uint8_t length = 0;
+  bool inSentence = false;
+  uint32_t chars = 0;
+  uint32_t withFix = 0;
+  uint32_t failed = 0;
+  uint32_t passed = 0;
+
+  bool commitSentence();
+};
+
+#endif
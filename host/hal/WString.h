@@ -0,0 +1,81 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+// Host-side replacement for the Arduino String class
+// Heap-backed like the AVR original, and every allocation is counted so the
+// simulator can report heap churn per loop cycle (see simHeapStats())
+
+#include <stddef.h>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+class String {
+public:
+  String(const char* cstr = "");
+  String(const String& other);
+  String(const __FlashStringHelper* str);
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimalPlaces = 2);
+  explicit String(double value, unsigned char decimalPlaces = 2);
+  ~String();
+
+  String& operator=(const String& rhs);
+  String& operator=(const char* cstr);
+
+  bool reserve(unsigned int size);
+  unsigned int length() const { return len; }
+  const char* c_str() const { return buffer ? buffer : ""; }
+
+  bool concat(const String& str);
+  bool concat(const char* cstr);
+  bool concat(const char* cstr, unsigned int length);
+  bool concat(char c);
+  String& operator+=(const String& rhs) { concat(rhs); return *this; }
+  String& operator+=(const char* cstr) { concat(cstr); return *this; }
+  String& operator+=(char c) { concat(c); return *this; }
+  String& operator+=(int value) { concat(String(value)); return *this; }
+  String& operator+=(long value) { concat(String(value)); return *this; }
+
+  bool equals(const String& s) const;
+  bool equals(const char* cstr) const;
+  bool operator==(const String& rhs) const { return equals(rhs); }
+  bool operator==(const char* cstr) const { return equals(cstr); }
+  bool operator!=(const String& rhs) const { return !equals(rhs); }
+  bool startsWith(const String& prefix) const;
+  bool endsWith(const String& suffix) const;
+
+  char charAt(unsigned int index) const;
+  char operator[](unsigned int index) const;
+  char& operator[](unsigned int index);
+
+  int indexOf(char ch, unsigned int fromIndex = 0) const;
+  int indexOf(const String& str, unsigned int fromIndex = 0) const;
+  String substring(unsigned int beginIndex) const;
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void toUpperCase();
+  void trim();
+  long toInt() const;
+  float toFloat() const;
+
+private:
+  char* buffer = nullptr;
+  unsigned int capacity = 0;
+  unsigned int len = 0;
+
+  bool changeBuffer(unsigned int maxStrLen);
+  void copy(const char* cstr, unsigned int length);
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const String& lhs, char rhs);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+// Host-side placeholder for the I2C (Wire) library
+// The simulated magnetometer is read directly, so only begin() is provided
+
+class TwoWire {
+public:
+  void begin() {}
+};
+
+extern TwoWire Wire;
+
+#endif
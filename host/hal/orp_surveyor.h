@@ -0,0 +1,25 @@
+#ifndef HOST_ORP_SURVEYOR_H
+#define HOST_ORP_SURVEYOR_H
+
+// Host-side replacement for the Atlas Scientific Surveyor ORP library
+// Converts the simulated analog channel to mV and keeps the calibration
+// offset in the simulated EEPROM like the original library
+
+#include <Arduino.h>
+
+class Surveyor_ORP {
+public:
+  explicit Surveyor_ORP(uint8_t pin) : pin(pin) {}
+
+  bool begin();
+  float read_voltage();
+  float read_orp();
+  void cal(float value);
+  void cal_clear();
+
+private:
+  uint8_t pin;
+  float offset = 0;
+};
+
+#endif
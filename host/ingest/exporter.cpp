@@ -0,0 +1,314 @@
+// Pluggable, batched exporters for stored readings
+
+#include "exporter.h"
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <chrono>
+
+// Longest wait between retries of a failing exporter
+static const unsigned long MAX_BACKOFF_MS = 30000;
+
+// Socket send/receive timeout for the HTTP exporter
+static const int HTTP_TIMEOUT_SECONDS = 10;
+
+void formatTimestamp(int64_t timeMs, char* out, size_t size) {
+  time_t seconds = (time_t)(timeMs / 1000);
+  struct tm local;
+  localtime_r(&seconds, &local);
+  strftime(out, size, "%Y-%m-%d %H:%M:%S", &local);
+}
+
+// Append 'value' with 'decimals' places, or 'missing' if it is NaN
+static void appendValue(std::string& out, double value, int decimals, const char* missing) {
+  if (isnan(value)) {
+    out += missing;
+    return;
+  }
+  char text[32];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  out += text;
+}
+
+// Append one reading's fields separated by commas, as CSV or JSON
+static void appendFields(std::string& out, const Reading& r, bool json) {
+  char text[64];
+  formatTimestamp(r.timeMs, text, sizeof(text));
+  if (json) out += '"';
+  out += text;
+  if (json) out += '"';
+
+  const char* missing = json ? "null" : "";
+  snprintf(text, sizeof(text), ",%u,%u,%u,", r.node, r.gateway, r.seq);
+  out += text;
+  appendValue(out, r.temperature, 2, missing);
+  out += ',';
+  appendValue(out, r.pH, 2, missing);
+  out += ',';
+  appendValue(out, r.tds, 1, missing);
+  out += ',';
+  appendValue(out, r.orp, 0, missing);
+  snprintf(text, sizeof(text), ",%d,", r.rssi);
+  out += text;
+  appendValue(out, r.snr, 1, missing);
+}
+
+// === CSV file ===
+
+CsvExporter::CsvExporter(const char* path) : path(path), file(NULL) {}
+
+CsvExporter::~CsvExporter() {
+  if (file) fclose(file);
+}
+
+bool CsvExporter::exportBatch(const Reading* readings, size_t count) {
+  if (!file) {
+    file = fopen(path.c_str(), "a");
+    if (!file) {
+      fprintf(stderr, "csv: cannot open %s: %s\n", path.c_str(), strerror(errno));
+      return false;
+    }
+    struct stat st;
+    if (fstat(fileno(file), &st) == 0 && st.st_size == 0) {
+      fputs("Timestamp,Node,Gateway,Seq,Temperature,pH,TDS,ORP,RSSI,SNR\n", file);
+    }
+  }
+
+  std::string rows;
+  rows.reserve(count * 64);
+  for (size_t i = 0; i < count; i++) {
+    appendFields(rows, readings[i], false);
+    rows += '\n';
+  }
+
+  if (fwrite(rows.data(), 1, rows.size(), file) != rows.size() || fflush(file) != 0) {
+    // Reopen on the next attempt, e.g. after the disk was remounted
+    fprintf(stderr, "csv: write to %s failed: %s\n", path.c_str(), strerror(errno));
+    fclose(file);
+    file = NULL;
+    return false;
+  }
+  return true;
+}
+
+// === HTTP ===
+
+HttpExporter::HttpExporter(const char* url) : port("80") {
+  const char* scheme = "http://";
+  if (strncmp(url, scheme, strlen(scheme)) != 0) {
+    fprintf(stderr, "http: only http:// URLs are supported: %s\n", url);
+    return;
+  }
+  const char* authority = url + strlen(scheme);
+  const char* slash = strchr(authority, '/');
+  std::string hostPort = slash ? std::string(authority, slash) : std::string(authority);
+  target = slash ? slash : "/";
+
+  size_t colon = hostPort.rfind(':');
+  if (colon != std::string::npos) {
+    port = hostPort.substr(colon + 1);
+    hostPort.erase(colon);
+  }
+  host = hostPort;
+}
+
+// Connect to the first address of host:port that accepts
+static int connectTo(const std::string& host, const std::string& port) {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addresses;
+  int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+  if (status != 0) {
+    fprintf(stderr, "http: cannot resolve %s: %s\n", host.c_str(), gai_strerror(status));
+    return -1;
+  }
+
+  int fd = -1;
+  for (struct addrinfo* a = addresses; a && fd < 0; a = a->ai_next) {
+    fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+    if (fd < 0) continue;
+    struct timeval timeout = { HTTP_TIMEOUT_SECONDS, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0) {
+    fprintf(stderr, "http: cannot connect to %s:%s\n", host.c_str(), port.c_str());
+  }
+  return fd;
+}
+
+static bool sendAll(int fd, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    sent += n;
+  }
+  return true;
+}
+
+bool HttpExporter::exportBatch(const Reading* readings, size_t count) {
+  if (!valid()) return false;
+
+  body.clear();
+  body += "{\"rows\":[";
+  for (size_t i = 0; i < count; i++) {
+    if (i) body += ',';
+    body += '[';
+    appendFields(body, readings[i], true);
+    body += ']';
+  }
+  body += "]}";
+
+  char length[32];
+  snprintf(length, sizeof(length), "%zu", body.size());
+  request.clear();
+  request += "POST " + target + " HTTP/1.1\r\nHost: " + host + "\r\n";
+  request += "Content-Type: application/json\r\nContent-Length: ";
+  request += length;
+  request += "\r\nConnection: close\r\n\r\n";
+
+  int fd = connectTo(host, port);
+  if (fd < 0) return false;
+
+  bool ok = sendAll(fd, request) && sendAll(fd, body);
+  int statusCode = 0;
+  if (ok) {
+    // Only the status line matters: "HTTP/1.1 200 OK"
+    char reply[64];
+    size_t got = 0;
+    ssize_t n;
+    while (got < sizeof(reply) - 1 && (n = recv(fd, reply + got, sizeof(reply) - 1 - got, 0)) > 0) {
+      got += n;
+      if (memchr(reply, '\n', got)) break;
+    }
+    reply[got] = 0;
+    const char* space = strchr(reply, ' ');
+    statusCode = space ? atoi(space + 1) : 0;
+  }
+  close(fd);
+
+  if (statusCode < 200 || statusCode > 299) {
+    fprintf(stderr, "http: %s%s rejected the batch (status %d)\n", host.c_str(), target.c_str(),
+            statusCode);
+    return false;
+  }
+  return true;
+}
+
+// === Worker ===
+
+ExportWorker::ExportWorker(Exporter* exporter, size_t batchSize, unsigned long flushMs,
+                           size_t capacity)
+    : exporter(exporter), batchSize(batchSize), flushMs(flushMs), queue(capacity), head(0),
+      queued(0), stopping(false), exportedCount(0), droppedCount(0), failureCount(0) {
+  thread = std::thread(&ExportWorker::run, this);
+}
+
+ExportWorker::~ExportWorker() {
+  finish();
+}
+
+void ExportWorker::finish() {
+  if (!thread.joinable()) return;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_one();
+  thread.join();
+}
+
+void ExportWorker::push(const Reading* readings, size_t count) {
+  std::lock_guard<std::mutex> guard(lock);
+  for (size_t i = 0; i < count; i++) {
+    if (queued == queue.size()) {
+      head = (head + 1) % queue.size();
+      queued--;
+      droppedCount++;
+    }
+    queue[(head + queued) % queue.size()] = readings[i];
+    queued++;
+  }
+  if (queued >= batchSize) {
+    wake.notify_one();
+  }
+}
+
+void ExportWorker::run() {
+  std::vector<Reading> batch;
+  batch.reserve(batchSize);
+  unsigned long backoffMs = 0;
+
+  std::unique_lock<std::mutex> guard(lock);
+  for (;;) {
+    if (backoffMs) {
+      // Wait out the backoff, but leave at once when asked to stop
+      wake.wait_for(guard, std::chrono::milliseconds(backoffMs), [this] { return stopping; });
+    } else if (batch.empty()) {
+      wake.wait_for(guard, std::chrono::milliseconds(flushMs),
+                    [this] { return stopping || queued >= batchSize; });
+    }
+
+    // A failed batch is retried as it was; otherwise take the next one
+    if (batch.empty()) {
+      while (queued > 0 && batch.size() < batchSize) {
+        batch.push_back(queue[head]);
+        head = (head + 1) % queue.size();
+        queued--;
+      }
+    }
+    if (batch.empty()) {
+      if (stopping) break;
+      continue;
+    }
+
+    guard.unlock();
+    bool delivered = exporter->exportBatch(batch.data(), batch.size());
+    guard.lock();
+
+    if (delivered) {
+      exportedCount += batch.size();
+      batch.clear();
+      backoffMs = 0;
+    } else {
+      failureCount++;
+      if (stopping) {
+        // One last attempt on shutdown; what is left stays in the store
+        droppedCount += batch.size() + queued;
+        break;
+      }
+      backoffMs = backoffMs ? backoffMs * 2 : 500;
+      if (backoffMs > MAX_BACKOFF_MS) backoffMs = MAX_BACKOFF_MS;
+    }
+  }
+}
+
+unsigned long long ExportWorker::exported() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return exportedCount;
+}
+
+unsigned long long ExportWorker::dropped() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return droppedCount;
+}
+
+unsigned long ExportWorker::failures() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return failureCount;
+}
@@ -0,0 +1,116 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tsdb.h"
+
+// Pluggable, batched exporters for stored readings
+// Each exporter runs behind its own ExportWorker thread with a bounded
+// queue, so a slow or unreachable destination never stalls ingestion or
+// the other exporters; readings are already safe in the local store, and
+// the queue only decides how far an exporter may fall behind before the
+// oldest unexported readings are skipped
+
+// Destination for batches of readings
+class Exporter {
+public:
+  virtual ~Exporter() {}
+
+  // Short name used in the statistics line
+  virtual const char* name() const = 0;
+
+  // Deliver one batch, oldest reading first
+  // Returns false to have the same batch retried after a backoff
+  virtual bool exportBatch(const Reading* readings, size_t count) = 0;
+};
+
+// Appends readings to a local CSV file with the spreadsheet's columns
+// (Timestamp, Temperature, pH, TDS, ORP) plus node, link and packet details
+class CsvExporter : public Exporter {
+public:
+  explicit CsvExporter(const char* path);
+  ~CsvExporter();
+
+  const char* name() const { return "csv"; }
+  bool exportBatch(const Reading* readings, size_t count);
+
+private:
+  std::string path;
+  FILE* file;
+};
+
+// POSTs each batch as one JSON document to an HTTP endpoint, standing in
+// for the spreadsheet API:
+//   {"rows":[["2026-01-31 12:00:00",node,gateway,seq,temp,ph,tds,orp,rssi,snr],...]}
+// Missing values are sent as null; any 2xx status counts as delivered
+class HttpExporter : public Exporter {
+public:
+  // 'url' is http://host[:port]/path
+  explicit HttpExporter(const char* url);
+
+  const char* name() const { return "http"; }
+  bool valid() const { return !host.empty(); }
+  bool exportBatch(const Reading* readings, size_t count);
+
+private:
+  std::string host;
+  std::string port;
+  std::string target;
+  std::string body;     // Reused between batches
+  std::string request;
+};
+
+// Feeds one exporter from a background thread
+// Batches leave when 'batchSize' readings are queued or 'flushMs' has
+// passed since the last batch, whichever comes first
+class ExportWorker {
+public:
+  ExportWorker(Exporter* exporter, size_t batchSize, unsigned long flushMs, size_t capacity);
+
+  ~ExportWorker();
+
+  // Deliver what is still queued (one attempt), then stop the thread
+  void finish();
+
+  // Queue readings without waiting for the exporter
+  // When the queue is full the oldest readings are dropped and counted
+  void push(const Reading* readings, size_t count);
+
+  const char* name() const { return exporter->name(); }
+  unsigned long long exported() const;
+  unsigned long long dropped() const;
+  unsigned long failures() const;
+
+private:
+  ExportWorker(const ExportWorker&);
+  ExportWorker& operator=(const ExportWorker&);
+
+  void run();
+
+  Exporter* exporter;
+  size_t batchSize;
+  unsigned long flushMs;
+
+  mutable std::mutex lock;
+  std::condition_variable wake;
+  std::vector<Reading> queue;  // Ring of 'capacity' readings
+  size_t head;
+  size_t queued;
+  bool stopping;
+  unsigned long long exportedCount;
+  unsigned long long droppedCount;
+  unsigned long failureCount;
+  std::thread thread;
+};
+
+// Function to format a Unix time in milliseconds as local
+// "YYYY-MM-DD HH:MM:SS"; 'out' must hold at least 20 bytes
+void formatTimestamp(int64_t timeMs, char* out, size_t size);
+
+#endif
@@ -0,0 +1,444 @@
+// Gateway-side ingestion daemon
+// Reads the output of one or more LoRa receivers, either JSON lines or,
+// with --framed, the SLIP-framed events of a receiver built with
+// BINARY_OUTPUT; stores every water quality reading in the local
+// time-series store and hands it to the configured exporters in batches
+// Replaces python/sheets.py, which re-authenticated on every push and
+// lost data while a push was in flight
+//
+// Usage: mizuguna_ingest [--db FILE] [--input PATH]... [--baud N] [--framed]
+//                        [--retention-hours H] [--csv FILE] [--http URL]
+//                        [--batch N] [--flush-ms MS] [--queue N]
+//                        [--stats-seconds S]
+//        mizuguna_ingest --db FILE --query NODE [--from MS] [--to MS]
+//
+// Each --input is a serial device, a file or "-" for standard input, and
+// counts as one gateway; a serial device that disappears is reopened
+// The same packet heard by several gateways is stored once: a node's
+// readings are accepted only from newer packets, or from the gateway that
+// delivered the packet currently being unpacked
+// --query prints the stored readings of one node as CSV and exits
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "exporter.h"
+#include "json_scan.h"
+#include "line_reader.h"
+#include "serial_frames.h"
+#include "tsdb.h"
+
+// Housekeeping periods of the main loop
+static const int POLL_TIMEOUT_MS = 200;
+static const int64_t EXPIRE_INTERVAL_MS = 1000;
+static const int64_t SYNC_INTERVAL_MS = 5000;
+static const int64_t RECONNECT_INTERVAL_MS = 2000;
+
+// A packet counter this far below the last one seen means the node's
+// counter was reset (e.g. EEPROM erased), not a replayed packet
+static const uint32_t COUNTER_RESET_GAP = 1UL << 20;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+  stopRequested = 1;
+}
+
+static int64_t wallClockMs() {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// One receiver connection
+struct Gateway {
+  std::string path;
+  bool reconnect;        // Serial device: reopen it when it goes away
+  LineReader* reader;
+  int64_t lastAttemptMs;
+};
+
+// Last packet a node's readings were accepted from
+struct NodeSeen {
+  bool known;
+  uint32_t seq;
+  uint8_t gateway;
+};
+
+struct Counters {
+  unsigned long long records;      // Lines or frames
+  unsigned long long readings;
+  unsigned long long duplicates;
+  unsigned long long otherFrames;  // Statistics, energy, path and obstacle lines
+  unsigned long long malformed;
+  unsigned long long storeErrors;
+};
+
+static NodeSeen seen[TSDB_MAX_NODES];
+static Counters counters;
+
+// Accept a reading unless another gateway already delivered its packet
+static bool firstDelivery(const Reading& r) {
+  NodeSeen& last = seen[r.node];
+  bool accept = !last.known || r.seq > last.seq ||
+                (r.seq == last.seq && r.gateway == last.gateway) ||
+                r.seq + COUNTER_RESET_GAP < last.seq;
+  if (accept) {
+    last.known = true;
+    last.seq = r.seq;
+    last.gateway = r.gateway;
+  }
+  return accept;
+}
+
+static int64_t intField(const JsonLine& json, const char* key, int64_t fallback) {
+  const JsonField* field = json.find(key);
+  int64_t value;
+  return field && parseInt(field->value, value) ? value : fallback;
+}
+
+// Decode one receiver line into 'out'
+// Returns false for lines that are not readings; they are only counted
+static bool decodeLine(const Span& line, uint8_t gateway, int64_t nowMs, Reading& out) {
+  JsonLine json;
+  if (!scanJsonLine(line.data, line.size, json)) {
+    // Debug output such as "ADR: SF7" is expected; a broken object is not
+    if (memchr(line.data, '{', line.size)) counters.malformed++;
+    return false;
+  }
+
+  const JsonField* message = json.find("message");
+  if (!message || !message->isString) {
+    counters.otherFrames++;
+    return false;
+  }
+  MessageValues values;
+  if (!parseReadingMessage(message->value, values)) {
+    counters.malformed++;
+    return false;
+  }
+
+  int64_t node = intField(json, "node", 0);
+  if (node < 0 || node >= (int64_t)TSDB_MAX_NODES) {
+    counters.malformed++;
+    return false;
+  }
+
+  double snr = NAN;
+  const JsonField* snrField = json.find("snr");
+  if (snrField) parseDecimal(snrField->value, snr);
+
+  out.timeMs = nowMs - intField(json, "age", 0) * 1000;
+  out.seq = (uint32_t)intField(json, "seq", 0);
+  out.node = (uint8_t)node;
+  out.gateway = gateway;
+  out.rssi = (int16_t)intField(json, "rssi", 0);
+  out.snr = (float)snr;
+  out.temperature = (float)values.temperature;
+  out.pH = (float)values.pH;
+  out.tds = (float)values.tds;
+  out.orp = (float)values.orp;
+  return true;
+}
+
+// Decode one binary event into 'out'
+// Returns false for events that are not readings; they are only counted
+static bool decodeFrame(const Span& frame, uint8_t gateway, int64_t nowMs, Reading& out) {
+  SerialEvent event;
+  if (!parseSerialEvent((const uint8_t*)frame.data, frame.size, event)) {
+    counters.malformed++;
+    return false;
+  }
+  ReadingEvent values;
+  if (!decodeReadingEvent(event, values)) {
+    counters.otherFrames++;
+    return false;
+  }
+
+  out.timeMs = nowMs - (int64_t)values.age * 1000;
+  out.seq = event.seq;
+  out.node = event.node;
+  out.gateway = gateway;
+  out.rssi = event.rssi;
+  out.snr = event.snr;
+  out.temperature = values.temperature;
+  out.pH = values.pH;
+  out.tds = values.tds;
+  out.orp = values.orp;
+  return true;
+}
+
+static void openGateway(Gateway& g, long baud, int64_t nowMs) {
+  g.lastAttemptMs = nowMs;
+  g.reader = new LineReader(g.path.c_str(), baud);
+  if (!g.reader->isOpen()) {
+    delete g.reader;
+    g.reader = NULL;
+  }
+}
+
+static void printQueryRow(const Reading& r, void* context) {
+  char timestamp[32];
+  formatTimestamp(r.timeMs, timestamp, sizeof(timestamp));
+  printf("%s,%lld,%u,%u,%u,%.2f,%.2f,%.1f,%.0f,%d,%.1f\n", timestamp, (long long)r.timeMs,
+         r.node, r.gateway, r.seq, r.temperature, r.pH, r.tds, r.orp, r.rssi, r.snr);
+  (void)context;
+}
+
+static void printStats(const TimeSeriesStore& store, const std::vector<ExportWorker*>& workers,
+                       double seconds, unsigned long long recordsBefore) {
+  fprintf(stderr, "ingest: %.0f records/s, %llu readings, %llu duplicates, %llu other, "
+          "%llu malformed, %llu store errors, %u blocks (%u free)",
+          (counters.records - recordsBefore) / seconds, counters.readings, counters.duplicates,
+          counters.otherFrames, counters.malformed, counters.storeErrors, store.blockCount(),
+          store.freeBlocks());
+  for (size_t i = 0; i < workers.size(); i++) {
+    fprintf(stderr, "; %s %llu exported, %llu dropped, %lu failures", workers[i]->name(),
+            workers[i]->exported(), workers[i]->dropped(), workers[i]->failures());
+  }
+  fprintf(stderr, "\n");
+}
+
+static void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [--db FILE] [--input PATH]... [--baud N] [--framed] [--retention-hours H]\n"
+          "          [--csv FILE] [--http URL] [--batch N] [--flush-ms MS] [--queue N]\n"
+          "          [--stats-seconds S]\n"
+          "       %s --db FILE --query NODE [--from MS] [--to MS]\n",
+          argv0, argv0);
+}
+
+int main(int argc, char** argv) {
+  const char* dbPath = "mizuguna.tsdb";
+  std::vector<std::string> inputs;
+  long baud = 115200;
+  bool framed = false;
+  double retentionHours = 24 * 30;
+  std::vector<std::string> csvPaths;
+  std::vector<std::string> httpUrls;
+  size_t batchSize = 500;
+  unsigned long flushMs = 60000;
+  size_t queueCapacity = 1 << 20;
+  double statsSeconds = 10;
+  int queryNode = -1;
+  int64_t queryFrom = INT64_MIN;
+  int64_t queryTo = INT64_MAX;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--db" && hasValue) {
+      dbPath = argv[++i];
+    } else if (arg == "--input" && hasValue) {
+      inputs.push_back(argv[++i]);
+    } else if (arg == "--baud" && hasValue) {
+      baud = atol(argv[++i]);
+    } else if (arg == "--framed") {
+      framed = true;
+    } else if (arg == "--retention-hours" && hasValue) {
+      retentionHours = atof(argv[++i]);
+    } else if (arg == "--csv" && hasValue) {
+      csvPaths.push_back(argv[++i]);
+    } else if (arg == "--http" && hasValue) {
+      httpUrls.push_back(argv[++i]);
+    } else if (arg == "--batch" && hasValue) {
+      batchSize = strtoul(argv[++i], NULL, 10);
+    } else if (arg == "--flush-ms" && hasValue) {
+      flushMs = strtoul(argv[++i], NULL, 10);
+    } else if (arg == "--queue" && hasValue) {
+      queueCapacity = strtoul(argv[++i], NULL, 10);
+    } else if (arg == "--stats-seconds" && hasValue) {
+      statsSeconds = atof(argv[++i]);
+    } else if (arg == "--query" && hasValue) {
+      queryNode = atoi(argv[++i]);
+    } else if (arg == "--from" && hasValue) {
+      queryFrom = strtoll(argv[++i], NULL, 10);
+    } else if (arg == "--to" && hasValue) {
+      queryTo = strtoll(argv[++i], NULL, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (batchSize == 0 || queueCapacity < batchSize || queryNode >= (int)TSDB_MAX_NODES) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  TimeSeriesStore store;
+  if (!store.open(dbPath, (int64_t)(retentionHours * 3600000.0))) {
+    return 1;
+  }
+
+  if (queryNode >= 0) {
+    printf("Timestamp,TimeMs,Node,Gateway,Seq,Temperature,pH,TDS,ORP,RSSI,SNR\n");
+    store.query((uint8_t)queryNode, queryFrom, queryTo, printQueryRow, NULL);
+    return 0;
+  }
+
+  if (inputs.empty()) {
+    inputs.push_back("-");
+  }
+
+  // Exporters, each behind its own worker thread
+  std::vector<Exporter*> exporters;
+  for (size_t i = 0; i < csvPaths.size(); i++) {
+    exporters.push_back(new CsvExporter(csvPaths[i].c_str()));
+  }
+  for (size_t i = 0; i < httpUrls.size(); i++) {
+    HttpExporter* http = new HttpExporter(httpUrls[i].c_str());
+    if (!http->valid()) {
+      return 2;
+    }
+    exporters.push_back(http);
+  }
+  std::vector<ExportWorker*> workers;
+  for (size_t i = 0; i < exporters.size(); i++) {
+    workers.push_back(new ExportWorker(exporters[i], batchSize, flushMs, queueCapacity));
+  }
+
+  // Resume duplicate suppression where the store left off
+  for (uint32_t node = 0; node < TSDB_MAX_NODES; node++) {
+    Reading last;
+    if (store.lastReading((uint8_t)node, last)) {
+      seen[node].known = true;
+      seen[node].seq = last.seq;
+      seen[node].gateway = last.gateway;
+    }
+  }
+
+  // Drop what aged out while the daemon was not running
+  int64_t nowMs = wallClockMs();
+  store.expire(nowMs);
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  std::vector<Gateway> gateways(inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    gateways[i].path = inputs[i];
+    openGateway(gateways[i], baud, nowMs);
+    if (!gateways[i].reader) {
+      return 1;
+    }
+    gateways[i].reconnect = inputs[i] != "-" && gateways[i].reader->isSerial();
+  }
+
+  // Readings decoded since the last hand-off to the exporters
+  std::vector<Reading> decoded;
+  decoded.reserve(4096);
+  std::vector<struct pollfd> fds;
+  std::vector<size_t> fdGateway;
+
+  int64_t lastExpire = nowMs;
+  int64_t lastSync = nowMs;
+  int64_t lastStats = nowMs;
+  unsigned long long recordsAtStats = 0;
+
+  while (!stopRequested) {
+    fds.clear();
+    fdGateway.clear();
+    bool anyOpen = false;
+    for (size_t i = 0; i < gateways.size(); i++) {
+      Gateway& g = gateways[i];
+      if (!g.reader && g.reconnect && nowMs - g.lastAttemptMs >= RECONNECT_INTERVAL_MS) {
+        openGateway(g, baud, nowMs);
+      }
+      if (g.reader) {
+        struct pollfd p = { g.reader->descriptor(), POLLIN, 0 };
+        fds.push_back(p);
+        fdGateway.push_back(i);
+      }
+      anyOpen = anyOpen || g.reader || g.reconnect;
+    }
+    if (!anyOpen) {
+      break;
+    }
+
+    if (poll(fds.data(), fds.size(), POLL_TIMEOUT_MS) < 0 && errno != EINTR) {
+      perror("poll");
+      break;
+    }
+    nowMs = wallClockMs();
+
+    for (size_t f = 0; f < fds.size(); f++) {
+      if (!fds[f].revents) continue;
+      Gateway& g = gateways[fdGateway[f]];
+      bool open = g.reader->fill();
+
+      Span record;
+      while (framed ? g.reader->nextFrame(record) : g.reader->nextLine(record)) {
+        counters.records++;
+        Reading reading;
+        uint8_t gateway = (uint8_t)fdGateway[f];
+        if (!(framed ? decodeFrame(record, gateway, nowMs, reading)
+                     : decodeLine(record, gateway, nowMs, reading))) {
+          continue;
+        }
+        if (!firstDelivery(reading)) {
+          counters.duplicates++;
+          continue;
+        }
+        if (!store.append(reading)) {
+          counters.storeErrors++;
+          continue;
+        }
+        counters.readings++;
+        decoded.push_back(reading);
+      }
+
+      if (!open) {
+        fprintf(stderr, "ingest: %s closed\n", g.path.c_str());
+        delete g.reader;
+        g.reader = NULL;
+        g.lastAttemptMs = nowMs;
+      }
+    }
+
+    if (!decoded.empty()) {
+      for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->push(decoded.data(), decoded.size());
+      }
+      decoded.clear();
+    }
+
+    if (nowMs - lastExpire >= EXPIRE_INTERVAL_MS) {
+      store.expire(nowMs);
+      lastExpire = nowMs;
+    }
+    if (nowMs - lastSync >= SYNC_INTERVAL_MS) {
+      store.sync(false);
+      lastSync = nowMs;
+    }
+    if (statsSeconds > 0 && nowMs - lastStats >= statsSeconds * 1000) {
+      printStats(store, workers, (nowMs - lastStats) / 1e3, recordsAtStats);
+      recordsAtStats = counters.records;
+      lastStats = nowMs;
+    }
+  }
+
+  // Deliver what is queued, then flush the store
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i]->finish();
+  }
+  nowMs = wallClockMs();
+  printStats(store, workers, (nowMs - lastStats + 1) / 1e3, recordsAtStats);
+  for (size_t i = 0; i < workers.size(); i++) {
+    delete workers[i];
+  }
+  for (size_t i = 0; i < exporters.size(); i++) {
+    delete exporters[i];
+  }
+  for (size_t i = 0; i < gateways.size(); i++) {
+    delete gateways[i].reader;
+  }
+  store.sync(true);
+  return 0;
+}
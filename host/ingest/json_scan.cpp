@@ -0,0 +1,184 @@
+// Zero-copy scanner for the receiver's JSON lines
+
+#include "json_scan.h"
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+bool Span::equals(const char* text) const {
+  size_t n = strlen(text);
+  return n == size && memcmp(data, text, n) == 0;
+}
+
+const JsonField* JsonLine::find(const char* key) const {
+  for (int i = 0; i < count; i++) {
+    if (fields[i].key.equals(key)) {
+      return &fields[i];
+    }
+  }
+  return NULL;
+}
+
+static const char* skipSpace(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+  return p;
+}
+
+// Span of a quoted string starting at 'p' (the opening quote)
+// Returns the position after the closing quote, or NULL if it is missing
+static const char* scanString(const char* p, const char* end, Span& out) {
+  const char* start = ++p;
+  while (p < end && *p != '"') {
+    if (*p == '\\') p++;
+    p++;
+  }
+  if (p >= end) return NULL;
+  out.data = start;
+  out.size = p - start;
+  return p + 1;
+}
+
+bool scanJsonLine(const char* line, size_t len, JsonLine& out) {
+  const char* end = line + len;
+  const char* p = (const char*)memchr(line, '{', len);
+  out.count = 0;
+  if (!p) return false;
+
+  p = skipSpace(p + 1, end);
+  if (p < end && *p == '}') return true;
+
+  while (p < end) {
+    JsonField field;
+    if (*p != '"' || !(p = scanString(p, end, field.key))) return false;
+
+    p = skipSpace(p, end);
+    if (p >= end || *p != ':') return false;
+    p = skipSpace(p + 1, end);
+    if (p >= end) return false;
+
+    if (*p == '"') {
+      field.isString = true;
+      if (!(p = scanString(p, end, field.value))) return false;
+    } else {
+      // Bare number, true, false or null: runs up to the next delimiter
+      field.isString = false;
+      const char* start = p;
+      while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t') p++;
+      if (p == start) return false;
+      field.value.data = start;
+      field.value.size = p - start;
+    }
+
+    if (out.count < MAX_JSON_FIELDS) {
+      out.fields[out.count++] = field;
+    }
+
+    p = skipSpace(p, end);
+    if (p >= end) return false;
+    if (*p == '}') return true;
+    if (*p != ',') return false;
+    p = skipSpace(p + 1, end);
+  }
+  return false;
+}
+
+bool parseInt(const Span& span, int64_t& value) {
+  const char* p = span.data;
+  const char* end = p + span.size;
+  bool negative = p < end && *p == '-';
+  if (negative) p++;
+  if (p == end) return false;
+
+  int64_t v = 0;
+  for (; p < end; p++) {
+    if (*p < '0' || *p > '9') return false;
+    v = v * 10 + (*p - '0');
+  }
+  value = negative ? -v : v;
+  return true;
+}
+
+// Decimal digits with an optional sign, fraction and exponent, stopping at
+// the first character that cannot continue the number
+// Returns the position after the number, or NULL if there is no digit
+static const char* scanDecimal(const char* p, const char* end, double& value) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+  double v = 0;
+  bool digits = false;
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    v = v * 10 + (*p - '0');
+    digits = true;
+  }
+  if (p < end && *p == '.') {
+    double scale = 0.1;
+    for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+      v += (*p - '0') * scale;
+      scale *= 0.1;
+      digits = true;
+    }
+  }
+  if (!digits) return NULL;
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    bool expNegative = false;
+    if (q < end && (*q == '-' || *q == '+')) expNegative = *q++ == '-';
+    int exponent = 0;
+    const char* expStart = q;
+    for (; q < end && *q >= '0' && *q <= '9'; q++) exponent = exponent * 10 + (*q - '0');
+    if (q > expStart) {
+      v *= pow(10.0, expNegative ? -exponent : exponent);
+      p = q;
+    }
+  }
+
+  value = negative ? -v : v;
+  return p;
+}
+
+bool parseDecimal(const Span& span, double& value) {
+  const char* end = span.data + span.size;
+  return scanDecimal(span.data, end, value) == end;
+}
+
+static bool keyIs(const char* key, size_t len, const char* name) {
+  size_t n = strlen(name);
+  return len == n && strncasecmp(key, name, n) == 0;
+}
+
+bool parseReadingMessage(const Span& message, MessageValues& out) {
+  out.temperature = out.pH = out.tds = out.orp = NAN;
+  bool any = false;
+
+  const char* p = message.data;
+  const char* end = p + message.size;
+  while (p < end) {
+    const char* partEnd = (const char*)memchr(p, '|', end - p);
+    if (!partEnd) partEnd = end;
+
+    const char* colon = (const char*)memchr(p, ':', partEnd - p);
+    if (colon) {
+      const char* key = skipSpace(p, colon);
+      const char* keyEnd = colon;
+      while (keyEnd > key && keyEnd[-1] == ' ') keyEnd--;
+
+      double value;
+      if (scanDecimal(skipSpace(colon + 1, partEnd), partEnd, value)) {
+        size_t keyLen = keyEnd - key;
+        double* slot = keyIs(key, keyLen, "temp") ? &out.temperature
+                     : keyIs(key, keyLen, "ph")   ? &out.pH
+                     : keyIs(key, keyLen, "tds")  ? &out.tds
+                     : keyIs(key, keyLen, "orp")  ? &out.orp
+                     : NULL;
+        if (slot) {
+          *slot = value;
+          any = true;
+        }
+      }
+    }
+    p = partEnd + 1;
+  }
+  return any;
+}
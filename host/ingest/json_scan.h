@@ -0,0 +1,66 @@
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Zero-copy scanner for the receiver's JSON lines
+// The receiver prints one flat object per line (no nesting, no arrays), so
+// the scanner only records where each key and value starts and ends inside
+// the read buffer; nothing is copied, unescaped or allocated
+// Numbers are converted on demand straight from those spans
+
+// View of bytes inside a buffer owned by someone else
+struct Span {
+  const char* data;
+  size_t size;
+
+  bool empty() const { return size == 0; }
+  bool equals(const char* text) const;
+};
+
+// One "key":value member; string values exclude their quotes and keep
+// any escapes as they were sent
+struct JsonField {
+  Span key;
+  Span value;
+  bool isString;
+};
+
+// Most members in any receiver line (the energy report has 12)
+const int MAX_JSON_FIELDS = 16;
+
+// One scanned line
+struct JsonLine {
+  JsonField fields[MAX_JSON_FIELDS];
+  int count;
+
+  // Member named 'key', or NULL if the line has none
+  const JsonField* find(const char* key) const;
+};
+
+// Function to scan the first flat object on a line
+// Anything before the opening brace (simulator timestamps, log prefixes)
+// is skipped; members beyond MAX_JSON_FIELDS are ignored
+// Returns false when the line holds no well-formed object
+bool scanJsonLine(const char* line, size_t len, JsonLine& out);
+
+// Functions to convert a span holding a JSON number
+// Return false if the span is not a number of that kind
+bool parseInt(const Span& span, int64_t& value);
+bool parseDecimal(const Span& span, double& value);
+
+// Water quality values decoded from a reading's "message" text
+// Keys are matched case-insensitively; missing values stay NaN
+struct MessageValues {
+  double temperature;
+  double pH;
+  double tds;
+  double orp;
+};
+
+// Function to decode "Temp:24.50 | pH:7.67 | TDS:162.0 | ORP:198"
+// Returns false unless at least one known key was found
+bool parseReadingMessage(const Span& message, MessageValues& out);
+
+#endif
@@ -0,0 +1,141 @@
+// Line and SLIP frame splitting over a serial port, pipe or file
+
+#include "line_reader.h"
+#include "serial_frames.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+// termios speed constant for a baud rate, B0 if unsupported
+static speed_t baudConstant(long baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    default: return B0;
+  }
+}
+
+// Raw 8N1 with no echo, flow control or line editing
+static bool configureSerial(int fd, long baud) {
+  struct termios tty;
+  if (tcgetattr(fd, &tty) != 0) return false;
+
+  speed_t speed = baudConstant(baud);
+  if (speed == B0) {
+    fprintf(stderr, "Unsupported baud rate %ld\n", baud);
+    return false;
+  }
+  cfmakeraw(&tty);
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  tty.c_cflag |= CLOCAL | CREAD;
+  tty.c_cflag &= ~CRTSCTS;
+  tty.c_cc[VMIN] = 0;
+  tty.c_cc[VTIME] = 0;
+  return tcsetattr(fd, TCSANOW, &tty) == 0;
+}
+
+LineReader::LineReader(const char* path, long baud)
+    : name(path), fd(-1), serial(false), buffer(new char[BUFFER_SIZE]), start(0), end(0),
+      skipping(false), totalBytes(0), overlong(0) {
+  fd = strcmp(path, "-") == 0 ? dup(STDIN_FILENO) : open(path, O_RDONLY | O_NOCTTY);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  serial = isatty(fd);
+  if (serial && !configureSerial(fd, baud)) {
+    fprintf(stderr, "Cannot configure %s: %s\n", path, strerror(errno));
+    close(fd);
+    fd = -1;
+  }
+}
+
+LineReader::~LineReader() {
+  if (fd >= 0) close(fd);
+  delete[] buffer;
+}
+
+bool LineReader::fill() {
+  if (fd < 0) return false;
+
+  // Keep the unfinished line, dropping everything already handed out
+  if (start > 0) {
+    memmove(buffer, buffer + start, end - start);
+    end -= start;
+    start = 0;
+  }
+
+  // A full buffer without a delimiter can never become a line or frame
+  if (end == BUFFER_SIZE) {
+    end = 0;
+    skipping = true;
+    overlong++;
+  }
+
+  ssize_t n = read(fd, buffer + end, BUFFER_SIZE - end);
+  if (n > 0) {
+    end += n;
+    totalBytes += n;
+    return true;
+  }
+  if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return true;
+  }
+  close(fd);
+  fd = -1;
+  return false;
+}
+
+bool LineReader::nextLine(Span& line) {
+  while (start < end) {
+    char* newline = (char*)memchr(buffer + start, '\n', end - start);
+    if (!newline) return false;
+
+    size_t lineStart = start;
+    start = newline - buffer + 1;
+    if (skipping) {
+      skipping = false;
+      continue;
+    }
+
+    size_t len = newline - (buffer + lineStart);
+    if (len > 0 && buffer[lineStart + len - 1] == '\r') len--;
+    line.data = buffer + lineStart;
+    line.size = len;
+    return true;
+  }
+  return false;
+}
+
+bool LineReader::nextFrame(Span& frame) {
+  while (start < end) {
+    char* delimiter = (char*)memchr(buffer + start, SLIP_END, end - start);
+    if (!delimiter) return false;
+
+    size_t frameStart = start;
+    start = delimiter - buffer + 1;
+    if (skipping) {
+      skipping = false;
+      continue;
+    }
+
+    // Every frame opens with its own SLIP_END, so empty frames are normal
+    size_t len = delimiter - (buffer + frameStart);
+    if (len == 0) continue;
+
+    frame.data = buffer + frameStart;
+    frame.size = slipDecodeInPlace((uint8_t*)buffer + frameStart, len);
+    return true;
+  }
+  return false;
+}
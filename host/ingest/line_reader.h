@@ -0,0 +1,60 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <stddef.h>
+#include "json_scan.h"
+
+// Line and SLIP frame splitting over a serial port, pipe or file
+// Bytes are read straight into a fixed buffer and complete lines (JSON
+// output) or frames (BINARY_OUTPUT, see serial_frames.h) are handed out as
+// spans into it; only the tail of an unfinished one is moved back to the
+// front before the next read
+// Lines or frames longer than the buffer are discarded whole and counted
+
+class LineReader {
+public:
+  // Open 'path' for reading ("-" is standard input)
+  // A serial device is switched to raw mode at 'baud'
+  LineReader(const char* path, long baud);
+  ~LineReader();
+
+  bool isOpen() const { return fd >= 0; }
+  bool isSerial() const { return serial; }
+  int descriptor() const { return fd; }
+  const char* path() const { return name; }
+
+  // Read whatever is available without blocking
+  // Returns false once the input has reached end of file or failed
+  bool fill();
+
+  // Next complete line (without its newline) since the last fill()
+  // The span stays valid until the following fill()
+  bool nextLine(Span& line);
+
+  // Next complete SLIP frame since the last fill(), unescaped in place
+  // A frame with an invalid escape is returned empty
+  // The span stays valid until the following fill()
+  bool nextFrame(Span& frame);
+
+  // Number of bytes read and of lines discarded for being too long
+  unsigned long long bytesRead() const { return totalBytes; }
+  unsigned long overlongLines() const { return overlong; }
+
+private:
+  static const size_t BUFFER_SIZE = 64 * 1024;
+
+  LineReader(const LineReader&);
+  LineReader& operator=(const LineReader&);
+
+  const char* name;
+  int fd;
+  bool serial;
+  char* buffer;
+  size_t start;      // First byte not yet handed out
+  size_t end;        // One past the last byte read
+  bool skipping;     // Dropping the rest of an overlong line or frame
+  unsigned long long totalBytes;
+  unsigned long overlong;
+};
+
+#endif
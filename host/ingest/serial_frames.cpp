@@ -0,0 +1,131 @@
+// Decoder for the receiver's binary serial output
+
+#include "serial_frames.h"
+
+#include <string.h>
+
+static uint16_t getU16(const uint8_t* src) {
+  return (uint16_t)src[0] | ((uint16_t)src[1] << 8);
+}
+
+static uint32_t getU32(const uint8_t* src) {
+  return (uint32_t)getU16(src) | ((uint32_t)getU16(src + 2) << 16);
+}
+
+uint16_t crc16Ccitt(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+size_t slipDecodeInPlace(uint8_t* frame, size_t len) {
+  size_t out = 0;
+  for (size_t i = 0; i < len; i++) {
+    uint8_t b = frame[i];
+    if (b == SLIP_ESC) {
+      if (++i >= len) return 0;
+      if (frame[i] == SLIP_ESC_END) {
+        b = SLIP_END;
+      } else if (frame[i] == SLIP_ESC_ESC) {
+        b = SLIP_ESC;
+      } else {
+        return 0;
+      }
+    }
+    frame[out++] = b;
+  }
+  return out;
+}
+
+bool parseSerialEvent(const uint8_t* frame, size_t len, SerialEvent& out) {
+  if (len < EVENT_HEADER_SIZE + EVENT_CRC_SIZE) return false;
+  size_t crcAt = len - EVENT_CRC_SIZE;
+  if (crc16Ccitt(frame, crcAt) != getU16(frame + crcAt)) return false;
+
+  out.type = frame[0];
+  out.node = frame[1];
+  out.seq = getU32(frame + 2);
+  out.timestamp = getU32(frame + 6);
+  out.rssi = (int16_t)getU16(frame + 10);
+  out.snr = (int8_t)frame[12] * 0.25f;
+  out.body = frame + EVENT_HEADER_SIZE;
+  out.bodySize = crcAt - EVENT_HEADER_SIZE;
+  return true;
+}
+
+bool decodeReadingEvent(const SerialEvent& event, ReadingEvent& out) {
+  if (event.type != EVENT_READING || event.bodySize != 13) return false;
+  const uint8_t* b = event.body;
+  out.packetSize = b[0];
+  out.age = getU32(b + 1);
+  out.temperature = (int16_t)getU16(b + 5) / 100.0f;
+  out.pH = (int16_t)getU16(b + 7) / 100.0f;
+  out.tds = getU16(b + 9) / 10.0f;
+  out.orp = (int16_t)getU16(b + 11);
+  return true;
+}
+
+bool decodePathEvent(const SerialEvent& event, PathEvent& out) {
+  if (event.type != EVENT_PATH || event.bodySize != 14) return false;
+  const uint8_t* b = event.body;
+  out.latitude = (int32_t)getU32(b);
+  out.longitude = (int32_t)getU32(b + 4);
+  out.heading = getU16(b + 8);
+  out.age = getU32(b + 10);
+  return true;
+}
+
+// Body is the obstacle frame without its type byte (arduino/telemetry.h)
+bool decodeObstacleEvent(const SerialEvent& event, ObstacleEvent& out) {
+  if (event.type != EVENT_OBSTACLE || event.bodySize != 13) return false;
+  const uint8_t* b = event.body;
+  out.latitude = (int32_t)getU32(b);
+  out.longitude = (int32_t)getU32(b + 4);
+  out.distanceCm = getU16(b + 8) / 10.0f;
+  out.heading = b[10] * 2;
+  out.fixAge = getU16(b + 11);
+  out.hasFix = out.fixAge != 0xFFFF;
+  return true;
+}
+
+// Body is the energy frame without its type byte (arduino/telemetry.h)
+bool decodeEnergyEvent(const SerialEvent& event, EnergyEvent& out) {
+  if (event.type != EVENT_ENERGY || event.bodySize != 4 + 4 * EVENT_ENERGY_FIELDS) return false;
+  out.uptime = getU32(event.body);
+  for (int i = 0; i < EVENT_ENERGY_FIELDS; i++) {
+    out.charges[i] = getU32(event.body + 4 + 4 * i);
+  }
+  return true;
+}
+
+bool decodeNodeStatsEvent(const SerialEvent& event, NodeStatsEvent& out) {
+  if (event.type != EVENT_NODE_STATS || event.bodySize != 12) return false;
+  out.received = getU32(event.body);
+  out.lost = getU32(event.body + 4);
+  out.lastHeard = getU32(event.body + 8);
+  return true;
+}
+
+bool decodeGatewayStatsEvent(const SerialEvent& event, GatewayStatsEvent& out) {
+  if (event.type != EVENT_GATEWAY_STATS || event.bodySize != 8) return false;
+  out.rxOverflows = getU32(event.body);
+  out.hintsMissed = getU32(event.body + 4);
+  return true;
+}
+
+bool decodePerfEvent(const SerialEvent& event, PerfEvent& out) {
+  if (event.type != EVENT_PERF || event.bodySize != 19 + EVENT_PERF_BUCKETS) return false;
+  out.probe = event.body[0];
+  out.window = getU16(event.body + 1);
+  out.count = getU32(event.body + 3);
+  out.minMicros = getU32(event.body + 7);
+  out.meanMicros = getU32(event.body + 11);
+  out.maxMicros = getU32(event.body + 15);
+  memcpy(out.histogram, event.body + 19, EVENT_PERF_BUCKETS);
+  return true;
+}
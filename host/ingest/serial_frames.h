@@ -0,0 +1,120 @@
+#ifndef SERIAL_FRAMES_H
+#define SERIAL_FRAMES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Decoder for the receiver's binary serial output (BINARY_OUTPUT)
+// Each event is a SLIP frame: header, body and CRC-16/CCITT-FALSE, with
+// the layout documented next to BINARY_OUTPUT in
+// LoRaReceiver_encrypted/LoRaReceiver_encrypted.ino; the constants below
+// must match it
+// Frames are decoded in place in the read buffer and events point into
+// them, so nothing is copied
+
+const uint8_t SLIP_END = 0xC0;
+const uint8_t SLIP_ESC = 0xDB;
+const uint8_t SLIP_ESC_END = 0xDC;
+const uint8_t SLIP_ESC_ESC = 0xDD;
+
+const uint8_t EVENT_READING = 0x01;
+const uint8_t EVENT_MESSAGE = 0x02;
+const uint8_t EVENT_PATH = 0x03;
+const uint8_t EVENT_OBSTACLE = 0x04;
+const uint8_t EVENT_ENERGY = 0x05;
+const uint8_t EVENT_NODE_STATS = 0x06;
+const uint8_t EVENT_GATEWAY_STATS = 0x07;
+const uint8_t EVENT_LOG = 0x08;
+const uint8_t EVENT_PERF = 0x09;
+
+const size_t EVENT_HEADER_SIZE = 13;
+const size_t EVENT_CRC_SIZE = 2;
+const int EVENT_ENERGY_FIELDS = 6;
+const int EVENT_PERF_BUCKETS = 8;
+
+// Header fields and body of one event
+struct SerialEvent {
+  uint8_t type;          // EVENT_*
+  uint8_t node;          // 0 for gateway events
+  uint32_t seq;          // Packet counter of the uplink
+  uint32_t timestamp;    // Receiver millis() when the uplink arrived
+  int16_t rssi;          // dBm
+  float snr;             // dB
+  const uint8_t* body;
+  size_t bodySize;
+};
+
+struct ReadingEvent {
+  uint8_t packetSize;
+  uint32_t age;          // Seconds between the reading and its transmission
+  float temperature;     // degC
+  float pH;
+  float tds;             // ppm
+  float orp;             // mV
+};
+
+struct PathEvent {
+  int32_t latitude;      // 1e-6 degrees
+  int32_t longitude;     // 1e-6 degrees
+  uint16_t heading;      // Degrees
+  uint32_t age;          // Seconds between the fix and its transmission
+};
+
+struct ObstacleEvent {
+  bool hasFix;           // Position fields are 0 without a fix
+  int32_t latitude;
+  int32_t longitude;
+  float distanceCm;
+  uint16_t heading;
+  uint16_t fixAge;       // Seconds
+};
+
+struct EnergyEvent {
+  uint32_t uptime;                        // Seconds since the node booted
+  uint32_t charges[EVENT_ENERGY_FIELDS];  // uAh: CPU, sleep, TX, RX, sensors, GPS
+};
+
+struct NodeStatsEvent {
+  uint32_t received;
+  uint32_t lost;
+  uint32_t lastHeard;    // Seconds
+};
+
+struct GatewayStatsEvent {
+  uint32_t rxOverflows;
+  uint32_t hintsMissed;
+};
+
+struct PerfEvent {
+  uint8_t probe;         // PerfProbe index, see arduino/perf.h
+  uint16_t window;       // Seconds the statistics cover
+  uint32_t count;
+  uint32_t minMicros;
+  uint32_t meanMicros;
+  uint32_t maxMicros;
+  uint8_t histogram[EVENT_PERF_BUCKETS];  // Share of the calls per bucket, 1/255
+};
+
+// Function to compute CRC-16/CCITT-FALSE (polynomial 0x1021, initial 0xFFFF)
+uint16_t crc16Ccitt(const uint8_t* data, size_t len);
+
+// Function to undo SLIP escapes in place
+// Returns the decoded length, or 0 if the frame holds an invalid escape
+size_t slipDecodeInPlace(uint8_t* frame, size_t len);
+
+// Function to check the CRC of a decoded frame and split it into header
+// and body; returns false for short or corrupted frames
+bool parseSerialEvent(const uint8_t* frame, size_t len, SerialEvent& out);
+
+// Functions to decode an event body; each returns false if the event is
+// of another type or its body has the wrong size
+// EVENT_MESSAGE and EVENT_LOG bodies are text and need no decoding
+bool decodeReadingEvent(const SerialEvent& event, ReadingEvent& out);
+bool decodePathEvent(const SerialEvent& event, PathEvent& out);
+bool decodeObstacleEvent(const SerialEvent& event, ObstacleEvent& out);
+bool decodeEnergyEvent(const SerialEvent& event, EnergyEvent& out);
+bool decodeNodeStatsEvent(const SerialEvent& event, NodeStatsEvent& out);
+bool decodeGatewayStatsEvent(const SerialEvent& event, GatewayStatsEvent& out);
+bool decodePerfEvent(const SerialEvent& event, PerfEvent& out);
+
+#endif
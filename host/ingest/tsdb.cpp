@@ -0,0 +1,320 @@
+// Local time-series store for water quality readings
+
+#include "tsdb.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char TSDB_MAGIC[8] = { 'M', 'Z', 'G', 'T', 'S', 'D', 'B', 0 };
+static const uint32_t TSDB_VERSION = 1;
+
+// Blocks added each time the free list runs dry
+static const uint32_t GROW_BLOCKS = 64;
+
+
+// Index entry of one node; block numbers are 1-based, 0 = none
+struct NodeIndex {
+  uint32_t oldest;
+  uint32_t newest;
+  uint64_t rows;
+};
+
+struct TimeSeriesStore::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t blockRows;
+  uint32_t blockCount;
+  uint32_t freeHead;     // First free block, chained through BlockHeader.next
+  uint32_t freeCount;
+  uint32_t reserved;
+  int64_t retentionMs;
+  NodeIndex nodes[TSDB_MAX_NODES];
+};
+
+struct BlockHeader {
+  uint32_t next;         // Next newer block of the node, or next free block
+  uint32_t count;        // Committed rows
+  int64_t minMs;
+  int64_t maxMs;
+  uint8_t node;
+  uint8_t reserved[7];
+};
+
+// Column offsets inside a block
+static const size_t COL_TIME = sizeof(BlockHeader);
+static const size_t COL_SEQ = COL_TIME + TSDB_BLOCK_ROWS * sizeof(int64_t);
+static const size_t COL_TEMPERATURE = COL_SEQ + TSDB_BLOCK_ROWS * sizeof(uint32_t);
+static const size_t COL_PH = COL_TEMPERATURE + TSDB_BLOCK_ROWS * sizeof(float);
+static const size_t COL_TDS = COL_PH + TSDB_BLOCK_ROWS * sizeof(float);
+static const size_t COL_ORP = COL_TDS + TSDB_BLOCK_ROWS * sizeof(float);
+static const size_t COL_SNR = COL_ORP + TSDB_BLOCK_ROWS * sizeof(float);
+static const size_t COL_RSSI = COL_SNR + TSDB_BLOCK_ROWS * sizeof(float);
+static const size_t COL_GATEWAY = COL_RSSI + TSDB_BLOCK_ROWS * sizeof(int16_t);
+static const size_t BLOCK_END = COL_GATEWAY + TSDB_BLOCK_ROWS * sizeof(uint8_t);
+
+static const size_t TSDB_HEADER_SIZE = 3 * 4096;
+static const size_t TSDB_BLOCK_SIZE = (BLOCK_END + 4095) & ~(size_t)4095;
+
+// A block is only ever addressed through its header
+struct TimeSeriesStore::Block {
+  BlockHeader head;
+
+  template <typename T> T* column(size_t offset) {
+    return (T*)((uint8_t*)this + offset);
+  }
+  template <typename T> const T* column(size_t offset) const {
+    return (const T*)((const uint8_t*)this + offset);
+  }
+};
+
+TimeSeriesStore::TimeSeriesStore() : fd(-1), base(NULL), mappedSize(0), header(NULL) {
+  static_assert(sizeof(Header) <= TSDB_HEADER_SIZE, "Store header outgrew its pages");
+}
+
+TimeSeriesStore::~TimeSeriesStore() {
+  close();
+}
+
+bool TimeSeriesStore::open(const char* path, int64_t retentionMs) {
+  close();
+  fd = ::open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open store %s: %s\n", path, strerror(errno));
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close();
+    return false;
+  }
+
+  if (st.st_size == 0) {
+    // New store: header only, blocks are added on the first append
+    if (ftruncate(fd, TSDB_HEADER_SIZE) != 0 || !map(0)) {
+      fprintf(stderr, "Cannot create store %s: %s\n", path, strerror(errno));
+      close();
+      return false;
+    }
+    memcpy(header->magic, TSDB_MAGIC, sizeof(TSDB_MAGIC));
+    header->version = TSDB_VERSION;
+    header->blockRows = TSDB_BLOCK_ROWS;
+  } else {
+    // Existing store: the header must describe exactly this file
+    Header existing;
+    if (pread(fd, &existing, sizeof(existing), 0) != (ssize_t)sizeof(existing) ||
+        memcmp(existing.magic, TSDB_MAGIC, sizeof(TSDB_MAGIC)) != 0 ||
+        existing.version != TSDB_VERSION || existing.blockRows != TSDB_BLOCK_ROWS ||
+        (size_t)st.st_size != TSDB_HEADER_SIZE + existing.blockCount * TSDB_BLOCK_SIZE) {
+      fprintf(stderr, "%s is not a compatible store\n", path);
+      close();
+      return false;
+    }
+    if (!map(existing.blockCount)) {
+      close();
+      return false;
+    }
+  }
+
+  header->retentionMs = retentionMs;
+  return true;
+}
+
+void TimeSeriesStore::close() {
+  if (base) {
+    msync(base, mappedSize, MS_SYNC);
+    munmap(base, mappedSize);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  fd = -1;
+  base = NULL;
+  header = NULL;
+  mappedSize = 0;
+}
+
+// Map the header and 'blocks' blocks, replacing any earlier mapping
+bool TimeSeriesStore::map(uint32_t blocks) {
+  size_t size = TSDB_HEADER_SIZE + (size_t)blocks * TSDB_BLOCK_SIZE;
+  void* mapped = base ? mremap(base, mappedSize, size, MREMAP_MAYMOVE)
+                      : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapped == MAP_FAILED) {
+    fprintf(stderr, "Cannot map store: %s\n", strerror(errno));
+    return false;
+  }
+  base = (uint8_t*)mapped;
+  mappedSize = size;
+  header = (Header*)base;
+  return true;
+}
+
+// Extend the file by GROW_BLOCKS blocks and put them on the free list
+bool TimeSeriesStore::grow() {
+  uint32_t first = header->blockCount + 1;
+  uint32_t blocks = header->blockCount + GROW_BLOCKS;
+  if (ftruncate(fd, TSDB_HEADER_SIZE + (off_t)blocks * TSDB_BLOCK_SIZE) != 0 || !map(blocks)) {
+    fprintf(stderr, "Cannot grow store: %s\n", strerror(errno));
+    return false;
+  }
+  header->blockCount = blocks;
+
+  // Chain in descending order so the lowest block is handed out first
+  for (uint32_t number = blocks; number >= first; number--) {
+    freeBlock(number);
+  }
+  return true;
+}
+
+TimeSeriesStore::Block* TimeSeriesStore::block(uint32_t number) const {
+  return (Block*)(base + TSDB_HEADER_SIZE + (size_t)(number - 1) * TSDB_BLOCK_SIZE);
+}
+
+void TimeSeriesStore::freeBlock(uint32_t number) {
+  Block* b = block(number);
+  b->head.count = 0;
+  b->head.next = header->freeHead;
+  header->freeHead = number;
+  header->freeCount++;
+}
+
+// Take a block off the free list and link it as the newest of 'node'
+// Returns 0 if the file could not grow
+uint32_t TimeSeriesStore::allocateBlock(uint8_t node) {
+  if (header->freeHead == 0 && !grow()) {
+    return 0;
+  }
+
+  uint32_t number = header->freeHead;
+  Block* b = block(number);
+  header->freeHead = b->head.next;
+  header->freeCount--;
+
+  memset(&b->head, 0, sizeof(b->head));
+  b->head.node = node;
+
+  NodeIndex& index = header->nodes[node];
+  if (index.newest) {
+    block(index.newest)->head.next = number;
+  } else {
+    index.oldest = number;
+  }
+  index.newest = number;
+  return number;
+}
+
+bool TimeSeriesStore::append(const Reading& reading) {
+  if (!header) return false;
+
+  NodeIndex* index = &header->nodes[reading.node];
+  uint32_t number = index->newest;
+  if (number == 0 || block(number)->head.count == TSDB_BLOCK_ROWS) {
+    number = allocateBlock(reading.node);
+    if (number == 0) return false;
+    index = &header->nodes[reading.node];  // The mapping may have moved
+  }
+
+  Block* b = block(number);
+  uint32_t row = b->head.count;
+  b->column<int64_t>(COL_TIME)[row] = reading.timeMs;
+  b->column<uint32_t>(COL_SEQ)[row] = reading.seq;
+  b->column<float>(COL_TEMPERATURE)[row] = reading.temperature;
+  b->column<float>(COL_PH)[row] = reading.pH;
+  b->column<float>(COL_TDS)[row] = reading.tds;
+  b->column<float>(COL_ORP)[row] = reading.orp;
+  b->column<float>(COL_SNR)[row] = reading.snr;
+  b->column<int16_t>(COL_RSSI)[row] = reading.rssi;
+  b->column<uint8_t>(COL_GATEWAY)[row] = reading.gateway;
+
+  if (row == 0 || reading.timeMs < b->head.minMs) b->head.minMs = reading.timeMs;
+  if (row == 0 || reading.timeMs > b->head.maxMs) b->head.maxMs = reading.timeMs;
+  b->head.count = row + 1;
+  index->rows++;
+  return true;
+}
+
+size_t TimeSeriesStore::expire(int64_t nowMs) {
+  if (!header) return 0;
+
+  int64_t cutoff = nowMs - header->retentionMs;
+  size_t freed = 0;
+  for (uint32_t node = 0; node < TSDB_MAX_NODES; node++) {
+    NodeIndex& index = header->nodes[node];
+    while (index.oldest && block(index.oldest)->head.maxMs < cutoff) {
+      uint32_t number = index.oldest;
+      Block* b = block(number);
+      index.rows -= b->head.count;
+      index.oldest = number == index.newest ? 0 : b->head.next;
+      if (index.oldest == 0) index.newest = 0;
+      freeBlock(number);
+      freed++;
+    }
+  }
+  return freed;
+}
+
+void TimeSeriesStore::sync(bool wait) {
+  if (base) {
+    msync(base, mappedSize, wait ? MS_SYNC : MS_ASYNC);
+  }
+}
+
+void TimeSeriesStore::readRow(const Block* b, uint32_t row, Reading& out) const {
+  out.timeMs = b->column<int64_t>(COL_TIME)[row];
+  out.seq = b->column<uint32_t>(COL_SEQ)[row];
+  out.node = b->head.node;
+  out.gateway = b->column<uint8_t>(COL_GATEWAY)[row];
+  out.rssi = b->column<int16_t>(COL_RSSI)[row];
+  out.snr = b->column<float>(COL_SNR)[row];
+  out.temperature = b->column<float>(COL_TEMPERATURE)[row];
+  out.pH = b->column<float>(COL_PH)[row];
+  out.tds = b->column<float>(COL_TDS)[row];
+  out.orp = b->column<float>(COL_ORP)[row];
+}
+
+size_t TimeSeriesStore::query(uint8_t node, int64_t fromMs, int64_t toMs, RowVisitor visit,
+                              void* context) const {
+  if (!header) return 0;
+
+  size_t visited = 0;
+  for (uint32_t number = header->nodes[node].oldest; number; ) {
+    const Block* b = block(number);
+    // Only the time column is read for blocks that straddle the range
+    if (b->head.maxMs >= fromMs && b->head.minMs <= toMs) {
+      const int64_t* times = b->column<int64_t>(COL_TIME);
+      for (uint32_t row = 0; row < b->head.count; row++) {
+        if (times[row] < fromMs || times[row] > toMs) continue;
+        Reading reading;
+        readRow(b, row, reading);
+        visit(reading, context);
+        visited++;
+      }
+    }
+    number = number == header->nodes[node].newest ? 0 : b->head.next;
+  }
+  return visited;
+}
+
+bool TimeSeriesStore::lastReading(uint8_t node, Reading& out) const {
+  if (!header || !header->nodes[node].newest) return false;
+  const Block* b = block(header->nodes[node].newest);
+  if (b->head.count == 0) return false;
+  readRow(b, b->head.count - 1, out);
+  return true;
+}
+
+uint64_t TimeSeriesStore::rowCount(uint8_t node) const {
+  return header ? header->nodes[node].rows : 0;
+}
+
+uint32_t TimeSeriesStore::blockCount() const {
+  return header ? header->blockCount : 0;
+}
+
+uint32_t TimeSeriesStore::freeBlocks() const {
+  return header ? header->freeCount : 0;
+}
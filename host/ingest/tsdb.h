@@ -0,0 +1,97 @@
+#ifndef TSDB_H
+#define TSDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Local time-series store for water quality readings
+// One memory-mapped file split into fixed-size blocks; each block holds up
+// to TSDB_BLOCK_ROWS readings of a single node, stored column by column so
+// a query over one quantity touches only that column's pages
+// The file header holds a per-node index: the chain of that node's blocks
+// from oldest to newest, so appends go to the newest block and retention
+// frees whole blocks from the oldest end without scanning anything
+// Freed blocks are kept on a free list and reused before the file grows
+//
+// File layout:
+//   [0 .. TSDB_HEADER_SIZE)  TsdbHeader
+//   then blockCount blocks of TSDB_BLOCK_SIZE bytes:
+//     BlockHeader, then the columns time, seq, temperature, pH, TDS, ORP,
+//     SNR, RSSI and gateway, TSDB_BLOCK_ROWS entries each
+//
+// A row is committed by incrementing its block's count after the columns
+// are written, so a crash leaves at most the row being written unseen
+
+// Readings per block and number of node ids (node ids are one byte on air)
+const uint32_t TSDB_BLOCK_ROWS = 1024;
+const uint32_t TSDB_MAX_NODES = 256;
+
+// One stored reading
+struct Reading {
+  int64_t timeMs;      // Unix time of the reading (arrival minus its age)
+  uint32_t seq;        // Packet counter it arrived in
+  uint8_t node;
+  uint8_t gateway;     // Index of the input it arrived on
+  int16_t rssi;        // dBm
+  float snr;           // dB
+  float temperature;   // degC
+  float pH;
+  float tds;           // ppm
+  float orp;           // mV
+};
+
+class TimeSeriesStore {
+public:
+  TimeSeriesStore();
+  ~TimeSeriesStore();
+
+  // Open the store at 'path', creating it if it does not exist
+  // Readings older than 'retentionMs' are dropped by expire()
+  bool open(const char* path, int64_t retentionMs);
+  void close();
+
+  // Append one reading to its node's newest block
+  // Returns false if the file could not grow
+  bool append(const Reading& reading);
+
+  // Free every block whose newest reading is older than the retention
+  // period before 'nowMs'; returns the number of blocks freed
+  size_t expire(int64_t nowMs);
+
+  // Schedule dirty pages for writeback, or wait for them with 'wait'
+  void sync(bool wait);
+
+  // Call 'visit' for each reading of 'node' with fromMs <= time <= toMs,
+  // oldest block first; returns the number of readings visited
+  typedef void (*RowVisitor)(const Reading& reading, void* context);
+  size_t query(uint8_t node, int64_t fromMs, int64_t toMs, RowVisitor visit,
+               void* context) const;
+
+  // Most recent reading stored for 'node'; false if there is none
+  bool lastReading(uint8_t node, Reading& out) const;
+
+  uint64_t rowCount(uint8_t node) const;
+  uint32_t blockCount() const;
+  uint32_t freeBlocks() const;
+
+private:
+  TimeSeriesStore(const TimeSeriesStore&);
+  TimeSeriesStore& operator=(const TimeSeriesStore&);
+
+  struct Header;
+  struct Block;
+
+  bool map(uint32_t blocks);
+  bool grow();
+  uint32_t allocateBlock(uint8_t node);
+  void freeBlock(uint32_t number);
+  Block* block(uint32_t number) const;
+  void readRow(const Block* b, uint32_t row, Reading& out) const;
+
+  int fd;
+  uint8_t* base;
+  size_t mappedSize;
+  Header* header;
+};
+
+#endif
@@ -0,0 +1,159 @@
+// AES-128 block cipher (FIPS-197) for the simulated Crypto library
+// Byte-oriented reference implementation; correctness over speed, with
+// per-block counters so the simulator can report encryption cost
+
+#include <AES.h>
+#include <string.h>
+#include "sim.h"
+
+static SimCryptoStats cryptoStats;
+
+SimCryptoStats& simCryptoStats() {
+  return cryptoStats;
+}
+
+static const uint8_t sbox[256] = {
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static uint8_t invSbox[256];
+
+static void buildInverseSbox() {
+  static bool built = false;
+  if (built) return;
+  for (int i = 0; i < 256; i++) invSbox[sbox[i]] = (uint8_t)i;
+  built = true;
+}
+
+static uint8_t xtime(uint8_t x) {
+  return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+static uint8_t mul(uint8_t x, uint8_t y) {
+  uint8_t result = 0;
+  while (y) {
+    if (y & 1) result ^= x;
+    x = xtime(x);
+    y >>= 1;
+  }
+  return result;
+}
+
+static void addRoundKey(uint8_t* state, const uint8_t* roundKey) {
+  for (int i = 0; i < 16; i++) state[i] ^= roundKey[i];
+}
+
+AES128::AES128() {
+  memset(schedule, 0, sizeof(schedule));
+  buildInverseSbox();
+}
+
+AES128::~AES128() {
+  clear();
+}
+
+bool AES128::setKey(const uint8_t* key, size_t len) {
+  if (len != 16) return false;
+  static const uint8_t rcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+  memcpy(schedule, key, 16);
+  for (int i = 4; i < 44; i++) {
+    uint8_t temp[4];
+    memcpy(temp, schedule + (i - 1) * 4, 4);
+    if (i % 4 == 0) {
+      uint8_t t = temp[0];
+      temp[0] = sbox[temp[1]] ^ rcon[i / 4 - 1];
+      temp[1] = sbox[temp[2]];
+      temp[2] = sbox[temp[3]];
+      temp[3] = sbox[t];
+    }
+    for (int j = 0; j < 4; j++) {
+      schedule[i * 4 + j] = schedule[(i - 4) * 4 + j] ^ temp[j];
+    }
+  }
+  return true;
+}
+
+void AES128::encryptBlock(uint8_t* output, const uint8_t* input) {
+  uint8_t state[16];
+  memcpy(state, input, 16);
+  addRoundKey(state, schedule);
+
+  for (int round = 1; round <= 10; round++) {
+    uint8_t tmp[16];
+    // SubBytes + ShiftRows
+    for (int c = 0; c < 4; c++) {
+      for (int r = 0; r < 4; r++) {
+        tmp[c * 4 + r] = sbox[state[((c + r) % 4) * 4 + r]];
+      }
+    }
+    // MixColumns (skipped in the final round)
+    if (round != 10) {
+      for (int c = 0; c < 4; c++) {
+        uint8_t* col = tmp + c * 4;
+        uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+        uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+        col[0] ^= all ^ xtime(a0 ^ a1);
+        col[1] ^= all ^ xtime(a1 ^ a2);
+        col[2] ^= all ^ xtime(a2 ^ a3);
+        col[3] ^= all ^ xtime(a3 ^ a0);
+      }
+    }
+    memcpy(state, tmp, 16);
+    addRoundKey(state, schedule + round * 16);
+  }
+
+  memcpy(output, state, 16);
+  cryptoStats.blocksEncrypted++;
+}
+
+void AES128::decryptBlock(uint8_t* output, const uint8_t* input) {
+  uint8_t state[16];
+  memcpy(state, input, 16);
+  addRoundKey(state, schedule + 160);
+
+  for (int round = 9; round >= 0; round--) {
+    uint8_t tmp[16];
+    // InvShiftRows + InvSubBytes
+    for (int c = 0; c < 4; c++) {
+      for (int r = 0; r < 4; r++) {
+        tmp[((c + r) % 4) * 4 + r] = invSbox[state[c * 4 + r]];
+      }
+    }
+    memcpy(state, tmp, 16);
+    addRoundKey(state, schedule + round * 16);
+    // InvMixColumns (skipped after the last round key)
+    if (round != 0) {
+      for (int c = 0; c < 4; c++) {
+        uint8_t* col = state + c * 4;
+        uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+        col[0] = mul(a0, 14) ^ mul(a1, 11) ^ mul(a2, 13) ^ mul(a3, 9);
+        col[1] = mul(a0, 9) ^ mul(a1, 14) ^ mul(a2, 11) ^ mul(a3, 13);
+        col[2] = mul(a0, 13) ^ mul(a1, 9) ^ mul(a2, 14) ^ mul(a3, 11);
+        col[3] = mul(a0, 11) ^ mul(a1, 13) ^ mul(a2, 9) ^ mul(a3, 14);
+      }
+    }
+  }
+
+  memcpy(output, state, 16);
+  cryptoStats.blocksDecrypted++;
+}
+
+void AES128::clear() {
+  memset(schedule, 0, sizeof(schedule));
+}
@@ -0,0 +1,367 @@
+// Simulated Arduino core: virtual clock, event queue, digital I/O,
+// interrupts, random numbers and the sketch serial consoles
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <ucontext.h>
+#include <chrono>
+#include <map>
+#include <functional>
+#include <vector>
+#include "sim.h"
+#include "sim_internal.h"
+
+// === Virtual clock, event queue and sketch contexts ===
+// Each sketch runs in its own ucontext. Whenever a sketch waits on the
+// clock (delay, blocking I/O) it yields to the scheduler, which lets the
+// other sketches and pending events run up to the sketch's wake time.
+// Sketches therefore interleave exactly as separate boards would
+
+static uint64_t nowMicros = 0;
+static std::multimap<uint64_t, std::function<void()>> events;
+static bool interruptsEnabled = true;
+static bool inEventHandler = false;
+
+struct SimSketch {
+  const char* name;
+  void (*setup)();
+  void (*loop)();
+  ucontext_t context;
+  std::vector<char> stack;
+  uint64_t wakeAt = 0;
+  unsigned long loops = 0;
+  double cpuNanos = 0;
+  double maxLoopNanos = 0;
+  std::chrono::steady_clock::time_point sliceStart;
+};
+
+static const size_t SKETCH_STACK_SIZE = 256 * 1024;
+static const uint64_t SKETCH_IDLE_TICK_US = 100;
+
+static std::vector<SimSketch*> sketches;
+static SimSketch* currentSketch = nullptr;
+static ucontext_t schedulerContext;
+
+uint64_t simNowMicros() {
+  return nowMicros;
+}
+
+// Move the clock forward, firing every scheduled event that falls inside
+// the interval in time order. Events run "in interrupt context": they may
+// schedule further events but never wait on the clock themselves
+static void advanceClockTo(uint64_t target) {
+  while (!events.empty() && events.begin()->first <= target) {
+    auto it = events.begin();
+    if (it->first > nowMicros) nowMicros = it->first;
+    std::function<void()> fn = it->second;
+    events.erase(it);
+    fn();
+  }
+  if (target > nowMicros) nowMicros = target;
+}
+
+static double sliceNanos(const SimSketch* sketch) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() -
+                                                  sketch->sliceStart).count();
+}
+
+// Wait on the virtual clock. Inside a sketch this yields to the scheduler;
+// from the driver it simply advances the clock; from an event handler
+// (interrupt context) it is ignored, as ISR time is not modelled
+void simAdvanceMicros(uint64_t us) {
+  if (currentSketch) {
+    SimSketch* self = currentSketch;
+    self->wakeAt = nowMicros + us;
+    self->cpuNanos += sliceNanos(self);
+    swapcontext(&self->context, &schedulerContext);
+    return;
+  }
+  if (!inEventHandler) advanceClockTo(nowMicros + us);
+}
+
+static void sketchEntry() {
+  SimSketch* self = currentSketch;
+  self->setup();
+  for (;;) {
+    double before = self->cpuNanos + sliceNanos(self);
+    self->loop();
+    double cost = self->cpuNanos + sliceNanos(self) - before;
+    if (cost > self->maxLoopNanos) self->maxLoopNanos = cost;
+    self->loops++;
+    simAdvanceMicros(SKETCH_IDLE_TICK_US);
+  }
+}
+
+void simAddSketch(const char* name, void (*setup)(), void (*loop)()) {
+  SimSketch* sketch = new SimSketch();
+  sketch->name = name;
+  sketch->setup = setup;
+  sketch->loop = loop;
+  sketch->stack.resize(SKETCH_STACK_SIZE);
+  sketch->wakeAt = nowMicros;
+  getcontext(&sketch->context);
+  sketch->context.uc_stack.ss_sp = sketch->stack.data();
+  sketch->context.uc_stack.ss_size = sketch->stack.size();
+  sketch->context.uc_link = nullptr;
+  makecontext(&sketch->context, sketchEntry, 0);
+  sketches.push_back(sketch);
+}
+
+// Run every sketch until the clock reaches 'untilMicros'
+// Always resumes the sketch with the earliest wake time; ties go to the
+// sketch registered first
+void simRun(uint64_t untilMicros) {
+  for (;;) {
+    SimSketch* next = nullptr;
+    for (SimSketch* sketch : sketches) {
+      if (!next || sketch->wakeAt < next->wakeAt) next = sketch;
+    }
+    if (!next || next->wakeAt > untilMicros) {
+      advanceClockTo(untilMicros);
+      return;
+    }
+    advanceClockTo(next->wakeAt);
+    currentSketch = next;
+    next->sliceStart = std::chrono::steady_clock::now();
+    swapcontext(&schedulerContext, &next->context);
+    currentSketch = nullptr;
+  }
+}
+
+SimSketchStats simSketchStats(const char* name) {
+  SimSketchStats stats;
+  for (SimSketch* sketch : sketches) {
+    if (strcmp(sketch->name, name) == 0) {
+      stats.loops = sketch->loops;
+      stats.cpuNanos = sketch->cpuNanos;
+      stats.maxLoopNanos = sketch->maxLoopNanos;
+    }
+  }
+  return stats;
+}
+
+void simSchedule(uint64_t atMicros, std::function<void()> fn) {
+  events.insert(std::make_pair(atMicros, [fn]() {
+    bool nested = inEventHandler;
+    inEventHandler = true;
+    fn();
+    inEventHandler = nested;
+  }));
+}
+
+bool simInterruptsEnabled() {
+  return interruptsEnabled;
+}
+
+unsigned long millis() {
+  return (unsigned long)(nowMicros / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)nowMicros;
+}
+
+void delay(unsigned long ms) {
+  simAdvanceMicros((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  simAdvanceMicros(us);
+}
+
+// === Digital I/O and interrupts ===
+
+static uint8_t pinModes[32];
+static uint8_t pinLevels[32];
+static void (*isrTable[2])() = { nullptr, nullptr };
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < 32) pinModes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin >= 32) return;
+  uint8_t previous = pinLevels[pin];
+  pinLevels[pin] = value ? HIGH : LOW;
+  simOnDigitalWrite(pin, previous, pinLevels[pin]);
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < 32 ? pinLevels[pin] : LOW;
+}
+
+// Drive an input pin from the simulated hardware and fire its interrupt
+void simSetInputLevel(uint8_t pin, uint8_t level) {
+  if (pin >= 32 || pinLevels[pin] == level) return;
+  pinLevels[pin] = level;
+  int irq = digitalPinToInterrupt(pin);
+  if (irq >= 0 && isrTable[irq] && interruptsEnabled) {
+    isrTable[irq]();
+  }
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*isr)(), int mode) {
+  (void)mode;
+  if (interruptNum < 2) isrTable[interruptNum] = isr;
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+  if (interruptNum < 2) isrTable[interruptNum] = nullptr;
+}
+
+void noInterrupts() {
+  interruptsEnabled = false;
+}
+
+void interrupts() {
+  interruptsEnabled = true;
+}
+
+// === Random numbers ===
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom() {
+  // xorshift32, deterministic for a given seed
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+void simSeed(unsigned long seed) {
+  rngState = seed ? (uint32_t)seed : 1;
+}
+
+float simNoise() {
+  return (nextRandom() % 20001) / 10000.0f - 1.0f;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) simSeed(seed);
+}
+
+long random(long howbig) {
+  return howbig <= 0 ? 0 : (long)(nextRandom() % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : random(howbig - howsmall) + howsmall;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+char* strupr(char* s) {
+  for (char* p = s; *p; p++) *p = toupper((unsigned char)*p);
+  return s;
+}
+
+// === Serial consoles ===
+
+static bool serialEcho = true;
+
+void simSetSerialEcho(bool echo) {
+  serialEcho = echo;
+}
+
+HardwareSerial Serial("node");
+
+void HardwareSerial::begin(unsigned long baud) {
+  this->baud = baud;
+  written = 0;
+}
+
+int HardwareSerial::available() {
+  return input.length() - inputPos;
+}
+
+int HardwareSerial::read() {
+  if (inputPos >= input.length()) return -1;
+  return (unsigned char)input[inputPos++];
+}
+
+int HardwareSerial::peek() {
+  if (inputPos >= input.length()) return -1;
+  return (unsigned char)input[inputPos];
+}
+
+// Write one byte to the simulated UART
+// Models the 64-byte AVR transmit buffer: once more than a buffer's worth
+// of bytes is waiting for the wire, the caller stalls on the virtual clock
+size_t HardwareSerial::write(uint8_t c) {
+  written++;
+
+  if (baud > 0) {
+    uint64_t byteMicros = 10000000ULL / baud;
+    uint64_t now = simNowMicros();
+    if (txBusyUntil < now) txBusyUntil = now;
+    txBusyUntil += byteMicros;
+    uint64_t bufferMicros = 64 * byteMicros;
+    if (txBusyUntil - now > bufferMicros) {
+      simAdvanceMicros(txBusyUntil - now - bufferMicros);
+    }
+  }
+
+  if (captureFile) fputc(c, captureFile);
+
+  if (!serialEcho) return 1;
+  if (c == '\n') {
+    printf("%10.3f [%s] %s\n", simNowMicros() / 1e6, tag, line.c_str());
+    line.clear();
+  } else if (c != '\r') {
+    line.push_back((char)c);
+  }
+  return 1;
+}
+
+void HardwareSerial::inject(const char* text) {
+  input.erase(0, inputPos);
+  inputPos = 0;
+  input += text;
+}
+
+// === Stream helpers ===
+
+int Stream::timedRead() {
+  uint64_t start = simNowMicros();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    simAdvanceMicros(100);
+  } while (simNowMicros() - start < (uint64_t)timeoutMs * 1000);
+  return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) break;
+    *buffer++ = (char)c;
+    count++;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+  size_t index = 0;
+  while (index < length) {
+    int c = timedRead();
+    if (c < 0 || c == terminator) break;
+    *buffer++ = (char)c;
+    index++;
+  }
+  return index;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String ret;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    ret += (char)c;
+    c = timedRead();
+  }
+  return ret;
+}
@@ -0,0 +1,266 @@
+// Simulated GPS receiver on a SoftwareSerial port, plus the TinyGPS++
+// replacement that parses its output
+
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+#include <TinyGPS++.h>
+#include <stdio.h>
+#include "sim.h"
+
+// === NMEA generator ===
+// The module emits one $GPGGA and one $GPRMC sentence at the top of every
+// second; bytes go out back to back at the configured baud rate
+
+static std::string burst;
+static size_t burstPos = 0;
+static uint64_t burstSecond = 0;
+static bool burstStarted = false;
+
+static void appendSentence(std::string& out, const char* body) {
+  uint8_t checksum = 0;
+  for (const char* p = body; *p; p++) checksum ^= (uint8_t)*p;
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", checksum);
+  out += "$";
+  out += body;
+  out += tail;
+}
+
+static void formatCoordinate(char* out, size_t size, double value, int degreeDigits,
+                             char positive, char negative) {
+  char hemisphere = value < 0 ? negative : positive;
+  value = fabs(value);
+  int degrees = (int)value;
+  double minutes = (value - degrees) * 60.0;
+  snprintf(out, size, "%0*d%08.5f,%c", degreeDigits, degrees, minutes, hemisphere);
+}
+
+static void buildBurst(uint64_t second) {
+  const SimEnvironment& env = simEnvironment();
+  unsigned long t = (unsigned long)(second % 86400);
+  char hhmmss[16];
+  snprintf(hhmmss, sizeof(hhmmss), "%02lu%02lu%02lu.00", t / 3600, (t / 60) % 60, t % 60);
+  unsigned long day = 17 + (unsigned long)(second / 86400);
+
+  char lat[24], lng[24], body[128];
+  formatCoordinate(lat, sizeof(lat), env.latitude, 2, 'N', 'S');
+  formatCoordinate(lng, sizeof(lng), env.longitude, 3, 'E', 'W');
+
+  burst.clear();
+  if (env.gpsFix) {
+    snprintf(body, sizeof(body), "GPGGA,%s,%s,%s,1,08,0.9,12.4,M,39.0,M,,", hhmmss, lat, lng);
+    appendSentence(burst, body);
+    snprintf(body, sizeof(body), "GPRMC,%s,A,%s,%s,0.52,%.1f,%02lu1026,,,A", hhmmss, lat, lng,
+             env.headingDeg, day);
+    appendSentence(burst, body);
+  } else {
+    snprintf(body, sizeof(body), "GPGGA,%s,,,,,0,00,99.9,,M,,M,,", hhmmss);
+    appendSentence(burst, body);
+    snprintf(body, sizeof(body), "GPRMC,%s,V,,,,,,,%02lu1026,,,N", hhmmss, day);
+    appendSentence(burst, body);
+  }
+  burstPos = 0;
+  burstSecond = second;
+}
+
+// === SoftwareSerial ===
+
+SoftwareSerial::SoftwareSerial(uint8_t rxPin, uint8_t txPin, bool inverseLogic) {
+  (void)rxPin;
+  (void)txPin;
+  (void)inverseLogic;
+}
+
+void SoftwareSerial::begin(long speed) {
+  baud = speed;
+  head = tail = 0;
+  // The first sentence the firmware can see starts at the next second
+  burstStarted = false;
+  lastFill = micros();
+}
+
+// Move every byte that has arrived on the wire since the last call into
+// the receive buffer. Arrivals while the buffer is full are dropped
+void SoftwareSerial::fill() {
+  if (baud <= 0) return;
+  uint64_t now = simNowMicros();
+  double byteMicros = 10e6 / baud;
+
+  if (!burstStarted) {
+    buildBurst(now / 1000000 + 1);
+    burstStarted = true;
+  }
+
+  while (true) {
+    if (burstPos >= burst.size()) {
+      uint64_t next = burstSecond + 1;
+      if (next * 1000000 > now) break;
+      buildBurst(next);
+    }
+    uint64_t arrival = burstSecond * 1000000 + (uint64_t)((burstPos + 1) * byteMicros);
+    if (arrival > now) break;
+
+    uint8_t c = (uint8_t)burst[burstPos++];
+    int next = (tail + 1) % RX_BUFFER_SIZE;
+    if (next == head) {
+      overflowFlag = true;
+      dropped++;
+    } else {
+      buffer[tail] = c;
+      tail = next;
+      delivered++;
+    }
+  }
+  lastFill = (unsigned long)now;
+}
+
+bool SoftwareSerial::overflow() {
+  fill();
+  bool ret = overflowFlag;
+  overflowFlag = false;
+  return ret;
+}
+
+int SoftwareSerial::available() {
+  fill();
+  return (tail + RX_BUFFER_SIZE - head) % RX_BUFFER_SIZE;
+}
+
+int SoftwareSerial::read() {
+  fill();
+  if (head == tail) return -1;
+  uint8_t c = buffer[head];
+  head = (head + 1) % RX_BUFFER_SIZE;
+  return c;
+}
+
+int SoftwareSerial::peek() {
+  fill();
+  return head == tail ? -1 : buffer[head];
+}
+
+size_t SoftwareSerial::write(uint8_t byte) {
+  (void)byte;
+  // Transmit is bit-banged with interrupts off: one byte time per byte
+  if (baud > 0) simAdvanceMicros(10000000ULL / baud);
+  return 1;
+}
+
+// === TinyGPS++ ===
+
+static bool parseTime(const char* field, uint32_t& out) {
+  if (strlen(field) < 6) return false;
+  double t = atof(field);
+  out = (uint32_t)(t * 100 + 0.5);
+  return true;
+}
+
+static bool parseCoordinate(const char* value, const char* hemisphere, int degreeDigits,
+                            double& out) {
+  if (!*value || !*hemisphere) return false;
+  char degrees[4] = { 0 };
+  memcpy(degrees, value, degreeDigits);
+  out = atoi(degrees) + atof(value + degreeDigits) / 60.0;
+  if (*hemisphere == 'S' || *hemisphere == 'W') out = -out;
+  return true;
+}
+
+bool TinyGPSPlus::encode(char c) {
+  chars++;
+  if (c == '$') {
+    inSentence = true;
+    length = 0;
+    return false;
+  }
+  if (!inSentence) return false;
+  if (c == '\r' || c == '\n') {
+    inSentence = false;
+    sentence[length] = 0;
+    return commitSentence();
+  }
+  if (length < sizeof(sentence) - 1) {
+    sentence[length++] = c;
+  } else {
+    inSentence = false;
+  }
+  return false;
+}
+
+bool TinyGPSPlus::commitSentence() {
+  char* star = strchr(sentence, '*');
+  if (!star) return false;
+
+  uint8_t checksum = 0;
+  for (char* p = sentence; p < star; p++) checksum ^= (uint8_t)*p;
+  if (checksum != (uint8_t)strtol(star + 1, nullptr, 16)) {
+    failed++;
+    return false;
+  }
+  passed++;
+  *star = 0;
+
+  // Split on commas, keeping empty fields
+  const char* fields[20];
+  int count = 0;
+  fields[count++] = sentence;
+  for (char* p = sentence; *p && count < 20; p++) {
+    if (*p == ',') {
+      *p = 0;
+      fields[count++] = p + 1;
+    }
+  }
+
+  unsigned long now = millis();
+  if (strcmp(fields[0], "GPGGA") == 0 && count >= 10) {
+    uint32_t t;
+    if (parseTime(fields[1], t)) {
+      time.time = t;
+      time.valid = time.updated = true;
+      time.lastCommit = now;
+    }
+    satellites.val = atoi(fields[7]);
+    satellites.valid = satellites.updated = true;
+    hdop.val = (int32_t)(atof(fields[8]) * 100);
+    hdop.valid = hdop.updated = true;
+    double lat, lng;
+    if (atoi(fields[6]) > 0 && parseCoordinate(fields[2], fields[3], 2, lat) &&
+        parseCoordinate(fields[4], fields[5], 3, lng)) {
+      location.latitude = lat;
+      location.longitude = lng;
+      location.valid = location.updated = true;
+      location.lastCommit = now;
+      altitude.val = (int32_t)(atof(fields[9]) * 100);
+      altitude.valid = altitude.updated = true;
+      withFix++;
+    }
+    return true;
+  }
+
+  if (strcmp(fields[0], "GPRMC") == 0 && count >= 10) {
+    uint32_t t;
+    if (parseTime(fields[1], t)) {
+      time.time = t;
+      time.valid = time.updated = true;
+      time.lastCommit = now;
+    }
+    if (strlen(fields[9]) == 6) {
+      date.date = atol(fields[9]);
+      date.valid = date.updated = true;
+    }
+    double lat, lng;
+    if (fields[2][0] == 'A' && parseCoordinate(fields[3], fields[4], 2, lat) &&
+        parseCoordinate(fields[5], fields[6], 3, lng)) {
+      location.latitude = lat;
+      location.longitude = lng;
+      location.valid = location.updated = true;
+      location.lastCommit = now;
+      speed.val = (int32_t)(atof(fields[7]) * 100);
+      speed.valid = speed.updated = true;
+      course.val = (int32_t)(atof(fields[8]) * 100);
+      course.valid = course.updated = true;
+      withFix++;
+    }
+    return true;
+  }
+  return true;
+}
@@ -0,0 +1,77 @@
+// Simulated ArduinoJson: flat objects serialized in insertion order
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+
+void JsonDocument::set(const char* key, const char* json) {
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(keys[i], key) == 0) {
+      snprintf(values[i], sizeof(values[i]), "%s", json);
+      return;
+    }
+  }
+  if (count >= MAX_MEMBERS) return;
+  snprintf(keys[count], sizeof(keys[count]), "%s", key);
+  snprintf(values[count], sizeof(values[count]), "%s", json);
+  count++;
+}
+
+size_t JsonDocument::serialize(Print& out) const {
+  size_t n = out.print('{');
+  for (size_t i = 0; i < count; i++) {
+    if (i) n += out.print(',');
+    n += out.print('"');
+    n += out.print(keys[i]);
+    n += out.print("\":");
+    n += out.print(values[i]);
+  }
+  return n + out.print('}');
+}
+
+size_t serializeJson(const JsonDocument& doc, Print& out) {
+  return doc.serialize(out);
+}
+
+JsonMemberProxy& JsonMemberProxy::operator=(const char* value) {
+  char json[96];
+  size_t j = 0;
+  json[j++] = '"';
+  for (const char* p = value; *p && j < sizeof(json) - 3; p++) {
+    if (*p == '"' || *p == '\\') json[j++] = '\\';
+    json[j++] = *p;
+  }
+  json[j++] = '"';
+  json[j] = 0;
+  doc.set(key, json);
+  return *this;
+}
+
+JsonMemberProxy& JsonMemberProxy::operator=(const String& value) {
+  return operator=(value.c_str());
+}
+
+JsonMemberProxy& JsonMemberProxy::operator=(bool value) {
+  doc.set(key, value ? "true" : "false");
+  return *this;
+}
+
+JsonMemberProxy& JsonMemberProxy::operator=(long value) {
+  char json[24];
+  snprintf(json, sizeof(json), "%ld", value);
+  doc.set(key, json);
+  return *this;
+}
+
+JsonMemberProxy& JsonMemberProxy::operator=(unsigned long value) {
+  char json[24];
+  snprintf(json, sizeof(json), "%lu", value);
+  doc.set(key, json);
+  return *this;
+}
+
+JsonMemberProxy& JsonMemberProxy::operator=(double value) {
+  char json[32];
+  snprintf(json, sizeof(json), "%.7g", value);
+  doc.set(key, json);
+  return *this;
+}
@@ -0,0 +1,325 @@
+// Simulated SX127x radios and the air between them
+
+#include <Arduino.h>
+#include <LoRa.h>
+#include <vector>
+#include "sim.h"
+#include "sim_internal.h"
+
+static SimLinkConfig linkConfig;
+static SimLinkStats linkStats;
+
+SimLinkConfig& simLinkConfig() {
+  return linkConfig;
+}
+
+SimLinkStats& simLinkStats() {
+  return linkStats;
+}
+
+// Time-on-air per the SX1276 datasheet (section 4.1.1.7), explicit header
+// Low data rate optimization is enabled when a symbol exceeds 16 ms,
+// matching what the arduino-LoRa library configures
+uint64_t simTimeOnAirMicros(size_t payloadLen, int sf, long bandwidth, int cr4,
+                            long preamble, bool crc) {
+  double symbolMicros = (double)(1L << sf) * 1e6 / bandwidth;
+  int lowDataRate = symbolMicros > 16000 ? 1 : 0;
+  double preambleMicros = (preamble + 4.25) * symbolMicros;
+
+  double numerator = 8.0 * payloadLen - 4.0 * sf + 28 + 16 * (crc ? 1 : 0);
+  double denominator = 4.0 * (sf - 2 * lowDataRate);
+  double blocks = ceil(numerator / denominator);
+  if (blocks < 0) blocks = 0;
+  double payloadSymbols = 8 + blocks * cr4;
+
+  return (uint64_t)(preambleMicros + payloadSymbols * symbolMicros);
+}
+
+// Lowest SNR the SX1276 can demodulate at each spreading factor (datasheet
+// table 13); weaker packets are lost no matter how quiet the channel is
+float simDemodulationFloor(int sf) {
+  static const float floors[] = { -7.5f, -10.0f, -12.5f, -15.0f, -17.5f, -20.0f };
+  if (sf < 7) sf = 7;
+  if (sf > 12) sf = 12;
+  return floors[sf - 7];
+}
+
+// === Air ===
+
+struct Transmission {
+  const LoRaClass* sender;
+  long frequency;
+  int spreadingFactor;
+  long bandwidth;
+  int syncWord;
+  bool invertIQ;
+  uint64_t start;
+  uint64_t end;
+  bool collided;
+};
+
+class SimAir {
+public:
+  static std::vector<LoRaClass*>& radios() {
+    static std::vector<LoRaClass*> list;
+    return list;
+  }
+
+  static std::vector<Transmission>& inFlight() {
+    static std::vector<Transmission> list;
+    return list;
+  }
+
+  static bool sameChannel(const LoRaClass* a, const Transmission& t) {
+    return a->frequency == t.frequency && a->spreadingFactor == t.spreadingFactor &&
+           a->bandwidth == t.bandwidth;
+  }
+
+  static bool canHear(const LoRaClass* radio, const Transmission& t) {
+    return radio != t.sender && radio->isListening() && sameChannel(radio, t) &&
+           radio->syncWord == t.syncWord && radio->invertIQ == t.invertIQ;
+  }
+
+  // Start a transmission from 'sender' and schedule its delivery
+  static uint64_t transmit(LoRaClass* sender) {
+    uint64_t now = simNowMicros();
+    uint64_t toa = simTimeOnAirMicros(sender->txLength, sender->spreadingFactor,
+                                      sender->bandwidth, sender->codingRate,
+                                      sender->preambleLength, sender->crc);
+
+    Transmission t = { sender, sender->frequency, sender->spreadingFactor, sender->bandwidth,
+                       sender->syncWord, sender->invertIQ, now, now + toa, false };
+
+    // Overlapping packets on the same channel destroy each other
+    std::vector<Transmission>& flights = inFlight();
+    for (size_t i = 0; i < flights.size(); i++) {
+      if (flights[i].end > now && flights[i].frequency == t.frequency &&
+          flights[i].spreadingFactor == t.spreadingFactor && flights[i].bandwidth == t.bandwidth) {
+        flights[i].collided = true;
+        t.collided = true;
+      }
+    }
+    flights.push_back(t);
+
+    // Radios must be listening when the preamble starts to lock on
+    std::vector<LoRaClass*> receivers;
+    for (LoRaClass* radio : radios()) {
+      if (canHear(radio, t)) receivers.push_back(radio);
+    }
+
+    std::vector<uint8_t> payload(sender->txBuffer, sender->txBuffer + sender->txLength);
+    linkStats.packetsSent++;
+    linkStats.bytesSent += payload.size();
+    linkStats.airtimeMs += toa / 1000.0;
+
+    int sf = sender->spreadingFactor;
+    simSchedule(now + toa, [sender, receivers, payload, now, sf]() {
+      bool collided = false;
+      std::vector<Transmission>& flights = inFlight();
+      for (size_t i = 0; i < flights.size(); i++) {
+        if (flights[i].sender == sender && flights[i].start == now) {
+          collided = flights[i].collided;
+          flights.erase(flights.begin() + i);
+          break;
+        }
+      }
+
+      sender->mode = LoRaClass::MODE_STANDBY;
+      if (sender->onTxDoneCallback) sender->onTxDoneCallback();
+
+      for (LoRaClass* radio : receivers) {
+        bool lost = collided || linkConfig.snr < simDemodulationFloor(sf) ||
+                    (simNoise() + 1.0f) / 2.0f < linkConfig.lossRate;
+        if (lost || !radio->isListening()) {
+          linkStats.packetsLost++;
+          continue;
+        }
+        linkStats.packetsDelivered++;
+        radio->deliver(payload.data(), payload.size(), linkConfig.rssi, linkConfig.snr);
+      }
+    });
+    return toa;
+  }
+
+  // Whether another radio is transmitting on the radio's channel, for
+  // rssi() and channel activity detection
+  static bool channelBusy(const LoRaClass* radio) {
+    uint64_t now = simNowMicros();
+    for (const Transmission& t : inFlight()) {
+      if (t.sender != radio && t.end > now && sameChannel(radio, t)) return true;
+    }
+    return false;
+  }
+};
+
+// === LoRaClass ===
+
+LoRaClass LoRa;
+
+LoRaClass::LoRaClass() {
+  SimAir::radios().push_back(this);
+}
+
+LoRaClass::~LoRaClass() {
+  std::vector<LoRaClass*>& list = SimAir::radios();
+  for (size_t i = 0; i < list.size(); i++) {
+    if (list[i] == this) {
+      list.erase(list.begin() + i);
+      break;
+    }
+  }
+}
+
+int LoRaClass::begin(long frequency) {
+  this->frequency = frequency;
+  begun = true;
+  mode = MODE_STANDBY;
+  return 1;
+}
+
+void LoRaClass::end() {
+  begun = false;
+  mode = MODE_SLEEP;
+}
+
+bool LoRaClass::isListening() const {
+  return begun && (mode == MODE_RX_SINGLE || mode == MODE_RX_CONTINUOUS);
+}
+
+int LoRaClass::beginPacket(int implicitHeader) {
+  (void)implicitHeader;
+  if (mode == MODE_TX) return 0;
+  mode = MODE_STANDBY;
+  txLength = 0;
+  return 1;
+}
+
+int LoRaClass::endPacket(bool async) {
+  mode = MODE_TX;
+  uint64_t toa = SimAir::transmit(this);
+  if (!async) {
+    // Blocking transmit: the library polls the TX-done flag
+    simAdvanceMicros(toa);
+  }
+  return 1;
+}
+
+size_t LoRaClass::write(uint8_t byte) {
+  return write(&byte, 1);
+}
+
+size_t LoRaClass::write(const uint8_t* buffer, size_t size) {
+  if (txLength + size > sizeof(txBuffer)) size = sizeof(txBuffer) - txLength;
+  memcpy(txBuffer + txLength, buffer, size);
+  txLength += size;
+  return size;
+}
+
+int LoRaClass::parsePacket(int size) {
+  (void)size;
+  if (rxPending) {
+    memcpy(rxBuffer, pendingBuffer, pendingLength);
+    rxLength = pendingLength;
+    rxIndex = 0;
+    lastRssi = pendingRssi;
+    lastSnr = pendingSnr;
+    rxPending = false;
+    mode = MODE_STANDBY;
+    return (int)rxLength;
+  }
+  if (mode != MODE_RX_SINGLE && mode != MODE_TX) {
+    mode = MODE_RX_SINGLE;
+  }
+  return 0;
+}
+
+void LoRaClass::deliver(const uint8_t* data, size_t len, int rssi, float snr) {
+  if (mode == MODE_RX_CONTINUOUS && onReceiveCallback) {
+    // DIO0 interrupt: the packet is readable from inside the callback
+    memcpy(rxBuffer, data, len);
+    rxLength = len;
+    rxIndex = 0;
+    lastRssi = rssi;
+    lastSnr = snr;
+    if (simInterruptsEnabled()) onReceiveCallback((int)len);
+    return;
+  }
+
+  // Single receive: the FIFO holds the packet until parsePacket() collects it
+  memcpy(pendingBuffer, data, len);
+  pendingLength = len;
+  pendingRssi = rssi;
+  pendingSnr = snr;
+  rxPending = true;
+  if (mode == MODE_RX_SINGLE) mode = MODE_STANDBY;
+}
+
+int LoRaClass::packetRssi() {
+  return lastRssi;
+}
+
+float LoRaClass::packetSnr() {
+  return lastSnr;
+}
+
+int LoRaClass::rssi() {
+  if (SimAir::channelBusy(this)) return linkConfig.rssi;
+  return -120 + (int)(simNoise() * 3);
+}
+
+int LoRaClass::available() {
+  return (int)(rxLength - rxIndex);
+}
+
+int LoRaClass::read() {
+  if (rxIndex >= rxLength) return -1;
+  return rxBuffer[rxIndex++];
+}
+
+int LoRaClass::peek() {
+  if (rxIndex >= rxLength) return -1;
+  return rxBuffer[rxIndex];
+}
+
+void LoRaClass::onReceive(void (*callback)(int)) {
+  onReceiveCallback = callback;
+}
+
+void LoRaClass::onTxDone(void (*callback)()) {
+  onTxDoneCallback = callback;
+}
+
+void LoRaClass::onCadDone(void (*callback)(boolean)) {
+  onCadDoneCallback = callback;
+}
+
+// CAD listens for two symbols; any transmission on the channel at either
+// end of the detection counts as activity. The FIFO is left untouched
+void LoRaClass::channelActivityDetection() {
+  mode = MODE_CAD;
+  bool busyAtStart = SimAir::channelBusy(this);
+  uint64_t symbolMicros = (uint64_t)((double)(1L << spreadingFactor) * 1e6 / bandwidth);
+  simSchedule(simNowMicros() + 2 * symbolMicros, [this, busyAtStart]() {
+    if (mode != MODE_CAD) return;
+    mode = MODE_STANDBY;
+    bool detected = busyAtStart || SimAir::channelBusy(this);
+    if (onCadDoneCallback) onCadDoneCallback(detected);
+  });
+}
+
+void LoRaClass::receive(int size) {
+  (void)size;
+  mode = MODE_RX_CONTINUOUS;
+}
+
+void LoRaClass::idle() {
+  mode = MODE_STANDBY;
+}
+
+void LoRaClass::sleep() {
+  mode = MODE_SLEEP;
+}
+
+byte LoRaClass::random() {
+  return (byte)::random(256);
+}
@@ -0,0 +1,5 @@
+// Sensor node firmware compiled for the simulator
+// arduino/arduino.ino is built unchanged; its setup() and loop() are the
+// global sketch entry points, talking to the global Serial and LoRa
+
+#include "../../arduino/arduino.ino"
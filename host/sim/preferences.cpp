@@ -0,0 +1,78 @@
+// Simulated ESP32 NVS behind the Preferences library
+// Values live in the object for the life of the process
+
+#include <Preferences.h>
+#include <string.h>
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partitionLabel) {
+  (void)partitionLabel;
+  if (name == NULL || strlen(name) > MAX_KEY) {
+    return false;
+  }
+  started = true;
+  this->readOnly = readOnly;
+  return true;
+}
+
+void Preferences::end() {
+  started = false;
+}
+
+Preferences::Entry* Preferences::find(const char* key) {
+  if (!started || key == NULL || strlen(key) > MAX_KEY) {
+    return NULL;
+  }
+  for (int i = 0; i < MAX_ENTRIES; i++) {
+    if (entries[i].used && strcmp(entries[i].key, key) == 0) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!started || readOnly || key == NULL || strlen(key) > MAX_KEY || len > MAX_VALUE) {
+    return 0;
+  }
+  Entry* entry = find(key);
+  for (int i = 0; entry == NULL && i < MAX_ENTRIES; i++) {
+    if (!entries[i].used) {
+      entry = &entries[i];
+      entry->used = true;
+      strcpy(entry->key, key);
+    }
+  }
+  if (entry == NULL) {
+    return 0;   // NVS full
+  }
+  entry->length = len;
+  memcpy(entry->value, value, len);
+  return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  Entry* entry = find(key);
+  if (entry == NULL || entry->length > maxLen) {
+    return 0;
+  }
+  memcpy(buf, entry->value, entry->length);
+  return entry->length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  Entry* entry = find(key);
+  return entry != NULL ? entry->length : 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  return find(key) != NULL;
+}
+
+bool Preferences::remove(const char* key) {
+  Entry* entry = find(key);
+  if (entry == NULL || readOnly) {
+    return false;
+  }
+  entry->used = false;
+  return true;
+}
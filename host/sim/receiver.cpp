@@ -0,0 +1,20 @@
+// Receiver firmware compiled for the simulator
+// The sketch is wrapped in its own namespace with a private Serial console
+// and LoRa radio, so it runs in the same process as the sensor node and
+// hears the node's packets over the simulated air
+
+#include <SPI.h>
+#include <LoRa.h>
+#include <Crypto.h>
+#include <AES.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+
+namespace receiver {
+
+HardwareSerial Serial("rx");
+LoRaClass LoRa;
+
+#include "../../LoRaReceiver_encrypted/LoRaReceiver_encrypted.ino"
+
+}  // namespace receiver
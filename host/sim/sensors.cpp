@@ -0,0 +1,233 @@
+// Simulated sensors: analog probes, DS18B20, HMC5883, HC-SR04, ORP
+// and the on-chip EEPROM. Models are driven by simEnvironment()
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <EEPROM.h>
+#include <DallasTemperature.h>
+#include <Adafruit_HMC5883_U.h>
+#include <orp_surveyor.h>
+#include "sim.h"
+#include "sim_internal.h"
+#include "../../arduino/pins.h"
+
+static SimEnvironment environment;
+
+SimEnvironment& simEnvironment() {
+  return environment;
+}
+
+TwoWire Wire;
+
+void clean(void* dest, size_t size) {
+  memset(dest, 0, size);
+}
+
+// === Analog probes ===
+
+// Convert a probe voltage to a noisy 10-bit ADC count
+static int voltageToAdc(float volts) {
+  float counts = volts / 5.0f * 1023.0f + simNoise() * environment.analogNoiseLsb;
+  int raw = (int)lroundf(counts);
+  return constrain(raw, 0, 1023);
+}
+
+int analogRead(uint8_t pin) {
+  // One ADC conversion takes ~112 us on a 16 MHz AVR
+  simAdvanceMicros(112);
+
+  if (pin == TDS_PIN) return voltageToAdc(environment.tdsVoltage);
+  if (pin == PH_PIN) return voltageToAdc(environment.phVoltage);
+  if (pin == A2) return voltageToAdc(environment.orpVoltage);
+  return 0;
+}
+
+// === HC-SR04 ultrasonic ranger ===
+
+// Round-trip echo time in microseconds for the current obstacle distance
+// Speed of sound follows the simulated temperature (331.3 + 0.606 * T m/s)
+static unsigned long echoMicros() {
+  if (environment.obstacleCm <= 0) return 0;
+  float speed = 331.3f + 0.606f * environment.waterTempC;
+  return (unsigned long)(2.0f * environment.obstacleCm / 100.0f / speed * 1e6f);
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout) {
+  (void)state;
+  if (pin != ECHO_PIN) {
+    simAdvanceMicros(timeout);
+    return 0;
+  }
+
+  // Echo line rises ~450 us after the trigger burst, then stays high for the flight time
+  unsigned long echo = echoMicros();
+  if (echo == 0 || echo + 450 > timeout) {
+    simAdvanceMicros(timeout);
+    return 0;
+  }
+  simAdvanceMicros(450 + echo);
+  return echo;
+}
+
+// A falling edge on the trigger pin starts a ping: schedule the echo pulse
+// so interrupt-driven firmware sees both edges on the echo pin
+void simOnDigitalWrite(uint8_t pin, uint8_t previous, uint8_t level) {
+  if (pin != TRIG_PIN || previous != HIGH || level != LOW) return;
+
+  unsigned long echo = echoMicros();
+  uint64_t rise = simNowMicros() + 450;
+  // With no obstacle the module holds echo high for its ~38 ms timeout
+  uint64_t fall = rise + (echo ? echo : 38000);
+  simSchedule(rise, []() { simSetInputLevel(ECHO_PIN, HIGH); });
+  simSchedule(fall, []() { simSetInputLevel(ECHO_PIN, LOW); });
+}
+
+// === DS18B20 temperature probe ===
+
+uint8_t DallasTemperature::getDeviceCount() {
+  return environment.waterTempC < -100 ? 0 : 1;
+}
+
+int16_t DallasTemperature::millisToWaitForConversion(uint8_t bitResolution) {
+  switch (bitResolution) {
+    case 9: return 94;
+    case 10: return 188;
+    case 11: return 375;
+    default: return 750;
+  }
+}
+
+void DallasTemperature::requestTemperatures() {
+  // Bus reset and convert-T command take ~3 ms on the OneWire bus
+  simAdvanceMicros(3000);
+  conversionStart = millis();
+  converting = true;
+  if (waitForConversion) {
+    delay(millisToWaitForConversion(resolution));
+    converting = false;
+  }
+}
+
+bool DallasTemperature::requestTemperaturesByIndex(uint8_t index) {
+  (void)index;
+  requestTemperatures();
+  return getDeviceCount() > 0;
+}
+
+bool DallasTemperature::isConversionComplete() {
+  return !converting ||
+         millis() - conversionStart >= (unsigned long)millisToWaitForConversion(resolution);
+}
+
+float DallasTemperature::getTempCByIndex(uint8_t index) {
+  (void)index;
+  // Reading the 9-byte scratchpad takes ~6 ms at OneWire speed
+  simAdvanceMicros(6000);
+  if (getDeviceCount() == 0) return DEVICE_DISCONNECTED_C;
+  converting = false;
+  // Quantize to the 1/16 degC step of a 12-bit conversion
+  return roundf(environment.waterTempC * 16.0f) / 16.0f;
+}
+
+// === HMC5883 magnetometer ===
+
+// Hard-iron offset and scale of the simulated unit, matching the
+// calibration constants measured on the reference hardware
+static const float MAG_CENTER_X = 7.86f;
+static const float MAG_CENTER_Y = -11.73f;
+static const float MAG_HALF_X = 35.50f;
+static const float MAG_HALF_Y = 36.09f;
+static const float MAG_DECLINATION = 0.009f;
+
+bool Adafruit_HMC5883_Unified::begin() {
+  return true;
+}
+
+bool Adafruit_HMC5883_Unified::getEvent(sensors_event_t* event) {
+  // One I2C register burst read at 100 kHz
+  simAdvanceMicros(700);
+
+  memset(event, 0, sizeof(*event));
+  event->sensor_id = sensorID;
+  event->timestamp = millis();
+
+  // Turn the hull by the time elapsed since the previous reading
+  static uint64_t lastReadMicros = 0;
+  uint64_t now = simNowMicros();
+  if (environment.turnRateDps != 0.0f && lastReadMicros != 0) {
+    float heading = environment.headingDeg + environment.turnRateDps * (now - lastReadMicros) / 1e6f;
+    environment.headingDeg = fmodf(heading + 360.0f, 360.0f);
+  }
+  lastReadMicros = now;
+
+  float magnetic = environment.headingDeg * (float)DEG_TO_RAD - MAG_DECLINATION;
+  event->magnetic.x = MAG_CENTER_X + MAG_HALF_X * cosf(magnetic) + simNoise() * environment.magNoiseUt;
+  event->magnetic.y = MAG_CENTER_Y + MAG_HALF_Y * sinf(magnetic) + simNoise() * environment.magNoiseUt;
+  event->magnetic.z = -20.0f + simNoise() * environment.magNoiseUt;
+  return true;
+}
+
+// === Surveyor ORP probe ===
+
+// EEPROM layout used by the Atlas Scientific library: magic byte then offset
+static const int ORP_EEPROM_ADDR = 0;
+static const uint8_t ORP_EEPROM_MAGIC = 0x03;
+
+bool Surveyor_ORP::begin() {
+  if (EEPROM.read(ORP_EEPROM_ADDR) == ORP_EEPROM_MAGIC) {
+    EEPROM.get(ORP_EEPROM_ADDR + 1, offset);
+  } else {
+    offset = 0;
+  }
+  return true;
+}
+
+float Surveyor_ORP::read_voltage() {
+  return analogRead(pin) * 5000.0f / 1024.0f;
+}
+
+float Surveyor_ORP::read_orp() {
+  return read_voltage() - 1500.0f - offset;
+}
+
+void Surveyor_ORP::cal(float value) {
+  offset = read_voltage() - 1500.0f - value;
+  EEPROM.write(ORP_EEPROM_ADDR, ORP_EEPROM_MAGIC);
+  EEPROM.put(ORP_EEPROM_ADDR + 1, offset);
+}
+
+void Surveyor_ORP::cal_clear() {
+  offset = 0;
+  EEPROM.write(ORP_EEPROM_ADDR, 0xFF);
+}
+
+// === EEPROM ===
+
+static uint8_t eepromCells[1024];
+static bool eepromErased = false;
+
+EEPROMClass EEPROM;
+
+static void eraseIfNeeded() {
+  if (!eepromErased) {
+    memset(eepromCells, 0xFF, sizeof(eepromCells));
+    eepromErased = true;
+  }
+}
+
+uint8_t EEPROMClass::read(int idx) {
+  eraseIfNeeded();
+  return (idx >= 0 && idx < 1024) ? eepromCells[idx] : 0xFF;
+}
+
+void EEPROMClass::write(int idx, uint8_t val) {
+  eraseIfNeeded();
+  if (idx < 0 || idx >= 1024) return;
+  // An EEPROM cell write takes 3.3 ms on the ATmega328P
+  simAdvanceMicros(3300);
+  eepromCells[idx] = val;
+}
+
+void EEPROMClass::update(int idx, uint8_t val) {
+  if (read(idx) != val) write(idx, val);
+}
@@ -0,0 +1,109 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+// Simulator control interface
+// The firmware never includes this header; it is used by the simulator
+// driver (sim_main.cpp) to set up the environment the sketches run in,
+// advance the virtual clock and read back measurements
+
+#include <stdint.h>
+#include <stddef.h>
+
+// === Virtual clock ===
+// All Arduino timing functions run on this clock, in microseconds
+uint64_t simNowMicros();
+void simAdvanceMicros(uint64_t us);
+
+// === Sketches ===
+// Each sketch (setup + loop pair) runs as if on its own board, sharing the
+// virtual clock and the simulated air with the other registered sketches
+void simAddSketch(const char* name, void (*setup)(), void (*loop)());
+
+// Run all sketches until the virtual clock reaches 'untilMicros'
+void simRun(uint64_t untilMicros);
+
+// Host CPU time spent inside a sketch, excluding time it spent waiting
+struct SimSketchStats {
+  unsigned long loops = 0;     // Completed loop() calls
+  double cpuNanos = 0;         // Total host time spent running the sketch
+  double maxLoopNanos = 0;     // Most expensive single loop() call
+};
+
+SimSketchStats simSketchStats(const char* name);
+
+// === Simulated environment ===
+// Water and surroundings the sensors are exposed to
+struct SimEnvironment {
+  float waterTempC = 24.5;     // DS18B20 reading, set below -100 to disconnect the probe
+  float phVoltage = 2.38;      // pH probe amplifier output in volts
+  float tdsVoltage = 0.42;     // TDS probe output in volts
+  float orpVoltage = 1.70;     // ORP probe output in volts (1.5 V = 0 mV)
+  float analogNoiseLsb = 2.0;  // Peak uniform noise added to each analog read, in ADC counts
+  float headingDeg = 73.0;     // True heading of the hull
+  float turnRateDps = 0.0;     // Rate the hull turns at, degrees per second (positive clockwise)
+  float magNoiseUt = 0.8;      // Peak uniform noise on each magnetometer axis
+  float obstacleCm = 22.0;     // Distance to the nearest obstacle, 0 for no echo
+  bool gpsFix = true;          // Whether the GPS reports a valid fix
+  double latitude = 35.681236;
+  double longitude = 139.767125;
+};
+
+SimEnvironment& simEnvironment();
+
+// === Simulated LoRa link ===
+struct SimLinkStats {
+  unsigned long packetsSent = 0;
+  unsigned long packetsDelivered = 0;
+  unsigned long packetsLost = 0;
+  unsigned long bytesSent = 0;
+  double airtimeMs = 0;  // Sum of time-on-air of every transmitted packet
+};
+
+struct SimLinkConfig {
+  int rssi = -96;           // RSSI reported for delivered packets
+  float snr = 7.5;          // SNR of every packet; below the SF's floor the packet is lost
+  float lossRate = 0.0;     // Probability that a packet is lost on air
+};
+
+SimLinkConfig& simLinkConfig();
+SimLinkStats& simLinkStats();
+
+// Lowest SNR in dB at which a packet sent with spreading factor 'sf' is
+// still demodulated; packets below it are counted as lost
+float simDemodulationFloor(int sf);
+
+// LoRa time-on-air in microseconds for a payload, per the SX127x datasheet
+uint64_t simTimeOnAirMicros(size_t payloadLen, int sf, long bandwidth, int cr4,
+                            long preamble, bool crc);
+
+// === Heap accounting ===
+// Every String allocation and reallocation goes through these counters
+struct SimHeapStats {
+  unsigned long allocations = 0;
+  unsigned long frees = 0;
+  long liveBytes = 0;
+  long peakBytes = 0;
+};
+
+SimHeapStats& simHeapStats();
+
+// === Crypto accounting ===
+// AES block operations performed by every AES128 instance
+struct SimCryptoStats {
+  unsigned long blocksEncrypted = 0;
+  unsigned long blocksDecrypted = 0;
+};
+
+SimCryptoStats& simCryptoStats();
+
+// === Serial output ===
+// Silences sketch serial output (statistics are still gathered)
+void simSetSerialEcho(bool echo);
+
+// Seed for the deterministic noise and random() generators
+void simSeed(unsigned long seed);
+
+// Uniform random value in [-1, 1] from the simulator's generator
+float simNoise();
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HOST_SIM_INTERNAL_H
+#define HOST_SIM_INTERNAL_H
+
+// Hooks shared between the simulated peripherals
+// Not part of the simulator control interface in sim.h
+
+#include <stdint.h>
+#include <functional>
+
+// Run 'fn' when the virtual clock reaches 'atMicros'
+void simSchedule(uint64_t atMicros, std::function<void()> fn);
+
+// Whether interrupts are currently enabled by the firmware
+bool simInterruptsEnabled();
+
+// Drive an input pin from simulated hardware, firing its interrupt on change
+void simSetInputLevel(uint8_t pin, uint8_t level);
+
+// Called on every digitalWrite so peripherals can react to output edges
+void simOnDigitalWrite(uint8_t pin, uint8_t previous, uint8_t level);
+
+// Count a heap allocation of 'bytes' (negative for a free)
+void simCountHeap(long bytes, bool isFree);
+
+#endif
@@ -0,0 +1,273 @@
+// Simulator driver
+// Runs the sensor node and the receiver sketches side by side on the
+// virtual clock and reports per-cycle CPU time, heap churn, encryption
+// work, airtime and GPS byte loss for the simulated interval
+//
+// Usage: mizuguna_sim [--seconds N] [--quiet] [--seed N] [--loss P]
+//                     [--rssi DBM] [--snr DB] [--snr-at SECONDS:DB]...
+//                     [--cmd SECONDS:TEXT]... [--rx-cmd SECONDS:TEXT]...
+//                     [--turn-at SECONDS:DPS]...
+//                     [--budget-allocs N] [--budget-loop-ns N] [--rx-capture FILE]
+//                     [--neighbours N] [--neighbour-period SECONDS]
+//
+// --snr-at changes the link SNR part way through the run, e.g. to watch
+// adaptive data rate step down and fall back when the link degrades
+// --cmd types a serial command on the node's console, --rx-cmd one on the
+// receiver's, e.g. "SET,1,REPORT,10000" to send the node a configuration
+// command over the air
+// --turn-at sets the rate the hull turns at from then on, e.g. to turn the
+// unit through full circles during a "CAL,MAG" compass calibration
+// --rx-capture writes the receiver's serial output to FILE byte for byte,
+// e.g. to feed host/ingest (JSON lines, or frames when the receiver is
+// built with RECEIVER_BINARY_OUTPUT)
+// --neighbours adds N other nodes sharing the channel, each sending a
+// 30-byte packet every --neighbour-period seconds (default 3) at a fixed
+// random phase, without listening first; the receiver does not decode
+// them, but they collide with the node's packets and its CAD hears them,
+// so the receiver's per-node loss shows what listen-before-talk saves.
+// Their packets are counted in the summary's link figures
+//
+// The budget options make the run exit with status 1 when the steady
+// state exceeds the given heap allocations per packet or mean host CPU
+// time per loop(), so performance regressions can fail a CI job
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "sim.h"
+#include "sim_internal.h"
+#include "../../arduino/gps.h"
+#include <LoRa.h>
+
+// Sensor node sketch entry points
+void setup();
+void loop();
+
+namespace receiver {
+extern HardwareSerial Serial;
+extern LoRaClass LoRa;
+void setup();
+void loop();
+}
+
+// Virtual time allowed for both sketches to complete setup()
+static const uint64_t SETTLE_MICROS = 1000000;
+
+struct ScheduledCommand {
+  double atSeconds;
+  std::string text;
+};
+
+struct ScheduledSnr {
+  double atSeconds;
+  float snr;
+};
+
+struct ScheduledTurn {
+  double atSeconds;
+  float degreesPerSecond;
+};
+
+// Interfering nodes added with --neighbours
+// They use inverted IQ, which the receiver does not demodulate, and
+// follow the node's data rate so they share its channel
+static std::vector<LoRaClass*> neighbours;
+
+static void neighbourTransmit(size_t index, uint64_t periodMicros) {
+  LoRaClass* radio = neighbours[index];
+  radio->setSpreadingFactor(LoRa.getSpreadingFactor());
+  radio->setCodingRate4(LoRa.getCodingRate4());
+  if (radio->beginPacket()) {
+    uint8_t packet[30] = { 0 };
+    radio->write(packet, sizeof(packet));
+    radio->endPacket(true);
+  }
+  simSchedule(simNowMicros() + periodMicros,
+              [index, periodMicros]() { neighbourTransmit(index, periodMicros); });
+}
+
+static void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [--seconds N] [--quiet] [--seed N] [--loss P] [--rssi DBM] [--snr DB]\n"
+          "          [--snr-at SECONDS:DB]... [--cmd SECONDS:TEXT]... [--rx-cmd SECONDS:TEXT]...\n"
+          "          [--turn-at SECONDS:DPS]...\n"
+          "          [--budget-allocs N] [--budget-loop-ns N] [--rx-capture FILE]\n"
+          "          [--neighbours N] [--neighbour-period SECONDS]\n",
+          argv0);
+}
+
+int main(int argc, char** argv) {
+  double seconds = 30;
+  unsigned long seed = 1;
+  double budgetAllocs = -1;
+  double budgetLoopNanos = -1;
+  std::vector<ScheduledCommand> commands;
+  std::vector<ScheduledCommand> rxCommands;
+  std::vector<ScheduledSnr> snrChanges;
+  std::vector<ScheduledTurn> turns;
+  FILE* rxCapture = nullptr;
+  int neighbourCount = 0;
+  double neighbourPeriod = 3;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--seconds" && hasValue) {
+      seconds = atof(argv[++i]);
+    } else if (arg == "--quiet") {
+      simSetSerialEcho(false);
+    } else if (arg == "--seed" && hasValue) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--loss" && hasValue) {
+      simLinkConfig().lossRate = (float)atof(argv[++i]);
+    } else if (arg == "--rssi" && hasValue) {
+      simLinkConfig().rssi = atoi(argv[++i]);
+    } else if (arg == "--snr" && hasValue) {
+      simLinkConfig().snr = (float)atof(argv[++i]);
+    } else if (arg == "--snr-at" && hasValue) {
+      std::string spec = argv[++i];
+      size_t colon = spec.find(':');
+      if (colon == std::string::npos) {
+        usage(argv[0]);
+        return 2;
+      }
+      snrChanges.push_back({ atof(spec.substr(0, colon).c_str()),
+                             (float)atof(spec.substr(colon + 1).c_str()) });
+    } else if (arg == "--turn-at" && hasValue) {
+      std::string spec = argv[++i];
+      size_t colon = spec.find(':');
+      if (colon == std::string::npos) {
+        usage(argv[0]);
+        return 2;
+      }
+      turns.push_back({ atof(spec.substr(0, colon).c_str()),
+                        (float)atof(spec.substr(colon + 1).c_str()) });
+    } else if (arg == "--rx-capture" && hasValue) {
+      rxCapture = fopen(argv[++i], "wb");
+      if (!rxCapture) {
+        perror(argv[i]);
+        return 2;
+      }
+      receiver::Serial.capture(rxCapture);
+    } else if (arg == "--budget-allocs" && hasValue) {
+      budgetAllocs = atof(argv[++i]);
+    } else if (arg == "--budget-loop-ns" && hasValue) {
+      budgetLoopNanos = atof(argv[++i]);
+    } else if (arg == "--neighbours" && hasValue) {
+      neighbourCount = atoi(argv[++i]);
+    } else if (arg == "--neighbour-period" && hasValue) {
+      neighbourPeriod = atof(argv[++i]);
+    } else if ((arg == "--cmd" || arg == "--rx-cmd") && hasValue) {
+      std::string spec = argv[++i];
+      size_t colon = spec.find(':');
+      if (colon == std::string::npos) {
+        usage(argv[0]);
+        return 2;
+      }
+      (arg == "--cmd" ? commands : rxCommands)
+          .push_back({ atof(spec.substr(0, colon).c_str()), spec.substr(colon + 1) + "\r" });
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  simSeed(seed);
+  simAddSketch("node", setup, loop);
+  simAddSketch("rx", receiver::setup, receiver::loop);
+
+  uint64_t neighbourPeriodMicros = (uint64_t)(neighbourPeriod * 1e6);
+  for (int i = 0; i < neighbourCount; i++) {
+    LoRaClass* radio = new LoRaClass();
+    radio->begin(433E6);
+    radio->setSignalBandwidth(125E3);
+    radio->setSyncWord(0x34);
+    radio->enableCrc();
+    radio->enableInvertIQ();
+    neighbours.push_back(radio);
+
+    size_t index = neighbours.size() - 1;
+    uint64_t phase = (uint64_t)random((long)(neighbourPeriodMicros / 1000)) * 1000;
+    simSchedule(SETTLE_MICROS + phase,
+                [index, neighbourPeriodMicros]() { neighbourTransmit(index, neighbourPeriodMicros); });
+  }
+
+  for (const ScheduledCommand& command : commands) {
+    std::string text = command.text;
+    simSchedule((uint64_t)(command.atSeconds * 1e6), [text]() { Serial.inject(text.c_str()); });
+  }
+
+  for (const ScheduledCommand& command : rxCommands) {
+    std::string text = command.text;
+    simSchedule((uint64_t)(command.atSeconds * 1e6),
+                [text]() { receiver::Serial.inject(text.c_str()); });
+  }
+
+  for (const ScheduledSnr& change : snrChanges) {
+    float snr = change.snr;
+    simSchedule((uint64_t)(change.atSeconds * 1e6), [snr]() { simLinkConfig().snr = snr; });
+  }
+
+  for (const ScheduledTurn& turn : turns) {
+    float rate = turn.degreesPerSecond;
+    simSchedule((uint64_t)(turn.atSeconds * 1e6), [rate]() { simEnvironment().turnRateDps = rate; });
+  }
+
+  // Let both sketches finish setup() before gathering steady-state statistics
+  simRun(SETTLE_MICROS);
+  SimHeapStats heapAtStart = simHeapStats();
+  SimCryptoStats cryptoAtStart = simCryptoStats();
+  SimLinkStats linkAtStart = simLinkStats();
+  SimSketchStats nodeAtStart = simSketchStats("node");
+  uint64_t startMicros = simNowMicros();
+
+  simRun(startMicros + (uint64_t)(seconds * 1e6));
+
+  const SimHeapStats& heap = simHeapStats();
+  const SimCryptoStats& crypto = simCryptoStats();
+  const SimLinkStats& link = simLinkStats();
+  SimSketchStats node = simSketchStats("node");
+  unsigned long loopCalls = node.loops - nodeAtStart.loops;
+  unsigned long packets = link.packetsSent - linkAtStart.packetsSent;
+  unsigned long allocations = heap.allocations - heapAtStart.allocations;
+  unsigned long blocks = crypto.blocksEncrypted - cryptoAtStart.blocksEncrypted;
+  double perPacket = packets ? 1.0 / packets : 0;
+  double elapsedMs = (simNowMicros() - startMicros) / 1e3;
+  double allocsPerPacket = allocations * perPacket;
+  double loopNanos = loopCalls ? (node.cpuNanos - nodeAtStart.cpuNanos) / loopCalls : 0.0;
+
+  printf("\n=== Simulation summary (%.1f s virtual) ===\n", elapsedMs / 1e3);
+  printf("node loop() calls       : %lu\n", loopCalls);
+  printf("host CPU per loop()     : mean %.0f ns, max %.0f ns\n", loopNanos, node.maxLoopNanos);
+  printf("packets sent / delivered: %lu / %lu (lost %lu)\n", packets,
+         link.packetsDelivered - linkAtStart.packetsDelivered,
+         link.packetsLost - linkAtStart.packetsLost);
+  printf("bytes per packet        : %.1f\n", (link.bytesSent - linkAtStart.bytesSent) * perPacket);
+  printf("airtime per packet      : %.1f ms\n", (link.airtimeMs - linkAtStart.airtimeMs) * perPacket);
+  printf("data rate node / rx     : SF%d CR4/%d / SF%d CR4/%d\n", LoRa.getSpreadingFactor(),
+         LoRa.getCodingRate4(), receiver::LoRa.getSpreadingFactor(),
+         receiver::LoRa.getCodingRate4());
+  printf("channel occupancy       : %.1f %%\n", 100.0 * (link.airtimeMs - linkAtStart.airtimeMs) / elapsedMs);
+  printf("AES blocks per packet   : %.1f encrypted\n", blocks * perPacket);
+  printf("heap allocs per packet  : %.1f (live %ld B, peak %ld B)\n", allocsPerPacket,
+         heap.liveBytes, heap.peakBytes);
+  printf("GPS bytes delivered     : %lu (dropped %lu)\n", ss.deliveredBytes(), ss.droppedBytes());
+  printf("serial bytes node / rx  : %lu / %lu\n", Serial.bytesWritten(),
+         receiver::Serial.bytesWritten());
+
+  int status = 0;
+  if (budgetAllocs >= 0 && allocsPerPacket > budgetAllocs) {
+    printf("FAIL: %.1f heap allocations per packet exceeds budget of %.1f\n", allocsPerPacket,
+           budgetAllocs);
+    status = 1;
+  }
+  if (budgetLoopNanos >= 0 && loopNanos > budgetLoopNanos) {
+    printf("FAIL: %.0f ns per loop() exceeds budget of %.0f ns\n", loopNanos, budgetLoopNanos);
+    status = 1;
+  }
+  if (rxCapture) {
+    fclose(rxCapture);
+  }
+  return status;
+}
@@ -0,0 +1,376 @@
+// Simulated Arduino String and Print
+// String mirrors the AVR implementation's allocation pattern (realloc on
+// growth, exact-fit buffers) so the heap counters reflect on-target churn
+
+#include <Arduino.h>
+#include <stdio.h>
+#include "sim.h"
+#include "sim_internal.h"
+
+// === Heap accounting ===
+
+static SimHeapStats heapStats;
+
+SimHeapStats& simHeapStats() {
+  return heapStats;
+}
+
+void simCountHeap(long bytes, bool isFree) {
+  if (isFree) {
+    heapStats.frees++;
+  } else {
+    heapStats.allocations++;
+  }
+  heapStats.liveBytes += bytes;
+  if (heapStats.liveBytes > heapStats.peakBytes) {
+    heapStats.peakBytes = heapStats.liveBytes;
+  }
+}
+
+// === String ===
+
+String::String(const char* cstr) {
+  if (cstr) copy(cstr, strlen(cstr));
+}
+
+String::String(const String& other) {
+  copy(other.c_str(), other.len);
+}
+
+String::String(const __FlashStringHelper* str) {
+  const char* cstr = reinterpret_cast<const char*>(str);
+  if (cstr) copy(cstr, strlen(cstr));
+}
+
+String::String(char c) {
+  char buf[2] = { c, 0 };
+  copy(buf, 1);
+}
+
+static void formatInteger(char* buf, unsigned long value, bool negative, unsigned char base) {
+  char tmp[34];
+  int i = 0;
+  do {
+    int digit = value % base;
+    tmp[i++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  int j = 0;
+  if (negative) buf[j++] = '-';
+  while (i) buf[j++] = tmp[--i];
+  buf[j] = 0;
+}
+
+String::String(unsigned char value, unsigned char base) {
+  char buf[34];
+  formatInteger(buf, value, false, base);
+  copy(buf, strlen(buf));
+}
+
+String::String(int value, unsigned char base) {
+  char buf[34];
+  if (base == 10 && value < 0) {
+    formatInteger(buf, -(long)value, true, base);
+  } else {
+    formatInteger(buf, (unsigned int)value, false, base);
+  }
+  copy(buf, strlen(buf));
+}
+
+String::String(unsigned int value, unsigned char base) {
+  char buf[34];
+  formatInteger(buf, value, false, base);
+  copy(buf, strlen(buf));
+}
+
+String::String(long value, unsigned char base) {
+  char buf[34];
+  if (base == 10 && value < 0) {
+    formatInteger(buf, -(unsigned long)value, true, base);
+  } else {
+    formatInteger(buf, (unsigned long)value, false, base);
+  }
+  copy(buf, strlen(buf));
+}
+
+String::String(unsigned long value, unsigned char base) {
+  char buf[34];
+  formatInteger(buf, value, false, base);
+  copy(buf, strlen(buf));
+}
+
+String::String(float value, unsigned char decimalPlaces) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, (double)value);
+  copy(buf, strlen(buf));
+}
+
+String::String(double value, unsigned char decimalPlaces) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  copy(buf, strlen(buf));
+}
+
+String::~String() {
+  if (buffer) {
+    simCountHeap(-(long)(capacity + 1), true);
+    free(buffer);
+  }
+}
+
+bool String::changeBuffer(unsigned int maxStrLen) {
+  char* newBuffer = (char*)realloc(buffer, maxStrLen + 1);
+  if (!newBuffer) return false;
+  simCountHeap((long)maxStrLen - (buffer ? (long)capacity : -1L), false);
+  buffer = newBuffer;
+  capacity = maxStrLen;
+  return true;
+}
+
+bool String::reserve(unsigned int size) {
+  if (buffer && capacity >= size) return true;
+  if (!changeBuffer(size)) return false;
+  if (len == 0) buffer[0] = 0;
+  return true;
+}
+
+void String::copy(const char* cstr, unsigned int length) {
+  if (!reserve(length)) return;
+  len = length;
+  memcpy(buffer, cstr, length);
+  buffer[length] = 0;
+}
+
+String& String::operator=(const String& rhs) {
+  if (this != &rhs) copy(rhs.c_str(), rhs.len);
+  return *this;
+}
+
+String& String::operator=(const char* cstr) {
+  copy(cstr ? cstr : "", cstr ? strlen(cstr) : 0);
+  return *this;
+}
+
+bool String::concat(const char* cstr, unsigned int length) {
+  unsigned int newLen = len + length;
+  if (length == 0) return true;
+  if (!reserve(newLen)) return false;
+  memmove(buffer + len, cstr, length);
+  len = newLen;
+  buffer[len] = 0;
+  return true;
+}
+
+bool String::concat(const String& str) {
+  return concat(str.c_str(), str.len);
+}
+
+bool String::concat(const char* cstr) {
+  return cstr ? concat(cstr, strlen(cstr)) : false;
+}
+
+bool String::concat(char c) {
+  return concat(&c, 1);
+}
+
+bool String::equals(const String& s) const {
+  return len == s.len && strcmp(c_str(), s.c_str()) == 0;
+}
+
+bool String::equals(const char* cstr) const {
+  return strcmp(c_str(), cstr ? cstr : "") == 0;
+}
+
+bool String::startsWith(const String& prefix) const {
+  return prefix.len <= len && strncmp(c_str(), prefix.c_str(), prefix.len) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return suffix.len <= len && strcmp(c_str() + len - suffix.len, suffix.c_str()) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+  return index < len ? buffer[index] : 0;
+}
+
+char String::operator[](unsigned int index) const {
+  return charAt(index);
+}
+
+char& String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= len) {
+    dummy = 0;
+    return dummy;
+  }
+  return buffer[index];
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  if (fromIndex >= len) return -1;
+  const char* p = strchr(c_str() + fromIndex, ch);
+  return p ? (int)(p - c_str()) : -1;
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+  if (fromIndex >= len) return -1;
+  const char* p = strstr(c_str() + fromIndex, str.c_str());
+  return p ? (int)(p - c_str()) : -1;
+}
+
+String String::substring(unsigned int beginIndex) const {
+  return substring(beginIndex, len);
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (beginIndex > endIndex) {
+    unsigned int tmp = endIndex;
+    endIndex = beginIndex;
+    beginIndex = tmp;
+  }
+  String out;
+  if (beginIndex >= len) return out;
+  if (endIndex > len) endIndex = len;
+  out.copy(c_str() + beginIndex, endIndex - beginIndex);
+  return out;
+}
+
+void String::toUpperCase() {
+  for (unsigned int i = 0; i < len; i++) buffer[i] = toupper((unsigned char)buffer[i]);
+}
+
+void String::trim() {
+  if (!buffer || len == 0) return;
+  unsigned int begin = 0;
+  while (begin < len && isspace((unsigned char)buffer[begin])) begin++;
+  unsigned int end = len;
+  while (end > begin && isspace((unsigned char)buffer[end - 1])) end--;
+  len = end - begin;
+  memmove(buffer, buffer + begin, len);
+  buffer[len] = 0;
+}
+
+long String::toInt() const {
+  return atol(c_str());
+}
+
+float String::toFloat() const {
+  return (float)atof(c_str());
+}
+
+String operator+(const String& lhs, const String& rhs) {
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const String& lhs, const char* rhs) {
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const char* lhs, const String& rhs) {
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const String& lhs, char rhs) {
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+// === Print ===
+
+size_t Print::strlen_(const char* s) {
+  return strlen(s);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper* str) {
+  return write(reinterpret_cast<const char*>(str));
+}
+
+size_t Print::print(const String& str) {
+  return write(str.c_str(), str.length());
+}
+
+size_t Print::print(const char* str) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base) {
+  return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+  if (base == 0) return write((uint8_t)value);
+  if (base == 10 && value < 0) {
+    return print('-') + printNumber(-(unsigned long)value, 10);
+  }
+  return printNumber((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  if (base == 0) return write((uint8_t)value);
+  return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits) {
+  return printFloat(value, digits);
+}
+
+size_t Print::println() {
+  return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper* str) { return print(str) + println(); }
+size_t Print::println(const String& str) { return print(str) + println(); }
+size_t Print::println(const char* str) { return print(str) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char value, int base) { return print(value, base) + println(); }
+size_t Print::println(int value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned int value, int base) { return print(value, base) + println(); }
+size_t Print::println(long value, int base) { return print(value, base) + println(); }
+size_t Print::println(unsigned long value, int base) { return print(value, base) + println(); }
+size_t Print::println(double value, int digits) { return print(value, digits) + println(); }
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char* str = &buf[sizeof(buf) - 1];
+  *str = 0;
+  if (base < 2) base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits) {
+  if (isnan(number)) return print("nan");
+  if (isinf(number)) return print("inf");
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, number);
+  return write(buf);
+}
@@ -0,0 +1,211 @@
+// Known-answer test for the packet sealing (arduino/ccm.h)
+// Node and receiver each carry their own AES-CCM code, and they only
+// interoperate while both agree with the standard. This test checks the
+// node's streaming ccmBegin()/ccmEncrypt()/ccmFinish() and the receiver
+// sketch's ccmCrypt() against:
+//   - the FIPS-197 appendix C.1 AES-128 block, for the host AES
+//   - CCM vectors with the link's parameters (M = 4, L = 2, no associated
+//     data, nonce = direction, node id, counter LE, zeros) produced by
+//     OpenSSL's EVP_aes_128_ccm, which reproduces RFC 3610 packet vector
+//     #1 for that RFC's parameters
+// Each vector is sealed and opened by both implementations, and a packet
+// with one flipped ciphertext bit must fail the MIC check
+// A change to the nonce layout, MIC length or chunking that breaks
+// interoperability fails here instead of on air
+//
+// Usage: mizuguna_ccm_test
+// Exit status 1 on any mismatch
+
+#include <SPI.h>
+#include <LoRa.h>
+#include <Crypto.h>
+#include <AES.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <stdio.h>
+#include <string.h>
+#include "../../arduino/ccm.h"
+
+namespace receiver {
+
+HardwareSerial Serial("rx");
+LoRaClass LoRa;
+
+#include "../../LoRaReceiver_encrypted/LoRaReceiver_encrypted.ino"
+
+}  // namespace receiver
+
+struct CcmVector {
+  uint8_t key[16];
+  uint8_t direction;
+  uint8_t node;
+  uint32_t counter;
+  uint8_t length;
+  uint8_t plaintext[64];
+  uint8_t ciphertext[64];
+  uint8_t mic[CCM_MIC_SIZE];
+};
+
+static const CcmVector VECTORS[] = {
+  // Telemetry frame uplink under the factory key
+  { { 's','e','c','r','e','t','k','e','y','1','2','3','4','5','6','7' },
+    CCM_UPLINK, 0x01, 0x00000001, 12,
+    { 0x01, 0x92, 0x09, 0xff, 0x02, 0x64, 0x06, 0xc7, 0x00, 0x00, 0x0c, 0x00 },
+    { 0xcf, 0x5b, 0xf6, 0xe1, 0xbd, 0xc6, 0x47, 0x55, 0x1b, 0x15, 0x89, 0x3a },
+    { 0x9a, 0xbf, 0x71, 0x7c } },
+  // Link hint answering it
+  { { 's','e','c','r','e','t','k','e','y','1','2','3','4','5','6','7' },
+    CCM_DOWNLINK, 0x01, 0x00000001, 5,
+    { 0x10, 0x1e, 0x11, 0x07, 0x05 },
+    { 0x6f, 0x1c, 0x2a, 0x0e, 0x16 },
+    { 0xca, 0xfe, 0xf7, 0xea } },
+  // One byte, highest node id and counter
+  { { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+    CCM_UPLINK, 0xfe, 0xffffffff, 1,
+    { 0x03 },
+    { 0x50 },
+    { 0xfe, 0x0e, 0xe3, 0xd6 } },
+  // Exactly one block
+  { { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+    CCM_UPLINK, 0x2a, 0x00010203, 16,
+    { 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c },
+    { 0x47, 0x7c, 0xec, 0xf7, 0xac, 0x27, 0xaf, 0xa7, 0x4e, 0xd8, 0x2f, 0xca, 0xe6, 0xb8, 0x91, 0xc6 },
+    { 0x7a, 0x60, 0xf6, 0x94 } },
+  // One block and a byte, downlink direction with the same counter
+  { { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+    CCM_DOWNLINK, 0x2a, 0x00010203, 17,
+    { 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c,
+      0x73 },
+    { 0xa3, 0xf1, 0x3f, 0xf6, 0x2c, 0x80, 0x2d, 0x5b, 0x47, 0xed, 0xf4, 0xb5, 0x4f, 0x10, 0xcd, 0xce,
+      0x40 },
+    { 0xb4, 0x3d, 0x58, 0xff } },
+  // Config frame length, three chunks
+  { { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+    CCM_UPLINK, 0x80, 0x89abcdef, 35,
+    { 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c,
+      0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc,
+      0xe3, 0xea, 0xf1 },
+    { 0x09, 0x80, 0xf9, 0x7e, 0xca, 0xf7, 0x64, 0x2e, 0x5d, 0x9b, 0x36, 0x90, 0xf1, 0xab, 0x22, 0x8b,
+      0x99, 0xe3, 0x9b, 0xfc, 0x6f, 0x76, 0x63, 0x42, 0x86, 0x2f, 0xa2, 0x92, 0x85, 0x05, 0x6e, 0x41,
+      0x1b, 0xa1, 0x8e },
+    { 0xf8, 0x5b, 0xef, 0xf3 } },
+  // Four full blocks
+  { { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f },
+    CCM_UPLINK, 0x01, 0x00000100, 64,
+    { 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c,
+      0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc,
+      0xe3, 0xea, 0xf1, 0xf8, 0xff, 0x06, 0x0d, 0x14, 0x1b, 0x22, 0x29, 0x30, 0x37, 0x3e, 0x45, 0x4c,
+      0x53, 0x5a, 0x61, 0x68, 0x6f, 0x76, 0x7d, 0x84, 0x8b, 0x92, 0x99, 0xa0, 0xa7, 0xae, 0xb5, 0xbc },
+    { 0x93, 0x68, 0xaf, 0x32, 0x43, 0xdc, 0xb5, 0x64, 0xb7, 0x08, 0x7f, 0x0b, 0x49, 0xa7, 0x16, 0xab,
+      0x24, 0xab, 0x03, 0x74, 0xd4, 0xe5, 0x47, 0x9c, 0xee, 0x08, 0x70, 0x4b, 0x0f, 0x74, 0x10, 0x26,
+      0xda, 0xb7, 0x8e, 0x41, 0xf1, 0x23, 0x1a, 0x5d, 0xe2, 0xa5, 0xd4, 0xe0, 0x60, 0xe1, 0x92, 0xa4,
+      0x14, 0xdb, 0x07, 0x64, 0x7a, 0xe8, 0xd8, 0x91, 0x73, 0xfd, 0x62, 0xb0, 0x4d, 0x39, 0xa0, 0xba },
+    { 0xea, 0xf4, 0x43, 0x3a } },
+};
+static const int VECTOR_COUNT = sizeof(VECTORS) / sizeof(VECTORS[0]);
+
+static int failures = 0;
+
+// Compare two byte strings, reporting a mismatch
+static void expect(const char* what, int vector, const uint8_t* got, const uint8_t* want,
+                   size_t len) {
+  if (memcmp(got, want, len) == 0) {
+    return;
+  }
+  printf("vector %d: %s mismatch\n", vector, what);
+  failures++;
+}
+
+// Seal or open with the node's streaming code, 16-byte chunks as
+// sendFrame() and pollDownlink() use them
+static void nodeCrypt(AES128& cipher, const CcmVector& v, uint8_t* data, uint8_t* mic,
+                      bool decrypt) {
+  CcmContext ccm;
+  ccmBegin(ccm, cipher, v.direction, v.node, v.counter, v.length);
+  for (uint8_t offset = 0; offset < v.length; offset += 16) {
+    uint8_t n = v.length - offset < 16 ? v.length - offset : 16;
+    if (decrypt) {
+      ccmDecrypt(ccm, data + offset, n);
+    } else {
+      ccmEncrypt(ccm, data + offset, n);
+    }
+  }
+  ccmFinish(ccm, mic);
+}
+
+// FIPS-197 appendix C.1
+static void testAes() {
+  static const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                   0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+  static const uint8_t plaintext[16] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                         0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+  static const uint8_t ciphertext[16] = { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+                                          0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+  AES128 cipher;
+  cipher.setKey(key, sizeof(key));
+  uint8_t block[16];
+  cipher.encryptBlock(block, plaintext);
+  expect("AES-128 block", -1, block, ciphertext, sizeof(block));
+}
+
+static void testVector(int index) {
+  const CcmVector& v = VECTORS[index];
+  uint8_t data[64];
+  uint8_t mic[CCM_MIC_SIZE];
+
+  AES128 cipher;
+  cipher.setKey(v.key, sizeof(v.key));
+
+  memcpy(data, v.plaintext, v.length);
+  nodeCrypt(cipher, v, data, mic, false);
+  expect("node ciphertext", index, data, v.ciphertext, v.length);
+  expect("node seal MIC", index, mic, v.mic, sizeof(mic));
+
+  nodeCrypt(cipher, v, data, mic, true);
+  expect("node plaintext", index, data, v.plaintext, v.length);
+  expect("node open MIC", index, mic, v.mic, sizeof(mic));
+  if (!ccmVerify(mic, v.mic)) {
+    printf("vector %d: node rejected an authentic packet\n", index);
+    failures++;
+  }
+
+  receiver::aes.setKey(v.key, sizeof(v.key));
+  memcpy(data, v.plaintext, v.length);
+  receiver::ccmCrypt(v.direction, v.node, v.counter, data, v.length, mic, false);
+  expect("receiver ciphertext", index, data, v.ciphertext, v.length);
+  expect("receiver seal MIC", index, mic, v.mic, sizeof(mic));
+
+  receiver::ccmCrypt(v.direction, v.node, v.counter, data, v.length, mic, true);
+  expect("receiver plaintext", index, data, v.plaintext, v.length);
+  expect("receiver open MIC", index, mic, v.mic, sizeof(mic));
+  if (!receiver::micMatches(mic, v.mic)) {
+    printf("vector %d: receiver rejected an authentic packet\n", index);
+    failures++;
+  }
+
+  // Any flipped bit must fail the MIC check on both sides
+  memcpy(data, v.ciphertext, v.length);
+  data[v.length - 1] ^= 0x01;
+  nodeCrypt(cipher, v, data, mic, true);
+  if (ccmVerify(mic, v.mic)) {
+    printf("vector %d: node accepted a tampered packet\n", index);
+    failures++;
+  }
+  memcpy(data, v.ciphertext, v.length);
+  data[0] ^= 0x80;
+  receiver::ccmCrypt(v.direction, v.node, v.counter, data, v.length, mic, true);
+  if (receiver::micMatches(mic, v.mic)) {
+    printf("vector %d: receiver accepted a tampered packet\n", index);
+    failures++;
+  }
+}
+
+int main() {
+  testAes();
+  for (int i = 0; i < VECTOR_COUNT; i++) {
+    testVector(i);
+  }
+
+  printf("%d CCM vectors, %d failures\n", VECTOR_COUNT, failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+// Accuracy test for the integer conversion kernels (arduino/conversion.h)
+// Compares phFromAdc() and tdsFromAdc() with the float formulas they
+// replaced at every oversampled ADC code, and atan2Centidegrees() with
+// atan2() over a grid of angles and vector lengths, and fails if any
+// error exceeds the worst case the kernels are documented to hold:
+//   pH       0.006 pH: rounding to hundredths plus the Q16 slope
+//   TDS      1/TDS_TABLE_SCALE ppm: half a step from rounding the table
+//            entries, half from rounding the interpolated fraction
+//   heading  0.015 degree: the 33-entry arctangent table
+//
+// Usage: mizuguna_conversion_test
+// Prints the worst error of each kernel; exit status 1 on failure
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include "../../arduino/constants.h"
+#include "../../arduino/conversion.h"
+
+static const double PH_MAX_ERROR = 0.006;                   // pH
+static const double TDS_MAX_ERROR = 1.0 / TDS_TABLE_SCALE;  // ppm
+static const double HEADING_MAX_ERROR = 0.015;              // Degrees
+
+// Oversampled codes cover 0..ADC_MAX with ANALOG_OVERSAMPLE_BITS fraction bits
+static const unsigned CODE_STEPS = 1u << ANALOG_OVERSAMPLE_BITS;
+static const unsigned MAX_CODE = (unsigned)ADC_MAX * CODE_STEPS;
+
+// Float formulas the kernels replaced, taking the ADC reading in counts
+static double phFormula(double raw) {
+  double voltage = raw * ADC_REFERENCE_VOLTAGE / ADC_MAX;
+  return 7.0 + (PH_NEUTRAL_VOLTAGE - voltage) / PH_VOLTS_PER_UNIT;
+}
+
+static double tdsFormula(double raw) {
+  double v = raw * ADC_REFERENCE_VOLTAGE / ADC_MAX;
+  double ppm = (TDS_COEFF_CUBIC * v * v * v + TDS_COEFF_SQUARE * v * v + TDS_COEFF_LINEAR * v) *
+               TDS_FACTOR;
+  return ppm > 0 ? ppm : 0;
+}
+
+// Report one kernel's worst error; returns false if it is over the limit
+static bool check(const char* name, double worst, double worstAt, double limit,
+                  const char* unit) {
+  bool pass = worst <= limit;
+  printf("%-8s worst error %.4f %s at %g (limit %.4f) %s\n", name, worst, unit, worstAt, limit,
+         pass ? "ok" : "FAIL");
+  return pass;
+}
+
+static bool testPH() {
+  double worst = 0, worstAt = 0;
+  for (unsigned code = 0; code <= MAX_CODE; code++) {
+    double error = fabs(phFromAdc(code) / 100.0 - phFormula((double)code / CODE_STEPS));
+    if (error > worst) {
+      worst = error;
+      worstAt = code;
+    }
+  }
+  return check("pH", worst, worstAt, PH_MAX_ERROR, "pH");
+}
+
+static bool testTDS() {
+  double worst = 0, worstAt = 0;
+  for (unsigned code = 0; code <= MAX_CODE; code++) {
+    double error =
+        fabs((double)tdsFromAdc(code) / TDS_TABLE_SCALE - tdsFormula((double)code / CODE_STEPS));
+    if (error > worst) {
+      worst = error;
+      worstAt = code;
+    }
+  }
+  return check("TDS", worst, worstAt, TDS_MAX_ERROR, "ppm");
+}
+
+// Every 0.01 degree of a full circle at several vector lengths, from
+// a few counts up to the int16 range, against atan2() of the same
+// rounded components
+static bool testHeading() {
+  static const double lengths[] = { 64, 512, MAG_NORM_SCALE, 3 * MAG_NORM_SCALE, 32000 };
+  double worst = 0, worstAt = 0;
+  for (double length : lengths) {
+    for (long centidegrees = -18000; centidegrees < 18000; centidegrees++) {
+      double radians = centidegrees * M_PI / 18000.0;
+      int16_t x = (int16_t)lround(length * cos(radians));
+      int16_t y = (int16_t)lround(length * sin(radians));
+      if (x == 0 && y == 0) continue;
+
+      double expected = atan2((double)y, (double)x) * 180.0 / M_PI;
+      double error = fabs(atan2Centidegrees(y, x) / 100.0 - expected);
+      if (error > 180) error = 360 - error;   // -180 and 180 are the same heading
+      if (error > worst) {
+        worst = error;
+        worstAt = centidegrees / 100.0;
+      }
+    }
+  }
+
+  bool pass = check("heading", worst, worstAt, HEADING_MAX_ERROR, "degree");
+  if (atan2Centidegrees(0, 0) != 0) {
+    printf("heading  atan2(0, 0) is %d, expected 0 FAIL\n", atan2Centidegrees(0, 0));
+    pass = false;
+  }
+  return pass;
+}
+
+int main() {
+  bool pass = testPH();
+  pass = testTDS() && pass;
+  pass = testHeading() && pass;
+  return pass ? 0 : 1;
+}